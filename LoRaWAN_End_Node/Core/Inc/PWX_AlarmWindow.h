@@ -0,0 +1,73 @@
+/**
+ * @file PWX_AlarmWindow.h
+ * @brief Class C Alarm Window Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_ALARMWINDOW_H_
+#define INC_PWX_ALARMWINDOW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defaults, changed at run time with ALARM_WINDOW_CONFIG_ID on LORAWAN_SWITCH_CLASS_PORT */
+#define ALARM_WINDOW_DEFAULT_S          120
+#define ALARM_WINDOW_DEFAULT_BUDGET_MAS 3600    // receive charge per day, 1 mAh
+#define ALARM_WINDOW_MAX_S              3600
+
+/* Windows that the budget left cannot keep open this long are not opened */
+#define ALARM_WINDOW_MIN_MS             10000
+
+/* Radio in continuous receive, the MCU sleeping in STOP2 in between */
+#define ALARM_WINDOW_RX_UA              5500
+
+/* The budget refills at a steady rate, a full budget per period */
+#define ALARM_WINDOW_BUDGET_PERIOD_S    86400U
+
+/**
+ * @brief Clears the counters, restores the defaults and fills the budget.
+ */
+void initAlarmWindow(void);
+
+/**
+ * @brief Asks for a window once the alarm uplink just queued is sent. Ignored while a window is open.
+ */
+void armAlarmWindow(void);
+
+/**
+ * @brief Drops the pending request, e.g. when the device is already in Class C.
+ */
+void disarmAlarmWindow(void);
+
+bool isAlarmWindowArmed(void);
+
+bool isAlarmWindowOpen(void);
+
+/**
+ * @brief Opens the armed window, as long as the configured time or the budget left allows.
+ *
+ * @return Window length in ms, 0 if the budget is exhausted or the window disabled.
+ */
+uint32_t openAlarmWindow(void);
+
+/**
+ * @brief Closes the window and charges the time it was open to the budget.
+ */
+void closeAlarmWindow(void);
+
+/**
+ * @brief Sets the window length and the daily budget, 0 for either disables the window.
+ *
+ * @param windowSeconds Window length, ALARM_WINDOW_MAX_S at most.
+ * @param budgetMas Receive charge allowed per ALARM_WINDOW_BUDGET_PERIOD_S, in mAs.
+ * @return false if out of range, nothing changed.
+ */
+bool setAlarmWindowConfig(uint16_t windowSeconds, uint16_t budgetMas);
+
+/**
+ * @brief Logs the windows opened, their total time and charge, and the budget left.
+ */
+void printAlarmWindow(void);
+
+#endif /* INC_PWX_ALARMWINDOW_H_ */
@@ -0,0 +1,76 @@
+/**
+ * @file PWX_ClockPolicy.h
+ * @brief Dynamic System Clock Policy Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_CLOCKPOLICY_H_
+#define INC_PWX_CLOCKPOLICY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Largest USART1 baud rate error accepted at a level, in ppm of the nominal rate */
+#define CLOCK_POLICY_MAX_BAUD_ERR_PPM   10000   // 1 %, half of what 8 data bits + parity tolerate
+
+/**
+ * @enum ClockLevel_t
+ * @brief Performance levels, SYSCLK from MSI with AHB and APB undivided.
+ */
+typedef enum {
+    CLOCK_LEVEL_LOW = 0,        // MSI range 6, 4 MHz, 0 wait states: waiting on slow peripherals
+    CLOCK_LEVEL_MEDIUM,         // MSI range 8, 16 MHz, 0 wait states
+    CLOCK_LEVEL_HIGH,           // MSI range 11, 48 MHz, 2 wait states: boot default, LoRaWAN stack and crypto
+    CLOCK_LEVEL_NUM,
+} ClockLevel_t;
+
+/**
+ * @enum ClockUser_t
+ * @brief Tasks that may ask for a level, one vote each.
+ */
+typedef enum {
+    CLOCK_USER_MODBUS = 0,
+    CLOCK_USER_SENSOR_RAIL,
+    CLOCK_USER_NUM,
+} ClockUser_t;
+
+/**
+ * @brief Clears every vote and the per-level residency, the clock stays at CLOCK_LEVEL_HIGH.
+ */
+void initClockPolicy(void);
+
+/**
+ * @brief Sets the level a task needs until it releases it, then applies the policy.
+ *
+ * The clock runs at the highest level voted, at CLOCK_LEVEL_HIGH when no
+ * task votes or while the LoRaWAN MAC is busy, and never below the lowest
+ * level that keeps USART1 within CLOCK_POLICY_MAX_BAUD_ERR_PPM. Only call
+ * from the main loop, with no USART1 transmission in progress.
+ *
+ * @param user Requesting task.
+ * @param level Level needed.
+ */
+void requestClockLevel(ClockUser_t user, ClockLevel_t level);
+
+/**
+ * @brief Withdraws the vote of a task, then applies the policy.
+ */
+void releaseClockLevel(ClockUser_t user);
+
+/**
+ * @brief Level the clock runs at.
+ */
+ClockLevel_t getClockLevel(void);
+
+/**
+ * @brief Time spent at a level since boot, in ms.
+ */
+uint32_t getClockResidencyMs(ClockLevel_t level);
+
+/**
+ * @brief Logs the residency per level and the number of switches.
+ */
+void printClockPolicy(void);
+
+#endif /* INC_PWX_CLOCKPOLICY_H_ */
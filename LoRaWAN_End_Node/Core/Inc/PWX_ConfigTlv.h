@@ -0,0 +1,150 @@
+/**
+ * @file PWX_ConfigTlv.h
+ * @brief Atomic TLV Configuration Downlink Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_CONFIGTLV_H_
+#define INC_PWX_CONFIGTLV_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "secure-element-nvm.h"
+
+/*
+ * Downlink: [txn id u8] followed by TLVs, each [tag u8][length u8][value].
+ * Multi-byte values are big endian.
+ */
+#define CONFIG_TLV_TX_INTERVAL          0x01    // u32 seconds
+#define CONFIG_TLV_CNF_UPLINK_COUNT     0x02    // u16 uplinks between link evidence requests
+#define CONFIG_TLV_THRESHOLD_HIGH       0x03    // u16
+#define CONFIG_TLV_THRESHOLD_LOW        0x04    // u16
+#define CONFIG_TLV_SAMPLING_COUNT       0x05    // u16
+#define CONFIG_TLV_SAMPLING_METHOD      0x06    // u8
+#define CONFIG_TLV_MEASUREMENT_METHOD   0x07    // u8
+#define CONFIG_TLV_HEARTBEAT_INTERVAL   0x08    // u32 seconds
+#define CONFIG_TLV_MODBUS_DEVICE        0x10    // [dev][baud][parity][stop bits][active]
+#define CONFIG_TLV_MODBUS_SEGMENT       0x11    // [dev][seg][enable][send now][valid addresses u64][cmd 1..32]
+
+/* Limits of the staged update */
+#define CONFIG_TLV_MAX_DEVICE_EDITS     4
+#define CONFIG_TLV_MAX_SEGMENT_EDITS    4
+#define CONFIG_TLV_SEGMENT_HEADER_SIZE  12
+#define CONFIG_TLV_MAX_CMD_SIZE         32
+
+/* Accepted ranges */
+#define CONFIG_TLV_MIN_INTERVAL_S       60
+#define CONFIG_TLV_MAX_INTERVAL_S       86400
+#define CONFIG_TLV_MAX_CNF_UPLINK_COUNT 1000
+#define CONFIG_TLV_MAX_THRESHOLD        254     // same bound the boot load applies
+#define CONFIG_TLV_MAX_SAMPLING_COUNT   100
+
+/* Acknowledgement: [txn id][status][failed TLV index][config hash u32] */
+#define CONFIG_TLV_ACK_SIZE             7
+#define CONFIG_TLV_NO_INDEX             0xFF
+
+/**
+ * @enum ConfigTlvStatus_t
+ * @brief Outcome of a TLV configuration downlink, sent back in the acknowledgement.
+ */
+typedef enum {
+    CONFIG_TLV_OK = 0,
+    CONFIG_TLV_ERR_TRUNCATED,       // TLV runs past the end of the payload
+    CONFIG_TLV_ERR_UNKNOWN_TAG,
+    CONFIG_TLV_ERR_LENGTH,          // length does not match the tag
+    CONFIG_TLV_ERR_RANGE,           // value out of range or inconsistent
+    CONFIG_TLV_ERR_DUPLICATE,       // same parameter given twice
+    CONFIG_TLV_ERR_TOO_MANY,        // more Modbus edits than can be staged
+    CONFIG_TLV_ERR_FLASH,           // validated, but a flash commit failed
+} ConfigTlvStatus_t;
+
+typedef struct {
+    uint8_t device;                 // 1..NUM_DEVICES
+    uint8_t baudrate;
+    uint8_t parity;
+    uint8_t stopBits;
+    uint8_t active;
+} ConfigTlvDeviceEdit_t;
+
+typedef struct {
+    uint8_t  device;                // 1..NUM_DEVICES
+    uint8_t  segment;               // 1..NUM_DEV_SEGMENTS
+    uint8_t  enable;
+    uint8_t  sendNow;
+    uint64_t validAddresses;        // bit n for register n, as in struct Segment
+    uint8_t  cmdSize;
+    uint8_t  cmdRaw[CONFIG_TLV_MAX_CMD_SIZE];
+} ConfigTlvSegmentEdit_t;
+
+/**
+ * @struct ConfigTlvUpdate_t
+ * @brief Every change of one downlink, staged before anything is written.
+ */
+typedef struct {
+    uint8_t  txnId;
+    uint16_t present;               // bit (1 << tag) per pwx* parameter given
+    uint32_t txIntervalSeconds;
+    uint16_t cnfUplinkCount;
+    uint16_t thresholdHigh;
+    uint16_t thresholdLow;
+    uint16_t samplingCount;
+    uint8_t  samplingMethod;
+    uint8_t  measurementMethod;
+    uint32_t heartbeatSeconds;
+    uint8_t  numDeviceEdits;
+    ConfigTlvDeviceEdit_t deviceEdits[CONFIG_TLV_MAX_DEVICE_EDITS];
+    uint8_t  numSegmentEdits;
+    ConfigTlvSegmentEdit_t segmentEdits[CONFIG_TLV_MAX_SEGMENT_EDITS];
+    uint8_t  failedIndex;           // index of the rejected TLV, CONFIG_TLV_NO_INDEX if none
+} ConfigTlvUpdate_t;
+
+/**
+ * @brief Checks if a pwx* parameter is part of the update.
+ */
+static inline bool hasConfigTlv(const ConfigTlvUpdate_t *update, uint8_t tag) {
+    return (update->present & (1U << tag)) != 0;
+}
+
+/**
+ * @brief Parses and validates a TLV configuration payload. Nothing is applied.
+ *
+ * @param payload Downlink payload, starting with the transaction ID.
+ * @param size Payload size in bytes.
+ * @param update Staged update to fill.
+ * @return CONFIG_TLV_OK if every TLV is valid, otherwise the first error,
+ *         with update->failedIndex set to the offending TLV.
+ */
+ConfigTlvStatus_t parseConfigTlv(const uint8_t *payload, size_t size, ConfigTlvUpdate_t *update);
+
+/**
+ * @brief Applies a parsed update to flash.
+ *
+ * The pwx* parameters are merged into the config page and checked against
+ * the values they are not replacing before anything is written. Each touched
+ * Modbus device page and the config page are then written once.
+ *
+ * @param update Update returned by parseConfigTlv().
+ * @param nvm Receives the resulting config page image.
+ * @return CONFIG_TLV_OK, CONFIG_TLV_ERR_RANGE if the merged config is
+ *         inconsistent (nothing written), or CONFIG_TLV_ERR_FLASH.
+ */
+ConfigTlvStatus_t commitConfigTlv(ConfigTlvUpdate_t *update, SecureElementNvmData_t *nvm);
+
+/**
+ * @brief CRC32 over a canonical big-endian encoding of the pwx* parameters
+ *        and of the enabled Modbus devices and segments in flash.
+ */
+uint32_t getConfigHash(const SecureElementNvmData_t *nvm);
+
+/**
+ * @brief Builds the acknowledgement payload.
+ *
+ * @return Number of bytes written, CONFIG_TLV_ACK_SIZE or 0 if maxSize is too small.
+ */
+size_t buildConfigTlvAck(const ConfigTlvUpdate_t *update, ConfigTlvStatus_t status, uint32_t hash,
+                         uint8_t *destination, size_t maxSize);
+
+#endif /* INC_PWX_CONFIGTLV_H_ */
@@ -0,0 +1,77 @@
+/**
+ * @file PWX_DeviceTable.h
+ * @brief Bulk Modbus Device Table Download Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_DEVICETABLE_H_
+#define INC_PWX_DEVICETABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "LmhpDeviceTable.h"
+
+/*
+ * Complete Modbus device table, sent as one data block through the
+ * LmhpDeviceTable package on DEVICE_TABLE_PORT. Multi-byte values are big
+ * endian, devices and segments in ascending order:
+ *   [format u8][device count u8]
+ *   per device:  [dev 1..16][baud][parity][stop bits][flags][segment count]
+ *   per segment: [seg 1..16][flags][valid addresses u64][cmd size 1..32][cmd]
+ * Devices left out are deactivated, segments left out of a listed device are cleared.
+ */
+#define DEVICE_TABLE_FORMAT             0x01
+#define DEVICE_TABLE_HEADER_SIZE        2
+#define DEVICE_TABLE_DEVICE_SIZE        6
+#define DEVICE_TABLE_SEGMENT_SIZE       11      // without the command
+#define DEVICE_TABLE_MAX_CMD_SIZE       32
+
+#define DEVICE_TABLE_DEVICE_ACTIVE      0x01
+#define DEVICE_TABLE_DEVICE_CRC_CHECK   0x02
+#define DEVICE_TABLE_DEVICE_STANDARD    0x04
+#define DEVICE_TABLE_SEGMENT_ENABLE     0x01
+#define DEVICE_TABLE_SEGMENT_SEND_NOW   0x02
+
+/*
+ * Reassembly buffer, every segment of every device with 8-byte commands takes 4962 bytes.
+ * The download keeps its RAM for good, in .bss of RAM1 (32 KB), about 8.3 KB in all:
+ *   _block (this module)          5120
+ *   Rows (LmhpDeviceTable)        2048    128 x 128 bit parity rows
+ *   _device (this module)          976    sizeof(struct ModbusDevice)
+ *   Payload (LmhpDeviceTable)      240
+ *   KnownBits, RowBits, Row         48
+ *   _deviceOffsets                  32
+ * Check these symbols in the .map file after a change to the sizes.
+ */
+#define DEVICE_TABLE_BLOCK_SIZE         5120
+
+/**
+ * @enum DeviceTableResult_t
+ * @brief Outcome of a received table, sent back as the application status of the DataBlockInd.
+ */
+typedef enum {
+    DEVICE_TABLE_APPLIED = 0,
+    DEVICE_TABLE_ERR_FORMAT,        // unknown format
+    DEVICE_TABLE_ERR_LENGTH,        // records run past the block, or bytes left after them
+    DEVICE_TABLE_ERR_RANGE,         // device, segment or setting out of range
+    DEVICE_TABLE_ERR_ORDER,         // devices or segments not in ascending order
+    DEVICE_TABLE_ERR_FLASH,         // validated, but a page write failed
+} DeviceTableResult_t;
+
+/* Parameters handed to the package by LmhpPackagesRegistrationInit() */
+extern LmhpDeviceTableParams_t DeviceTableParams;
+
+/**
+ * @brief Validates a complete table, then writes every device page that changes, once.
+ *
+ * Nothing is written unless the whole block is valid.
+ *
+ * @param block Reassembled table.
+ * @param size Table size in bytes.
+ * @return DEVICE_TABLE_APPLIED or the first error found.
+ */
+DeviceTableResult_t applyDeviceTable(const uint8_t *block, size_t size);
+
+#endif /* INC_PWX_DEVICETABLE_H_ */
@@ -0,0 +1,108 @@
+/**
+ * @file PWX_HistoryLog.h
+ * @brief Flash Ring History Log Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_HISTORYLOG_H_
+#define INC_PWX_HISTORYLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * History log area: spare pages right below the Modbus device pages
+ * (MODBUS_DEVICE_BASE_ADDRESS_16 = 0x08035000).
+ */
+#define HISTORY_LOG_BASE_ADDRESS     ((void *)0x08031000UL)
+#define HISTORY_LOG_NUM_PAGES        8
+#define HISTORY_LOG_PAGE_SIZE        0x800UL
+#define HISTORY_LOG_RECORD_SIZE      32
+#define HISTORY_LOG_SLOTS_PER_PAGE   (HISTORY_LOG_PAGE_SIZE / HISTORY_LOG_RECORD_SIZE)
+#define HISTORY_LOG_TOTAL_SLOTS      (HISTORY_LOG_SLOTS_PER_PAGE * HISTORY_LOG_NUM_PAGES)
+
+#define HISTORY_SEQ_NONE             0xFFFFFFFFUL
+
+/* Size of one record in a backfill uplink: timestamp + 5 x u16 values */
+#define HISTORY_BACKFILL_HEADER_SIZE 4
+#define HISTORY_BACKFILL_RECORD_SIZE 14
+
+/**
+ * @struct HistoryRecord_t
+ * @brief One 32-byte history entry, written with a single flash program pass.
+ *
+ * Level values are in cm x100 and LTC values are raw x100, same as the
+ * scheduled uplink payload.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t timestamp;          // getSyncedSeconds()
+    uint16_t waterLevelLatest;
+    uint16_t waterLevel;
+    uint16_t waterLevelMin;
+    uint16_t waterLevelMax;
+    uint16_t vbat;
+    uint16_t vin;
+    uint16_t vsys;
+    uint16_t ibat;
+    uint16_t iin;
+    uint16_t systemStatus;
+    uint8_t  transmissionType;
+    uint8_t  reserved;
+    uint16_t crc;
+} HistoryRecord_t;
+
+/**
+ * @brief Scans the log area and restores the write head and sequence counters.
+ *
+ * Torn or corrupted slots (bad CRC) are ignored and skipped over.
+ */
+void initHistoryLog(void);
+
+/**
+ * @brief Appends a record to the ring, erasing the oldest page on wrap-around.
+ *
+ * The sequence number, timestamp and CRC are filled in by this function.
+ *
+ * @param record Pointer to the record to append.
+ * @return true if the record was written and verified.
+ */
+bool appendHistoryRecord(HistoryRecord_t *record);
+
+/**
+ * @brief Reads the record with the given sequence number.
+ *
+ * @param seq Sequence number to look up.
+ * @param record Output record.
+ * @return true if a valid record with this sequence number exists.
+ */
+bool readHistoryRecord(uint32_t seq, HistoryRecord_t *record);
+
+/**
+ * @brief Returns the oldest sequence number still held in flash, or HISTORY_SEQ_NONE.
+ */
+uint32_t getHistoryOldestSeq(void);
+
+/**
+ * @brief Returns the sequence number the next appended record will get.
+ */
+uint32_t getHistoryNextSeq(void);
+
+/**
+ * @brief Packs consecutive records starting at *nextSeq into a backfill uplink.
+ *
+ * Layout: first sequence number (u32, big-endian) followed by
+ * HISTORY_BACKFILL_RECORD_SIZE bytes per record. Packing stops at the first
+ * gap in the sequence so receivers can rebuild sequence numbers by position.
+ *
+ * @param nextSeq In: first sequence to send. Out: first sequence not yet sent.
+ * @param lastSeq Last sequence of the requested range (inclusive).
+ * @param destination Output buffer.
+ * @param maxSize Maximum number of bytes that may be written.
+ * @return Number of bytes written, 0 if nothing could be packed.
+ */
+size_t buildHistoryBackfill(uint32_t *nextSeq, uint32_t lastSeq, uint8_t *destination, size_t maxSize);
+
+#endif /* INC_PWX_HISTORYLOG_H_ */
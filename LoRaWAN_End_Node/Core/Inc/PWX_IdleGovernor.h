@@ -0,0 +1,85 @@
+/**
+ * @file PWX_IdleGovernor.h
+ * @brief Tickless Idle Governor Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_IDLEGOVERNOR_H_
+#define INC_PWX_IDLEGOVERNOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Typical supply current per mode (uA), used for the sleep vs STOP2 break-even */
+#define IDLE_GOV_RUN_UA                 3000    // MSI 48 MHz, exit path running
+#define IDLE_GOV_SLEEP_UA               1000
+#define IDLE_GOV_STOP2_UA               2       // RTC and LSE on
+
+/* STOP2 exit: hardware wake-up before the first instruction, then the measured restore */
+#define IDLE_GOV_STOP2_WAKEUP_US        10
+#define IDLE_GOV_LATENCY_SHIFT          3       // EWMA weight of 1/8 for the measured restore
+#define IDLE_GOV_PREARM_MIN_US          500     // shorter exits are not worth an early wake
+
+/**
+ * @enum IdleMode_t
+ * @brief Low-power modes the governor accounts for.
+ */
+typedef enum {
+    IDLE_MODE_SLEEP = 0,
+    IDLE_MODE_STOP2,
+    IDLE_MODE_NUM,
+} IdleMode_t;
+
+/**
+ * @brief Starts the cycle counter used to time the STOP2 exit, clears the counters.
+ */
+void initIdleGovernor(void);
+
+/**
+ * @brief Allows or vetoes STOP2 for the coming idle period. Called from UTIL_SEQ_Idle().
+ *
+ * STOP2 is kept only if the next UTIL_TIMER deadline is further away than
+ * the exit latency plus the time after which STOP2 saves more than the
+ * exit costs. When the exit is long enough, a wake is armed that much
+ * ahead of the deadline, so the timer is served on time. The other
+ * UTIL_LPM requesters can still veto STOP2.
+ */
+void idleGovernorSelect(void);
+
+/**
+ * @brief Marks the entry in a low-power mode. Called from PWR_Enter*Mode() before WFI.
+ */
+void idleGovernorOnEnter(IdleMode_t mode);
+
+/**
+ * @brief Marks the wake-up. Called from PWR_Enter*Mode() right after WFI.
+ */
+void idleGovernorOnWake(void);
+
+/**
+ * @brief Closes the residency of the period and times the restore. Called at the end of PWR_Exit*Mode().
+ */
+void idleGovernorOnExit(void);
+
+/**
+ * @brief Time spent in a mode since boot, in ms.
+ */
+uint32_t getIdleResidencyMs(IdleMode_t mode);
+
+/**
+ * @brief Number of entries in a mode since boot.
+ */
+uint32_t getIdleEntries(IdleMode_t mode);
+
+/**
+ * @brief Current STOP2 exit latency estimate, hardware wake-up included, in us.
+ */
+uint32_t getStopExitLatencyUs(void);
+
+/**
+ * @brief Logs the residency per mode and the exit latency.
+ */
+void printIdleGovernor(void);
+
+#endif /* INC_PWX_IDLEGOVERNOR_H_ */
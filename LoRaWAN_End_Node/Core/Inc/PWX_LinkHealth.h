@@ -0,0 +1,85 @@
+/**
+ * @file PWX_LinkHealth.h
+ * @brief Link Health Tracker and Confirmed-Uplink Policy Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_LINKHEALTH_H_
+#define INC_PWX_LINKHEALTH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* LinkCheckAns margin (dB above the gateway demodulation floor) considered healthy */
+#define LINK_HEALTH_MARGIN_GOOD_DB      6
+/* Averaged downlink SNR (dB) below which the link is considered degraded */
+#define LINK_HEALTH_SNR_LOW_DB          (-10)
+
+/*
+ * Rejoin once the chance of seeing this many consecutive unanswered
+ * uplinks on a healthy link drops below 1 / LINK_HEALTH_OUTAGE_ODDS,
+ * given the measured loss rate. The miss count is clamped to this range.
+ */
+#define LINK_HEALTH_OUTAGE_ODDS         100
+#define LINK_HEALTH_OUTAGE_MIN_MISSES   4
+#define LINK_HEALTH_OUTAGE_MAX_MISSES   12
+
+/**
+ * @enum LinkUplinkType_t
+ * @brief Uplink kind chosen by the policy.
+ */
+typedef enum {
+    LINK_UPLINK_UNCONFIRMED = 0,    // no link evidence requested
+    LINK_UPLINK_LINK_CHECK,         // unconfirmed, LinkCheckReq piggybacked
+    LINK_UPLINK_CONFIRMED,          // confirmed, MAC retransmits until ACK
+} LinkUplinkType_t;
+
+/**
+ * @brief Clears all link statistics. Called at boot and after a rejoin.
+ */
+void initLinkHealth(void);
+
+/**
+ * @brief Picks the kind of the next uplink.
+ *
+ * Link evidence is requested once every evidenceInterval uplinks: a cheap
+ * LinkCheckReq while the margin is good, a confirmed uplink when the link
+ * looks degraded or answers are being missed. A LinkCheckReq still
+ * unanswered when this is called is counted as a miss.
+ *
+ * @param evidenceInterval Uplinks allowed between two link evidence requests.
+ * @return Kind of uplink to send.
+ */
+LinkUplinkType_t getLinkUplinkType(uint16_t evidenceInterval);
+
+/**
+ * @brief Records an uplink that left the radio (McpsConfirm).
+ *
+ * @param type Kind of uplink that was sent.
+ * @param ackReceived For confirmed uplinks, whether the ACK arrived.
+ */
+void linkHealthOnTx(LinkUplinkType_t type, bool ackReceived);
+
+/**
+ * @brief Records a received downlink.
+ *
+ * @param rssi Downlink RSSI in dBm.
+ * @param snr Downlink SNR in dB.
+ * @param linkCheck True if the frame carried a LinkCheckAns.
+ * @param margin LinkCheckAns demodulation margin in dB.
+ * @param gateways LinkCheckAns gateway count.
+ */
+void linkHealthOnRx(int8_t rssi, int8_t snr, bool linkCheck, uint8_t margin, uint8_t gateways);
+
+/**
+ * @brief Checks if the consecutive misses amount to an outage that warrants a rejoin.
+ */
+bool isLinkOutage(void);
+
+/**
+ * @brief Logs the current link statistics.
+ */
+void printLinkHealth(void);
+
+#endif /* INC_PWX_LINKHEALTH_H_ */
@@ -0,0 +1,83 @@
+/**
+ * @file PWX_MemWatch.h
+ * @brief Stack and Heap High-Water Marks Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_MEMWATCH_H_
+#define INC_PWX_MEMWATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* The _Min_Stack_Size reserve is painted at boot, the deepest overwritten word gives the peak */
+#define MEM_WATCH_PAINT                 0xC5C5C5C5UL
+#define MEM_WATCH_GUARD_BYTES           64      // below the painting frame, left alone
+#define MEM_WATCH_MAX_TASKS             32      // UTIL_SEQ limit
+
+/*
+ * Diagnostic block: [stack peak u16][heap peak u16][sbrk failures u8]
+ * [deepest task id u8][deepest task stack peak u16], sizes in bytes.
+ */
+#define MEM_WATCH_BLOCK_SIZE            8
+#define MEM_WATCH_NO_TASK               0xFF
+
+/**
+ * @brief Paints the stack reserve below the caller. Called first thing in main().
+ */
+void paintStack(void);
+
+/**
+ * @brief Charges the stack used since the last dispatch to a sequencer task, then repaints it.
+ *
+ * Called by UTIL_SEQ_Run() after each task through UTIL_SEQ_POST_TASK_HOOK.
+ *
+ * @param taskId Index of the task that just returned.
+ */
+void memWatchTaskDone(uint32_t taskId);
+
+/**
+ * @brief Records a heap extension, or a refused one. Called from _sbrk().
+ *
+ * @param heapEnd Heap end after the call.
+ * @param isFailed True if the extension would have reached the stack reserve.
+ */
+void memWatchOnSbrk(const uint8_t *heapEnd, bool isFailed);
+
+/**
+ * @brief Deepest stack use seen since boot, in bytes from the top of RAM. Capped at _Min_Stack_Size.
+ */
+uint16_t getStackPeakBytes(void);
+
+/**
+ * @brief Deepest stack use seen while a task ran, in bytes. 0 if the task never ran.
+ */
+uint16_t getTaskStackPeakBytes(uint32_t taskId);
+
+/**
+ * @brief Largest heap extent since boot, in bytes.
+ */
+uint16_t getHeapPeakBytes(void);
+
+/**
+ * @brief Number of heap extensions _sbrk() refused.
+ */
+uint16_t getHeapFailures(void);
+
+/**
+ * @brief Encodes the high-water marks for the diagnostic uplink.
+ *
+ * @param destination Output buffer.
+ * @param maxSize Bytes left in the uplink.
+ * @return MEM_WATCH_BLOCK_SIZE, 0 if it does not fit.
+ */
+size_t buildMemWatchBlock(uint8_t *destination, size_t maxSize);
+
+/**
+ * @brief Logs the high-water marks and the stack peak of every task that ran.
+ */
+void printMemWatch(void);
+
+#endif /* INC_PWX_MEMWATCH_H_ */
@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "PWX_ST50H_Modbus.h"
 #include "PWX_ModbusMonitoring.h"
@@ -105,7 +106,41 @@ struct ModbusResponse {
 void initModbusDevices();  // init counter for active device and segment.
 
 
-void scanModbusDevice(struct ModbusDevice ModbusDevice, uint8_t SegmentID, size_t* outputSize, uint8_t* arrFilteredData);
+/* Segment scan: response ends after an idle gap, or at the timeout without a first byte */
+#define MODBUS_SCAN_TIMEOUT_MS   1000
+#define MODBUS_SCAN_IDLE_MS      20
+#define MODBUS_SCAN_HEADER_SIZE  3      // slave id, function code, byte count
+#define MODBUS_SCAN_CRC_SIZE     2
+
+/**
+ * @brief Sends a segment command and writes its filtered response to the uplink buffer.
+ *
+ * Register reads keep only the registers flagged in validAddresses, two bytes
+ * each, in register order. Other responses are copied as received. The
+ * response CRC is checked when the device has enableCRCCheck set.
+ *
+ * @param ModbusDevice Device settings, read in place.
+ * @param SegmentID Segment index, 0 to NUM_DEV_SEGMENTS - 1.
+ * @param destination Uplink buffer the data is written to.
+ * @param maxSize Bytes left in destination.
+ * @return Number of bytes written, 0 on timeout or a bad response.
+ */
+size_t scanModbusDevice(const struct ModbusDevice *ModbusDevice, uint8_t SegmentID, uint8_t *destination, size_t maxSize);
+
+/**
+ * @brief Copies the registers flagged in validAddresses out of a register read response.
+ *
+ * Registers past the byte count of the response are skipped.
+ *
+ * @param segment Segment holding validAddresses, bit n for register n.
+ * @param response Response frame, starting with the slave id.
+ * @param responseSize Received bytes.
+ * @param destination Output buffer.
+ * @param maxSize Bytes left in destination.
+ * @return Number of bytes written.
+ */
+size_t filterModbusRegisters(const struct Segment *segment, const uint8_t *response, uint16_t responseSize,
+		uint8_t *destination, size_t maxSize);
 
 
 void initModbusParameters(uint32_t baudRate, uint8_t parity, uint8_t stopBits);
@@ -0,0 +1,107 @@
+/**
+ * @file PWX_ModbusPassthrough.h
+ * @brief Remote Modbus Passthrough Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_MODBUSPASSTHROUGH_H_
+#define INC_PWX_MODBUSPASSTHROUGH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "PWX_ST50H_Modbus.h"
+
+/*
+ * Downlink: [txn id u8] followed by requests, each [length u8][slave id][function code][data].
+ * The CRC is appended on the device, so a request is 2..MODBUS_PASSTHROUGH_MAX_PDU bytes.
+ *
+ * Uplink: [txn id u8] followed by responses, each [request index][status][length u8][response].
+ * The response is the slave frame without its CRC, which the device has already checked.
+ * One transaction may span several uplinks, responses are not necessarily in request order.
+ */
+#define MODBUS_PASSTHROUGH_MAX_REQUESTS     8
+#define MODBUS_PASSTHROUGH_MAX_PDU          30
+#define MODBUS_PASSTHROUGH_MAX_RESPONSE     64      // response without CRC
+#define MODBUS_PASSTHROUGH_CACHE_SIZE       4
+#define MODBUS_PASSTHROUGH_RECORD_HEADER    3
+
+/* Bus timing: give up without a first byte, end of frame after an idle gap */
+#define MODBUS_PASSTHROUGH_TIMEOUT_MS       1000
+#define MODBUS_PASSTHROUGH_IDLE_MS          20
+
+/**
+ * @enum ModbusPassthroughStatus_t
+ * @brief Per-request status, sent with each response.
+ */
+typedef enum {
+    MODBUS_PASSTHROUGH_OK = 0,          // answered on the bus
+    MODBUS_PASSTHROUGH_CACHED,          // identical read answered within the freshness window
+    MODBUS_PASSTHROUGH_TIMEOUT,         // no answer from the slave
+    MODBUS_PASSTHROUGH_BAD_RESPONSE,    // answer too short or CRC mismatch
+    MODBUS_PASSTHROUGH_INVALID,         // request length out of range or runs past the payload
+    MODBUS_PASSTHROUGH_TOO_LARGE,       // answer does not fit the buffer or an uplink, no data sent
+} ModbusPassthroughStatus_t;
+
+/**
+ * @brief Clears the pending transaction and the response cache.
+ */
+void initModbusPassthrough(void);
+
+/**
+ * @brief Parses a passthrough downlink. The requests run on the next runModbusPassthrough().
+ *
+ * A transaction still pending is dropped. Requests beyond
+ * MODBUS_PASSTHROUGH_MAX_REQUESTS are ignored.
+ *
+ * @param payload Downlink payload, starting with the transaction ID.
+ * @param size Payload size in bytes.
+ * @return Number of requests queued, 0 if the payload holds none.
+ */
+uint8_t queueModbusPassthrough(const uint8_t *payload, size_t size);
+
+/**
+ * @brief Checks if queued requests have not run yet.
+ */
+bool isModbusPassthroughPending(void);
+
+/**
+ * @brief Runs the queued requests through sendRaw().
+ *
+ * Reads (function codes 1 to 4) are answered from the cache when the same
+ * request was answered less than MODBUS_PASSTHROUGH_CACHE_MS ago, so
+ * identical requests in one or several downlinks reach the bus once.
+ * Any other function code reaches the bus and drops the cached answers
+ * of its slave.
+ *
+ * @param modbusResponse Receive buffer fed by Modbus_RxCallback().
+ */
+void runModbusPassthrough(ModBus_t *modbusResponse);
+
+/**
+ * @brief Packs unsent responses into one uplink, first fit.
+ *
+ * A response that would not fit an empty uplink of maxSize is downgraded to
+ * MODBUS_PASSTHROUGH_TOO_LARGE without data.
+ *
+ * @param destination Uplink buffer.
+ * @param maxSize Largest application payload at the current data rate.
+ * @param packed Receives the bit per request packed, for markModbusPassthroughSent().
+ * @return Number of bytes written, 0 if every response was sent or maxSize
+ *         cannot hold the transaction ID and one record header.
+ */
+size_t buildModbusPassthroughUplink(uint8_t *destination, size_t maxSize, uint8_t *packed);
+
+/**
+ * @brief Marks the responses of an uplink accepted by the MAC as sent.
+ */
+void markModbusPassthroughSent(uint8_t packed);
+
+/**
+ * @brief Checks if responses of the current transaction are waiting for an uplink.
+ */
+bool hasModbusPassthroughReplies(void);
+
+#endif /* INC_PWX_MODBUSPASSTHROUGH_H_ */
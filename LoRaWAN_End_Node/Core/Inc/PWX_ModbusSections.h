@@ -0,0 +1,70 @@
+/**
+ * @file PWX_ModbusSections.h
+ * @brief Multi-Device Modbus Section Aggregator Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_MODBUSSECTIONS_H_
+#define INC_PWX_MODBUSSECTIONS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Sections read in one cycle, packed into as few uplinks on
+ * MODBUS_SECTION_PORT as the data rate allows:
+ *   [tag][len][data]...   tag = ((device 1..16 - 1) << 4) | segment 0..15
+ * A section is never split, those that do not fit go to the next frame.
+ * A section too large for any frame at the data rate is sent with len 0.
+ */
+#define MODBUS_SECTION_HEADER_SIZE      2
+#define MODBUS_SECTION_MAX_DATA         255     // len is one byte
+#define MODBUS_SECTION_MAX_QUEUED       32      // fits the packed mask
+#define MODBUS_SECTION_POOL_SIZE        1024    // data of every section of a cycle
+
+/**
+ * @brief Clears the queue and the counters.
+ */
+void initModbusSections(void);
+
+/**
+ * @brief Scans every enabled segment flagged sendNow of every active device, into the queue.
+ *
+ * Sections left unsent from the previous cycle are stale and dropped. A
+ * failed scan is left out. Once the queue or the pool is full, the
+ * remaining segments are read first next cycle. The Modbus bus and the
+ * sensor rail must be ready. USART1 is left with the settings it had, the
+ * ST50H level sensor ones.
+ *
+ * @return Number of sections queued.
+ */
+uint8_t collectModbusSections(void);
+
+/**
+ * @brief Packs queued sections, first fit in queue order, into one uplink.
+ *
+ * @param destination Uplink buffer.
+ * @param maxSize Largest payload at the current data rate.
+ * @param packed Set to the sections packed, bit per queue entry. Pass to markModbusSectionsSent() once sent.
+ * @return Payload size, 0 if no section fits.
+ */
+size_t buildModbusSectionUplink(uint8_t *destination, size_t maxSize, uint32_t *packed);
+
+/**
+ * @brief Drops the sections of an uplink the MAC accepted.
+ */
+void markModbusSectionsSent(uint32_t packed);
+
+/**
+ * @brief True while queued sections wait for an uplink.
+ */
+bool hasModbusSections(void);
+
+/**
+ * @brief Logs the sections and frames sent, and the frames saved over one uplink per section.
+ */
+void printModbusSections(void);
+
+#endif /* INC_PWX_MODBUSSECTIONS_H_ */
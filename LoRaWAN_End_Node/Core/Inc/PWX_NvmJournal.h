@@ -0,0 +1,55 @@
+/**
+ * @file PWX_NvmJournal.h
+ * @brief LoRaMac NVM Context Journal Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_NVMJOURNAL_H_
+#define INC_PWX_NVMJOURNAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Journal area: pages right below the history log. The LoRaMac context is no
+ * longer written to LORAWAN_NVM_BASE_ADDRESS, which keeps only the pwx* config.
+ */
+#define NVM_JOURNAL_BASE_ADDRESS     ((void *)0x0802F000UL)
+#define NVM_JOURNAL_NUM_PAGES        4
+#define NVM_JOURNAL_PAGE_SIZE        0x800UL
+
+/*
+ * Page budget (group sizes from LoRaMac.h): the snapshot opening a page takes
+ * 1704 bytes, leaving 344 for appends. An uplink usually changes Crypto and
+ * MacGroup1, 104 bytes of records, so a page takes 3 stores before the next
+ * one is erased for a new snapshot.
+ */
+
+/**
+ * @brief Scans the journal pages and indexes the latest record of every NVM group.
+ */
+void initNvmJournal(void);
+
+/**
+ * @brief Rebuilds the LoRaMac NVM image from the journal.
+ *
+ * @param nvm Pointer to the LoRaMacNvmData_t to fill.
+ * @param nvmSize Size of the buffer in bytes.
+ * @return true if a complete image was found, false if the journal is empty.
+ */
+bool restoreNvmJournal(void *nvm, uint32_t nvmSize);
+
+/**
+ * @brief Appends the NVM groups that differ from their last journal record.
+ *
+ * When the active page is full, the next page is erased and a full snapshot
+ * of all groups is written there instead.
+ *
+ * @param nvm Pointer to the LoRaMacNvmData_t to store.
+ * @param nvmSize Size of the buffer in bytes.
+ * @return true if the journal holds the given image.
+ */
+bool storeNvmJournal(const void *nvm, uint32_t nvmSize);
+
+#endif /* INC_PWX_NVMJOURNAL_H_ */
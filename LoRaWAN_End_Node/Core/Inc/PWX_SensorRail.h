@@ -0,0 +1,79 @@
+/**
+ * @file PWX_SensorRail.h
+ * @brief Sensor Power-Rail Manager Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_SENSORRAIL_H_
+#define INC_PWX_SENSORRAIL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PWX_ST50H_Modbus.h"
+
+/* PA6/PA7 power the ultrasonic Modbus sensor */
+#define SENSOR_RAIL_PORT                GPIOA
+#define SENSOR_RAIL_PINS                (GPIO_PIN_6 | GPIO_PIN_7)
+
+/* Readiness probing: first retry step, doubled after each unanswered probe */
+#define SENSOR_RAIL_PROBE_STEP_MS       25
+#define SENSOR_RAIL_PROBE_TIMEOUT_MS    60
+#define SENSOR_RAIL_LEARN_SHIFT         2       // EWMA weight of 1/4 for the learned warm-up
+
+/**
+ * @enum SensorRailSensor_t
+ * @brief Sensors with a warm-up profile.
+ */
+typedef enum {
+    SENSOR_RAIL_LEVEL_SENSOR = 0,   // ST50H level sensor, slave 1
+    SENSOR_RAIL_NUM_SENSORS,
+} SensorRailSensor_t;
+
+/**
+ * @struct SensorRailProfile_t
+ * @brief Warm-up bounds and the cheap request used to probe readiness.
+ */
+typedef struct {
+    const uint8_t *probeCmd;        // full frame, CRC included
+    uint8_t  probeSize;
+    uint8_t  responseSize;          // expected answer size, CRC included
+    uint16_t minWarmUpMs;           // no probe before this
+    uint16_t maxWarmUpMs;           // give up probing, the sensor is considered ready
+} SensorRailProfile_t;
+
+/**
+ * @brief Clears the reference count and the learned warm-up times. Rails off.
+ */
+void initSensorRail(void);
+
+/**
+ * @brief Takes a reference on the rails, powering them if this is the first one.
+ */
+void acquireSensorRail(void);
+
+/**
+ * @brief Drops a reference on the rails, powering them down with the last one.
+ */
+void releaseSensorRail(void);
+
+/**
+ * @brief Waits until the sensor answers its probe, or maxWarmUpMs after power-up.
+ *
+ * The first probe goes out shortly before the learned warm-up time, then
+ * retries back off exponentially. Returns at once if the sensor already
+ * answered since the rails came up. The rails must be acquired.
+ *
+ * @param sensor Sensor to wait for.
+ * @param modbusResponse Receive buffer fed by Modbus_RxCallback().
+ * @return True if the sensor answered, false if the wait ran out.
+ */
+bool waitSensorRailReady(SensorRailSensor_t sensor, ModBus_t *modbusResponse);
+
+/**
+ * @brief Learned warm-up time of a sensor in ms, 0 until it answered once.
+ */
+uint16_t getSensorWarmUpMs(SensorRailSensor_t sensor);
+
+#endif /* INC_PWX_SENSORRAIL_H_ */
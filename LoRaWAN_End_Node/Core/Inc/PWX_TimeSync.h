@@ -0,0 +1,114 @@
+/**
+ * @file PWX_TimeSync.h
+ * @brief Network Clock Sync and Time-Tagged Samples Header
+ * @date October 19, 2026
+ * @version 1.0
+ */
+
+#ifndef INC_PWX_TIMESYNC_H_
+#define INC_PWX_TIMESYNC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A DeviceTimeReq is piggybacked on uplinks until the network answers, then
+ * again once the compensated clock may have drifted by TIME_SYNC_TOLERANCE_MS.
+ */
+#define TIME_SYNC_TOLERANCE_MS          1000
+#define TIME_SYNC_MIN_INTERVAL_S        (6UL * 3600UL)
+#define TIME_SYNC_MAX_INTERVAL_S        (7UL * 86400UL)
+#define TIME_SYNC_MIN_DRIFT_SPAN_S      3600    // shorter spans are dominated by the 1/256 s answer resolution
+
+/* Samples kept for the time-tagged block, oldest dropped first */
+#define TIME_SYNC_MAX_SAMPLES           32
+
+/*
+ * Time-tagged block: [base time u32][flags u8][count u8], then per sample
+ * [seconds after base u16][level u16]. Base time is Unix seconds once
+ * synced (flags bit 0), seconds since boot before that.
+ */
+#define TIME_SYNC_BLOCK_HEADER_SIZE     6
+#define TIME_SYNC_BLOCK_RECORD_SIZE     4
+#define TIME_SYNC_FLAG_SYNCED           0x01
+
+/*
+ * Series block: CayenneLPP series records of the levels in 0.01 m, one per
+ * run of samples that sit within TIME_SYNC_SERIES_JITTER_S of a regular
+ * grid. Base times on TIME_SYNC_SERIES_CHANNEL are Unix seconds, on
+ * TIME_SYNC_SERIES_CHANNEL_UNSYNCED seconds since boot.
+ */
+#define TIME_SYNC_SERIES_CHANNEL            1
+#define TIME_SYNC_SERIES_CHANNEL_UNSYNCED   2
+#define TIME_SYNC_SERIES_JITTER_S           5
+
+/**
+ * @brief Clears the sync state and the sample buffer.
+ */
+void initTimeSync(void);
+
+/**
+ * @brief Records a DeviceTimeAns the MAC has just applied. Called from OnSysTimeUpdate().
+ */
+void timeSyncOnUpdate(void);
+
+/**
+ * @brief Checks if the next uplink should carry a DeviceTimeReq.
+ */
+bool isTimeSyncDue(void);
+
+/**
+ * @brief Checks if the network time was received at least once.
+ */
+bool isTimeSynced(void);
+
+/**
+ * @brief SysTimeGet() seconds, corrected by the drift measured between syncs.
+ */
+uint32_t getSyncedSeconds(void);
+
+/**
+ * @brief Drift of the RTC against network time in ppb, positive if the RTC runs slow.
+ */
+int32_t getTimeSyncDriftPpb(void);
+
+/**
+ * @brief Tags a sample with the current synced time.
+ *
+ * @param level Water level in cm x100, as in the scheduled uplink.
+ */
+void recordTimedSample(uint16_t level);
+
+/**
+ * @brief Drops every recorded sample. Called once a cycle has been uplinked.
+ */
+void clearTimedSamples(void);
+
+/**
+ * @brief Encodes the newest samples that fit into a time-tagged block.
+ *
+ * @param destination Output buffer.
+ * @param maxSize Bytes left in the uplink.
+ * @return Number of bytes written, 0 if no sample fits.
+ */
+size_t buildTimedSampleBlock(uint8_t *destination, size_t maxSize);
+
+/**
+ * @brief Encodes the newest samples that fit as CayenneLPP series records.
+ *
+ * Samples left over from cycles that were not uplinked are packed along
+ * with the current ones, oldest dropped first when the block does not fit.
+ *
+ * @param destination Output buffer.
+ * @param maxSize Bytes left in the uplink.
+ * @return Number of bytes written, 0 if no sample fits.
+ */
+size_t buildTimedSampleSeries(uint8_t *destination, size_t maxSize);
+
+/**
+ * @brief Logs the sync state.
+ */
+void printTimeSync(void);
+
+#endif /* INC_PWX_TIMESYNC_H_ */
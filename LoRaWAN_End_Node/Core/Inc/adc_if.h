@@ -91,6 +91,11 @@ int16_t SYS_GetTemperatureLevel(void);
 uint16_t SYS_GetBatteryLevel(void);
 
 /* USER CODE BEGIN EFP */
+/**
+  * @brief Get the time the ADC was powered for measurements since boot
+  * @return time in ms
+  */
+uint32_t SYS_GetMeasurementOnTime(void);
 
 /* USER CODE END EFP */
 
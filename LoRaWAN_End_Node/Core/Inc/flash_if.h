@@ -114,7 +114,20 @@ FLASH_IF_StatusTypedef FLASH_IF_Read(void *pDestination, const void *pSource, ui
 FLASH_IF_StatusTypedef FLASH_IF_Erase(void *pStart, uint32_t uLength);
 
 /* USER CODE BEGIN EFP */
-
+/**
+  * @brief This function writes only the double words that differ from the internal flash content
+  *
+  * @note  A changed double word is programmed in place when it is still erased or cleared to 0.
+  *        Otherwise the page is erased and restored from the FLASH_PAGE_SIZE RAM buffer given to
+  *        FLASH_IF_Init, then programmed in full. Without that buffer FLASH_IF_PARAM_ERROR is
+  *        returned and flash is left untouched for that page, so only 1 to 0 updates are saved.
+  *        Nothing is written when the content is already identical.
+  * @param pDestination pointer of flash address to write. It has to be 8 bytes aligned.
+  * @param pSource pointer on buffer with data to write
+  * @param uLength length of data buffer in bytes. It has to be 8 bytes aligned.
+  * @return FLASH_IF_StatusTypedef status
+  */
+FLASH_IF_StatusTypedef FLASH_IF_DiffWrite(void *pDestination, const void *pSource, uint32_t uLength);
 /* USER CODE END EFP */
 
 #ifdef __cplusplus
@@ -17,8 +17,23 @@
 #include "PWX_ST50H_Modbus.h"
 #include "PWX_ModbusDevice.h"
 #include "PWX_ModbusMonitoring.h"
+#include "PWX_HistoryLog.h"
+#include "PWX_NvmJournal.h"
+#include "PWX_LinkHealth.h"
+#include "PWX_ConfigTlv.h"
+#include "PWX_ModbusPassthrough.h"
+#include "PWX_SensorRail.h"
+#include "PWX_TimeSync.h"
+#include "PWX_MemWatch.h"
+#include "PWX_IdleGovernor.h"
+#include "PWX_DeviceTable.h"
+#include "PWX_ClockPolicy.h"
+#include "PWX_AlarmWindow.h"
+#include "PWX_ModbusSections.h"
 
 //#define LORA_UART_CONFIG
+#define TIME_TAGGED_SAMPLES		// append the time-tagged samples of the cycle to scheduled uplinks
+#define TIME_TAGGED_SERIES		// ... as CayenneLPP series records, 2 bytes per regularly spaced sample
 
 #define MAIN_VERSION   02
 #define MEDIUM_VERSION 05
@@ -28,6 +43,21 @@
 
 #define CLI_WAIT_TIME 5000
 
+/**
+ * @struct BootProfile_t
+ * @brief HAL_GetTick() in ms at the end of each boot phase.
+ *
+ * The tick runs from the RTC, which starts inside MX_LoRaWAN_Init().
+ */
+typedef struct {
+    uint32_t lorawanInit;        // MX_LoRaWAN_Init() done
+    uint32_t joinTx;             // first join request handed to the MAC
+    uint32_t halInit;            // I2C, UART and Modbus peripherals ready
+    uint32_t flashLoad;          // device params read from flash
+    uint32_t configWindowEnd;    // CLI window closed or config mode entered
+    uint32_t joinDone;           // first join result received
+} BootProfile_t;
+
 #define LORAWAN_NVM_BASE_ADDRESS                    ((void *)0x0803F000UL)
 
 
@@ -52,7 +82,10 @@
 
 //#define LORAWAN_MODBUS_DEVICE_CONFIG_ID             1
 //#define LORAWAN_MODBUS_SEGMENT_CONFIG_ID            2
-//#define LORAWAN_BYPASS_CMD_PORT                     3
+#define LORAWAN_BYPASS_CMD_PORT                     30		// [txn id][len][Modbus PDU]... see PWX_ModbusPassthrough.h
+#define LORAWAN_BYPASS_REPLY_PORT                   31
+#define MODBUS_PASSTHROUGH_CACHE_MS                 10000	// freshness window of cached read answers
+#define MODBUS_PASSTHROUGH_INTERVAL_MS              5000
 
 #define DEVICE_PANIC_PORT			69
 #define CONFIG_RESTORE_DEV_CONFIG   0x01
@@ -67,6 +100,24 @@
 
 #define BOARD_DIAGNOSTIC_PORT 22
 
+#define HISTORY_BACKFILL_PORT                       26
+#define HISTORY_BACKFILL_REPLY_PORT                 27
+#define HISTORY_BACKFILL_REQUEST_ID                 0x01	// [ID][from seq u32][to seq u32]
+#define HISTORY_BACKFILL_STOP_ID                    0x02
+#define HISTORY_BACKFILL_INTERVAL_MS                30000
+
+#define CONFIG_TLV_PORT                             28		// [txn id][tag][len][value]... see PWX_ConfigTlv.h
+#define CONFIG_TLV_REPLY_PORT                       29
+#define CONFIG_TLV_ACK_DELAY_MS                     5000
+
+#define ALARM_WINDOW_CONFIG_ID                      0x10	// on LORAWAN_SWITCH_CLASS_PORT: [ID][window s u16][budget mAs per day u16]
+#define ALARM_WINDOW_RETRY_MS                       1000	// MAC busy, try the class switch again
+
+#define MODBUS_SECTION_PORT                         33		// [tag][len][data]... see PWX_ModbusSections.h
+#define MODBUS_SECTION_INTERVAL_MS                  5000	// between frames while sections are left
+
+// DEVICE_TABLE_PORT (32): fragmented device table download, handled by the LmhpDeviceTable package
+
 
 extern const void *ModbusDeviceFlashAddresses[];
 
@@ -75,7 +126,6 @@ extern int MAX_WATER_LEVEL_SAMPLES;
 extern int SAMPLE_INTERVAL_MS;
 extern int TRANSMIT_INTERVAL_MS;
 extern float thresholdLevel;
-extern uint16_t confUplinkCounter;
 
 extern float thresholdLevelHigh;
 extern float thresholdLevelLow;
@@ -106,6 +156,7 @@ extern uint8_t SECTION_TO_SEND;
 extern uint32_t doneScanningDevicesMillis;
 
 extern SecureElementNvmData_t DeviceParamsNVM;
+extern BootProfile_t bootProfile;
 
 
 #endif /* APPLICATION_USER_CORE_PROJECT_CONFIG_H_ */
@@ -61,7 +61,7 @@ void EXTI1_IRQHandler(void);
 void DMA1_Channel5_IRQHandler(void);
 void EXTI9_5_IRQHandler(void);
 void USART1_IRQHandler(void);
-void USART2_IRQHandler(void);
+void LPUART1_IRQHandler(void);
 void RTC_Alarm_IRQHandler(void);
 void SUBGHZ_Radio_IRQHandler(void);
 /* USER CODE BEGIN EFP */
@@ -34,14 +34,14 @@ extern "C" {
 
 extern UART_HandleTypeDef huart1;
 
-extern UART_HandleTypeDef huart2;
+extern UART_HandleTypeDef hlpuart1;
 
 /* USER CODE BEGIN Private defines */
 
 /* USER CODE END Private defines */
 
 void MX_USART1_UART_Init(void);
-void MX_USART2_UART_Init(void);
+void MX_LPUART1_UART_Init(void);
 
 /* USER CODE BEGIN Prototypes */
 
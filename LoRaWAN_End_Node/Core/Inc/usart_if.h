@@ -107,6 +107,10 @@ void vcom_DMA_TX_IRQHandler(void);
 void vcom_Resume(void);
 
 /* USER CODE BEGIN EFP */
+/**
+  * @brief  Runs the last console line received, posted as CFG_SEQ_Task_CliLineEvent
+  */
+void vcom_ProcessCommandLine(void);
 
 /* USER CODE END EFP */
 
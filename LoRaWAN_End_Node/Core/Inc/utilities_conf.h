@@ -37,7 +37,7 @@ extern "C" {
 /* enum number of task and priority*/
 #include "utilities_def.h"
 /* USER CODE BEGIN Includes */
-
+#include "PWX_MemWatch.h"
 /* USER CODE END Includes */
 
 /* Exported types ------------------------------------------------------------*/
@@ -96,16 +96,20 @@ extern "C" {
   */
 #define UTILS_INIT_CRITICAL_SECTION()
 
+#ifndef UTILS_ENTER_CRITICAL_SECTION
 /**
   * @brief macro used to enter the critical section
   */
 #define UTILS_ENTER_CRITICAL_SECTION() uint32_t primask_bit= __get_PRIMASK();\
   __disable_irq()
+#endif /* !UTILS_ENTER_CRITICAL_SECTION */
 
+#ifndef UTILS_EXIT_CRITICAL_SECTION
 /**
   * @brief macro used to exit the critical section
   */
 #define UTILS_EXIT_CRITICAL_SECTION()  __set_PRIMASK(primask_bit)
+#endif /* !UTILS_EXIT_CRITICAL_SECTION */
 /******************************************************************************
   * sequencer
   ******************************************************************************/
@@ -162,6 +166,10 @@ extern "C" {
 #define UTIL_ADV_TRACE_VSNPRINTF(...)              tiny_vsnprintf_like(__VA_ARGS__)      /*!< vsnprintf utilities interface to trace feature */
 
 /* USER CODE BEGIN EM */
+/**
+  * @brief Stack high-water mark of each task, see PWX_MemWatch.h
+  */
+#define UTIL_SEQ_POST_TASK_HOOK( task_id )   memWatchTaskDone( task_id )
 
 /* USER CODE END EM */
 
@@ -48,6 +48,7 @@ typedef enum
   CFG_LPM_APPLI_Id,
   CFG_LPM_UART_TX_Id,
   /* USER CODE BEGIN CFG_LPM_Id_t */
+  CFG_LPM_GOVERNOR_Id,
 
   /* USER CODE END CFG_LPM_Id_t */
 } CFG_LPM_Id_t;
@@ -80,6 +81,12 @@ typedef enum
   CFG_SEQ_Task_LoRaStoreContextEvent,
   CFG_SEQ_Task_LoRaStopJoinEvent,
   /* USER CODE BEGIN CFG_SEQ_Task_Id_t */
+  CFG_SEQ_Task_HistoryBackfillEvent,
+  CFG_SEQ_Task_ConfigTlvAckEvent,
+  CFG_SEQ_Task_ModbusPassthroughEvent,
+  CFG_SEQ_Task_CliLineEvent,
+  CFG_SEQ_Task_AlarmWindowEvent,
+  CFG_SEQ_Task_ModbusSectionEvent,
 
   /* USER CODE END CFG_SEQ_Task_Id_t */
   CFG_SEQ_Task_NBR
@@ -23,6 +23,7 @@
 #include "sys_app.h"
 
 /* USER CODE BEGIN Includes */
+#include <stdbool.h>
 
 /* USER CODE END Includes */
 
@@ -45,6 +46,8 @@ extern ADC_HandleTypeDef hadc;
 #define TEMPSENSOR_TYP_AVGSLOPE        (( int32_t) 2500)        /*!< Internal temperature sensor, parameter Avg_Slope (unit: uV/DegCelsius). Refer to device datasheet for min/typ/max values. */
 
 /* USER CODE BEGIN PD */
+#define ADC_BURST_VALIDITY_MS          1000     /*!< VREFINT and TEMPSENSOR results reused within this window */
+#define ADC_RECAL_TEMPERATURE_DELTA    10       /*!< recalibrate once the die moved this many degrees from the last calibration */
 
 /* USER CODE END PD */
 
@@ -56,6 +59,14 @@ extern ADC_HandleTypeDef hadc;
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
+static bool isCalibrated = false;
+static uint32_t calibrationFactor = 0;
+static int16_t calibrationTemperature = 0;
+static bool hasBurst = false;
+static uint32_t burstTick = 0;
+static uint32_t vrefintData = 0;
+static uint32_t tempsensorData = 0;
+static uint32_t adcOnTimeMs = 0;
 
 /* USER CODE END PV */
 
@@ -68,11 +79,41 @@ extern ADC_HandleTypeDef hadc;
 static uint32_t ADC_ReadChannels(uint32_t channel);
 
 /* USER CODE BEGIN PFP */
+/**
+  * @brief Converts VREFINT then TEMPSENSOR in one oversampled scan sequence,
+  *        unless the previous results are less than ADC_BURST_VALIDITY_MS old
+  * @note  Replaces ADC_ReadChannels(), which re-initialises and recalibrates per channel
+  */
+static void ADC_ReadBurst(void);
+
+/**
+  * @brief Configures the ADC for the two rank, 16x oversampled scan sequence
+  */
+static void ADC_InitScan(void);
+
+/**
+  * @brief Converts a VREFINT result to VDDA in mV
+  * @param measuredLevel VREFINT conversion result
+  * @return VDDA in mV, 0 if measuredLevel is 0
+  */
+static uint16_t ADC_GetVddaLevel(uint32_t measuredLevel);
+
+/**
+  * @brief Converts a TEMPSENSOR result to degree Celsius
+  * @param batteryLevelmV VDDA in mV
+  * @param measuredLevel TEMPSENSOR conversion result
+  * @return temperature in degree Celsius
+  */
+static int16_t ADC_GetTemperature(uint16_t batteryLevelmV, uint32_t measuredLevel);
 
 /* USER CODE END PFP */
 
 /* Exported functions --------------------------------------------------------*/
 /* USER CODE BEGIN EF */
+uint32_t SYS_GetMeasurementOnTime(void)
+{
+  return adcOnTimeMs;
+}
 
 /* USER CODE END EF */
 
@@ -83,6 +124,8 @@ void SYS_InitMeasurement(void)
   /* USER CODE END SYS_InitMeasurement_1 */
   hadc.Instance = ADC;
   /* USER CODE BEGIN SYS_InitMeasurement_2 */
+  isCalibrated = false;
+  hasBurst = false;
 
   /* USER CODE END SYS_InitMeasurement_2 */
 }
@@ -97,6 +140,14 @@ void SYS_DeInitMeasurement(void)
 int16_t SYS_GetTemperatureLevel(void)
 {
   /* USER CODE BEGIN SYS_GetTemperatureLevel_1 */
+  /* Both channels come from one burst, the generated per-channel read below is not used */
+  int16_t burstTemperatureDegreeC;
+
+  ADC_ReadBurst();
+  burstTemperatureDegreeC = ADC_GetTemperature(ADC_GetVddaLevel(vrefintData), tempsensorData);
+
+  /* from int16 to q8.7*/
+  return (int16_t)(burstTemperatureDegreeC << 8);
 
   /* USER CODE END SYS_GetTemperatureLevel_1 */
   __IO int16_t temperatureDegreeC = 0;
@@ -139,6 +190,9 @@ int16_t SYS_GetTemperatureLevel(void)
 uint16_t SYS_GetBatteryLevel(void)
 {
   /* USER CODE BEGIN SYS_GetBatteryLevel_1 */
+  /* Both channels come from one burst, the generated per-channel read below is not used */
+  ADC_ReadBurst();
+  return ADC_GetVddaLevel(vrefintData);
 
   /* USER CODE END SYS_GetBatteryLevel_1 */
   uint16_t batteryLevelmV = 0;
@@ -175,6 +229,170 @@ uint16_t SYS_GetBatteryLevel(void)
 
 /* Private Functions Definition -----------------------------------------------*/
 /* USER CODE BEGIN PrFD */
+static void ADC_ReadBurst(void)
+{
+  ADC_ChannelConfTypeDef sConfig = {0};
+  uint32_t startTick = HAL_GetTick();
+  int16_t temperature;
+
+  if (hasBurst && ((startTick - burstTick) < ADC_BURST_VALIDITY_MS))
+  {
+    return;
+  }
+
+  ADC_InitScan();
+
+  if (isCalibrated == false)
+  {
+    /* Start Calibration, the factor is kept for the next bring-ups */
+    if (HAL_ADCEx_Calibration_Start(&hadc) != HAL_OK)
+    {
+      Error_Handler();
+    }
+    calibrationFactor = HAL_ADCEx_Calibration_GetValue(&hadc);
+  }
+  else
+  {
+    /* Restore the factor lost with the ADC regulator */
+    if ((ADC_Enable(&hadc) != HAL_OK) || (HAL_ADCEx_Calibration_SetValue(&hadc, calibrationFactor) != HAL_OK))
+    {
+      Error_Handler();
+    }
+  }
+
+  /* Configure Regular Channels */
+  sConfig.Channel = ADC_CHANNEL_VREFINT;
+  sConfig.Rank = ADC_REGULAR_RANK_1;
+  sConfig.SamplingTime = ADC_SAMPLINGTIME_COMMON_1;
+  if (HAL_ADC_ConfigChannel(&hadc, &sConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sConfig.Channel = ADC_CHANNEL_TEMPSENSOR;
+  sConfig.Rank = ADC_REGULAR_RANK_2;
+  if (HAL_ADC_ConfigChannel(&hadc, &sConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  if (HAL_ADC_Start(&hadc) != HAL_OK)
+  {
+    /* Start Error */
+    Error_Handler();
+  }
+
+  /** Wait for end of each conversion of the sequence */
+  HAL_ADC_PollForConversion(&hadc, HAL_MAX_DELAY);
+  vrefintData = HAL_ADC_GetValue(&hadc);
+  HAL_ADC_PollForConversion(&hadc, HAL_MAX_DELAY);
+  tempsensorData = HAL_ADC_GetValue(&hadc);
+
+  HAL_ADC_Stop(&hadc);   /* it calls also ADC_Disable() */
+  HAL_ADC_DeInit(&hadc);
+
+  burstTick = HAL_GetTick();
+  hasBurst = true;
+  adcOnTimeMs += burstTick - startTick;
+
+  /* The calibration holds as long as the die stays close to its temperature */
+  temperature = ADC_GetTemperature(ADC_GetVddaLevel(vrefintData), tempsensorData);
+  if (isCalibrated == false)
+  {
+    calibrationTemperature = temperature;
+    isCalibrated = true;
+  }
+  else if ((temperature - calibrationTemperature) >= ADC_RECAL_TEMPERATURE_DELTA
+           || (calibrationTemperature - temperature) >= ADC_RECAL_TEMPERATURE_DELTA)
+  {
+    isCalibrated = false;
+  }
+  APP_LOG(TS_OFF, VLEVEL_H, "ADC: burst %u ms, %u ms on since boot \r\n", burstTick - startTick, adcOnTimeMs);
+}
+
+static void ADC_InitScan(void)
+{
+  hadc.Instance = ADC;
+  hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+  hadc.Init.Resolution = ADC_RESOLUTION_12B;
+  hadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+  hadc.Init.ScanConvMode = ADC_SCAN_ENABLE;
+  hadc.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+  hadc.Init.LowPowerAutoWait = DISABLE;
+  hadc.Init.LowPowerAutoPowerOff = DISABLE;
+  hadc.Init.ContinuousConvMode = DISABLE;
+  hadc.Init.NbrOfConversion = 2;
+  hadc.Init.DiscontinuousConvMode = DISABLE;
+  hadc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+  hadc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+  hadc.Init.DMAContinuousRequests = DISABLE;
+  hadc.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+  hadc.Init.SamplingTimeCommon1 = ADC_SAMPLETIME_160CYCLES_5;
+  hadc.Init.SamplingTimeCommon2 = ADC_SAMPLETIME_160CYCLES_5;
+  hadc.Init.OversamplingMode = ENABLE;
+  hadc.Init.Oversampling.Ratio = ADC_OVERSAMPLING_RATIO_16;
+  hadc.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_4;      /* results stay on 12 bits */
+  hadc.Init.Oversampling.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+  hadc.Init.TriggerFrequencyMode = ADC_TRIGGER_FREQ_HIGH;
+  if (HAL_ADC_Init(&hadc) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+static uint16_t ADC_GetVddaLevel(uint32_t measuredLevel)
+{
+  uint16_t batteryLevelmV = 0;
+
+  if (measuredLevel == 0)
+  {
+    batteryLevelmV = 0;
+  }
+  else
+  {
+    if ((uint32_t)*VREFINT_CAL_ADDR != (uint32_t)0xFFFFU)
+    {
+      /* Device with Reference voltage calibrated in production:
+         use device optimized parameters */
+      batteryLevelmV = __LL_ADC_CALC_VREFANALOG_VOLTAGE(measuredLevel,
+                                                        ADC_RESOLUTION_12B);
+    }
+    else
+    {
+      /* Device with Reference voltage not calibrated in production:
+         use generic parameters */
+      batteryLevelmV = (VREFINT_CAL_VREF * 1510) / measuredLevel;
+    }
+  }
+  return batteryLevelmV;
+}
+
+static int16_t ADC_GetTemperature(uint16_t batteryLevelmV, uint32_t measuredLevel)
+{
+  int16_t temperatureDegreeC = 0;
+
+  /* convert ADC level to temperature */
+  /* check whether device has temperature sensor calibrated in production */
+  if (((int32_t)*TEMPSENSOR_CAL2_ADDR - (int32_t)*TEMPSENSOR_CAL1_ADDR) != 0)
+  {
+    /* Device with temperature sensor calibrated in production:
+       use device optimized parameters */
+    temperatureDegreeC = __LL_ADC_CALC_TEMPERATURE(batteryLevelmV,
+                                                   measuredLevel,
+                                                   LL_ADC_RESOLUTION_12B);
+  }
+  else
+  {
+    /* Device with temperature sensor not calibrated in production:
+       use generic parameters */
+    temperatureDegreeC = __LL_ADC_CALC_TEMPERATURE_TYP_PARAMS(TEMPSENSOR_TYP_AVGSLOPE,
+                                                              TEMPSENSOR_TYP_CAL1_V,
+                                                              TEMPSENSOR_CAL1_TEMP,
+                                                              batteryLevelmV,
+                                                              measuredLevel,
+                                                              LL_ADC_RESOLUTION_12B);
+  }
+  return temperatureDegreeC;
+}
 
 /* USER CODE END PrFD */
 
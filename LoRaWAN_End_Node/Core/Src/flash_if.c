@@ -24,7 +24,7 @@
 #include "stm32_mem.h"
 
 /* USER CODE BEGIN Includes */
-
+#include <string.h>
 /* USER CODE END Includes */
 
 /* External variables ---------------------------------------------------------*/
@@ -48,7 +48,10 @@ enum
 };
 
 /* USER CODE BEGIN PD */
-
+/**
+  * @brief Size of a fast programming row (32 double words)
+  */
+#define FLASH_IF_ROW_SIZE           256U
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -117,7 +120,17 @@ static int32_t FLASH_IF_INT_IsEmpty(void *pStart, uint32_t uLength);
 static FLASH_IF_StatusTypedef FLASH_IF_INT_Clear_Error(void);
 
 /* USER CODE BEGIN PFP */
-
+/**
+  * @brief  Programs an already erased area, using fast row programming when a full
+  *         256 bytes row is aligned. Double words left at 0xFF are not programmed.
+  *
+  * @note   Flash has to be unlocked. The area is verified once at the end with memcmp.
+  * @param  uDest flash address to program. It has to be 8 bytes aligned.
+  * @param  uSource address of the data to program
+  * @param  uLength number of bytes. It has to be 8 bytes aligned.
+  * @return FLASH_IF_StatusTypedef status
+  */
+static FLASH_IF_StatusTypedef FLASH_IF_INT_Program(uint32_t uDest, uint32_t uSource, uint32_t uLength);
 /* USER CODE END PFP */
 
 /* Exported functions --------------------------------------------------------*/
@@ -199,7 +212,115 @@ FLASH_IF_StatusTypedef FLASH_IF_Erase(void *pStart, uint32_t uLength)
 }
 
 /* USER CODE BEGIN EF */
+FLASH_IF_StatusTypedef FLASH_IF_DiffWrite(void *pDestination, const void *pSource, uint32_t uLength)
+{
+  FLASH_IF_StatusTypedef ret_status = FLASH_IF_OK;
+  uint32_t uDest = (uint32_t)pDestination;
+  uint32_t uSource = (uint32_t)pSource;
+  uint32_t uEnd;
+  uint32_t page_address;
+  uint32_t chunk_end;
+  uint32_t offset;
+  uint64_t old_data;
+  uint64_t new_data;
+  bool need_erase;
+  bool changed;
+
+  if (!IS_FLASH_MAIN_MEM_ADDRESS(uDest) || (pSource == NULL) || !IS_ADDR_ALIGNED_64BITS(uLength)
+      || !IS_ADDR_ALIGNED_64BITS(uDest))
+  {
+    return FLASH_IF_PARAM_ERROR;
+  }
+
+  /* Nothing changed: no unlock, no erase, no program */
+  if (memcmp(pDestination, pSource, uLength) == 0)
+  {
+    return FLASH_IF_OK;
+  }
+
+  ret_status = FLASH_IF_INT_Clear_Error();
+  if (ret_status != FLASH_IF_OK)
+  {
+    return ret_status;
+  }
+  if (HAL_FLASH_Unlock() != HAL_OK)
+  {
+    return FLASH_IF_LOCK_ERROR;
+  }
+
+  uEnd = uDest + uLength;
+  while ((uDest < uEnd) && (ret_status == FLASH_IF_OK))
+  {
+    page_address = uDest - ((uDest - FLASH_BASE) % FLASH_PAGE_SIZE);
+    chunk_end = ((page_address + FLASH_PAGE_SIZE) < uEnd) ? (page_address + FLASH_PAGE_SIZE) : uEnd;
+
+    /* A changed double word can be programmed in place only if it is still erased,
+       or if it is cleared to 0. Anything else needs the page to be erased. */
+    need_erase = false;
+    changed = false;
+    for (offset = 0U; offset < (chunk_end - uDest); offset += 8U)
+    {
+      old_data = *(uint64_t *)(uDest + offset);
+      UTIL_MEM_cpy_8(&new_data, (const void *)(uSource + offset), 8U);
+      if (old_data != new_data)
+      {
+        changed = true;
+        if ((old_data != UINT64_MAX) && (new_data != 0U))
+        {
+          need_erase = true;
+          break;
+        }
+      }
+    }
+
+    if (need_erase)
+    {
+      if (pAllocatedBuffer == NULL)
+      {
+        ret_status = FLASH_IF_PARAM_ERROR;
+        break;
+      }
+      FLASH_IF_INT_Read(pAllocatedBuffer, (const void *)page_address, FLASH_PAGE_SIZE);
+      UTIL_MEM_cpy_8(&pAllocatedBuffer[uDest - page_address], (const void *)uSource, chunk_end - uDest);
+      if (FLASH_IF_INT_Erase((void *)page_address, FLASH_PAGE_SIZE) != FLASH_IF_OK)
+      {
+        ret_status = FLASH_IF_ERASE_ERROR;
+        break;
+      }
+      /* Erase locks the flash again */
+      if (HAL_FLASH_Unlock() != HAL_OK)
+      {
+        ret_status = FLASH_IF_LOCK_ERROR;
+        break;
+      }
+      ret_status = FLASH_IF_INT_Program(page_address, (uint32_t)pAllocatedBuffer, FLASH_PAGE_SIZE);
+    }
+    else if (changed)
+    {
+      for (offset = 0U; offset < (chunk_end - uDest); offset += 8U)
+      {
+        old_data = *(uint64_t *)(uDest + offset);
+        UTIL_MEM_cpy_8(&new_data, (const void *)(uSource + offset), 8U);
+        if ((old_data != new_data)
+            && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, uDest + offset, new_data) != HAL_OK))
+        {
+          ret_status = FLASH_IF_WRITE_ERROR;
+          break;
+        }
+      }
+      if ((ret_status == FLASH_IF_OK) && (memcmp((const void *)uDest, (const void *)uSource, chunk_end - uDest) != 0))
+      {
+        ret_status = FLASH_IF_WRITE_ERROR;
+      }
+    }
+
+    uSource += chunk_end - uDest;
+    uDest = chunk_end;
+  }
 
+  HAL_FLASH_Lock();
+  return ret_status;
+}
 /* USER CODE END EF */
 
 /* Private Functions Definition -----------------------------------------------*/
@@ -215,7 +336,6 @@ static FLASH_IF_StatusTypedef FLASH_IF_INT_Write(void *pDestination, const void
   uint32_t uSource = (uint32_t)pSource;
   uint32_t length = uLength;
   uint32_t page_index;
-  uint32_t address_offset;
   uint32_t start_page_index;
   uint32_t page_address;
   uint32_t number_pages;
@@ -248,7 +368,7 @@ static FLASH_IF_StatusTypedef FLASH_IF_INT_Write(void *pDestination, const void
       for (page_index = start_page_index; page_index < (start_page_index + number_pages); page_index++)
       {
         page_address = page_index * FLASH_PAGE_SIZE + FLASH_BASE;
-        if (FLASH_IF_INT_IsEmpty(pDestination, length) != FLASH_IF_MEM_EMPTY)
+        if (FLASH_IF_INT_IsEmpty((void *)uDest, length) != FLASH_IF_MEM_EMPTY)
         {
           if (pAllocatedBuffer == NULL)
           {
@@ -267,6 +387,14 @@ static FLASH_IF_StatusTypedef FLASH_IF_INT_Write(void *pDestination, const void
             ret_status = FLASH_IF_ERASE_ERROR;
             break; /* exit for loop */
           }
+          /* USER CODE BEGIN FLASH_IF_INT_Write_Erased */
+          /* FLASH_IF_INT_Erase() locks the flash on exit */
+          if (HAL_FLASH_Unlock() != HAL_OK)
+          {
+            ret_status = FLASH_IF_LOCK_ERROR;
+            break; /* exit for loop */
+          }
+          /* USER CODE END FLASH_IF_INT_Write_Erased */
 
           /* copy the whole flash sector including fragment from RAM to Flash */
           current_dest = page_address;
@@ -281,29 +409,7 @@ static FLASH_IF_StatusTypedef FLASH_IF_INT_Write(void *pDestination, const void
           current_length = length;
         }
 
-        for (address_offset = 0U; address_offset < current_length; address_offset += 8U)
-        {
-          /* Device voltage range supposed to be [2.7V to 3.6V], the operation will be done by word */
-          if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, current_dest,
-                                *((uint64_t *)(current_source + address_offset))) == HAL_OK)
-          {
-            /* Check the written value */
-            if (*(uint64_t *)current_dest != *(uint64_t *)(current_source + address_offset))
-            {
-              /* Flash content doesn't match SRAM content */
-              ret_status = FLASH_IF_WRITE_ERROR;
-              break;
-            }
-            /* Increment FLASH Destination address */
-            current_dest = current_dest + 8U;
-          }
-          else
-          {
-            /* Error occurred while writing data in Flash memory */
-            ret_status = FLASH_IF_WRITE_ERROR;
-            break;
-          }
-        }
+        ret_status = FLASH_IF_INT_Program(current_dest, current_source, current_length);
 
         if (ret_status != FLASH_IF_OK)
         {
@@ -448,7 +554,44 @@ static FLASH_IF_StatusTypedef FLASH_IF_INT_Clear_Error(void)
 }
 
 /* USER CODE BEGIN PrFD */
+static FLASH_IF_StatusTypedef FLASH_IF_INT_Program(uint32_t uDest, uint32_t uSource, uint32_t uLength)
+{
+  uint32_t offset = 0U;
+  uint64_t data;
+
+  while (offset < uLength)
+  {
+    if ((((uDest + offset) % FLASH_IF_ROW_SIZE) == 0U) && ((uLength - offset) >= FLASH_IF_ROW_SIZE)
+        && (((uSource + offset) & 0x3U) == 0U))
+    {
+      /* Fast programming of a full row: 32 double words in one operation */
+      if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_FAST, uDest + offset, (uint64_t)(uSource + offset)) != HAL_OK)
+      {
+        return FLASH_IF_WRITE_ERROR;
+      }
+      offset += FLASH_IF_ROW_SIZE;
+    }
+    else
+    {
+      UTIL_MEM_cpy_8(&data, (const void *)(uSource + offset), 8U);
+      /* Erased flash already reads 0xFF: skip programming it */
+      if ((data != UINT64_MAX)
+          && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, uDest + offset, data) != HAL_OK))
+      {
+        return FLASH_IF_WRITE_ERROR;
+      }
+      offset += 8U;
+    }
+  }
 
+  /* Check the written area in a single pass */
+  if (memcmp((const void *)uDest, (const void *)uSource, uLength) != 0)
+  {
+    /* Flash content doesn't match SRAM content */
+    return FLASH_IF_WRITE_ERROR;
+  }
+  return FLASH_IF_OK;
+}
 /* USER CODE END PrFD */
 
 /* HAL overload functions ---------------------------------------------------------*/
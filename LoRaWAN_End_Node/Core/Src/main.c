@@ -29,6 +29,11 @@
 #include "project_config.h"
 #include "lora_app.h"
 #include "LmHandler.h"
+#include "stm32_timer.h"
+#include "stm32_lpm.h"
+#include "utilities_conf.h"
+#include "stm32_seq.h"
+#include "usart_if.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -49,7 +54,6 @@ int TRANSMIT_INTERVAL_MS        = 900000; 	// 15 minutes in milliseconds
 
 float thresholdLevelHigh		= 2.0;
 float thresholdLevelLow			= 1.5;
-uint16_t confUplinkCounter 		= 0;
 int samplingMethod				= 0;
 int measurementMethod			= 0;
 
@@ -73,6 +77,8 @@ static LmHandlerParams_t LmHandlerParams =
 };
 
 static UTIL_TIMER_Object_t TxTimer;
+
+BootProfile_t bootProfile;
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
@@ -87,18 +93,44 @@ static UTIL_TIMER_Object_t TxTimer;
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-
+static UTIL_TIMER_Object_t BootWindowTimer;
+static volatile bool isBootWindowOpen = true;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
 void initModbusDevice(void);
+static void OnBootWindowTimerEvent(void *context);
+static void enableConsoleWakeUp(void);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+/**
+  * @brief Closes the config-mode window opened at boot
+  */
+static void OnBootWindowTimerEvent(void *context)
+{
+  isBootWindowOpen = false;
+}
+
+/**
+  * @brief Lets a start bit on LPUART1 wake the MCU from STOP2, same setup as vcom_ReceiveInit
+  */
+static void enableConsoleWakeUp(void)
+{
+  UART_WakeUpTypeDef WakeUpSelection;
 
+  WakeUpSelection.WakeUpEvent = UART_WAKEUP_ON_STARTBIT;
+  HAL_UARTEx_StopModeWakeUpSourceConfig(&hlpuart1, WakeUpSelection);
+
+  while (__HAL_UART_GET_FLAG(&hlpuart1, USART_ISR_BUSY) == SET);
+  while (__HAL_UART_GET_FLAG(&hlpuart1, USART_ISR_REACK) == RESET);
+
+  __HAL_UART_ENABLE_IT(&hlpuart1, UART_IT_WUF);
+  HAL_UARTEx_EnableStopMode(&hlpuart1);
+}
 /* USER CODE END 0 */
 
 /**
@@ -108,7 +140,7 @@ void initModbusDevice(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
-
+  paintStack();
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -130,27 +162,37 @@ int main(void)
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
   MX_LoRaWAN_Init();
+  bootProfile.lorawanInit = HAL_GetTick();
   MX_I2C1_Init();
   MX_USART1_UART_Init();
   /* USER CODE BEGIN 2 */
   initModbus(&huart1, GPIOC, GPIO_PIN_2);
+  initClockPolicy();
 
-  MX_USART2_UART_Init();
-  HAL_UART_Receive_IT(&huart2, &charRx, 1);
+  MX_LPUART1_UART_Init();
+  enableConsoleWakeUp();
+  HAL_UART_Receive_IT(&hlpuart1, &charRx, 1);
 
   HAL_UART_Receive_IT(&huart1, (uint8_t *)modbus_buffer, 1);
-
-  uint32_t startMillis = HAL_GetTick();
-  uint32_t printMillis = HAL_GetTick();
-
-  HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_SET);
-  HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
+  bootProfile.halInit = HAL_GetTick();
 
   if (FLASH_IF_Read(&DeviceParamsNVM, LORAWAN_NVM_BASE_ADDRESS, sizeof(DeviceParamsNVM)) == FLASH_IF_OK) {
 	  APP_LOG( TS_OFF, VLEVEL_M, "MODBUS Heart Beat Interval: %u ms \r\n", DeviceParamsNVM.pwxHeartbeatInterval );
   } else {
 	  APP_LOG(TS_OFF, VLEVEL_M, "FAILED READING FLASH \r\n");
   }
+  bootProfile.flashLoad = HAL_GetTick();
+
+  /* Give the user CLI_WAIT_TIME to type "set config on", sleeping in STOP2 meanwhile.
+     Only console lines run, the sequencer idles between them and wakes on the timer or a start bit */
+  UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_CliLineEvent), UTIL_SEQ_RFU, vcom_ProcessCommandLine);
+  UTIL_TIMER_Create(&BootWindowTimer, CLI_WAIT_TIME, UTIL_TIMER_ONESHOT, OnBootWindowTimerEvent, NULL);
+  UTIL_TIMER_Start(&BootWindowTimer);
+  while (isBootWindowOpen && !isConfigMode) {
+	  UTIL_SEQ_Run(1 << CFG_SEQ_Task_CliLineEvent);
+  }
+  UTIL_TIMER_Stop(&BootWindowTimer);
+  bootProfile.configWindowEnd = HAL_GetTick();
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -158,12 +200,11 @@ int main(void)
   while (1)
   {
     /* USER CODE END WHILE */
-	  while(HAL_GetTick() - startMillis < 5000){
-	    	  // give time for user to enter config mode
-	  }
-
 	  if(!isConfigMode){
 		  MX_LoRaWAN_Process();
+	  }else{
+		  /* Console only, sleeping in STOP2 between lines */
+		  UTIL_SEQ_Run(1 << CFG_SEQ_Task_CliLineEvent);
 	  }
 
     /* USER CODE BEGIN 3 */
@@ -191,8 +232,11 @@ void SystemClock_Config(void)
 
   /** Initializes the CPU, AHB and APB buses clocks
   */
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_LSE|RCC_OSCILLATORTYPE_MSI;
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI|RCC_OSCILLATORTYPE_LSE
+                              |RCC_OSCILLATORTYPE_MSI;
   RCC_OscInitStruct.LSEState = RCC_LSE_ON;
+  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
+  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
   RCC_OscInitStruct.MSIState = RCC_MSI_ON;
   RCC_OscInitStruct.MSICalibrationValue = RCC_MSICALIBRATION_DEFAULT;
   RCC_OscInitStruct.MSIClockRange = RCC_MSIRANGE_11;
@@ -25,7 +25,7 @@
 #include "usart_if.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "PWX_IdleGovernor.h"
 /* USER CODE END Includes */
 
 /* External variables ---------------------------------------------------------*/
@@ -99,10 +99,12 @@ void PWR_EnterStopMode(void)
   LL_PWR_ClearFlag_C1STOP_C1STB();
 
   /* USER CODE BEGIN EnterStopMode_2 */
+  idleGovernorOnEnter(IDLE_MODE_STOP2);
 
   /* USER CODE END EnterStopMode_2 */
   HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
   /* USER CODE BEGIN EnterStopMode_3 */
+  idleGovernorOnWake();
 
   /* USER CODE END EnterStopMode_3 */
 }
@@ -122,6 +124,7 @@ void PWR_ExitStopMode(void)
   /* Resume not retained USARTx and DMA */
   vcom_Resume();
   /* USER CODE BEGIN ExitStopMode_2 */
+  idleGovernorOnExit();
 
   /* USER CODE END ExitStopMode_2 */
 }
@@ -134,10 +137,12 @@ void PWR_EnterSleepMode(void)
   /* Suspend sysTick */
   HAL_SuspendTick();
   /* USER CODE BEGIN EnterSleepMode_2 */
+  idleGovernorOnEnter(IDLE_MODE_SLEEP);
 
   /* USER CODE END EnterSleepMode_2 */
   HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
   /* USER CODE BEGIN EnterSleepMode_3 */
+  idleGovernorOnWake();
 
   /* USER CODE END EnterSleepMode_3 */
 }
@@ -151,6 +156,7 @@ void PWR_ExitSleepMode(void)
   HAL_ResumeTick();
 
   /* USER CODE BEGIN ExitSleepMode_2 */
+  idleGovernorOnExit();
 
   /* USER CODE END ExitSleepMode_2 */
 }
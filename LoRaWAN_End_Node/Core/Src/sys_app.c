@@ -32,7 +32,7 @@
 #include "sys_sensors.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "PWX_IdleGovernor.h"
 /* USER CODE END Includes */
 
 /* External variables ---------------------------------------------------------*/
@@ -131,6 +131,7 @@ void SystemApp_Init(void)
 #endif /* LOW_POWER_DISABLE */
 
   /* USER CODE BEGIN SystemApp_Init_2 */
+  initIdleGovernor();
 
   /* USER CODE END SystemApp_Init_2 */
 }
@@ -141,6 +142,7 @@ void SystemApp_Init(void)
 void UTIL_SEQ_Idle(void)
 {
   /* USER CODE BEGIN UTIL_SEQ_Idle_1 */
+  idleGovernorSelect();
 
   /* USER CODE END UTIL_SEQ_Idle_1 */
   UTIL_LPM_EnterLowPower();
@@ -24,19 +24,24 @@
 /* USER CODE BEGIN Includes */
 #include "sys_app.h"
 #include "project_config.h"
+#include "stm32_seq.h"
+#include "utilities_def.h"
+#include <inttypes.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 /* USER CODE END Includes */
 
 /* External variables ---------------------------------------------------------*/
 /**
   * @brief DMA handle
   */
-extern DMA_HandleTypeDef hdma_usart2_tx;
+extern DMA_HandleTypeDef hdma_lpuart1_tx;
 
 /**
   * @brief UART handle
   */
-extern UART_HandleTypeDef huart2;
+extern UART_HandleTypeDef hlpuart1;
 
 /**
   * @brief buffer to receive 1 character
@@ -49,6 +54,10 @@ uint8_t charRx;
 
 bool isConfigMode = false;
 
+/* Complete line waiting for vcom_ProcessCommandLine() */
+static char commandLine[MAX_UART_BUFFER_SIZE];
+static volatile bool isCommandLinePending = false;
+
 extern ModBus_t ModbusResp;
 /* USER CODE END EV */
 
@@ -112,8 +121,8 @@ UTIL_ADV_TRACE_Status_t vcom_Init(void (*cb)(void *))
   /* USER CODE END vcom_Init_1 */
   TxCpltCallback = cb;
   MX_DMA_Init();
-  MX_USART2_UART_Init();
-  LL_EXTI_EnableIT_0_31(LL_EXTI_LINE_27);
+  MX_LPUART1_UART_Init();
+  LL_EXTI_EnableIT_0_31(LL_EXTI_LINE_28);
   return UTIL_ADV_TRACE_OK;
   /* USER CODE BEGIN vcom_Init_2 */
 
@@ -126,11 +135,11 @@ UTIL_ADV_TRACE_Status_t vcom_DeInit(void)
 
   /* USER CODE END vcom_DeInit_1 */
   /* ##-1- Reset peripherals ################################################## */
-  __HAL_RCC_USART2_FORCE_RESET();
-  __HAL_RCC_USART2_RELEASE_RESET();
+  __HAL_RCC_LPUART1_FORCE_RESET();
+  __HAL_RCC_LPUART1_RELEASE_RESET();
 
   /* ##-2- MspDeInit ################################################## */
-  HAL_UART_MspDeInit(&huart2);
+  HAL_UART_MspDeInit(&hlpuart1);
 
   /* ##-3- Disable the NVIC for DMA ########################################### */
   /* USER CODE BEGIN 1 */
@@ -148,7 +157,7 @@ void vcom_Trace(uint8_t *p_data, uint16_t size)
   /* USER CODE BEGIN vcom_Trace_1 */
 
   /* USER CODE END vcom_Trace_1 */
-  HAL_UART_Transmit(&huart2, p_data, size, 1000);
+  HAL_UART_Transmit(&hlpuart1, p_data, size, 1000);
   /* USER CODE BEGIN vcom_Trace_2 */
 
   /* USER CODE END vcom_Trace_2 */
@@ -159,7 +168,7 @@ UTIL_ADV_TRACE_Status_t vcom_Trace_DMA(uint8_t *p_data, uint16_t size)
   /* USER CODE BEGIN vcom_Trace_DMA_1 */
 
   /* USER CODE END vcom_Trace_DMA_1 */
-  HAL_UART_Transmit_DMA(&huart2, p_data, size);
+  HAL_UART_Transmit_DMA(&hlpuart1, p_data, size);
   return UTIL_ADV_TRACE_OK;
   /* USER CODE BEGIN vcom_Trace_DMA_2 */
 
@@ -179,22 +188,22 @@ UTIL_ADV_TRACE_Status_t vcom_ReceiveInit(void (*RxCb)(uint8_t *rxChar, uint16_t
   /*Set wakeUp event on start bit*/
   WakeUpSelection.WakeUpEvent = UART_WAKEUP_ON_STARTBIT;
 
-  HAL_UARTEx_StopModeWakeUpSourceConfig(&huart2, WakeUpSelection);
+  HAL_UARTEx_StopModeWakeUpSourceConfig(&hlpuart1, WakeUpSelection);
 
   /* Make sure that no UART transfer is on-going */
-  while (__HAL_UART_GET_FLAG(&huart2, USART_ISR_BUSY) == SET);
+  while (__HAL_UART_GET_FLAG(&hlpuart1, USART_ISR_BUSY) == SET);
 
   /* Make sure that UART is ready to receive)   */
-  while (__HAL_UART_GET_FLAG(&huart2, USART_ISR_REACK) == RESET);
+  while (__HAL_UART_GET_FLAG(&hlpuart1, USART_ISR_REACK) == RESET);
 
   /* Enable USART interrupt */
-  __HAL_UART_ENABLE_IT(&huart2, UART_IT_WUF);
+  __HAL_UART_ENABLE_IT(&hlpuart1, UART_IT_WUF);
 
   /*Enable wakeup from stop mode*/
-  HAL_UARTEx_EnableStopMode(&huart2);
+  HAL_UARTEx_EnableStopMode(&hlpuart1);
 
   /*Start LPUART receive on IT*/
-  HAL_UART_Receive_IT(&huart2, &charRx, 1);
+  HAL_UART_Receive_IT(&hlpuart1, &charRx, 1);
 
   return UTIL_ADV_TRACE_OK;
   /* USER CODE BEGIN vcom_ReceiveInit_2 */
@@ -207,14 +216,9 @@ void vcom_Resume(void)
   /* USER CODE BEGIN vcom_Resume_1 */
 
   /* USER CODE END vcom_Resume_1 */
-  /*to re-enable lost UART settings*/
-  if (HAL_UART_Init(&huart2) != HAL_OK)
-  {
-    Error_Handler();
-  }
-
-  /*to re-enable lost DMA settings*/
-  if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK)
+  /* LPUART1 is retained in STOP2: re-initialising it would drop the characters
+     received while waking up, only the DMA settings are lost */
+  if (HAL_DMA_Init(&hdma_lpuart1_tx) != HAL_OK)
   {
     Error_Handler();
   }
@@ -229,7 +233,7 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 
   /* USER CODE END HAL_UART_TxCpltCallback_1 */
   /* buffer transmission complete*/
-  if (huart->Instance == USART2)
+  if (huart->Instance == LPUART1)
   {
     TxCpltCallback(NULL);
   }
@@ -241,19 +245,10 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 {
   /* USER CODE BEGIN HAL_UART_RxCpltCallback_1 */
-  static char buffer[MAX_UART_BUFFER_SIZE];  // Static buffer for command storage
+  static char buffer[MAX_UART_BUFFER_SIZE];  // Line being received
   static uint8_t bufferIndex = 0;
-  static uint8_t devEui[SE_EUI_SIZE]; // Array to store DevEUI bytes
-  static uint8_t _devEui[8]; // Array to store DevEUI bytes
-  static uint8_t appEui[8]; // Array to store DevEUI bytes
-  static uint8_t appKey[16]; // Array to store DevEUI bytes
-  static uint64_t txInterval;
-  static uint64_t hbInterval;
-
-  SecureElementNvmData_t FlashNVM; //
-
   /* USER CODE END HAL_UART_RxCpltCallback_1 */
-  if (huart->Instance == USART2)
+  if (huart->Instance == LPUART1)
   {
     if ((NULL != RxCpltCallback) && (HAL_UART_ERROR_NONE == huart->ErrorCode))
     {
@@ -262,9 +257,60 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 
     /* Check for newline character */
 	if (charRx == '\n') {
-		/* Terminate buffer with null character for string processing */
-		buffer[bufferIndex] = '\0';
+		/* Hand the line to the sequencer, the command runs outside the interrupt */
+		if (!isCommandLinePending) {
+			memcpy(commandLine, buffer, bufferIndex);
+			commandLine[bufferIndex] = '\0';
+			isCommandLinePending = true;
+			UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_CliLineEvent), CFG_SEQ_Prio_0);
+		} else {
+			APP_LOG(TS_OFF, VLEVEL_M, "###### Busy, command dropped \r\n");
+		}
+
+		/* Reset buffer index and prepare for next command */
+		bufferIndex = 0;
+	} else {
+		/* Store received byte in buffer (handle buffer overflow) */
+		if (bufferIndex < MAX_UART_BUFFER_SIZE - 1) {
+			buffer[bufferIndex++] = charRx;
+		} else {
+			// Handle buffer overflow (e.g., print error message)
+		}
+	}
 
+    HAL_UART_Receive_IT(huart, &charRx, 1);
+  }
+  /* USER CODE BEGIN HAL_UART_RxCpltCallback_2 */
+  if (huart->Instance == USART1) {
+
+ 	Modbus_RxCallback(&ModbusResp);
+ 	HAL_UART_Receive_IT(&huart1, (uint8_t *)(ModbusResp.buffer + ModbusResp.rxIndex), 1);
+
+   }
+  /* USER CODE END HAL_UART_RxCpltCallback_2 */
+}
+
+
+/* USER CODE BEGIN EF */
+void vcom_ProcessCommandLine(void)
+{
+  static char buffer[MAX_UART_BUFFER_SIZE];  // Static buffer for command storage
+  static uint8_t devEui[SE_EUI_SIZE]; // Array to store DevEUI bytes
+  static uint8_t _devEui[8]; // Array to store DevEUI bytes
+  static uint8_t appEui[8]; // Array to store DevEUI bytes
+  static uint8_t appKey[16]; // Array to store DevEUI bytes
+  static uint64_t txInterval;
+  static uint64_t hbInterval;
+
+  SecureElementNvmData_t FlashNVM; //
+
+  UTILS_ENTER_CRITICAL_SECTION();
+  memcpy(buffer, commandLine, sizeof(buffer));
+  isCommandLinePending = false;
+  UTILS_EXIT_CRITICAL_SECTION();
+
+	/* An empty line is not a command */
+	if (buffer[0] != '\0') {
 		/* Enter Device to Config Mode */
 		if (strncmp(buffer, "set config on", 13) == 0) {
 			APP_LOG(TS_OFF, VLEVEL_M, "###### Configuration Mode: ON \r\n");
@@ -321,7 +367,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else if (strncmp(buffer, "set deveui ", 11) == 0) {
 			/* Parse and store hexadecimal bytes */
 			for (int i = 0; i < 8; i++) {
-			  sscanf(&buffer[11 + i * 2], "%02x", &_devEui[i]);
+			  sscanf(&buffer[11 + i * 2], "%2hhx", &_devEui[i]);
 			}
 			APP_LOG( TS_OFF, VLEVEL_M, "###### DevEUI:      %02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X\r\n", HEX8(_devEui));
 
@@ -331,7 +377,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else if (strncmp(buffer, "set appeui ", 11) == 0) {
 			/* Parse and store hexadecimal bytes */
 			for (int i = 0; i < 8; i++) {
-			  sscanf(&buffer[11 + i * 2], "%02x", &appEui[i]);
+			  sscanf(&buffer[11 + i * 2], "%2hhx", &appEui[i]);
 			}
 			APP_LOG( TS_OFF, VLEVEL_M, "###### AppEUI:      %02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X\r\n", HEX8(appEui));
 
@@ -341,7 +387,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else if (strncmp(buffer, "set appkey ", 11) == 0) {
 			/* Parse and store hexadecimal bytes */
 			for (int i = 0; i < 16; i++) {
-			  sscanf(&buffer[11 + i * 2], "%02x", &appKey[i]);
+			  sscanf(&buffer[11 + i * 2], "%2hhx", &appKey[i]);
 			}
 			APP_LOG( TS_OFF, VLEVEL_M, "###### APPKEY:      %02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X\r\n", HEX16(appKey));
 		}
@@ -350,7 +396,11 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else if (strncmp(buffer, "set lora-tx interval ", 21) == 0) {
 			// Add code for APP INTERVAL
 
-			sscanf(&buffer[21], "%u", &txInterval);
+			uint32_t interval;
+
+			if (sscanf(&buffer[21], "%" SCNu32, &interval) == 1) {
+				txInterval = interval;
+			}
 
 			APP_LOG( TS_OFF, VLEVEL_M, "###### ModBus Burst Interval: %u \r\n", txInterval);
 
@@ -359,7 +409,11 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else if (strncmp(buffer, "set modbus-hb interval ", 23) == 0) {
 			// Add code for APP INTERVAL
 
-			sscanf(&buffer[23], "%u", &hbInterval);
+			uint32_t interval;
+
+			if (sscanf(&buffer[23], "%" SCNu32, &interval) == 1) {
+				hbInterval = interval;
+			}
 
 			APP_LOG( TS_OFF, VLEVEL_M, "###### ModBus Heartbeat Interval: %u \r\n", hbInterval);
 
@@ -423,7 +477,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		/* View Device and Segment Settings */
 		else if (strncmp(buffer, "get modbus-params dev ", 22) == 0) {
 		    uint8_t devID, segID;
-		    if (sscanf(&buffer[22], "%u seg %u", &devID, &segID) == 2) {
+		    if (sscanf(&buffer[22], "%hhu seg %hhu", &devID, &segID) == 2) {
 
 		    	if(devID >= 1 && devID <= 16 && segID >= 1 && segID <= 16){
 
@@ -475,7 +529,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 			uint8_t cmdID, devId, baudRate, parity, stopBit, isActive;
 
 			// Parse the input string
-			int parsed = sscanf(buffer, "set device-params %u %u %u %u %u %u", &cmdID, &devId, &baudRate, &parity, &stopBit, &isActive);
+			int parsed = sscanf(buffer, "set device-params %hhu %hhu %hhu %hhu %hhu %hhu", &cmdID, &devId, &baudRate, &parity, &stopBit, &isActive);
 
 			// Check if all values were successfully parsed
 			if (parsed == 6) {
@@ -518,7 +572,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else if (strncmp(buffer, "set segment-params ", 19) == 0) {
 			uint8_t cmdID, devId, segId, enSegment, sendNow, validAdd_1, validAdd_2, validAdd_3, validAdd_4, cmdSize;
 
-			int parsed = sscanf(buffer, "set segment-params %u %u %u %u %u %x %x %x %x %x ", &cmdID, &devId, &segId, &enSegment, &sendNow, &validAdd_1, &validAdd_2, &validAdd_3, &validAdd_4, &cmdSize);
+			int parsed = sscanf(buffer, "set segment-params %hhu %hhu %hhu %hhu %hhu %hhx %hhx %hhx %hhx %hhx ", &cmdID, &devId, &segId, &enSegment, &sendNow, &validAdd_1, &validAdd_2, &validAdd_3, &validAdd_4, &cmdSize);
 
 			uint32_t _validAddr = 0;
 
@@ -534,7 +588,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 
 
 				for(uint8_t i = 0; i < cmdSize; i++){
-					sscanf(&buffer[49 + (i * 3)], "%x ", (unsigned int *)&cmdRaw[i]);
+					sscanf(&buffer[49 + (i * 3)], "%hhx ", &cmdRaw[i]);
 				}
 
 
@@ -587,7 +641,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		/* Clear Device Settings */
 		else if (strncmp(buffer, "clear modbus-params dev ", 24) == 0) {
 			uint8_t devID;
-			sscanf(&buffer[24], "%u ", &devID);
+			sscanf(&buffer[24], "%hhu ", &devID);
 			clearModbusParams(devID);
 		}
 
@@ -601,7 +655,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else if (strncmp(buffer, "set slot-params ", 16) == 0) {
 			uint8_t cmdID, slotId, dataType, valueStartIndex, THActive_1, THActive_2, SpikeUp_1, SpikeUp_2, SpikeUp_3, SpikeUp_4, SpikeDown_1, SpikeDown_2, SpikeDown_3, SpikeDown_4, THHigh_1, THHigh_2, THHigh_3, THHigh_4, THLow_1, THLow_2, THLow_3, THLow_4, onChange, cmdSize;
 
-			int parsed = sscanf(buffer, "set slot-params %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x ", &cmdID, &slotId, &dataType, &valueStartIndex, &THActive_1, &THActive_2, &SpikeUp_1, &SpikeUp_2, &SpikeUp_3, &SpikeUp_4, &SpikeDown_1, &SpikeDown_2, &SpikeDown_3, &SpikeDown_4, &THHigh_1, &THHigh_2, &THHigh_3, &THHigh_4, &THLow_1, &THLow_2, &THLow_3, &THLow_4, &onChange, &cmdSize);
+			int parsed = sscanf(buffer, "set slot-params %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx %hhx ", &cmdID, &slotId, &dataType, &valueStartIndex, &THActive_1, &THActive_2, &SpikeUp_1, &SpikeUp_2, &SpikeUp_3, &SpikeUp_4, &SpikeDown_1, &SpikeDown_2, &SpikeDown_3, &SpikeDown_4, &THHigh_1, &THHigh_2, &THHigh_3, &THHigh_4, &THLow_1, &THLow_2, &THLow_3, &THLow_4, &onChange, &cmdSize);
 			if(parsed == 24){
 				APP_LOG(TS_OFF, VLEVEL_M, "NUM PARSED DATA: %d \r\n", parsed);
 				APP_LOG(TS_OFF, VLEVEL_M, "SLOT ID: %d \r\n", slotId);
@@ -624,7 +678,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 
 
 				for(uint8_t i = 0; i < cmdSize; i++){
-					sscanf(&buffer[88 + (i * 3)], "%x ", (unsigned int *)&cmdRaw[i]);
+					sscanf(&buffer[88 + (i * 3)], "%hhx ", &cmdRaw[i]);
 				}
 
 
@@ -713,13 +767,13 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 
 		else if (strncmp(buffer, "view slot-params ", 17) == 0) {
 			uint8_t slotId;
-			sscanf(&buffer[17], "%u", &slotId);
+			sscanf(&buffer[17], "%hhu", &slotId);
 			viewMonitoringSlotParams(slotId - 1);
 		}
 
 		else if (strncmp(buffer, "clear slot-params ", 18) == 0) {
 			uint8_t slotId;
-			sscanf(&buffer[18], "%u", &slotId);
+			sscanf(&buffer[18], "%hhu", &slotId);
 			initMonitoringSlotParams(slotId - 1);
 			viewMonitoringSlotParams(slotId - 1);
 		}
@@ -733,7 +787,7 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 
 		else if (strncmp(buffer, "set slot-active ", 16) == 0) {
 			uint8_t slotId, state;
-			sscanf(&buffer[16], "%u %u", &slotId, &state);
+			sscanf(&buffer[16], "%hhu %hhu", &slotId, &state);
 
 			struct ModbusDevice MonitoringSlotNVM;
 
@@ -765,33 +819,8 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 		else {
 			APP_LOG(TS_OFF, VLEVEL_M, "###### Invalid Command! \r\n");
 		}
-
-		/* Reset buffer index and prepare for next command */
-		bufferIndex = 0;
-	} else {
-		/* Store received byte in buffer (handle buffer overflow) */
-		if (bufferIndex < MAX_UART_BUFFER_SIZE - 1) {
-			buffer[bufferIndex++] = charRx;
-		} else {
-			// Handle buffer overflow (e.g., print error message)
-		}
 	}
-
-    HAL_UART_Receive_IT(huart, &charRx, 1);
-  }
-  /* USER CODE BEGIN HAL_UART_RxCpltCallback_2 */
-  if (huart->Instance == USART1) {
-
- 	Modbus_RxCallback(&ModbusResp);
- 	HAL_UART_Receive_IT(&huart1, (uint8_t *)(ModbusResp.buffer + ModbusResp.rxIndex), 1);
-
-   }
-  /* USER CODE END HAL_UART_RxCpltCallback_2 */
 }
-
-
-/* USER CODE BEGIN EF */
-
 /* USER CODE END EF */
 
 /* Private Functions Definition -----------------------------------------------*/
@@ -65,6 +65,7 @@
 #define LPP_GPS_SIZE                 11
 
 /* USER CODE BEGIN PD */
+#define LPP_SERIES              200     /* value type, base time, step and count, then the values */
 
 /* USER CODE END PD */
 
@@ -390,6 +391,30 @@ uint8_t CayenneLppAddGps(uint8_t channel, float latitude, float longitude, float
 }
 
 /* USER CODE BEGIN EF */
+uint8_t CayenneLppAddAnalogInputSeries(uint8_t channel, uint32_t baseTime, uint16_t step, const int16_t *values,
+                                       uint8_t count)
+{
+  if ((count == 0) || ((CayenneLppCursor + CAYENNE_LPP_ANALOG_SERIES_SIZE(count)) > CAYENNE_LPP_MAXBUFFER_SIZE))
+  {
+    return 0;
+  }
+  CayenneLppBuffer[CayenneLppCursor++] = channel;
+  CayenneLppBuffer[CayenneLppCursor++] = LPP_SERIES;
+  CayenneLppBuffer[CayenneLppCursor++] = LPP_ANALOG_INPUT;
+  CayenneLppBuffer[CayenneLppCursor++] = baseTime >> 24;
+  CayenneLppBuffer[CayenneLppCursor++] = baseTime >> 16;
+  CayenneLppBuffer[CayenneLppCursor++] = baseTime >> 8;
+  CayenneLppBuffer[CayenneLppCursor++] = baseTime;
+  CayenneLppBuffer[CayenneLppCursor++] = step >> 8;
+  CayenneLppBuffer[CayenneLppCursor++] = step;
+  CayenneLppBuffer[CayenneLppCursor++] = count;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    CayenneLppBuffer[CayenneLppCursor++] = values[i] >> 8;
+    CayenneLppBuffer[CayenneLppCursor++] = values[i];
+  }
+  return CayenneLppCursor;
+}
 
 /* USER CODE END EF */
 
@@ -39,6 +39,12 @@ extern "C" {
 
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
+/*
+ * Series record: [channel][LPP_SERIES][value type][base time u32][step s u16][count u8]
+ * followed by count values of the value type, sample i taken at base time + i * step
+ */
+#define CAYENNE_LPP_SERIES_HEADER_SIZE              10
+#define CAYENNE_LPP_ANALOG_SERIES_SIZE(count)       (CAYENNE_LPP_SERIES_HEADER_SIZE + (2 * (count)))
 
 /* USER CODE END EC */
 
@@ -88,6 +94,17 @@ uint8_t CayenneLppAddGyrometer( uint8_t channel, float x, float y, float z );
 uint8_t CayenneLppAddGps( uint8_t channel, float latitude, float longitude, float meters );
 
 /* USER CODE BEGIN EFP */
+/**
+  * @brief Adds regularly spaced analog input samples of one channel as a single series record
+  * @param channel channel of the samples
+  * @param baseTime time of the first sample, in s
+  * @param step time between samples, in s
+  * @param values samples in 0.01 units
+  * @param count number of samples, 1 to 255
+  * @retval buffer size after the record, 0 if it does not fit
+  */
+uint8_t CayenneLppAddAnalogInputSeries(uint8_t channel, uint32_t baseTime, uint16_t step, const int16_t *values,
+                                       uint8_t count);
 
 /* USER CODE END EFP */
 
@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "usart.h"
+#include "LoRaMac.h"
 #include "LoRaMacCrypto.h"
 #include "project_config.h"
 
@@ -51,26 +52,12 @@
 /* External variables ---------------------------------------------------------*/
 /* USER CODE BEGIN EV */
 
-/**
-  * @brief LoRaWAN handler parameters for Confirmed Uplink
-  */
-static LmHandlerParams_t LmHandlerParamsConfirmed =
-{
-  .ActiveRegion =             ACTIVE_REGION,
-  .DefaultClass =             LORAWAN_DEFAULT_CLASS,
-  .AdrEnable =                LORAWAN_ADR_STATE,
-  .IsTxConfirmed =            LORAMAC_HANDLER_CONFIRMED_MSG,
-  .TxDatarate =               LORAWAN_DEFAULT_DATA_RATE,
-  .TxPower =                  LORAWAN_DEFAULT_TX_POWER,
-  .PingSlotPeriodicity =      LORAWAN_DEFAULT_PING_SLOT_PERIODICITY,
-  .RxBCTimeout =              LORAWAN_DEFAULT_CLASS_B_C_RESP_TIMEOUT
-};
-
 //int MAX_WATER_LEVEL_SAMPLES 	= 1;
 //int SAMPLE_INTERVAL_MS          = 60000;  	// 1 minute/s in milliseconds
 //int TRANSMIT_INTERVAL_MS        = 60000; 	// 1 minute/s in milliseconds
 
 bool hasJoined 					= false;
+static LinkUplinkType_t uplinkType = LINK_UPLINK_UNCONFIRMED;	// kind of the last scheduled uplink
 int transmissionType			= 0;		// 0: Scheduled	; 1: Unscheduled ; 2: System Diagnostic
 bool skipScheduledTransmission	= false;
 bool sendSystemDiagnostic		= false;
@@ -112,6 +99,7 @@ float * waterLevelSamples;    //waterLevelSamples = (int*)malloc(sizeof(int)*MAX
 int getDevnonce 				= 0;
 uint32_t getAddress 			= 0;
 bool devNonceInitialized 		= false;
+static uint64_t FlashPageBuffer[FLASH_PAGE_SIZE / sizeof(uint64_t)];	// FLASH_IF_DiffWrite restores an erased page from it
 
 //TX Process
 bool justTransmitted 			= false;
@@ -151,7 +139,7 @@ FLASH_IF_StatusTypedef write_devnonce_to_flash(uint32_t devnonce) {
 
     APP_LOG(TS_OFF, VLEVEL_M, "\r\n WRITING DEVNONCE TO FLASH \r\n");
 
-    if (FLASH_IF_Init(NULL) != FLASH_IF_OK) {
+    if (FLASH_IF_Init(FlashPageBuffer) != FLASH_IF_OK) {
         APP_LOG(TS_OFF, VLEVEL_M, "\r\n Error: Flash failed to initialize \r\n");
         return FLASH_IF_ERROR;
     }
@@ -297,11 +285,8 @@ float averageWaterLevel() {
  *
  */
 void fetchSingleShotData() {
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
-
-	HAL_Delay(1500);
-	uint8_t msg[100]; //! Buffer for storing messages to be transmitted via UART
+	acquireSensorRail();
+	waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp);
 	uint8_t ModbusCommand[8] = {0x01,0x03,0x00,0x03,0x00,0x01,0x74,0x0A};
 	uint16_t CommandSize = sizeof(ModbusCommand) / sizeof(ModbusCommand[0]);
 
@@ -317,14 +302,12 @@ void fetchSingleShotData() {
 	rawLevelVal = parseReply(ModbusResp.buffer);
 
 	//APP_LOG(TS_OFF, VLEVEL_M, " Water Level: %d\r\n", rawLevelVal);
-	sprintf((char*)msg, "Water Level: %f \r\n", rawLevelVal);
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "Water Level: %.3q \r\n", FIXED_POINT(rawLevelVal, 1000));
 
 	APP_LOG(TS_OFF, VLEVEL_M, " \r\n");
 	HAL_Delay(1000);
 
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_RESET);
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_RESET);
+	releaseSensorRail();
 }
 
 
@@ -497,6 +480,80 @@ static void OnRxTimerLedEvent(void *context);
   */
 static void OnJoinTimerLedEvent(void *context);
 
+/**
+  * @brief  Sends the next chunk of a requested history range
+  */
+static void SendHistoryBackfill(void);
+
+/**
+  * @brief  History backfill timer callback function
+  * @param  context ptr of backfill context
+  */
+static void OnHistoryBackfillTimerEvent(void *context);
+
+/**
+  * @brief  Logs the boot-phase timestamps
+  */
+static void LogBootProfile(void);
+
+/**
+  * @brief  Validates and commits a TLV configuration downlink, then schedules its acknowledgement
+  * @param  appData downlink on CONFIG_TLV_PORT
+  */
+static void HandleConfigTlv(const LmHandlerAppData_t *appData);
+
+/**
+  * @brief  Sends the pending TLV configuration acknowledgement
+  */
+static void SendConfigTlvAck(void);
+
+/**
+  * @brief  TLV configuration acknowledgement timer callback function
+  * @param  context ptr of acknowledgement context
+  */
+static void OnConfigTlvAckTimerEvent(void *context);
+
+/**
+  * @brief  Runs queued Modbus passthrough requests, then uplinks their responses
+  */
+static void ProcessModbusPassthrough(void);
+
+/**
+  * @brief  Modbus passthrough timer callback function
+  * @param  context ptr of passthrough context
+  */
+static void OnModbusPassthroughTimerEvent(void *context);
+
+/**
+  * @brief  Opens the armed Class C alarm window, or closes it once elapsed
+  */
+static void ProcessAlarmWindow(void);
+
+/**
+  * @brief  Alarm window timer callback function
+  * @param  context ptr of alarm window context
+  */
+static void OnAlarmWindowTimerEvent(void *context);
+
+/**
+  * @brief  Scans the Modbus sections of the cycle, then uplinks them packed into as few frames as possible
+  */
+static void ProcessModbusSections(void);
+
+/**
+  * @brief  Modbus section timer callback function
+  * @param  context ptr of section context
+  */
+static void OnModbusSectionTimerEvent(void *context);
+
+/**
+  * @brief  Packs the boot profile into a diagnostic uplink
+  * @param  destination output buffer
+  * @param  maxSize bytes left in the uplink
+  * @retval number of bytes written, 0 if it does not fit
+  */
+static uint8_t AppendBootProfile(uint8_t *destination, size_t maxSize);
+
 /* USER CODE END PFP */
 
 /* Private variables ---------------------------------------------------------*/
@@ -601,71 +658,75 @@ static UTIL_TIMER_Object_t RxLedTimer;
   */
 static UTIL_TIMER_Object_t JoinLedTimer;
 
-/* USER CODE END PV */
+/**
+  * @brief Timer pacing the history backfill uplinks
+  */
+static UTIL_TIMER_Object_t HistoryBackfillTimer;
 
-/* Exported functions ---------------------------------------------------------*/
+/**
+  * @brief History backfill buffer, kept apart from AppData so scheduled uplinks are untouched
+  */
+static uint8_t HistoryBackfillBuffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+static LmHandlerAppData_t HistoryBackfillData = { HISTORY_BACKFILL_REPLY_PORT, 0, HistoryBackfillBuffer };
 
-/* USER CODE BEGIN EF */
+static bool isBackfillActive = false;
+static uint32_t backfillNextSeq = 0;
+static uint32_t backfillLastSeq = 0;
 
 /**
- * PANIC Function to reset device configuration to default
- */
-void panicMode(void){
-	SecureElementNvmData_t FlashNVM;
+  * @brief Scheduled uplink held back by a link outage, sent first once the rejoin is done
+  */
+static uint8_t OutageHeldBuffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+static LmHandlerAppData_t OutageHeldData = { LORAWAN_USER_APP_PORT, 0, OutageHeldBuffer };
+static bool isOutageFrameHeld = false;
 
-	APP_LOG(TS_OFF, VLEVEL_M, "\r\n==============================================\r\n");
-	APP_LOG(TS_OFF, VLEVEL_M, "\r\n 		[!]	I F*CKED UP MODE [!]              \r\n");
-	APP_LOG(TS_OFF, VLEVEL_M, "\r\n==============================================\r\n");
-	APP_LOG(TS_OFF, VLEVEL_M, "\r\n Reverting all device configuration to default \r\n");
+/**
+  * @brief Timer delaying the TLV configuration acknowledgement until the MAC is idle
+  */
+static UTIL_TIMER_Object_t ConfigTlvAckTimer;
 
-	if (FLASH_IF_Read(&FlashNVM, LORAWAN_NVM_BASE_ADDRESS, sizeof(FlashNVM)) == FLASH_IF_OK) {
-		FlashNVM.pwxWaterLevelThresholdHigh = (uint16_t)15.0;
-		thresholdLevelHigh = 15.0;
-		HAL_Delay(50);
-		FlashNVM.pwxWaterLevelThresholdLow = (uint16_t)0.0;
-		thresholdLevelLow = 0.0;
-		HAL_Delay(50);
-		FlashNVM.pwxTxInterval = (uint64_t)900000;
-		TRANSMIT_INTERVAL_MS = 900000;
-		HAL_Delay(50);
-		FlashNVM.pwxCnfUplinkCount = (uint16_t)4;
-		MAX_UPLINK_BEFORE_CONFIRMED = 4;
-		confUplinkCounter = 0;
-		HAL_Delay(50);
-		FlashNVM.pwxSamplingCount = (uint16_t)5;
-		MAX_WATER_LEVEL_SAMPLES = 5;
-    	waterLevelSamples = (float*)malloc(sizeof(int)*MAX_WATER_LEVEL_SAMPLES);
-    	SAMPLE_INTERVAL_MS = (TRANSMIT_INTERVAL_MS/MAX_WATER_LEVEL_SAMPLES);
-	} else {
-		APP_LOG(TS_OFF, VLEVEL_M, "FAILED READING FLASH \r\n");
-	}
+static uint8_t ConfigTlvAckBuffer[CONFIG_TLV_ACK_SIZE];
+static LmHandlerAppData_t ConfigTlvAckData = { CONFIG_TLV_REPLY_PORT, 0, ConfigTlvAckBuffer };
 
-	/* Save to NVM */
-	if (FLASH_IF_Erase(LORAWAN_NVM_BASE_ADDRESS, FLASH_PAGE_SIZE) == FLASH_IF_OK){
-		if(FLASH_IF_Write(LORAWAN_NVM_BASE_ADDRESS, &FlashNVM, sizeof(FlashNVM)) == FLASH_IF_OK){
-			APP_LOG(TS_OFF, VLEVEL_M, "###### Success Saving to Flash \r\n");
-		}else{
-			APP_LOG(TS_OFF, VLEVEL_M, "###### Error Saving to Flash \r\n");
-		}
-	}else{
-		APP_LOG(TS_OFF, VLEVEL_M, "###### Error Erasing Flash \r\n");
-	}
+/**
+  * @brief Timer pacing the Modbus passthrough response uplinks
+  */
+static UTIL_TIMER_Object_t ModbusPassthroughTimer;
 
-	HAL_Delay(500);
-	HAL_NVIC_SystemReset();
-	APP_LOG(TS_OFF, VLEVEL_M, "\r\n==============================================\r\n");
-}
+static uint8_t ModbusPassthroughBuffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+static LmHandlerAppData_t ModbusPassthroughData = { LORAWAN_BYPASS_REPLY_PORT, 0, ModbusPassthroughBuffer };
+
+/**
+  * @brief Timer ending the Class C alarm window, or retrying the class switch while the MAC is busy
+  */
+static UTIL_TIMER_Object_t AlarmWindowTimer;
+
+/**
+  * @brief Timer pacing the Modbus section uplinks
+  */
+static UTIL_TIMER_Object_t ModbusSectionTimer;
+
+static uint8_t ModbusSectionBuffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+static LmHandlerAppData_t ModbusSectionData = { MODBUS_SECTION_PORT, 0, ModbusSectionBuffer };
+
+/**
+  * @brief Set by a scheduled uplink, the section task scans the devices before sending
+  */
+static bool isModbusSectionScanDue = false;
+
+/* USER CODE END PV */
+
+/* Exported functions ---------------------------------------------------------*/
+
+/* USER CODE BEGIN EF */
 
 /**
  *  Initial water level distance value fetch
  *
  */
 void fetchSensorDataOnce() {
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
-
-	HAL_Delay(1500);
-	uint8_t msg[100]; // Buffer for storing messages to be transmitted via UART
+	acquireSensorRail();
+	waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp);
 	uint8_t ModbusCommand[8] = {0x01,0x03,0x00,0x03,0x00,0x01,0x74,0x0A};
 	uint16_t CommandSize = sizeof(ModbusCommand) / sizeof(ModbusCommand[0]);
 	float waterLevels[readingCount];
@@ -696,8 +757,7 @@ void fetchSensorDataOnce() {
 		waterLevels[i] = rawLevelVal;
 		HAL_Delay(50);
 		//APP_LOG(TS_OFF, VLEVEL_M, " Water Level: %d\r\n", rawLevelVal);
-		sprintf((char*)msg, "\r\nWater Level: %f \r\n", rawLevelVal);
-		HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+		APP_LOG(TS_OFF, VLEVEL_M, "\r\nWater Level: %.3q \r\n", FIXED_POINT(rawLevelVal, 1000));
 
 		APP_LOG(TS_OFF, VLEVEL_M, " \r\n");
 		HAL_Delay(1000);
@@ -728,8 +788,8 @@ void fetchSensorDataOnce() {
 		waterLevelMax = waterLevel;
 	}
 
-	sprintf((char*)msg, "Final Water Level: %f \r\n", waterLevel);
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "Final Water Level: %.3q \r\n", FIXED_POINT(waterLevel, 1000));
+	releaseSensorRail();
 }
 
 
@@ -738,11 +798,8 @@ void fetchSensorDataOnce() {
  */
 void fetchSensorDataDifferential(void) {
 
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
-
-	HAL_Delay(1500);
-	uint8_t msg[100]; // Buffer for storing messages to be transmitted via UART
+	acquireSensorRail();
+	waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp);
 	uint8_t ModbusCommand[8] = {0x01,0x03,0x00,0x03,0x00,0x01,0x74,0x0A};
 	uint16_t CommandSize = sizeof(ModbusCommand) / sizeof(ModbusCommand[0]);
 	float waterLevelChange;
@@ -776,8 +833,7 @@ void fetchSensorDataDifferential(void) {
 	    differentialLevels[i] = rawLevelVal - waterLevelLatest; // Calculate the difference
 	    HAL_Delay(50);
 
-	    sprintf((char*)msg, "\r\nWater Level: %f, Differential: %f \r\n", rawLevelVal, differentialLevels[i]);
-	    HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	    APP_LOG(TS_OFF, VLEVEL_M, "\r\nWater Level: %.3q, Differential: %.3q \r\n", FIXED_POINT(rawLevelVal, 1000), FIXED_POINT(differentialLevels[i], 1000));
 
 	    APP_LOG(TS_OFF, VLEVEL_M, " \r\n");
 	    HAL_Delay(1000);
@@ -803,8 +859,7 @@ void fetchSensorDataDifferential(void) {
 	// Update the latest water level
 	waterLevelLatest = waterLevel + waterLevelChange;
 
-	sprintf((char*)msg, "\r\nWater Level Change: %f \r\n", waterLevelChange);
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "\r\nWater Level Change: %.3q \r\n", FIXED_POINT(waterLevelChange, 1000));
 
 	if(waterLevelMin == 0 && waterLevelMax == 0){
 		waterLevelMin = waterLevelMax = waterLevelLatest;
@@ -816,11 +871,11 @@ void fetchSensorDataDifferential(void) {
 		waterLevelMax = waterLevelLatest;
 	}
 
-	sprintf((char*)msg, "Final Water Level: %f \r\n", waterLevel);
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "Final Water Level: %.3q \r\n", FIXED_POINT(waterLevel, 1000));
 
     waterLevelSamples[sampleIndex] = waterLevel;
     sampleIndex += 1;
+    recordTimedSample((uint16_t)MIN(MAX(waterLevel * 100, 0.0f), (float)UINT16_MAX));	// cm, clamped before the cast
 
     TRANSMIT_INTERVAL_MS = 180000;
     APP_LOG(TS_OFF, VLEVEL_M, "Transmission Cycle: %d seconds \r\n", TRANSMIT_INTERVAL_MS / 1000);
@@ -831,8 +886,7 @@ void fetchSensorDataDifferential(void) {
     isLevelBreached = false;
 
 	APP_LOG(TS_OFF, VLEVEL_M, "\r\n");
-//	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_RESET);
-//	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_RESET);
+	releaseSensorRail();
 }
 
 /* Function to get water level distance value
@@ -843,11 +897,8 @@ void fetchSensorData(void) {
 	bool sendUnscheduledTransmission = false;
 	SecureElementNvmData_t FlashNVM;
 
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
-
-	HAL_Delay(1500);
-	uint8_t msg[100]; // Buffer for storing messages to be transmitted via UART
+	acquireSensorRail();
+	waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp);
 	uint8_t ModbusCommand[8] = {0x01,0x03,0x00,0x03,0x00,0x01,0x74,0x0A};
 	uint16_t CommandSize = sizeof(ModbusCommand) / sizeof(ModbusCommand[0]);
 	float waterLevels[readingCount];
@@ -878,8 +929,7 @@ void fetchSensorData(void) {
 		waterLevels[i] = rawLevelVal;
 		HAL_Delay(50);
 		//APP_LOG(TS_OFF, VLEVEL_M, " Water Level: %d\r\n", rawLevelVal);
-		sprintf((char*)msg, "\r\nWater Level: %f \r\n", rawLevelVal);
-		HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+		APP_LOG(TS_OFF, VLEVEL_M, "\r\nWater Level: %.3q \r\n", FIXED_POINT(rawLevelVal, 1000));
 
 		APP_LOG(TS_OFF, VLEVEL_M, " \r\n");
 		HAL_Delay(1000);
@@ -917,11 +967,11 @@ void fetchSensorData(void) {
 		waterLevelMax = waterLevel;
 	}
 
-	sprintf((char*)msg, "Final Water Level: %f \r\n", waterLevel);
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "Final Water Level: %.3q \r\n", FIXED_POINT(waterLevel, 1000));
 
     waterLevelSamples[sampleIndex] = waterLevel;
     sampleIndex += 1;
+    recordTimedSample((uint16_t)MIN(MAX(waterLevel * 100, 0.0f), (float)UINT16_MAX));	// cm, clamped before the cast
 
 //    if (waterLevel > thresholdLevelHigh || waterLevel < thresholdLevelLow) {
 //        APP_LOG(TS_OFF, VLEVEL_M, " Water Level is greater than threshold! \r\n");
@@ -1078,7 +1128,6 @@ void fetchSensorData(void) {
 				AppData.Port = LORAWAN_USER_APP_PORT;
 				_doneScanning = false;
 
-				uint8_t msg[100]; // Buffer for storing messages to be transmitted via UART
 				for(int x = 0; x < AppData.BufferSize; x++){
 						AppData.Buffer[x] = 0;
 					}
@@ -1122,8 +1171,7 @@ void fetchSensorData(void) {
 				}
 				AppData.BufferSize = i;
 
-				sprintf((char*)msg, "Payload Buffer Size: %u\r\n\r\n", AppData.BufferSize);
-				HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+				APP_LOG(TS_OFF, VLEVEL_M, "Payload Buffer Size: %u\r\n\r\n", AppData.BufferSize);
 
 				for(int i = 0; i < MAX_WATER_LEVEL_SAMPLES; i++){
 					waterLevelSamples[i] = 0;
@@ -1136,6 +1184,9 @@ void fetchSensorData(void) {
 				}
 
 				status = LmHandlerSend(&AppData, LmHandlerParams.IsTxConfirmed, false);
+				if(status == LORAMAC_HANDLER_SUCCESS && isLevelBreached){
+					armAlarmWindow();	// opened once the uplink is sent
+				}
 				if(status == 0){
 					APP_LOG(TS_ON, VLEVEL_L, "### Resetting Watchdog Timer! \r\n");
 					HAL_GPIO_WritePin(GPIOA, GPIO_PIN_8, GPIO_PIN_SET);
@@ -1154,8 +1205,7 @@ void fetchSensorData(void) {
     //sampleIndex = (sampleIndex + 1) % MAX_WATER_LEVEL_SAMPLES;
 
 	APP_LOG(TS_OFF, VLEVEL_M, "\r\n");
-//	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_RESET);
-//	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_RESET);
+	releaseSensorRail();
 }
 
 void fetchLTCData(void){
@@ -1169,51 +1219,44 @@ void fetchLTCData(void){
 	uint8_t readBuffer[2]; // Allocate memory for readBuffer
 	HAL_StatusTypeDef status;
 	uint8_t dataBuffer17[2] = {0x04, 0x00};
-	uint8_t msg[100]; // Buffer for storing messages to be transmitted via UART
 
-	sprintf((char*)msg, "LTC READING\r\n");
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "LTC READING\r\n");
 
-	sprintf((char*)msg, "=====================================================\r\n");
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "=====================================================\r\n");
 
 	if (isInit == true) {
 		isInit = false;
 		status = HAL_I2C_Mem_Write(&hi2c1, 0x68 << 1, 0x29, I2C_MEMADD_SIZE_8BIT, dataBuffer17, 2, 1000);
 		if (status != HAL_OK) {
-			sprintf((char*)msg, "Error writing new value: %d\r\n", status);
+			APP_LOG(TS_OFF, VLEVEL_M, "Error writing new value: %d\r\n", status);
 		} else {
-			sprintf((char*)msg, "Disabled en_jeita successful\r\n");
+			APP_LOG(TS_OFF, VLEVEL_M, "Disabled en_jeita successful\r\n");
 		}
-		HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 		status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x29, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 		if (status != HAL_OK) {
-			sprintf((char*)msg, "Error reading new value: %d\r\n", status);
+			APP_LOG(TS_OFF, VLEVEL_M, "Error reading new value: %d\r\n", status);
 		} else {
-			sprintf((char*)msg, "JEITA Value: %d\r\n", i2c_data);
+			APP_LOG(TS_OFF, VLEVEL_M, "JEITA Value: %d\r\n", i2c_data);
 		}
-		HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 	 //} REMOVED FOR TESTING PURPOSES
 
 	 // Read the initial value from the register
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x1A, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading initial value: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading initial value: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "CHARGER CONFIG Value: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER CONFIG Value: %d\r\n", i2c_data);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 HAL_Delay(100);
 
 	 // Write the new value to the register
 	 status = HAL_I2C_Mem_Write(&hi2c1, 0x68 << 1, 0x1A, I2C_MEMADD_SIZE_8BIT, dataBuffer1, 2, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error writing new value: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error writing new value: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "Write operation successful\r\n");
+		 APP_LOG(TS_OFF, VLEVEL_M, "Write operation successful\r\n");
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 HAL_Delay(100);
 
@@ -1221,175 +1264,142 @@ void fetchLTCData(void){
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x1A, I2C_MEMADD_SIZE_8BIT, readBuffer, 1, HAL_MAX_DELAY);
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x1A, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading new value: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading new value: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "CHARGER CONFIG New Value: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER CONFIG New Value: %d\r\n", i2c_data);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x44, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);    //ICHARGE_DAC
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading new value: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading new value: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "CHARGER DAC New Value: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER DAC New Value: %d\r\n", i2c_data);
 		 ICHARGE_DAC = (float)(i2c_data * 100);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x39, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading new system status: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading new system status: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "SYSTEM STATUS: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "SYSTEM STATUS: %d\r\n", i2c_data);
 		 SYSTEM_STATUS = (uint16_t)(i2c_data * 100);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x34, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading charger state: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading charger state: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "CHARGER STATE: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER STATE: %d\r\n", i2c_data);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x35, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading charger status: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading charger status: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "CHARGER STATUS: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER STATUS: %d\r\n", i2c_data);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x36, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading limit alert: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading limit alert: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "LIMIT ALERT: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "LIMIT ALERT: %d\r\n", i2c_data);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x37, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading charger state alert: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading charger state alert: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "CHARGER STATE ALERT: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER STATE ALERT: %d\r\n", i2c_data);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 
 	 status = HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x38, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 1, HAL_MAX_DELAY);
 	 if (status != HAL_OK) {
-		 sprintf((char*)msg, "Error reading charger status alert: %d\r\n", status);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error reading charger status alert: %d\r\n", status);
 	 } else {
-		 sprintf((char*)msg, "CHARGER STATUS ALERT: %d\r\n", i2c_data);
+		 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER STATUS ALERT: %d\r\n", i2c_data);
 	 }
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
 	}
 
-	 sprintf((char*)msg, "=====================================================\r\n");
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "=====================================================\r\n");
 
 	 /* Writing ICHARGE_TARGET */
 	 uint8_t register_address = 0x1A;
 
 	 // Write to device 0x68, set register address to 0x1A, and write 0x05
 	 if (HAL_I2C_Mem_Write(&hi2c1, 0x68 << 1, register_address, I2C_MEMADD_SIZE_8BIT, 0x05, 1, HAL_MAX_DELAY) == HAL_OK) {
-		 sprintf((char*)msg, "ICHARGE WRITTEN: %d\r\n", 0x05);
-		 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+		 APP_LOG(TS_OFF, VLEVEL_M, "ICHARGE WRITTEN: %d\r\n", 0x05);
 
 		 // Read from device 0x68, read data from the specified register (0x1A)
 		 if (HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, register_address, I2C_MEMADD_SIZE_8BIT, &b_i2c_data, 1, HAL_MAX_DELAY) == HAL_OK) {
-			 sprintf((char*)msg, "ICHARGE READ: %d\r\n", b_i2c_data);
-			 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+			 APP_LOG(TS_OFF, VLEVEL_M, "ICHARGE READ: %d\r\n", b_i2c_data);
 		 } else {
-			 sprintf((char*)msg, "Error in read operation\r\n");
-			 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+			 APP_LOG(TS_OFF, VLEVEL_M, "Error in read operation\r\n");
 		 }
 	 } else {
-		 sprintf((char*)msg, "Error in write operation\r\n");
-		 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+		 APP_LOG(TS_OFF, VLEVEL_M, "Error in write operation\r\n");
 	 }
 
-	 sprintf((char*)msg, "=====================================================\r\n");
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "=====================================================\r\n");
 
 	 /* Read actual charge current setting applied */
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x44, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&b_i2c_data, 1, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "ICHARGE_DAC RAW Value: %d\r\n", b_i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "ICHARGE_DAC RAW Value: %d\r\n", b_i2c_data);
 	 //float calculated_value = ((b_i2c_data & 0x1F) + 1) / 3.0f;
 	 float calculated_value = (b_i2c_data + 1) * (0.001/0.004);
-	 sprintf((char*)msg, "ICHARGE_DAC Converted Value: %f\r\n", calculated_value);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "ICHARGE_DAC Converted Value: %.3q\r\n", FIXED_POINT(calculated_value, 1000));
 	 ICHARGE_DAC = (float)(calculated_value * 100);																		//ICHARGE DAC
 
 	 /* Read Battery Voltage */
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x3A, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "BATTERY RAW Value: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "BATTERY RAW Value: %d\r\n", i2c_data);
 
 	 /* Calculate and print Battery Voltage */
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x3A, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
 	 float battery_voltage = i2c_data * 0.000192264 * 4;
-	 sprintf((char*)msg, "Battery Voltage: %f V\r\n", battery_voltage);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "Battery Voltage: %.3q V\r\n", FIXED_POINT(battery_voltage, 1000));
 	 VBAT = battery_voltage * 100;
 
 	 /* Read battery current */
 	 i2c_data = 0;
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x3D, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "BATTERY Current Raw: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "BATTERY Current Raw: %d\r\n", i2c_data);
 	 float calculated_battCur = i2c_data *( 0.00000146487 / 0.004);
-	 sprintf((char*)msg, "BATTERY Current Converted: %f\r\n\r\n", calculated_battCur);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "BATTERY Current Converted: %.4q\r\n\r\n", FIXED_POINT(calculated_battCur, 10000));
 	 IBAT = calculated_battCur * 100;																			//IBAT
 
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x3B, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "VOLTAGE IN RAW: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "VOLTAGE IN RAW: %d\r\n", i2c_data);
 	 float calculated_vin = i2c_data * 0.001648;
-	 sprintf((char*)msg, "VOLTAGE IN CALCULATED: %f\r\n", calculated_vin);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "VOLTAGE IN CALCULATED: %.3q\r\n", FIXED_POINT(calculated_vin, 1000));
 	 VIN = calculated_vin * 100;
 
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x3C, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "SYSTEM VOLTAGE RAW: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "SYSTEM VOLTAGE RAW: %d\r\n", i2c_data);
 	 float calculated_vsys = i2c_data * 0.001648;
-	 sprintf((char*)msg, "SYSTEM VOLTAGE CALCULATED: %f\r\n", calculated_vsys);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "SYSTEM VOLTAGE CALCULATED: %.3q\r\n", FIXED_POINT(calculated_vsys, 1000));
 	 VSYS = calculated_vsys * 100;
 
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x3E, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "INPUT CURRENT RAW: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "INPUT CURRENT RAW: %d\r\n", i2c_data);
 	 float calculated_iin = (i2c_data * ( 0.00000146487 / 0.003));
-	 sprintf((char*)msg, "INPUT CURRENT CALCULATED: %f\r\n", calculated_iin);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "INPUT CURRENT CALCULATED: %.4q\r\n", FIXED_POINT(calculated_iin, 10000));
 	 IIN = calculated_iin * 100;
 
-	 sprintf((char*)msg, "=====================================================\r\n");
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "=====================================================\r\n");
 
 	 /* Read Alerts */
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x36, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "LIMIT ALERTS: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "LIMIT ALERTS: %d\r\n", i2c_data);
 
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x37, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "CHARGER STATE ALERTS: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "CHARGER STATE ALERTS: %d\r\n", i2c_data);
 
 	 HAL_I2C_Mem_Read(&hi2c1, 0x68 << 1, 0x39, I2C_MEMADD_SIZE_8BIT, (uint8_t*)&i2c_data, 2, HAL_MAX_DELAY);
-	 sprintf((char*)msg, "SYSTEM STATUS ALERTS: %d\r\n", i2c_data);
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "SYSTEM STATUS ALERTS: %d\r\n", i2c_data);
 	 SYSTEM_STATUS = (uint16_t) i2c_data;
 
-	 sprintf((char*)msg, "=====================================================\r\n");
-	 HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
-
-	 HAL_Delay(2000);
+	 APP_LOG(TS_OFF, VLEVEL_M, "=====================================================\r\n");
 }
 
 /* USER CODE END EF */
@@ -1449,11 +1459,30 @@ void LoRaWAN_Init(void)
   UTIL_TIMER_Create(&RxLedTimer, LED_PERIOD_TIME, UTIL_TIMER_ONESHOT, OnRxTimerLedEvent, NULL);
   UTIL_TIMER_Create(&JoinLedTimer, LED_PERIOD_TIME, UTIL_TIMER_PERIODIC, OnJoinTimerLedEvent, NULL);
 
-  if (FLASH_IF_Init(NULL) != FLASH_IF_OK)
+  if (FLASH_IF_Init(FlashPageBuffer) != FLASH_IF_OK)
   {
     Error_Handler();
   }
 
+  initNvmJournal();
+  initHistoryLog();
+  initLinkHealth();
+  initModbusPassthrough();
+  initSensorRail();
+  initTimeSync();
+  initAlarmWindow();
+  initModbusSections();
+  UTIL_TIMER_Create(&HistoryBackfillTimer, HISTORY_BACKFILL_INTERVAL_MS, UTIL_TIMER_ONESHOT, OnHistoryBackfillTimerEvent, NULL);
+  UTIL_TIMER_Create(&ConfigTlvAckTimer, CONFIG_TLV_ACK_DELAY_MS, UTIL_TIMER_ONESHOT, OnConfigTlvAckTimerEvent, NULL);
+  UTIL_TIMER_Create(&ModbusPassthroughTimer, MODBUS_PASSTHROUGH_INTERVAL_MS, UTIL_TIMER_ONESHOT, OnModbusPassthroughTimerEvent, NULL);
+  UTIL_TIMER_Create(&AlarmWindowTimer, ALARM_WINDOW_RETRY_MS, UTIL_TIMER_ONESHOT, OnAlarmWindowTimerEvent, NULL);
+  UTIL_TIMER_Create(&ModbusSectionTimer, MODBUS_SECTION_INTERVAL_MS, UTIL_TIMER_ONESHOT, OnModbusSectionTimerEvent, NULL);
+  UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_HistoryBackfillEvent), UTIL_SEQ_RFU, SendHistoryBackfill);
+  UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_ConfigTlvAckEvent), UTIL_SEQ_RFU, SendConfigTlvAck);
+  UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_ModbusPassthroughEvent), UTIL_SEQ_RFU, ProcessModbusPassthrough);
+  UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_AlarmWindowEvent), UTIL_SEQ_RFU, ProcessAlarmWindow);
+  UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_ModbusSectionEvent), UTIL_SEQ_RFU, ProcessModbusSections);
+
   /* USER CODE END LoRaWAN_Init_1 */
 
   UTIL_TIMER_Create(&StopJoinTimer, JOIN_TIME, UTIL_TIMER_ONESHOT, OnStopJoinTimerEvent, NULL);
@@ -1474,6 +1503,7 @@ void LoRaWAN_Init(void)
 
   /* USER CODE BEGIN LoRaWAN_Init_2 */
   UTIL_TIMER_Start(&JoinLedTimer);
+  bootProfile.joinTx = HAL_GetTick();
 
   /* USER CODE END LoRaWAN_Init_2 */
 
@@ -1547,6 +1577,11 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
 
     UTIL_TIMER_Start(&RxLedTimer);
 
+    if (params->Status == LORAMAC_EVENT_INFO_STATUS_OK)
+    {
+      linkHealthOnRx(params->Rssi, params->Snr, params->LinkCheck, params->DemodMargin, params->NbGateways);
+    }
+
     if (params->IsMcpsIndication)
     {
       if (appData != NULL)
@@ -1581,6 +1616,16 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
                     break;
                 }
               }
+              else if ((appData->BufferSize == 5) && (appData->Buffer[0] == ALARM_WINDOW_CONFIG_ID))
+              {
+                uint16_t windowSeconds = ((uint16_t)appData->Buffer[1] << 8) | appData->Buffer[2];
+                uint16_t budgetMas = ((uint16_t)appData->Buffer[3] << 8) | appData->Buffer[4];
+
+                if (setAlarmWindowConfig(windowSeconds, budgetMas))
+                {
+                  APP_LOG(TS_OFF, VLEVEL_M, "Alarm Window: %u s, %u mAs per day \r\n", windowSeconds, budgetMas);
+                }
+              }
               break;
 //            case 25:
 //                if (appData->Buffer != NULL && appData->BufferSize >= 1) {
@@ -1808,7 +1853,6 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
             		if (FLASH_IF_Read(&FlashNVM, LORAWAN_NVM_BASE_ADDRESS, sizeof(FlashNVM)) == FLASH_IF_OK) {
             			FlashNVM.pwxCnfUplinkCount = (uint16_t)uplinkCounter;
             			MAX_UPLINK_BEFORE_CONFIRMED = uplinkCounter;
-            			confUplinkCounter = 0;
 					} else {
 						APP_LOG(TS_OFF, VLEVEL_M, "FAILED READING FLASH \r\n");
 					}
@@ -1872,7 +1916,6 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
 
 								FlashNVM.pwxCnfUplinkCount = (uint16_t)4;
 								MAX_UPLINK_BEFORE_CONFIRMED = 4;
-								confUplinkCounter = 0;
 								HAL_Delay(100);
 
 								FlashNVM.pwxSamplingMethod = (uint8_t)0;
@@ -1933,6 +1976,46 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
 					}
 				break;
 
+				case HISTORY_BACKFILL_PORT:
+					if(appData->BufferSize >= 9 && appData->Buffer[0] == HISTORY_BACKFILL_REQUEST_ID){
+						backfillNextSeq = ((uint32_t)appData->Buffer[1] << 24) | ((uint32_t)appData->Buffer[2] << 16) |
+										  ((uint32_t)appData->Buffer[3] << 8)  |  (uint32_t)appData->Buffer[4];
+						backfillLastSeq = ((uint32_t)appData->Buffer[5] << 24) | ((uint32_t)appData->Buffer[6] << 16) |
+										  ((uint32_t)appData->Buffer[7] << 8)  |  (uint32_t)appData->Buffer[8];
+						APP_LOG(TS_OFF, VLEVEL_M, "###### History Backfill: seq %u to %u (oldest %u, next %u) \r\n",
+								backfillNextSeq, backfillLastSeq, getHistoryOldestSeq(), getHistoryNextSeq());
+						UTIL_TIMER_Stop(&HistoryBackfillTimer);
+						/* Records logged from now on go out with the scheduled uplinks, end at the newest one */
+						if(getHistoryOldestSeq() != HISTORY_SEQ_NONE && backfillLastSeq >= getHistoryNextSeq()){
+							backfillLastSeq = getHistoryNextSeq() - 1;
+						}
+						if(getHistoryOldestSeq() == HISTORY_SEQ_NONE || backfillNextSeq > backfillLastSeq){
+							APP_LOG(TS_OFF, VLEVEL_M, "###### History Backfill: nothing in range \r\n");
+							isBackfillActive = false;
+						}else{
+							isBackfillActive = true;
+							UTIL_TIMER_SetPeriod(&HistoryBackfillTimer, HISTORY_BACKFILL_INTERVAL_MS);
+							UTIL_TIMER_Start(&HistoryBackfillTimer);
+						}
+					} else if(appData->BufferSize >= 1 && appData->Buffer[0] == HISTORY_BACKFILL_STOP_ID){
+						APP_LOG(TS_OFF, VLEVEL_M, "###### History Backfill: stopped \r\n");
+						isBackfillActive = false;
+						UTIL_TIMER_Stop(&HistoryBackfillTimer);
+					}
+					break;
+
+				case CONFIG_TLV_PORT:
+					HandleConfigTlv(appData);
+					break;
+
+				case LORAWAN_BYPASS_CMD_PORT:
+					if(queueModbusPassthrough(appData->Buffer, appData->BufferSize) > 0){
+						/* The bus transactions block, run them outside the RX path */
+						UTIL_TIMER_Stop(&ModbusPassthroughTimer);
+						UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ModbusPassthroughEvent), CFG_SEQ_Prio_0);
+					}
+					break;
+
 				case DEVICE_CONFIG_PORT:
 					if(appData->Buffer != NULL && appData->BufferSize >1){
 		            	if(appData->Buffer[0] == CONFIG_SAMPLING_COUNT_ID){
@@ -2164,13 +2247,33 @@ static void SendTxData(void)
 {
   /* USER CODE BEGIN SendTxData_1 */
 	uint8_t currentDR = 0;
+	bool isLtcDataFresh = false;
+	bool isRailHeld = false;
 	currentTime = HAL_GetTick();
 
+	/* The frame held back by a link outage is the first uplink after the rejoin */
+	if (isOutageFrameHeld && (LmHandlerJoinStatus() == LORAMAC_HANDLER_SET) && (LmHandlerIsBusy() == false)) {
+		uplinkType = LINK_UPLINK_UNCONFIRMED;
+		if (LmHandlerSend(&OutageHeldData, LORAMAC_HANDLER_UNCONFIRMED_MSG, false) == LORAMAC_HANDLER_SUCCESS) {
+			APP_LOG(TS_ON, VLEVEL_L, "### SENDING UPLINK HELD BY THE LINK OUTAGE \r\n");
+			isOutageFrameHeld = false;
+		}
+	}
+
 	// Check if it's time to sample the water level
 	if ((currentTime - lastSampleTime) >= SAMPLE_INTERVAL_MS) {
 		APP_LOG(TS_OFF, VLEVEL_M, "============================================= \r\n");
 		APP_LOG(TS_OFF, VLEVEL_M, "            DATA SAMPLING: %d           \r\n", sampleIndex+1);
 		APP_LOG(TS_OFF, VLEVEL_M, "============================================= \r\n");
+
+		/* If this sample completes the cycle, read the LTC4015 while the sensor warms up */
+		if(!skipScheduledTransmission && (sampleIndex + 1 >= MAX_WATER_LEVEL_SAMPLES || hasJoined == false)){
+			acquireSensorRail();				// held until the initial fetch below is done
+			isRailHeld = true;
+			fetchLTCData();
+			isLtcDataFresh = true;
+		}
+
 		if(measurementMethod == 0){
 			fetchSensorData();
 		} else {
@@ -2186,7 +2289,6 @@ static void SendTxData(void)
 		if (sampleIndex >= MAX_WATER_LEVEL_SAMPLES || hasJoined == false) {
 			LmHandlerErrorStatus_t status = LORAMAC_HANDLER_ERROR;
 			UTIL_TIMER_Time_t nextTxIn = 0;
-		    uint8_t msg[100]; 					    // Buffer for storing messages to be transmitted via UART
 
 			  if (LmHandlerIsBusy() == false)
 			  {
@@ -2210,9 +2312,9 @@ static void SendTxData(void)
 			    }
 			    _doneScanning = true;
 
-			    HAL_Delay(200);
-			    fetchLTCData();							//READ LTC DATA
-			    HAL_Delay(50);
+			    if(!isLtcDataFresh){
+			    	fetchLTCData();						//READ LTC DATA
+			    }
 
 			    for(int x = 0; x < AppData.BufferSize; x++){
 			    		AppData.Buffer[x] = 0;
@@ -2242,6 +2344,7 @@ static void SendTxData(void)
 				}
 
 				uint8_t i = 0;
+				size_t timedSampleSize = 0;
 				AppData.Buffer[i++] = (uint8_t)transmissionType;
 				AppData.Buffer[i++] = (uint8_t)((uint16_t)waterLevelLatest >> 8);
 				AppData.Buffer[i++] = (uint8_t)((uint16_t)waterLevelLatest & 0xFF);
@@ -2266,14 +2369,59 @@ static void SendTxData(void)
 				AppData.Buffer[i++] = (uint8_t)((uint16_t)SYSTEM_STATUS >> 8);
 				AppData.Buffer[i++] = (uint8_t)((uint16_t)SYSTEM_STATUS & 0xFF);
 				if(sendSystemDiagnostic == true){
+					LoRaMacTxInfo_t txInfo;
 					AppData.Buffer[i++] = (uint8_t)systemDiagnostic;
+					LoRaMacQueryTxPossible(0, &txInfo);
+					if(txInfo.MaxPossibleApplicationDataSize > i){
+						i += AppendBootProfile(&AppData.Buffer[i], txInfo.MaxPossibleApplicationDataSize - i);
+					}
+					if(txInfo.MaxPossibleApplicationDataSize > i){
+						printMemWatch();
+						printIdleGovernor();
+						printClockPolicy();
+						printAlarmWindow();
+						printModbusSections();
+						i += buildMemWatchBlock(&AppData.Buffer[i], txInfo.MaxPossibleApplicationDataSize - i);
+					}
 					sendSystemDiagnostic = false;
 				}
+#ifdef TIME_TAGGED_SAMPLES
+				else {
+					/* Every sample of the cycle with its time, so cycles can be batched */
+					LoRaMacTxInfo_t txInfo;
+					LoRaMacQueryTxPossible(0, &txInfo);
+					if(txInfo.MaxPossibleApplicationDataSize > i){
+#ifdef TIME_TAGGED_SERIES
+						timedSampleSize = buildTimedSampleSeries(&AppData.Buffer[i],
+								MIN(txInfo.MaxPossibleApplicationDataSize, LORAWAN_APP_DATA_BUFFER_MAX_SIZE) - i);
+#else
+						timedSampleSize = buildTimedSampleBlock(&AppData.Buffer[i],
+								MIN(txInfo.MaxPossibleApplicationDataSize, LORAWAN_APP_DATA_BUFFER_MAX_SIZE) - i);
+#endif
+						i += timedSampleSize;
+					}
+				}
+#endif
 
 				AppData.BufferSize = i;
 
-				sprintf((char*)msg, "Payload Buffer Size: %u\r\n\r\n", AppData.BufferSize);
-				HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+				HistoryRecord_t historyRecord;
+				historyRecord.waterLevelLatest	= (uint16_t)waterLevelLatest;
+				historyRecord.waterLevel		= (uint16_t)waterLevel;
+				historyRecord.waterLevelMin		= (uint16_t)waterLevelMin;
+				historyRecord.waterLevelMax		= (uint16_t)waterLevelMax;
+				historyRecord.vbat				= (uint16_t)VBAT;
+				historyRecord.vin				= (uint16_t)VIN;
+				historyRecord.vsys				= (uint16_t)VSYS;
+				historyRecord.ibat				= (uint16_t)IBAT;
+				historyRecord.iin				= (uint16_t)IIN;
+				historyRecord.systemStatus		= SYSTEM_STATUS;
+				historyRecord.transmissionType	= (uint8_t)transmissionType;
+				if(!appendHistoryRecord(&historyRecord)){
+					APP_LOG(TS_OFF, VLEVEL_M, "History Log: record not saved \r\n");
+				}
+
+				APP_LOG(TS_OFF, VLEVEL_M, "Payload Buffer Size: %u\r\n\r\n", AppData.BufferSize);
 
 			    if ((JoinLedTimer.IsRunning) && (LmHandlerJoinStatus() == LORAMAC_HANDLER_SET))
 			    {
@@ -2284,16 +2432,42 @@ static void SendTxData(void)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 				//status = LmHandlerSend(&AppData, LmHandlerParams.IsTxConfirmed, false);
 
-				if(confUplinkCounter >= MAX_UPLINK_BEFORE_CONFIRMED){
-					APP_LOG(TS_ON, VLEVEL_L, "### SENDING CONFIRMED UPLINK \r\n");
-					APP_LOG(TS_ON, VLEVEL_L, "% Uplink Counter %u \r\n", confUplinkCounter);
-					confUplinkCounter += 1;
-					//confUplinkCounter = 0;
-					status = LmHandlerSend(&AppData, LmHandlerParamsConfirmed.IsTxConfirmed, false);
+				if(isLinkOutage()){
+					APP_LOG(TS_ON, VLEVEL_L, "### Link Outage: Rejoining \r\n");
+					printLinkHealth();
+					initLinkHealth();
+					/* Held until the rejoin is done, the samples it carries go with it */
+					memcpy1(OutageHeldBuffer, AppData.Buffer, AppData.BufferSize);
+					OutageHeldData.BufferSize = AppData.BufferSize;
+					isOutageFrameHeld = true;
+					if(timedSampleSize > 0){
+						clearTimedSamples();
+					}
+					UTIL_TIMER_Start(&JoinLedTimer);
+					LmHandlerJoin(ActivationType, true);
+					status = LORAMAC_HANDLER_BUSY_ERROR;
 				}else{
-					status = LmHandlerSend(&AppData, LmHandlerParams.IsTxConfirmed, false);
-					APP_LOG(TS_ON, VLEVEL_L, "%u Remaining Uplink/s before sending Confirmed Uplink \r\n", (MAX_UPLINK_BEFORE_CONFIRMED-confUplinkCounter));
-					confUplinkCounter += 1;
+					uplinkType = getLinkUplinkType((uint16_t)MAX_UPLINK_BEFORE_CONFIRMED);
+					if(uplinkType == LINK_UPLINK_CONFIRMED){
+						APP_LOG(TS_ON, VLEVEL_L, "### SENDING CONFIRMED UPLINK \r\n");
+						status = LmHandlerSend(&AppData, LORAMAC_HANDLER_CONFIRMED_MSG, false);
+					}else{
+						if(uplinkType == LINK_UPLINK_LINK_CHECK){
+							APP_LOG(TS_ON, VLEVEL_L, "### SENDING UPLINK WITH LINK CHECK \r\n");
+							LmHandlerLinkCheckReq();
+						}
+						if(isTimeSyncDue()){
+							LmHandlerDeviceTimeReq();	// piggybacked on this uplink
+						}
+						status = LmHandlerSend(&AppData, LORAMAC_HANDLER_UNCONFIRMED_MSG, false);
+					}
+					printLinkHealth();
+				}
+				if(status == LORAMAC_HANDLER_SUCCESS && isLevelBreached){
+					armAlarmWindow();	// opened once the uplink is sent
+				}
+				if(status == LORAMAC_HANDLER_SUCCESS && timedSampleSize > 0){
+					clearTimedSamples();	// otherwise carried over and batched with the next cycle
 				}
 
 				if(status == 0){
@@ -2303,12 +2477,6 @@ static void SendTxData(void)
 					HAL_GPIO_WritePin(GPIOA, GPIO_PIN_8, GPIO_PIN_RESET);
 				}
 
-				if((confUplinkCounter - MAX_UPLINK_BEFORE_CONFIRMED) > 10){
-					APP_LOG(TS_ON, VLEVEL_L, "### Confirmed Uplinks Failed! \r\n");
-					APP_LOG(TS_ON, VLEVEL_L, "### Resetting Device! \r\n");
-					panicMode();
-					//HAL_NVIC_SystemReset();
-				}
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -2332,6 +2500,11 @@ static void SendTxData(void)
 			  }
 			lastTransmitTime = currentTime;
 
+			/* Sections of the Modbus devices follow the scheduled uplink, once per cycle */
+			isModbusSectionScanDue = true;
+			UTIL_TIMER_Stop(&ModbusSectionTimer);
+			UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ModbusSectionEvent), CFG_SEQ_Prio_0);
+
 			/*
 			 * Reset Water Level Values
 			 */
@@ -2345,6 +2518,9 @@ static void SendTxData(void)
 		}
 	}
 
+	if(isRailHeld){
+		releaseSensorRail();
+	}
 
 
   if (EventType == TX_ON_TIMER)
@@ -2389,6 +2565,411 @@ static void OnJoinTimerLedEvent(void *context)
   HAL_GPIO_TogglePin(LED3_GPIO_Port, LED3_Pin); /* LED_RED */
 }
 
+static void OnHistoryBackfillTimerEvent(void *context)
+{
+  UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_HistoryBackfillEvent), CFG_SEQ_Prio_0);
+}
+
+static void OnConfigTlvAckTimerEvent(void *context)
+{
+  UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ConfigTlvAckEvent), CFG_SEQ_Prio_0);
+}
+
+static void OnModbusPassthroughTimerEvent(void *context)
+{
+  UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ModbusPassthroughEvent), CFG_SEQ_Prio_0);
+}
+
+static void OnAlarmWindowTimerEvent(void *context)
+{
+  UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_AlarmWindowEvent), CFG_SEQ_Prio_0);
+}
+
+static void OnModbusSectionTimerEvent(void *context)
+{
+  UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_ModbusSectionEvent), CFG_SEQ_Prio_0);
+}
+
+static void LogBootProfile(void)
+{
+  APP_LOG(TS_OFF, VLEVEL_M, "Boot Profile (ms): LoRaWAN %u | Join TX %u | HAL %u | Flash %u | CLI %u | Joined %u \r\n",
+          bootProfile.lorawanInit, bootProfile.joinTx, bootProfile.halInit,
+          bootProfile.flashLoad, bootProfile.configWindowEnd, bootProfile.joinDone);
+}
+
+static uint8_t AppendBootProfile(uint8_t *destination, size_t maxSize)
+{
+  const uint32_t phases[] = { bootProfile.lorawanInit, bootProfile.joinTx, bootProfile.halInit,
+                              bootProfile.flashLoad, bootProfile.configWindowEnd, bootProfile.joinDone };
+  uint8_t index = 0;
+
+  LogBootProfile();
+  if (maxSize < (sizeof(phases) / sizeof(phases[0])) * 2)
+  {
+    return 0;
+  }
+
+  /* u16 per phase in 10 ms units, saturated */
+  for (uint8_t p = 0; p < (sizeof(phases) / sizeof(phases[0])); p++)
+  {
+    uint32_t ticks = MIN(phases[p] / 10, 0xFFFF);
+    destination[index++] = (uint8_t)(ticks >> 8);
+    destination[index++] = (uint8_t)(ticks & 0xFF);
+  }
+  return index;
+}
+
+static void SendHistoryBackfill(void)
+{
+  LoRaMacTxInfo_t txInfo;
+  LmHandlerErrorStatus_t status;
+  UTIL_TIMER_Time_t nextTxIn = HISTORY_BACKFILL_INTERVAL_MS;
+  uint32_t chunkSeq = backfillNextSeq;
+  size_t maxSize;
+
+  if (!isBackfillActive)
+  {
+    return;
+  }
+
+  if ((LmHandlerJoinStatus() != LORAMAC_HANDLER_SET) || LmHandlerIsBusy())
+  {
+    UTIL_TIMER_Start(&HistoryBackfillTimer);
+    return;
+  }
+
+  /* Fill the largest payload the current data rate allows */
+  LoRaMacQueryTxPossible(0, &txInfo);
+  maxSize = txInfo.MaxPossibleApplicationDataSize;
+  if (maxSize > LORAWAN_APP_DATA_BUFFER_MAX_SIZE)
+  {
+    maxSize = LORAWAN_APP_DATA_BUFFER_MAX_SIZE;
+  }
+
+  HistoryBackfillData.BufferSize = buildHistoryBackfill(&chunkSeq, backfillLastSeq, HistoryBackfillBuffer, maxSize);
+  if (HistoryBackfillData.BufferSize == 0)
+  {
+    backfillNextSeq = chunkSeq;
+    if ((backfillNextSeq > backfillLastSeq) || (backfillNextSeq >= getHistoryNextSeq()))
+    {
+      APP_LOG(TS_OFF, VLEVEL_M, "History Backfill: done \r\n");
+      isBackfillActive = false;
+      return;
+    }
+    APP_LOG(TS_OFF, VLEVEL_M, "History Backfill: payload too small (%u), waiting \r\n", maxSize);
+    UTIL_TIMER_Start(&HistoryBackfillTimer);
+    return;
+  }
+
+  status = LmHandlerSend(&HistoryBackfillData, LORAMAC_HANDLER_UNCONFIRMED_MSG, false);
+  if (status == LORAMAC_HANDLER_SUCCESS)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "History Backfill: sent seq %u to %u \r\n", backfillNextSeq, chunkSeq - 1);
+    backfillNextSeq = chunkSeq;
+  }
+  else if (status == LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED)
+  {
+    nextTxIn = MAX(LmHandlerGetDutyCycleWaitTime(), HISTORY_BACKFILL_INTERVAL_MS);
+  }
+
+  if ((backfillNextSeq > backfillLastSeq) || (backfillNextSeq >= getHistoryNextSeq()))
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "History Backfill: done \r\n");
+    isBackfillActive = false;
+    return;
+  }
+
+  UTIL_TIMER_SetPeriod(&HistoryBackfillTimer, nextTxIn);
+  UTIL_TIMER_Start(&HistoryBackfillTimer);
+}
+
+static void HandleConfigTlv(const LmHandlerAppData_t *appData)
+{
+  static ConfigTlvUpdate_t update;
+  SecureElementNvmData_t FlashNVM;
+  ConfigTlvStatus_t status;
+  uint32_t hash = 0;
+
+  status = parseConfigTlv(appData->Buffer, appData->BufferSize, &update);
+  if (status == CONFIG_TLV_OK)
+  {
+    status = commitConfigTlv(&update, &FlashNVM);
+  }
+
+  /* A failed commit leaves the update merged into FlashNVM, the ack hashes what flash holds */
+  if ((status != CONFIG_TLV_OK)
+      && (FLASH_IF_Read(&FlashNVM, LORAWAN_NVM_BASE_ADDRESS, sizeof(FlashNVM)) != FLASH_IF_OK))
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "FAILED READING FLASH \r\n");
+  }
+
+  if (status == CONFIG_TLV_OK)
+  {
+    /* Same runtime updates the single-parameter handlers make */
+    if (hasConfigTlv(&update, CONFIG_TLV_TX_INTERVAL))
+    {
+      TRANSMIT_INTERVAL_MS = update.txIntervalSeconds * 1000;
+    }
+    if (hasConfigTlv(&update, CONFIG_TLV_CNF_UPLINK_COUNT))
+    {
+      MAX_UPLINK_BEFORE_CONFIRMED = update.cnfUplinkCount;
+    }
+    if (hasConfigTlv(&update, CONFIG_TLV_THRESHOLD_HIGH))
+    {
+      thresholdLevelHigh = update.thresholdHigh;
+    }
+    if (hasConfigTlv(&update, CONFIG_TLV_THRESHOLD_LOW))
+    {
+      thresholdLevelLow = update.thresholdLow;
+    }
+    if (hasConfigTlv(&update, CONFIG_TLV_SAMPLING_METHOD))
+    {
+      samplingMethod = update.samplingMethod;
+    }
+    if (hasConfigTlv(&update, CONFIG_TLV_MEASUREMENT_METHOD))
+    {
+      measurementMethod = update.measurementMethod;
+    }
+    if (hasConfigTlv(&update, CONFIG_TLV_SAMPLING_COUNT) || hasConfigTlv(&update, CONFIG_TLV_TX_INTERVAL))
+    {
+      if (hasConfigTlv(&update, CONFIG_TLV_SAMPLING_COUNT))
+      {
+        MAX_WATER_LEVEL_SAMPLES = update.samplingCount;
+        free(waterLevelSamples);
+        waterLevelSamples = (float *)malloc(sizeof(float) * MAX_WATER_LEVEL_SAMPLES);
+        sampleIndex = 0;
+      }
+      SAMPLE_INTERVAL_MS = (TRANSMIT_INTERVAL_MS / MAX_WATER_LEVEL_SAMPLES);
+    }
+    DeviceParamsNVM = FlashNVM;
+  }
+
+  hash = getConfigHash(&FlashNVM);
+  APP_LOG(TS_OFF, VLEVEL_M, "###### Config TLV: txn %u | status %u | TLV %d | hash %08X \r\n",
+          update.txnId, status, (update.failedIndex == CONFIG_TLV_NO_INDEX) ? -1 : (int)update.failedIndex, hash);
+
+  ConfigTlvAckData.BufferSize = buildConfigTlvAck(&update, status, hash, ConfigTlvAckBuffer, sizeof(ConfigTlvAckBuffer));
+  UTIL_TIMER_Stop(&ConfigTlvAckTimer);
+  UTIL_TIMER_SetPeriod(&ConfigTlvAckTimer, CONFIG_TLV_ACK_DELAY_MS);
+  UTIL_TIMER_Start(&ConfigTlvAckTimer);
+}
+
+static void SendConfigTlvAck(void)
+{
+  LmHandlerErrorStatus_t status;
+
+  if (ConfigTlvAckData.BufferSize == 0)
+  {
+    return;
+  }
+
+  if ((LmHandlerJoinStatus() != LORAMAC_HANDLER_SET) || LmHandlerIsBusy())
+  {
+    UTIL_TIMER_Start(&ConfigTlvAckTimer);
+    return;
+  }
+
+  status = LmHandlerSend(&ConfigTlvAckData, LORAMAC_HANDLER_UNCONFIRMED_MSG, false);
+  if (status == LORAMAC_HANDLER_SUCCESS)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "Config TLV: acknowledgement sent \r\n");
+    ConfigTlvAckData.BufferSize = 0;
+    return;
+  }
+
+  if (status == LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED)
+  {
+    UTIL_TIMER_SetPeriod(&ConfigTlvAckTimer, MAX(LmHandlerGetDutyCycleWaitTime(), CONFIG_TLV_ACK_DELAY_MS));
+  }
+  UTIL_TIMER_Start(&ConfigTlvAckTimer);
+}
+
+static void ProcessModbusPassthrough(void)
+{
+  LoRaMacTxInfo_t txInfo;
+  LmHandlerErrorStatus_t status;
+  size_t maxSize;
+  uint8_t packed;
+
+  if (isModbusPassthroughPending())
+  {
+    acquireSensorRail();
+    waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp);
+    runModbusPassthrough(&ModbusResp);
+    releaseSensorRail();
+  }
+
+  if (!hasModbusPassthroughReplies())
+  {
+    return;
+  }
+
+  if ((LmHandlerJoinStatus() != LORAMAC_HANDLER_SET) || LmHandlerIsBusy())
+  {
+    UTIL_TIMER_SetPeriod(&ModbusPassthroughTimer, MODBUS_PASSTHROUGH_INTERVAL_MS);
+    UTIL_TIMER_Start(&ModbusPassthroughTimer);
+    return;
+  }
+
+  /* Fewest uplinks: fill the largest payload the current data rate allows */
+  LoRaMacQueryTxPossible(0, &txInfo);
+  maxSize = txInfo.MaxPossibleApplicationDataSize;
+  if (maxSize > LORAWAN_APP_DATA_BUFFER_MAX_SIZE)
+  {
+    maxSize = LORAWAN_APP_DATA_BUFFER_MAX_SIZE;
+  }
+
+  ModbusPassthroughData.BufferSize = buildModbusPassthroughUplink(ModbusPassthroughBuffer, maxSize, &packed);
+  if (ModbusPassthroughData.BufferSize == 0)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "Modbus Passthrough: payload too small (%u), waiting \r\n", maxSize);
+    UTIL_TIMER_SetPeriod(&ModbusPassthroughTimer, MODBUS_PASSTHROUGH_INTERVAL_MS);
+    UTIL_TIMER_Start(&ModbusPassthroughTimer);
+    return;
+  }
+
+  status = LmHandlerSend(&ModbusPassthroughData, LORAMAC_HANDLER_UNCONFIRMED_MSG, false);
+  if (status == LORAMAC_HANDLER_SUCCESS)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "Modbus Passthrough: sent %u bytes \r\n", ModbusPassthroughData.BufferSize);
+    markModbusPassthroughSent(packed);
+    if (!hasModbusPassthroughReplies())
+    {
+      return;
+    }
+  }
+
+  if (status == LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED)
+  {
+    UTIL_TIMER_SetPeriod(&ModbusPassthroughTimer, MAX(LmHandlerGetDutyCycleWaitTime(), MODBUS_PASSTHROUGH_INTERVAL_MS));
+  }
+  else
+  {
+    UTIL_TIMER_SetPeriod(&ModbusPassthroughTimer, MODBUS_PASSTHROUGH_INTERVAL_MS);
+  }
+  UTIL_TIMER_Start(&ModbusPassthroughTimer);
+}
+
+static void ProcessModbusSections(void)
+{
+  LoRaMacTxInfo_t txInfo;
+  LmHandlerErrorStatus_t status;
+  size_t maxSize;
+  uint32_t packed;
+
+  if (isModbusSectionScanDue)
+  {
+    isModbusSectionScanDue = false;
+    acquireSensorRail();
+    waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp);
+    APP_LOG(TS_OFF, VLEVEL_M, "Modbus Sections: %u queued \r\n", collectModbusSections());
+    releaseSensorRail();
+  }
+
+  if (!hasModbusSections())
+  {
+    return;
+  }
+
+  if ((LmHandlerJoinStatus() != LORAMAC_HANDLER_SET) || LmHandlerIsBusy())
+  {
+    UTIL_TIMER_SetPeriod(&ModbusSectionTimer, MODBUS_SECTION_INTERVAL_MS);
+    UTIL_TIMER_Start(&ModbusSectionTimer);
+    return;
+  }
+
+  /* Fewest uplinks: fill the largest payload the current data rate allows, the rest goes next frame */
+  LoRaMacQueryTxPossible(0, &txInfo);
+  maxSize = txInfo.MaxPossibleApplicationDataSize;
+  if (maxSize > LORAWAN_APP_DATA_BUFFER_MAX_SIZE)
+  {
+    maxSize = LORAWAN_APP_DATA_BUFFER_MAX_SIZE;
+  }
+
+  ModbusSectionData.BufferSize = buildModbusSectionUplink(ModbusSectionBuffer, maxSize, &packed);
+  if (ModbusSectionData.BufferSize == 0)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "Modbus Sections: payload too small (%u), waiting \r\n", maxSize);
+    UTIL_TIMER_SetPeriod(&ModbusSectionTimer, MODBUS_SECTION_INTERVAL_MS);
+    UTIL_TIMER_Start(&ModbusSectionTimer);
+    return;
+  }
+
+  status = LmHandlerSend(&ModbusSectionData, LORAMAC_HANDLER_UNCONFIRMED_MSG, false);
+  if (status == LORAMAC_HANDLER_SUCCESS)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "Modbus Sections: sent %u bytes \r\n", ModbusSectionData.BufferSize);
+    markModbusSectionsSent(packed);
+    if (!hasModbusSections())
+    {
+      printModbusSections();
+      return;
+    }
+  }
+
+  if (status == LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED)
+  {
+    UTIL_TIMER_SetPeriod(&ModbusSectionTimer, MAX(LmHandlerGetDutyCycleWaitTime(), MODBUS_SECTION_INTERVAL_MS));
+  }
+  else
+  {
+    UTIL_TIMER_SetPeriod(&ModbusSectionTimer, MODBUS_SECTION_INTERVAL_MS);
+  }
+  UTIL_TIMER_Start(&ModbusSectionTimer);
+}
+
+static void ProcessAlarmWindow(void)
+{
+  DeviceClass_t currentClass;
+  uint32_t windowMs;
+
+  if (LmHandlerIsBusy() || (LmHandlerGetCurrentClass(&currentClass) != LORAMAC_HANDLER_SUCCESS))
+  {
+    UTIL_TIMER_SetPeriod(&AlarmWindowTimer, ALARM_WINDOW_RETRY_MS);
+    UTIL_TIMER_Start(&AlarmWindowTimer);
+    return;
+  }
+
+  if (isAlarmWindowOpen())
+  {
+    if (UTIL_TIMER_IsRunning(&AlarmWindowTimer))
+    {
+      return;
+    }
+    /* Elapsed, OnClassChange() charges the window */
+    if (LmHandlerRequestClass(CLASS_A) != LORAMAC_HANDLER_SUCCESS)
+    {
+      UTIL_TIMER_SetPeriod(&AlarmWindowTimer, ALARM_WINDOW_RETRY_MS);
+      UTIL_TIMER_Start(&AlarmWindowTimer);
+    }
+    return;
+  }
+
+  if (!isAlarmWindowArmed())
+  {
+    return;
+  }
+  if (currentClass != CLASS_A)
+  {
+    /* Already in Class C on request, left as it is */
+    disarmAlarmWindow();
+    return;
+  }
+
+  windowMs = openAlarmWindow();
+  if (windowMs == 0)
+  {
+    return;
+  }
+  if (LmHandlerRequestClass(CLASS_C) != LORAMAC_HANDLER_SUCCESS)
+  {
+    closeAlarmWindow();
+    return;
+  }
+  APP_LOG(TS_OFF, VLEVEL_M, "Alarm Window: Class C for %u ms \r\n", windowMs);
+  UTIL_TIMER_SetPeriod(&AlarmWindowTimer, windowMs);
+  UTIL_TIMER_Start(&AlarmWindowTimer);
+}
 /* USER CODE END PrFD_LedEvents */
 
 static void OnTxData(LmHandlerTxParams_t *params)
@@ -2408,6 +2989,20 @@ static void OnTxData(LmHandlerTxParams_t *params)
 
       hasJoined = true;
 
+      if (params->AppData.Port == LORAWAN_USER_APP_PORT)
+      {
+        linkHealthOnTx(uplinkType, params->AckReceived != 0);
+        if (isAlarmWindowArmed())
+        {
+          /* RX1 and RX2 are over, the MAC is free for the class switch */
+          UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_AlarmWindowEvent), CFG_SEQ_Prio_0);
+        }
+      }
+      else
+      {
+        linkHealthOnTx(LINK_UPLINK_UNCONFIRMED, false);
+      }
+
       APP_LOG(TS_OFF, VLEVEL_H, " | MSG TYPE:");
       if (params->MsgType == LORAMAC_HANDLER_CONFIRMED_MSG)
       {
@@ -2438,6 +3033,10 @@ static void OnJoinRequest(LmHandlerJoinParams_t *joinParams)
       APP_LOG(TS_OFF, VLEVEL_M, "\r\n###### = JOINED = ");
       APP_LOG(TS_OFF, VLEVEL_M, "\r\nWriting Devnonce to Flash:%d \r\n", getDevnonce);
       write_devnonce_to_flash(getDevnonce);
+      if (isOutageFrameHeld)
+      {
+        UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent), CFG_SEQ_Prio_0);
+      }
       if (joinParams->Mode == ACTIVATION_TYPE_ABP)
       {
         APP_LOG(TS_OFF, VLEVEL_M, "ABP ======================\r\n");
@@ -2454,6 +3053,12 @@ static void OnJoinRequest(LmHandlerJoinParams_t *joinParams)
     }
 
     APP_LOG(TS_OFF, VLEVEL_H, "###### U/L FRAME:JOIN | DR:%d | PWR:%d\r\n", joinParams->Datarate, joinParams->TxPower);
+
+    if (bootProfile.joinDone == 0)
+    {
+      bootProfile.joinDone = HAL_GetTick();
+      LogBootProfile();
+    }
   }
   /* USER CODE END OnJoinRequest_1 */
 }
@@ -2496,7 +3101,7 @@ static void OnBeaconStatusChange(LmHandlerBeaconParams_t *params)
 static void OnSysTimeUpdate(void)
 {
   /* USER CODE BEGIN OnSysTimeUpdate_1 */
-
+  timeSyncOnUpdate();
   /* USER CODE END OnSysTimeUpdate_1 */
 }
 
@@ -2504,6 +3109,12 @@ static void OnClassChange(DeviceClass_t deviceClass)
 {
   /* USER CODE BEGIN OnClassChange_1 */
   APP_LOG(TS_OFF, VLEVEL_M, "Switch to Class %c done\r\n", "ABC"[deviceClass]);
+  if ((deviceClass == CLASS_A) && isAlarmWindowOpen())
+  {
+    /* Window elapsed, or ended early by a port 3 downlink */
+    UTIL_TIMER_Stop(&AlarmWindowTimer);
+    closeAlarmWindow();
+  }
   /* USER CODE END OnClassChange_1 */
 }
 
@@ -2673,7 +3284,15 @@ static void OnNvmDataChange(LmHandlerNvmContextStates_t state)
 static void OnStoreContextRequest(void *nvm, uint32_t nvm_size)
 {
   /* USER CODE BEGIN OnStoreContextRequest_1 */
-
+  /*
+   * Only the changed NVM groups are appended to the journal. The context is no longer
+   * written to LORAWAN_NVM_BASE_ADDRESS, as that page holds the pwx* configuration.
+   */
+  if (storeNvmJournal(nvm, nvm_size) == false)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "NVM Journal: store failed \r\n");
+  }
+  return;
   /* USER CODE END OnStoreContextRequest_1 */
   /* store nvm in flash */
   if (FLASH_IF_Erase(LORAWAN_NVM_BASE_ADDRESS, FLASH_PAGE_SIZE) == FLASH_IF_OK)
@@ -2688,7 +3307,15 @@ static void OnStoreContextRequest(void *nvm, uint32_t nvm_size)
 static void OnRestoreContextRequest(void *nvm, uint32_t nvm_size)
 {
   /* USER CODE BEGIN OnRestoreContextRequest_1 */
-
+  /*
+   * LORAWAN_NVM_BASE_ADDRESS holds the pwx* configuration, never a LoRaMac context. With
+   * nothing journalled the backup is left as it is, the MAC finds no valid group and joins afresh.
+   */
+  if (restoreNvmJournal(nvm, nvm_size) == false)
+  {
+    APP_LOG(TS_OFF, VLEVEL_M, "NVM Journal: no context to restore \r\n");
+  }
+  return;
   /* USER CODE END OnRestoreContextRequest_1 */
   FLASH_IF_Read(nvm, LORAWAN_NVM_BASE_ADDRESS, nvm_size);
   /* USER CODE BEGIN OnRestoreContextRequest_Last */
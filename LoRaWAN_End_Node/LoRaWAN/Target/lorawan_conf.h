@@ -170,6 +170,10 @@ extern "C" {
 #define DISABLE_LORAWAN_RX_WINDOW                       0
 
 /* USER CODE BEGIN EC */
+/*!
+ * @brief Enable the Modbus device table download package (Package ID: 5, Port: 32)
+ */
+#define LORAWAN_DEVICE_TABLE_PKG                        1
 
 /* USER CODE END EC */
 
@@ -42,7 +42,7 @@ extern "C"
 /*!
  * Maximum number of packages
  */
-#define PKG_MAX_NUMBER                              5
+#define PKG_MAX_NUMBER                              6
 
 typedef struct LmhPackage_s
 {
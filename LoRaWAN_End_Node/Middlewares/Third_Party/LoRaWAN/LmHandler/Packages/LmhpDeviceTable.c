@@ -0,0 +1,572 @@
+/**
+  ******************************************************************************
+  * @file    LmhpDeviceTable.c
+  * @brief   Fragmented device table download package implementation
+  ******************************************************************************
+  *
+  * Uncoded fragments are copied to their place in the reassembly buffer.
+  * A coded fragment is reduced, by Gaussian elimination over GF(2), against
+  * the fragments already known and the parity rows already kept. What is
+  * left is a row whose lowest bit is a missing fragment, so the row and its
+  * payload are kept in that fragment's slot of the buffer. Once every slot
+  * holds a fragment or a row, the rows are solved from the last one down.
+  */
+#include "platform.h"
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "LoRaMacCrypto.h"
+#include "LmHandler.h"
+#include "LmhpDeviceTable.h"
+#include "mw_log_conf.h"
+
+/*!
+ * Number of 32 bits words of a parity row
+ */
+#define DEVICE_TABLE_ROW_WORDS                      ( ( DEVICE_TABLE_MAX_NB_FRAG + 31 ) / 32 )
+
+#define DEVICE_TABLE_SETUP_REQ_SIZE                 15
+#define DEVICE_TABLE_FRAGMENT_HEADER_SIZE           3
+#define DEVICE_TABLE_ANS_MAX_SIZE                   8
+
+/*!
+ * Delay before an answer is sent, and between retries
+ */
+#define DEVICE_TABLE_ANS_DELAY                      1000
+
+typedef enum DeviceTableCmd_e
+{
+    DEVICE_TABLE_SESSION_SETUP  = 0x01,
+    DEVICE_TABLE_DATA_FRAGMENT  = 0x02,
+    DEVICE_TABLE_STATUS         = 0x03,
+    DEVICE_TABLE_SESSION_DELETE = 0x04,
+    DEVICE_TABLE_DATA_BLOCK_IND = 0x05,
+} DeviceTableCmd_t;
+
+/*!
+ * Package current context
+ */
+typedef struct DeviceTableState_s
+{
+    bool        Initialized;
+    bool        IsTxPending;
+    TimerTime_t TxPendingTimestamp;
+    bool        IsSessionActive;
+    uint16_t    SessionCnt;
+    uint16_t    NbFrag;
+    uint8_t     FragSize;
+    uint8_t     Padding;
+    uint32_t    Descriptor;
+    uint32_t    IntegrityCode;
+    uint16_t    NbKnown;            /* uncoded fragments received or solved */
+    uint16_t    NbRows;             /* parity rows kept for missing fragments */
+    uint16_t    NbReceived;         /* every fragment received in the session */
+    uint8_t     LastStatus;
+    uint8_t     AnsSize;
+    uint8_t     AnsBuffer[DEVICE_TABLE_ANS_MAX_SIZE];
+} DeviceTableState_t;
+
+static DeviceTableState_t DeviceTableState =
+{
+    .Initialized     = false,
+    .IsTxPending     = false,
+    .IsSessionActive = false,
+    .LastStatus      = DEVICE_TABLE_STATUS_NO_SESSION,
+};
+
+/*!
+ * Device table package parameters
+ */
+static LmhpDeviceTableParams_t *DeviceTableParams;
+
+/*!
+ * Bit per fragment whose slot holds its data
+ */
+static uint32_t KnownBits[DEVICE_TABLE_ROW_WORDS];
+
+/*!
+ * Bit per missing fragment whose slot holds a parity row payload
+ */
+static uint32_t RowBits[DEVICE_TABLE_ROW_WORDS];
+
+/*!
+ * Parity rows, indexed by their lowest bit
+ */
+static uint32_t Rows[DEVICE_TABLE_MAX_NB_FRAG][DEVICE_TABLE_ROW_WORDS];
+
+/*!
+ * Row and payload of the fragment being reduced
+ */
+static uint32_t Row[DEVICE_TABLE_ROW_WORDS];
+static uint8_t Payload[DEVICE_TABLE_MAX_FRAG_SIZE];
+
+/*!
+ * Process timer
+ */
+static TimerEvent_t ProcessTimer;
+
+static void LmhpDeviceTableInit( void *params, uint8_t *dataBuffer, uint8_t dataBufferMaxSize );
+static bool LmhpDeviceTableIsInitialized( void );
+static bool LmhpDeviceTableIsTxPending( void );
+static void LmhpDeviceTableProcess( void );
+static void LmhpDeviceTableOnMcpsIndication( McpsIndication_t *mcpsIndication );
+static void OnProcessTimer( void *context );
+
+static uint8_t SessionSetup( const uint8_t *payload, uint8_t size );
+static void OnFragment( uint16_t index, const uint8_t *fragment, uint8_t size );
+static int32_t ReduceRow( void );
+static void SolveRows( void );
+static void OnBlockComplete( void );
+static void GetParityRow( int32_t n, int32_t m, uint32_t *row );
+static void QueueAnswer( uint8_t size );
+
+static LmhPackage_t DeviceTablePackage =
+{
+    .Port                    = DEVICE_TABLE_PORT,
+    .Init                    = LmhpDeviceTableInit,
+    .IsInitialized           = LmhpDeviceTableIsInitialized,
+    .IsTxPending             = LmhpDeviceTableIsTxPending,
+    .Process                 = LmhpDeviceTableProcess,
+    .OnPackageProcessEvent   = NULL,  /* To be initialized by LmHandler */
+    .OnMcpsConfirmProcess    = NULL,  /* Not used in this package */
+    .OnMcpsIndicationProcess = LmhpDeviceTableOnMcpsIndication,
+    .OnMlmeConfirmProcess    = NULL,  /* Not used in this package */
+    .OnMlmeIndicationProcess = NULL,  /* Not used in this package */
+    .OnJoinRequest           = NULL,  /* To be initialized by LmHandler */
+    .OnDeviceTimeRequest     = NULL,  /* To be initialized by LmHandler */
+    .OnSysTimeUpdate         = NULL,  /* To be initialized by LmHandler */
+#if (defined( LORAMAC_VERSION ) && (( LORAMAC_VERSION == 0x01000400 ) || ( LORAMAC_VERSION == 0x01010100 )))
+    .OnSystemReset           = NULL,  /* To be initialized by LmHandler */
+#endif /* LORAMAC_VERSION */
+};
+
+static inline bool BitIsSet( const uint32_t *bits, uint16_t index )
+{
+    return ( bits[index >> 5] & ( 1UL << ( index & 0x1F ) ) ) != 0;
+}
+
+static inline void BitSet( uint32_t *bits, uint16_t index )
+{
+    bits[index >> 5] |= ( 1UL << ( index & 0x1F ) );
+}
+
+static inline void BitClear( uint32_t *bits, uint16_t index )
+{
+    bits[index >> 5] &= ~( 1UL << ( index & 0x1F ) );
+}
+
+static inline uint8_t *GetSlot( uint16_t index )
+{
+    return &DeviceTableParams->Buffer[( uint32_t )index * DeviceTableState.FragSize];
+}
+
+static void XorBytes( uint8_t *destination, const uint8_t *source, uint8_t size )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        destination[i] ^= source[i];
+    }
+}
+
+LmhPackage_t *LmhpDeviceTablePackageFactory( void )
+{
+    return &DeviceTablePackage;
+}
+
+static void LmhpDeviceTableInit( void *params, uint8_t *dataBuffer, uint8_t dataBufferMaxSize )
+{
+    if( ( params != NULL ) && ( ( ( LmhpDeviceTableParams_t * )params )->Buffer != NULL ) )
+    {
+        DeviceTableParams = ( LmhpDeviceTableParams_t * )params;
+        DeviceTableState.Initialized = true;
+        TimerInit( &ProcessTimer, OnProcessTimer );
+    }
+    else
+    {
+        DeviceTableParams = NULL;
+        DeviceTableState.Initialized = false;
+    }
+    DeviceTableState.IsTxPending = false;
+    DeviceTableState.IsSessionActive = false;
+    DeviceTableState.LastStatus = DEVICE_TABLE_STATUS_NO_SESSION;
+}
+
+static bool LmhpDeviceTableIsInitialized( void )
+{
+    return DeviceTableState.Initialized;
+}
+
+static bool LmhpDeviceTableIsTxPending( void )
+{
+    return DeviceTableState.IsTxPending;
+}
+
+static void LmhpDeviceTableProcess( void )
+{
+    TimerTime_t now;
+
+    if( DeviceTableState.IsTxPending == false )
+    {
+        return;
+    }
+
+    now = TimerGetCurrentTime( );
+    if( now > ( DeviceTableState.TxPendingTimestamp + LmHandlerGetDutyCycleWaitTime( ) ) )
+    {
+        LmHandlerAppData_t appData =
+        {
+            .Buffer     = DeviceTableState.AnsBuffer,
+            .BufferSize = DeviceTableState.AnsSize,
+            .Port       = DEVICE_TABLE_PORT,
+        };
+
+        LmHandlerErrorStatus_t lmhStatus = LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG, true );
+        if( ( lmhStatus == LORAMAC_HANDLER_SUCCESS ) || ( lmhStatus == LORAMAC_HANDLER_PAYLOAD_LENGTH_RESTRICTED ) )
+        {
+            DeviceTableState.IsTxPending = false;
+        }
+        else
+        {
+            /* try to send the answer again */
+            TimerSetValue( &ProcessTimer, DEVICE_TABLE_ANS_DELAY );
+            TimerStart( &ProcessTimer );
+        }
+        DeviceTableState.TxPendingTimestamp = now;
+    }
+}
+
+static void LmhpDeviceTableOnMcpsIndication( McpsIndication_t *mcpsIndication )
+{
+    const uint8_t *payload = mcpsIndication->Buffer;
+    uint8_t size = mcpsIndication->BufferSize;
+    uint8_t *ans = DeviceTableState.AnsBuffer;
+
+    if( ( DeviceTableState.Initialized == false ) || ( mcpsIndication->RxData == false ) ||
+        ( mcpsIndication->Port != DEVICE_TABLE_PORT ) || ( size == 0 ) )
+    {
+        return;
+    }
+
+    switch( payload[0] )
+    {
+        case DEVICE_TABLE_SESSION_SETUP:
+            {
+                ans[0] = DEVICE_TABLE_SESSION_SETUP;
+                ans[1] = SessionSetup( payload, size );
+                QueueAnswer( 2 );
+                break;
+            }
+        case DEVICE_TABLE_DATA_FRAGMENT:
+            {
+                if( size > DEVICE_TABLE_FRAGMENT_HEADER_SIZE )
+                {
+                    OnFragment( ( uint16_t )payload[1] | ( ( uint16_t )payload[2] << 8 ),
+                                &payload[DEVICE_TABLE_FRAGMENT_HEADER_SIZE], size - DEVICE_TABLE_FRAGMENT_HEADER_SIZE );
+                }
+                break;
+            }
+        case DEVICE_TABLE_STATUS:
+            {
+                uint16_t missing = DeviceTableState.IsSessionActive ?
+                                   ( DeviceTableState.NbFrag - DeviceTableState.NbKnown - DeviceTableState.NbRows ) : 0;
+
+                ans[0] = DEVICE_TABLE_STATUS;
+                ans[1] = DeviceTableState.SessionCnt & 0xFF;
+                ans[2] = ( DeviceTableState.SessionCnt >> 8 ) & 0xFF;
+                ans[3] = DeviceTableState.NbReceived & 0xFF;
+                ans[4] = ( DeviceTableState.NbReceived >> 8 ) & 0xFF;
+                ans[5] = missing & 0xFF;
+                ans[6] = ( missing >> 8 ) & 0xFF;
+                ans[7] = DeviceTableState.LastStatus;
+                QueueAnswer( 8 );
+                break;
+            }
+        case DEVICE_TABLE_SESSION_DELETE:
+            {
+                ans[0] = DEVICE_TABLE_SESSION_DELETE;
+                ans[1] = DeviceTableState.IsSessionActive ? DEVICE_TABLE_STATUS_OK : DEVICE_TABLE_STATUS_NO_SESSION;
+                DeviceTableState.IsSessionActive = false;
+                DeviceTableState.LastStatus = DEVICE_TABLE_STATUS_NO_SESSION;
+                QueueAnswer( 2 );
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+}
+
+static void OnProcessTimer( void *context )
+{
+    if( DeviceTablePackage.OnPackageProcessEvent != NULL )
+    {
+        DeviceTablePackage.OnPackageProcessEvent( );
+    }
+}
+
+static uint8_t SessionSetup( const uint8_t *payload, uint8_t size )
+{
+    uint16_t sessionCnt;
+    uint16_t nbFrag;
+    uint8_t fragSize;
+    uint8_t padding;
+
+    if( size < DEVICE_TABLE_SETUP_REQ_SIZE )
+    {
+        return DEVICE_TABLE_STATUS_BAD_SETUP;
+    }
+    sessionCnt = ( uint16_t )payload[1] | ( ( uint16_t )payload[2] << 8 );
+    nbFrag = ( uint16_t )payload[3] | ( ( uint16_t )payload[4] << 8 );
+    fragSize = payload[5];
+    padding = payload[6];
+
+    /* A repeated request must not throw away what was already received */
+    if( ( DeviceTableState.IsSessionActive == true ) && ( sessionCnt == DeviceTableState.SessionCnt ) &&
+        ( nbFrag == DeviceTableState.NbFrag ) && ( fragSize == DeviceTableState.FragSize ) )
+    {
+        return DEVICE_TABLE_STATUS_OK;
+    }
+
+    DeviceTableState.IsSessionActive = false;
+    if( ( nbFrag == 0 ) || ( nbFrag > DEVICE_TABLE_MAX_NB_FRAG ) || ( fragSize == 0 ) ||
+        ( fragSize > DEVICE_TABLE_MAX_FRAG_SIZE ) || ( padding >= fragSize ) )
+    {
+        DeviceTableState.LastStatus = DEVICE_TABLE_STATUS_BAD_SETUP;
+        return DEVICE_TABLE_STATUS_BAD_SETUP;
+    }
+    if( ( ( uint32_t )nbFrag * fragSize ) > DeviceTableParams->BufferSize )
+    {
+        DeviceTableState.LastStatus = DEVICE_TABLE_STATUS_NO_MEMORY;
+        return DEVICE_TABLE_STATUS_NO_MEMORY;
+    }
+
+    DeviceTableState.SessionCnt = sessionCnt;
+    DeviceTableState.NbFrag = nbFrag;
+    DeviceTableState.FragSize = fragSize;
+    DeviceTableState.Padding = padding;
+    DeviceTableState.Descriptor = ( uint32_t )payload[7] | ( ( uint32_t )payload[8] << 8 ) |
+                                  ( ( uint32_t )payload[9] << 16 ) | ( ( uint32_t )payload[10] << 24 );
+    DeviceTableState.IntegrityCode = ( uint32_t )payload[11] | ( ( uint32_t )payload[12] << 8 ) |
+                                     ( ( uint32_t )payload[13] << 16 ) | ( ( uint32_t )payload[14] << 24 );
+    DeviceTableState.NbKnown = 0;
+    DeviceTableState.NbRows = 0;
+    DeviceTableState.NbReceived = 0;
+    memset1( ( uint8_t * )KnownBits, 0, sizeof( KnownBits ) );
+    memset1( ( uint8_t * )RowBits, 0, sizeof( RowBits ) );
+    DeviceTableState.IsSessionActive = true;
+    DeviceTableState.LastStatus = DEVICE_TABLE_STATUS_IN_PROGRESS;
+
+    MW_LOG( TS_OFF, VLEVEL_M, "Device Table: session %u, %u fragments of %u bytes\r\n", sessionCnt, nbFrag, fragSize );
+    return DEVICE_TABLE_STATUS_OK;
+}
+
+static void OnFragment( uint16_t index, const uint8_t *fragment, uint8_t size )
+{
+    uint16_t nbFrag = DeviceTableState.NbFrag;
+    uint8_t fragSize = DeviceTableState.FragSize;
+    int32_t lead;
+
+    if( ( DeviceTableState.IsSessionActive == false ) || ( index == 0 ) || ( size < fragSize ) )
+    {
+        return;
+    }
+    DeviceTableState.NbReceived++;
+
+    if( index <= nbFrag )
+    {
+        uint16_t slot = index - 1;
+
+        if( BitIsSet( KnownBits, slot ) == true )
+        {
+            return;
+        }
+        if( BitIsSet( RowBits, slot ) == false )
+        {
+            memcpy1( GetSlot( slot ), fragment, fragSize );
+            BitSet( KnownBits, slot );
+            DeviceTableState.NbKnown++;
+        }
+        else
+        {
+            /* The slot holds a parity row: take it out, minus this fragment, and reduce it again */
+            memcpy1( ( uint8_t * )Row, ( uint8_t * )Rows[slot], sizeof( Row ) );
+            memcpy1( Payload, GetSlot( slot ), fragSize );
+            BitClear( Row, slot );
+            XorBytes( Payload, fragment, fragSize );
+            memcpy1( GetSlot( slot ), fragment, fragSize );
+            BitClear( RowBits, slot );
+            BitSet( KnownBits, slot );
+            DeviceTableState.NbRows--;
+            DeviceTableState.NbKnown++;
+
+            lead = ReduceRow( );
+            if( lead >= 0 )
+            {
+                memcpy1( ( uint8_t * )Rows[lead], ( uint8_t * )Row, sizeof( Row ) );
+                memcpy1( GetSlot( lead ), Payload, fragSize );
+                BitSet( RowBits, lead );
+                DeviceTableState.NbRows++;
+            }
+        }
+    }
+    else
+    {
+        GetParityRow( index - nbFrag, nbFrag, Row );
+        memcpy1( Payload, fragment, fragSize );
+
+        lead = ReduceRow( );
+        if( lead < 0 )
+        {
+            /* Nothing new in this fragment */
+            return;
+        }
+        memcpy1( ( uint8_t * )Rows[lead], ( uint8_t * )Row, sizeof( Row ) );
+        memcpy1( GetSlot( lead ), Payload, fragSize );
+        BitSet( RowBits, lead );
+        DeviceTableState.NbRows++;
+    }
+
+    if( ( DeviceTableState.NbKnown + DeviceTableState.NbRows ) == nbFrag )
+    {
+        SolveRows( );
+        OnBlockComplete( );
+    }
+}
+
+/*!
+ * Removes the known fragments and the kept rows from Row and Payload.
+ *
+ * \retval lead Lowest missing fragment left in the row, -1 if the row became empty
+ */
+static int32_t ReduceRow( void )
+{
+    int32_t lead = -1;
+
+    for( uint16_t i = 0; i < DeviceTableState.NbFrag; i++ )
+    {
+        if( BitIsSet( Row, i ) == false )
+        {
+            continue;
+        }
+        if( BitIsSet( KnownBits, i ) == true )
+        {
+            XorBytes( Payload, GetSlot( i ), DeviceTableState.FragSize );
+            BitClear( Row, i );
+        }
+        else if( BitIsSet( RowBits, i ) == true )
+        {
+            /* Kept rows have no bit below their lead, so only the bits after i change */
+            for( uint8_t w = 0; w < DEVICE_TABLE_ROW_WORDS; w++ )
+            {
+                Row[w] ^= Rows[i][w];
+            }
+            XorBytes( Payload, GetSlot( i ), DeviceTableState.FragSize );
+        }
+        else if( lead < 0 )
+        {
+            lead = i;
+        }
+    }
+    return lead;
+}
+
+/*!
+ * Back substitution: every bit of a row above its lead is solved first.
+ */
+static void SolveRows( void )
+{
+    for( int32_t i = DeviceTableState.NbFrag - 1; i >= 0; i-- )
+    {
+        if( BitIsSet( RowBits, i ) == false )
+        {
+            continue;
+        }
+        for( uint16_t j = i + 1; j < DeviceTableState.NbFrag; j++ )
+        {
+            if( BitIsSet( Rows[i], j ) == true )
+            {
+                XorBytes( GetSlot( i ), GetSlot( j ), DeviceTableState.FragSize );
+            }
+        }
+        BitClear( RowBits, i );
+        BitSet( KnownBits, i );
+    }
+    DeviceTableState.NbKnown = DeviceTableState.NbFrag;
+    DeviceTableState.NbRows = 0;
+}
+
+static void OnBlockComplete( void )
+{
+    uint32_t size = ( ( uint32_t )DeviceTableState.NbFrag * DeviceTableState.FragSize ) - DeviceTableState.Padding;
+    uint32_t integrityCode = 0;
+    uint8_t appStatus = 0;
+    uint8_t *ans = DeviceTableState.AnsBuffer;
+
+    DeviceTableState.IsSessionActive = false;
+    if( ( LoRaMacCryptoComputeDataBlock( DeviceTableParams->Buffer, size, DeviceTableState.SessionCnt, 0,
+                                         DeviceTableState.Descriptor, &integrityCode ) != LORAMAC_CRYPTO_SUCCESS ) ||
+        ( integrityCode != DeviceTableState.IntegrityCode ) )
+    {
+        DeviceTableState.LastStatus = DEVICE_TABLE_STATUS_BAD_INTEGRITY;
+    }
+    else
+    {
+        if( DeviceTableParams->OnDataBlockReceived != NULL )
+        {
+            appStatus = DeviceTableParams->OnDataBlockReceived( DeviceTableParams->Buffer, size );
+        }
+        DeviceTableState.LastStatus = ( appStatus == 0 ) ? DEVICE_TABLE_STATUS_OK : DEVICE_TABLE_STATUS_REJECTED;
+    }
+    MW_LOG( TS_OFF, VLEVEL_M, "Device Table: %u bytes from %u fragments for %u, status %u\r\n",
+            size, DeviceTableState.NbReceived, DeviceTableState.NbFrag, DeviceTableState.LastStatus );
+
+    ans[0] = DEVICE_TABLE_DATA_BLOCK_IND;
+    ans[1] = DeviceTableState.SessionCnt & 0xFF;
+    ans[2] = ( DeviceTableState.SessionCnt >> 8 ) & 0xFF;
+    ans[3] = DeviceTableState.LastStatus;
+    ans[4] = appStatus;
+    QueueAnswer( 5 );
+}
+
+static int32_t FragPrbs23( int32_t value )
+{
+    int32_t b0 = value & 0x01;
+    int32_t b1 = ( value & 0x20 ) >> 5;
+
+    return ( value >> 1 ) + ( ( b0 ^ b1 ) << 22 );
+}
+
+/*!
+ * Row n (1 for the first coded fragment) of the TS004 parity matrix for m uncoded fragments
+ */
+static void GetParityRow( int32_t n, int32_t m, uint32_t *row )
+{
+    int32_t mTemp = ( ( m & ( m - 1 ) ) == 0 ) ? 1 : 0;
+    int32_t x = 1 + ( 1001 * n );
+    int32_t nbCoeff = 0;
+    int32_t r;
+
+    memset1( ( uint8_t * )row, 0, sizeof( uint32_t ) * DEVICE_TABLE_ROW_WORDS );
+    while( nbCoeff < ( m >> 1 ) )
+    {
+        r = 1 << 16;
+        while( r >= m )
+        {
+            x = FragPrbs23( x );
+            r = x % ( m + mTemp );
+        }
+        BitSet( row, r );
+        nbCoeff += 1;
+    }
+}
+
+static void QueueAnswer( uint8_t size )
+{
+    DeviceTableState.AnsSize = size;
+    DeviceTableState.IsTxPending = true;
+    if( ProcessTimer.IsRunning == 0U )
+    {
+        TimerSetValue( &ProcessTimer, DEVICE_TABLE_ANS_DELAY );
+        TimerStart( &ProcessTimer );
+    }
+}
@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file    LmhpDeviceTable.h
+  * @brief   Fragmented device table download package definition
+  ******************************************************************************
+  *
+  * A data block is split by the server into NbFrag uncoded fragments of
+  * FragSize bytes, followed by as many coded fragments as it wants to send.
+  * Coded fragment N is the XOR of the uncoded fragments selected by row
+  * N - NbFrag of the parity matrix of the LoRaWAN fragmented data block
+  * transport (TS004), so any NbFrag independent fragments rebuild the block.
+  *
+  * Downlinks on DEVICE_TABLE_PORT, multi-byte fields little endian:
+  *  - 0x01 SessionSetupReq  [session u16][nb frag u16][frag size u8][padding u8]
+  *                          [descriptor u32][integrity code u32]
+  *  - 0x02 DataFragment     [index u16][fragment], index 1..NbFrag uncoded, above coded
+  *  - 0x03 StatusReq
+  *  - 0x04 SessionDeleteReq
+  *
+  * Answers on the same port:
+  *  - 0x01 SessionSetupAns  [status u8]
+  *  - 0x03 StatusAns        [session u16][fragments received u16][missing u16][status u8]
+  *  - 0x04 SessionDeleteAns [status u8]
+  *  - 0x05 DataBlockInd     [session u16][status u8][application status u8]
+  *
+  * The integrity code is LoRaMacCryptoComputeDataBlock() over the block
+  * without its padding, keyed with DataBlockIntKey and bound to the session
+  * counter and descriptor.
+  */
+
+#ifndef __LMHP_DEVICE_TABLE_H__
+#define __LMHP_DEVICE_TABLE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "LmhPackage.h"
+
+/*!
+ * Device table package identifier.
+ *
+ * \remark This value must be unique amongst the packages
+ */
+#define PACKAGE_ID_DEVICE_TABLE                     5
+
+/*!
+ * Port of the downlinks and of the answers
+ */
+#define DEVICE_TABLE_PORT                           32
+
+/*!
+ * Largest number of uncoded fragments. The decoder keeps a parity row of
+ * this many bits for each fragment still missing.
+ */
+#define DEVICE_TABLE_MAX_NB_FRAG                    128
+
+/*!
+ * Largest fragment, the biggest downlink payload minus the 3 bytes header
+ */
+#define DEVICE_TABLE_MAX_FRAG_SIZE                  240
+
+/*!
+ * Status reported in the answers
+ */
+typedef enum LmhpDeviceTableStatus_e
+{
+    DEVICE_TABLE_STATUS_OK = 0,
+    DEVICE_TABLE_STATUS_BAD_SETUP,          /* fragment count, size or padding out of range */
+    DEVICE_TABLE_STATUS_NO_MEMORY,          /* block larger than the reassembly buffer */
+    DEVICE_TABLE_STATUS_NO_SESSION,
+    DEVICE_TABLE_STATUS_IN_PROGRESS,
+    DEVICE_TABLE_STATUS_BAD_INTEGRITY,
+    DEVICE_TABLE_STATUS_REJECTED,           /* block refused by the application, see its status */
+} LmhpDeviceTableStatus_t;
+
+/*!
+ * Device table package parameters
+ */
+typedef struct LmhpDeviceTableParams_s
+{
+    /*!
+     * Reassembly buffer, NbFrag x FragSize bytes at most
+     */
+    uint8_t *Buffer;
+    /*!
+     * Reassembly buffer size
+     */
+    uint32_t BufferSize;
+    /*!
+     * Called once the block is complete and its integrity code matches
+     *
+     * \param [in] block Reassembled block, padding removed
+     * \param [in] size  Block size
+     *
+     * \retval status    0 if the block was applied, an application error code otherwise
+     */
+    uint8_t ( *OnDataBlockReceived )( const uint8_t *block, uint32_t size );
+} LmhpDeviceTableParams_t;
+
+LmhPackage_t *LmhpDeviceTablePackageFactory( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LMHP_DEVICE_TABLE_H__ */
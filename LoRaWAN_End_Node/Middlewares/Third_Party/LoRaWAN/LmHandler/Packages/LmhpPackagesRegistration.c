@@ -27,6 +27,10 @@
 #include "frag_decoder_if.h"
 #include "LmhpFirmwareManagement.h"
 #endif /* LORAWAN_DATA_DISTRIB_MGT */
+#if (defined (LORAWAN_DEVICE_TABLE_PKG) && (LORAWAN_DEVICE_TABLE_PKG == 1))
+#include "LmhpDeviceTable.h"
+#include "PWX_DeviceTable.h"
+#endif /* LORAWAN_DEVICE_TABLE_PKG */
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -41,6 +45,12 @@
 /* Exported functions ---------------------------------------------------------*/
 LmHandlerErrorStatus_t LmhpPackagesRegistrationInit( Version_t *fwVersion )
 {
+#if (defined (LORAWAN_DEVICE_TABLE_PKG) && (LORAWAN_DEVICE_TABLE_PKG == 1))
+    if( LmHandlerPackageRegister( PACKAGE_ID_DEVICE_TABLE, &DeviceTableParams ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+#endif /* LORAWAN_DEVICE_TABLE_PKG */
 #if (defined (LORAWAN_DATA_DISTRIB_MGT) && (LORAWAN_DATA_DISTRIB_MGT == 1))
     if( LmHandlerPackageRegister( PACKAGE_ID_CLOCK_SYNC, NULL ) != LORAMAC_HANDLER_SUCCESS )
     {
@@ -68,6 +78,13 @@ LmHandlerErrorStatus_t LmhpPackagesRegistrationInit( Version_t *fwVersion )
 
 LmHandlerErrorStatus_t LmhpPackagesRegister( uint8_t id, LmhPackage_t **package )
 {
+#if (defined (LORAWAN_DEVICE_TABLE_PKG) && (LORAWAN_DEVICE_TABLE_PKG == 1))
+    if( ( package != NULL ) && ( id == PACKAGE_ID_DEVICE_TABLE ) )
+    {
+        *package = LmhpDeviceTablePackageFactory();
+        return LORAMAC_HANDLER_SUCCESS;
+    }
+#endif /* LORAWAN_DEVICE_TABLE_PKG */
 #if (defined (LORAWAN_DATA_DISTRIB_MGT) && (LORAWAN_DATA_DISTRIB_MGT == 1))
     if( package == NULL )
     {
@@ -963,10 +963,6 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
     MW_LOG(TS_ON, VLEVEL_M, "MAC rxDone\r\n" );
 
     isTxSuccess = true;
-    if(confUplinkCounter >= MAX_UPLINK_BEFORE_CONFIRMED){
-    	MW_LOG(TS_ON, VLEVEL_M, "Resetting Uplink Counter\r\n" );
-        confUplinkCounter = 0;
-    }
 }
 
 static void OnRadioTxTimeout( void )
@@ -4729,6 +4725,9 @@ static LoRaMacStatus_t RestoreNvmData( void )
     memcpy1( ( uint8_t* ) &Nvm, ( uint8_t* ) &NvmBackup, sizeof( LoRaMacNvmData_t ) );
     memset1( ( uint8_t* ) &NvmBackup, 0, sizeof( LoRaMacNvmData_t ) );
 
+    // The channels table was replaced
+    RegionCommonChannelsChanged( );
+
     // Initialize RxC config parameters.
     MacCtx.RxWindowCConfig.Channel = MacCtx.Channel;
     MacCtx.RxWindowCConfig.Frequency = Nvm.MacGroup2.MacParams.RxCChannel.Frequency;
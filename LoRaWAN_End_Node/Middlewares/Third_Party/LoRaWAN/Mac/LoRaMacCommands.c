@@ -49,6 +49,22 @@
  */
 #define CID_FIELD_SIZE 1
 
+/*!
+ * Free slot bitmap covering all MAC command slots
+ */
+#if ( NUM_OF_MAC_COMMANDS > 32 )
+#error "NUM_OF_MAC_COMMANDS does not fit the free slot bitmap"
+#elif ( NUM_OF_MAC_COMMANDS == 32 )
+#define ALL_SLOTS_FREE_MASK 0xFFFFFFFFUL
+#else
+#define ALL_SLOTS_FREE_MASK ( ( 1UL << NUM_OF_MAC_COMMANDS ) - 1UL )
+#endif
+
+/*!
+ * Previous slot index of the first element of the list
+ */
+#define NO_SLOT_INDEX 0xFF
+
 /*!
  *  Mac Commands list structure
  */
@@ -77,6 +93,14 @@ typedef struct sLoRaMacCommandsCtx
      * Buffer to store MAC command elements
      */
     MacCommand_t MacCommandSlots[NUM_OF_MAC_COMMANDS];
+    /*
+     * Bitmap of the free MAC command slots, bit n for MacCommandSlots[n]
+     */
+    uint32_t FreeSlots;
+    /*
+     * Slot index of the previous element in the list, for each slot
+     */
+    uint8_t PrevSlot[NUM_OF_MAC_COMMANDS];
     /*
      * Size of all MAC commands serialized as buffer
      */
@@ -91,23 +115,29 @@ static LoRaMacCommandsCtx_t CommandsCtx;
 /* Memory management functions */
 
 /*!
- * \brief Determines if a MAC command slot is free
+ * \brief Returns the slot index of a MAC command element
+ *
+ * \param [in]    slot           - Slot
+ * \retval                       - Index in MacCommandSlots
+ */
+static uint8_t GetSlotIndex( const MacCommand_t* slot )
+{
+    return ( uint8_t )( slot - CommandsCtx.MacCommandSlots );
+}
+
+/*!
+ * \brief Determines if an element is an allocated MAC command slot
  *
  * \param [in]    slot           - Slot to check
  * \retval                       - Status of the operation
  */
-static bool IsSlotFree( const MacCommand_t* slot )
+static bool IsSlotAllocated( const MacCommand_t* slot )
 {
-    uint8_t* mem = ( uint8_t* )slot;
-
-    for( uint16_t size = 0; size < sizeof( MacCommand_t ); size++ )
+    if( ( slot < CommandsCtx.MacCommandSlots ) || ( slot >= &CommandsCtx.MacCommandSlots[NUM_OF_MAC_COMMANDS] ) )
     {
-        if( mem[size] != 0x00 )
-        {
-            return false;
-        }
+        return false;
     }
-    return true;
+    return ( CommandsCtx.FreeSlots & ( 1UL << GetSlotIndex( slot ) ) ) == 0;
 }
 
 /*!
@@ -117,17 +147,17 @@ static bool IsSlotFree( const MacCommand_t* slot )
  */
 static MacCommand_t* MallocNewMacCommandSlot( void )
 {
-    uint8_t itr = 0;
+    uint8_t itr;
 
-    while( IsSlotFree( ( const MacCommand_t* )&CommandsCtx.MacCommandSlots[itr] ) == false )
+    if( CommandsCtx.FreeSlots == 0 )
     {
-        itr++;
-        if( itr == NUM_OF_MAC_COMMANDS )
-        {
-            return NULL;
-        }
+        return NULL;
     }
 
+    // Lowest free slot
+    itr = ( uint8_t )__builtin_ctz( CommandsCtx.FreeSlots );
+    CommandsCtx.FreeSlots &= ~( 1UL << itr );
+
     return &CommandsCtx.MacCommandSlots[itr];
 }
 
@@ -146,6 +176,7 @@ static bool FreeMacCommandSlot( MacCommand_t* slot )
     }
 
     memset1( ( uint8_t* )slot, 0x00, sizeof( MacCommand_t ) );
+    CommandsCtx.FreeSlots |= ( 1UL << GetSlotIndex( slot ) );
 
     return true;
 }
@@ -195,6 +226,11 @@ static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
     if( list->Last )
     {
         list->Last->Next = element;
+        CommandsCtx.PrevSlot[GetSlotIndex( element )] = GetSlotIndex( list->Last );
+    }
+    else
+    {
+        CommandsCtx.PrevSlot[GetSlotIndex( element )] = NO_SLOT_INDEX;
     }
 
     // Update the next point of this entry.
@@ -220,26 +256,15 @@ static MacCommand_t* LinkedListGetPrevious( MacCommandsList_t* list, MacCommand_
         return NULL;
     }
 
-    MacCommand_t* curElement;
-
-    // Start at the head of the list
-    curElement = list->First;
+    uint8_t prevSlot = CommandsCtx.PrevSlot[GetSlotIndex( element )];
 
-    // When current element is the first of the list, there's no previous element so we can return NULL immediately.
-    if( element != curElement )
+    // The first element of the list has no previous element
+    if( ( element == list->First ) || ( prevSlot == NO_SLOT_INDEX ) )
     {
-        // Loop through all elements until the end is reached or the next of current is the current element.
-        while( ( curElement != NULL ) && ( curElement->Next != element ) )
-        {
-            curElement = curElement->Next;
-        }
-    }
-    else
-    {
-        curElement = NULL;
+        return NULL;
     }
 
-    return curElement;
+    return &CommandsCtx.MacCommandSlots[prevSlot];
 }
 
 /*!
@@ -251,7 +276,7 @@ static MacCommand_t* LinkedListGetPrevious( MacCommandsList_t* list, MacCommand_
  */
 static bool LinkedListRemove( MacCommandsList_t* list, MacCommand_t* element )
 {
-    if( ( list == NULL ) || ( element == NULL ) )
+    if( ( list == NULL ) || ( element == NULL ) || ( IsSlotAllocated( element ) == false ) )
     {
         return false;
     }
@@ -273,6 +298,11 @@ static bool LinkedListRemove( MacCommandsList_t* list, MacCommand_t* element )
         PrevElement->Next = element->Next;
     }
 
+    if( element->Next != NULL )
+    {
+        CommandsCtx.PrevSlot[GetSlotIndex( element->Next )] = ( PrevElement != NULL ) ? GetSlotIndex( PrevElement ) : NO_SLOT_INDEX;
+    }
+
     element->Next = NULL;
 
     return true;
@@ -333,6 +363,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsInit( void )
 {
     // Initialize with default
     memset1( ( uint8_t* )&CommandsCtx, 0, sizeof( CommandsCtx ) );
+    CommandsCtx.FreeSlots = ALL_SLOTS_FREE_MASK;
 
     LinkedListInit( &CommandsCtx.MacCommandList );
 
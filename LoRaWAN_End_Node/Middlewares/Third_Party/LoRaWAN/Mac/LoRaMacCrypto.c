@@ -52,7 +52,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include "usart.h"
+#include "sys_app.h"
 
 //int getDevnonce = 0;
 /*
@@ -61,10 +61,8 @@
 void check_page_for_empty(uint32_t start_address) {
     uint32_t address;
     uint32_t devnonce = 0;
-    uint8_t msg[100];
 
-    sprintf((char*)msg, "######### Checking entire flash page\r\n");
-    HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+    APP_LOG(TS_OFF, VLEVEL_M, "######### Checking entire flash page\r\n");
 
     for (address = start_address; address < start_address + FLASH_PAGE_SIZE; address += sizeof(uint64_t)) {
         uint64_t data;
@@ -74,26 +72,21 @@ void check_page_for_empty(uint32_t start_address) {
 
         // Check if the read operation was successful
         if (status != FLASH_IF_OK) {
-        	sprintf((char*)msg, "Error: Flash read failed!\r\n");
-        	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+        	APP_LOG(TS_OFF, VLEVEL_M, "Error: Flash read failed!\r\n");
             return;
         }
 
         // Check if the data is empty (all bits are set to 1)
         if (data != UINT64_MAX) {
-        	sprintf((char*)msg, "Address at 0x%x has value \r\n", address);
-        	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+        	APP_LOG(TS_OFF, VLEVEL_M, "Address at 0x%x has value \r\n", address);
         	status = FLASH_IF_Read((void *)&devnonce, (const void *)address, sizeof(devnonce));
-        	sprintf((char*)msg, "Devnonce Value: %d \r\n", devnonce);
-        	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+        	APP_LOG(TS_OFF, VLEVEL_M, "Devnonce Value: %d \r\n", devnonce);
         } else {
-        	sprintf((char*)msg, "Address at 0x%x is empty \r\n", address);
-        	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+        	APP_LOG(TS_OFF, VLEVEL_M, "Address at 0x%x is empty \r\n", address);
         }
     }
 
-    sprintf((char*)msg, "######### Entire flash page checked\r\n");
-    HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+    APP_LOG(TS_OFF, VLEVEL_M, "######### Entire flash page checked\r\n");
 }
 
 /*
@@ -105,12 +98,10 @@ uint32_t read_devnonce_from_flash() {
 	uint32_t latestDevnonce = 0;
 
 	uint32_t page_start_address = (DEVNONCE_FLASH_ADDRESS / FLASH_PAGE_SIZE) * FLASH_PAGE_SIZE;
-	uint8_t msg[100]; // Buffer for storing messages to be transmitted via UART
 
 	//check_page_for_empty(page_start_address);	//Read entire page for devnonce entries
 
-	sprintf((char*)msg, "Checking for stored DevNonce on Flash\r\n", devnonce, address);
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "Checking for stored DevNonce on Flash\r\n");
 
 	bool gotLatest = false;
 	for (address = page_start_address; address < page_start_address + FLASH_PAGE_SIZE; address += sizeof(uint64_t)) {
@@ -121,21 +112,17 @@ uint32_t read_devnonce_from_flash() {
 		// Check if the data in the given address is empty (all bits are set to 1)
 		if (data != UINT64_MAX) {
 			status = FLASH_IF_Read((void *)&devnonce, (const void *)address, sizeof(devnonce));
-			sprintf((char*)msg, "Devnonce %d at address 0x%x\r\n", devnonce, address);
-			HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+			APP_LOG(TS_OFF, VLEVEL_M, "Devnonce %d at address 0x%x\r\n", devnonce, address);
 			gotLatest = true;
 			latestDevnonce = devnonce;
 		} else if (data == UINT64_MAX && gotLatest == true) {
-			sprintf((char*)msg, "Free address at 0x%x\r\n", address);
-			HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+			APP_LOG(TS_OFF, VLEVEL_M, "Free address at 0x%x\r\n", address);
 			return devnonce;
 		} else{
-			sprintf((char*)msg, "No devnonce at address 0x%x\r\n", address);
-			HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+			APP_LOG(TS_OFF, VLEVEL_M, "No devnonce at address 0x%x\r\n", address);
 		}
 	}
-	sprintf((char*)msg, "Devnonce %d fetched at address 0x%x\r\n", devnonce, address);
-	HAL_UART_Transmit(&huart2, msg, strlen((char*)msg), 1000);
+	APP_LOG(TS_OFF, VLEVEL_M, "Devnonce %d fetched at address 0x%x\r\n", devnonce, address);
 	return devnonce;
 }
 
@@ -653,6 +653,8 @@ void RegionSetBandTxDone( LoRaMacRegion_t region, SetBandTxDoneParams_t* txDone
 
 void RegionInitDefaults( LoRaMacRegion_t region, InitDefaultsParams_t* params )
 {
+    RegionCommonChannelsChanged( );
+
     switch( region )
     {
         AS923_INIT_DEFAULTS( );
@@ -695,6 +697,8 @@ bool RegionVerify( LoRaMacRegion_t region, VerifyParams_t* verify, PhyAttribute_
 
 void RegionApplyCFList( LoRaMacRegion_t region, ApplyCFListParams_t* applyCFList )
 {
+    RegionCommonChannelsChanged( );
+
     switch( region )
     {
         AS923_APPLY_CF_LIST( );
@@ -842,6 +846,8 @@ uint8_t RegionRxParamSetupReq( LoRaMacRegion_t region, RxParamSetupReqParams_t*
 
 int8_t RegionNewChannelReq( LoRaMacRegion_t region, NewChannelReqParams_t* newChannelReq )
 {
+    RegionCommonChannelsChanged( );
+
     switch( region )
     {
         AS923_NEW_CHANNEL_REQ( );
@@ -947,6 +953,8 @@ LoRaMacStatus_t RegionNextChannel( LoRaMacRegion_t region, NextChanParams_t* nex
 
 LoRaMacStatus_t RegionChannelAdd( LoRaMacRegion_t region, ChannelAddParams_t* channelAdd )
 {
+    RegionCommonChannelsChanged( );
+
     switch( region )
     {
         AS923_CHANNEL_ADD( );
@@ -968,6 +976,8 @@ LoRaMacStatus_t RegionChannelAdd( LoRaMacRegion_t region, ChannelAddParams_t* ch
 
 bool RegionChannelsRemove( LoRaMacRegion_t region, ChannelRemoveParams_t* channelRemove )
 {
+    RegionCommonChannelsChanged( );
+
     switch( region )
     {
         AS923_CHANNEL_REMOVE( );
@@ -87,6 +87,61 @@
 static const char *EventRXSlotStrings[] = { "1", "2", "C", "Multi_C", "P", "Multi_P" };
 #endif
 
+/*!
+ * Channels passing the mask, frequency, join mask and datarate checks, in
+ * ascending order. Only band readiness is re-evaluated on each TX.
+ */
+typedef struct sRegionCommonChannelCache
+{
+    /*!
+     * Set when the candidate list matches the key below
+     */
+    bool Valid;
+    /*!
+     * Value of ChannelsGeneration when the list was built
+     */
+    uint16_t Generation;
+    /*!
+     * Channels table the list was built from
+     */
+    ChannelParams_t* Channels;
+    /*!
+     * Number of channels of the region
+     */
+    uint16_t MaxNbChannels;
+    /*!
+     * Datarate the list was built for
+     */
+    uint8_t Datarate;
+    /*!
+     * Join state the list was built for
+     */
+    bool Joined;
+    /*!
+     * Copy of the channels mask the list was built from
+     */
+    uint16_t ChannelsMask[REGION_NVM_CHANNELS_MASK_SIZE];
+    /*!
+     * Copy of the join channels mask, all ones when not applicable
+     */
+    uint16_t JoinChannels[REGION_NVM_CHANNELS_MASK_SIZE];
+    /*!
+     * Number of candidate channels
+     */
+    uint8_t NbCandidates;
+    /*!
+     * Candidate channel indexes
+     */
+    uint8_t Candidates[REGION_NVM_MAX_NB_CHANNELS];
+}RegionCommonChannelCache_t;
+
+static RegionCommonChannelCache_t ChannelCache;
+
+/*!
+ * Bumped by RegionCommonChannelsChanged on every edit of the channels table
+ */
+static uint16_t ChannelsGeneration = 0;
+
 static uint16_t GetDutyCycle( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup )
 {
     uint16_t dutyCycle = band->DCycle;
@@ -219,16 +274,11 @@ static uint16_t UpdateTimeCredits( Band_t* band, bool joined, bool dutyCycleEnab
 
 static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
 {
-    uint8_t nbActiveBits = 0;
-
-    for( uint8_t j = 0; j < nbBits; j++ )
+    if( nbBits < 16 )
     {
-        if( ( mask & ( 1 << j ) ) == ( 1 << j ) )
-        {
-            nbActiveBits++;
-        }
+        mask &= ( 1U << nbBits ) - 1;
     }
-    return nbActiveBits;
+    return ( uint8_t )__builtin_popcount( mask );
 }
 
 bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_t dr, int8_t minDr, int8_t maxDr, ChannelParams_t* channels )
@@ -565,44 +615,115 @@ void RegionCommonRxBeaconSetup( RegionCommonRxBeaconSetupParams_t* rxBeaconSetup
     MW_LOG(TS_ON, VLEVEL_M, "RX_BC on freq %d Hz at DR %d\r\n", rxBeaconSetupParams->Frequency, rxBeaconSetupParams->BeaconDatarate );
 }
 
+static bool ChannelCacheMatches( RegionCommonCountNbOfEnabledChannelsParams_t* params, uint8_t maskSize )
+{
+    if( ( ChannelCache.Valid == false ) ||
+        ( ChannelCache.Generation != ChannelsGeneration ) ||
+        ( ChannelCache.Channels != params->Channels ) ||
+        ( ChannelCache.MaxNbChannels != params->MaxNbChannels ) ||
+        ( ChannelCache.Datarate != params->Datarate ) ||
+        ( ChannelCache.Joined != params->Joined ) )
+    {
+        return false;
+    }
+    for( uint8_t k = 0; k < maskSize; k++ )
+    {
+        uint16_t joinChannels = 0xFFFF;
+
+        if( ( params->Joined == false ) && ( params->JoinChannels != NULL ) )
+        {
+            joinChannels = params->JoinChannels[k];
+        }
+        if( ( ChannelCache.ChannelsMask[k] != params->ChannelsMask[k] ) ||
+            ( ChannelCache.JoinChannels[k] != joinChannels ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void ChannelCacheBuild( RegionCommonCountNbOfEnabledChannelsParams_t* params, uint8_t maskSize )
+{
+    uint8_t nbCandidates = 0;
+
+    for( uint8_t k = 0; k < maskSize; k++ )
+    {
+        uint16_t mask = params->ChannelsMask[k];
+
+        ChannelCache.ChannelsMask[k] = mask;
+        ChannelCache.JoinChannels[k] = 0xFFFF;
+        if( ( params->Joined == false ) && ( params->JoinChannels != NULL ) )
+        {
+            ChannelCache.JoinChannels[k] = params->JoinChannels[k];
+            mask &= params->JoinChannels[k];
+        }
+
+        // Visit the set bits only
+        while( mask != 0 )
+        {
+            uint8_t id = ( k * 16 ) + ( uint8_t )__builtin_ctz( mask );
+            mask &= mask - 1;
+
+            if( id >= params->MaxNbChannels )
+            {
+                break;
+            }
+            if( params->Channels[id].Frequency == 0 )
+            { // Check if the channel is enabled
+                continue;
+            }
+            if( RegionCommonValueInRange( params->Datarate,
+                                          params->Channels[id].DrRange.Fields.Min,
+                                          params->Channels[id].DrRange.Fields.Max ) == false )
+            { // Check if the current channel selection supports the given datarate
+                continue;
+            }
+            ChannelCache.Candidates[nbCandidates++] = id;
+        }
+    }
+
+    ChannelCache.NbCandidates = nbCandidates;
+    ChannelCache.Generation = ChannelsGeneration;
+    ChannelCache.Channels = params->Channels;
+    ChannelCache.MaxNbChannels = params->MaxNbChannels;
+    ChannelCache.Datarate = params->Datarate;
+    ChannelCache.Joined = params->Joined;
+    ChannelCache.Valid = true;
+}
+
+void RegionCommonChannelsChanged( void )
+{
+    ChannelsGeneration++;
+}
+
 void RegionCommonCountNbOfEnabledChannels( RegionCommonCountNbOfEnabledChannelsParams_t* countNbOfEnabledChannelsParams,
                                            uint8_t* enabledChannels, uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels )
 {
     uint8_t nbChannelCount = 0;
     uint8_t nbRestrictedChannelsCount = 0;
+    uint8_t maskSize = ( countNbOfEnabledChannelsParams->MaxNbChannels + 15 ) / 16;
 
-    for( uint8_t i = 0, k = 0; i < countNbOfEnabledChannelsParams->MaxNbChannels; i += 16, k++ )
+    if( maskSize > REGION_NVM_CHANNELS_MASK_SIZE )
     {
-        for( uint8_t j = 0; j < 16; j++ )
-        {
-            if( ( countNbOfEnabledChannelsParams->ChannelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( countNbOfEnabledChannelsParams->Channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( ( countNbOfEnabledChannelsParams->Joined == false ) &&
-                    ( countNbOfEnabledChannelsParams->JoinChannels != NULL ) )
-                {
-                    if( ( countNbOfEnabledChannelsParams->JoinChannels[k] & ( 1 << j ) ) == 0 )
-                    {
-                        continue;
-                    }
-                }
-                if( RegionCommonValueInRange( countNbOfEnabledChannelsParams->Datarate,
-                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Min,
-                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( countNbOfEnabledChannelsParams->Bands[countNbOfEnabledChannelsParams->Channels[i + j].Band].ReadyForTransmission == false )
-                { // Check if the band is available for transmission
-                    nbRestrictedChannelsCount++;
-                    continue;
-                }
-                enabledChannels[nbChannelCount++] = i + j;
-            }
+        maskSize = REGION_NVM_CHANNELS_MASK_SIZE;
+    }
+
+    if( ChannelCacheMatches( countNbOfEnabledChannelsParams, maskSize ) == false )
+    {
+        ChannelCacheBuild( countNbOfEnabledChannelsParams, maskSize );
+    }
+
+    for( uint8_t i = 0; i < ChannelCache.NbCandidates; i++ )
+    {
+        uint8_t id = ChannelCache.Candidates[i];
+
+        if( countNbOfEnabledChannelsParams->Bands[countNbOfEnabledChannelsParams->Channels[id].Band].ReadyForTransmission == false )
+        { // Check if the band is available for transmission
+            nbRestrictedChannelsCount++;
+            continue;
         }
+        enabledChannels[nbChannelCount++] = id;
     }
     *nbEnabledChannels = nbChannelCount;
     *nbRestrictedChannels = nbRestrictedChannelsCount;
@@ -554,6 +554,14 @@ int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float ant
  */
 void RegionCommonRxBeaconSetup( RegionCommonRxBeaconSetupParams_t* rxBeaconSetupParams );
 
+/*!
+ * \brief Invalidates the cached channel candidates of
+ *        \ref RegionCommonCountNbOfEnabledChannels. Shall be called whenever
+ *        the channels table (frequency, datarate range, band) is modified.
+ *        Channels mask edits are detected without it.
+ */
+void RegionCommonChannelsChanged( void );
+
 /*!
  * \brief Counts the number of enabled channels.
  *
@@ -566,6 +574,10 @@ void RegionCommonRxBeaconSetup( RegionCommonRxBeaconSetupParams_t* rxBeaconSetup
  *
  * \param [out] nbRestrictedChannels It contains the number of channel
  *                      which are available, but restricted due to duty cycle.
+ *
+ * \remark The channels passing the mask, frequency, join and datarate checks
+ *         are cached, keyed on the channels mask, datarate and join state, so
+ *         only band readiness is evaluated when nothing else changed.
  */
 void RegionCommonCountNbOfEnabledChannels( RegionCommonCountNbOfEnabledChannelsParams_t* countNbOfEnabledChannelsParams,
                                            uint8_t* enabledChannels, uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels );
@@ -155,6 +155,11 @@ typedef struct SubgRf_s
 
 #define RADIO_BUF_SIZE 255
 
+/*!
+ * Number of LoRa modem settings whose time on air per payload length is memoized
+ */
+#define RADIO_TOA_CACHE_NB_SLOTS 2
+
 /* Private function prototypes -----------------------------------------------*/
 /*!
  * \brief Initializes the radio
@@ -629,10 +634,44 @@ static uint32_t RadioGetLoRaTimeOnAirNumerator( uint32_t bandwidth,
                                                 uint16_t preambleLen, bool fixLen, uint8_t payloadLen,
                                                 bool crcOn );
 
+/*!
+ * \brief Returns the memoized LoRa time on air, computing and storing it on a miss
+ *
+ * \param [in] bandwidth    LoRa bandwidth index [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \param [in] datarate     Spreading factor
+ * \param [in] coderate     Coding rate
+ * \param [in] preambleLen  Preamble length in symbols
+ * \param [in] fixLen       Fixed length packets [0: variable, 1: fixed]
+ * \param [in] payloadLen   Payload length
+ * \param [in] crcOn        Enables/Disables the CRC [0: OFF, 1: ON]
+ * \retval airTime          Time on air (ms), same value as the exact formula
+ */
+static uint32_t RadioGetLoRaTimeOnAirCached( uint32_t bandwidth,
+                                             uint32_t datarate, uint8_t coderate,
+                                             uint16_t preambleLen, bool fixLen, uint8_t payloadLen,
+                                             bool crcOn );
+
 #if( RADIO_LR_FHSS_IS_ON == 1 )
 static uint32_t GetNextFreqIdx( uint32_t max );
 #endif /* RADIO_LR_FHSS_IS_ON == 1 */
 
+/* Private types -------------------------------------------------------------*/
+/*!
+ * Time on air of every payload length for one LoRa modem setting.
+ * An entry of 0 has not been computed yet (a LoRa frame never takes 0 ms).
+ */
+typedef struct
+{
+    bool     Used;
+    uint8_t  Bandwidth;
+    uint8_t  Datarate;
+    uint8_t  Coderate;
+    uint16_t PreambleLen;
+    bool     FixLen;
+    bool     CrcOn;
+    uint16_t TimeOnAir[RADIO_BUF_SIZE + 1];
+} RadioToaCacheSlot_t;
+
 /* Private variables ---------------------------------------------------------*/
 /*!
  * Radio driver structure initialization
@@ -683,6 +722,12 @@ static uint8_t MaxPayloadLength = RADIO_BUF_SIZE;
 
 static uint8_t RadioBuffer[RADIO_BUF_SIZE];
 
+/*!
+ * Memoized LoRa time on air, slots are recycled oldest first
+ */
+static RadioToaCacheSlot_t RadioToaCache[RADIO_TOA_CACHE_NB_SLOTS];
+static uint8_t RadioToaCacheNextSlot = 0;
+
 /*
  * Radio callbacks variable
  */
@@ -1275,6 +1320,57 @@ static uint32_t RadioGetLoRaTimeOnAirNumerator( uint32_t bandwidth,
     return ( uint32_t )( ( 4 * intermediate + 1 ) * ( 1 << ( datarate - 2 ) ) );
 }
 
+static uint32_t RadioGetLoRaTimeOnAirCached( uint32_t bandwidth,
+                                             uint32_t datarate, uint8_t coderate,
+                                             uint16_t preambleLen, bool fixLen, uint8_t payloadLen,
+                                             bool crcOn )
+{
+    RadioToaCacheSlot_t *slot = NULL;
+    uint32_t airTime;
+
+    for( uint8_t i = 0; i < RADIO_TOA_CACHE_NB_SLOTS; i++ )
+    {
+        RadioToaCacheSlot_t *candidate = &RadioToaCache[i];
+
+        if( ( candidate->Used == true ) && ( candidate->Bandwidth == bandwidth ) &&
+            ( candidate->Datarate == datarate ) && ( candidate->Coderate == coderate ) &&
+            ( candidate->PreambleLen == preambleLen ) && ( candidate->FixLen == fixLen ) &&
+            ( candidate->CrcOn == crcOn ) )
+        {
+            slot = candidate;
+            break;
+        }
+    }
+
+    if( ( slot != NULL ) && ( slot->TimeOnAir[payloadLen] != 0 ) )
+    {
+        return slot->TimeOnAir[payloadLen];
+    }
+
+    airTime = DIVC( 1000U * RadioGetLoRaTimeOnAirNumerator( bandwidth, datarate, coderate,
+                                                            preambleLen, fixLen, payloadLen, crcOn ),
+                    RadioGetLoRaBandwidthInHz( Bandwidths[bandwidth] ) );
+
+    if( slot == NULL )
+    {
+        slot = &RadioToaCache[RadioToaCacheNextSlot];
+        RadioToaCacheNextSlot = ( RadioToaCacheNextSlot + 1 ) % RADIO_TOA_CACHE_NB_SLOTS;
+        RADIO_MEMSET8( ( uint8_t * )slot->TimeOnAir, 0, sizeof( slot->TimeOnAir ) );
+        slot->Used = true;
+        slot->Bandwidth = bandwidth;
+        slot->Datarate = datarate;
+        slot->Coderate = coderate;
+        slot->PreambleLen = preambleLen;
+        slot->FixLen = fixLen;
+        slot->CrcOn = crcOn;
+    }
+    if( airTime <= UINT16_MAX )
+    {
+        slot->TimeOnAir[payloadLen] = ( uint16_t )airTime;
+    }
+    return airTime;
+}
+
 static uint32_t RadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth,
                                 uint32_t datarate, uint8_t coderate,
                                 uint16_t preambleLen, bool fixLen, uint8_t payloadLen,
@@ -1295,12 +1391,9 @@ static uint32_t RadioTimeOnAir( RadioModems_t modem, uint32_t bandwidth,
         break;
     case MODEM_LORA:
         {
-            numerator   = 1000U * RadioGetLoRaTimeOnAirNumerator( bandwidth, datarate,
-                                                                  coderate, preambleLen,
-                                                                  fixLen, payloadLen, crcOn );
-            denominator = RadioGetLoRaBandwidthInHz( Bandwidths[bandwidth] );
+            return RadioGetLoRaTimeOnAirCached( bandwidth, datarate, coderate,
+                                                preambleLen, fixLen, payloadLen, crcOn );
         }
-        break;
     default:
         break;
     }
@@ -110,6 +110,37 @@ typedef struct FskBandwidth_s
 #define DCDC_ENABLE                 ( 1UL )
 #endif /* DCDC_ENABLE */
 
+/**
+  * @brief Largest parameter buffer kept by the configuration shadow (packet params)
+  */
+#define RADIO_SHADOW_BUFFER_SIZE    ( 9UL )
+
+/* Private typedef -----------------------------------------------------------*/
+/*!
+ * \brief Configuration commands whose last value is kept by the driver
+ */
+typedef enum
+{
+    RADIO_SHADOW_PACKETTYPE = 0,
+    RADIO_SHADOW_MODULATIONPARAMS,
+    RADIO_SHADOW_PACKETPARAMS,
+    RADIO_SHADOW_RFFREQUENCY,
+    RADIO_SHADOW_TXPARAMS,
+    RADIO_SHADOW_DIOIRQ,
+    RADIO_SHADOW_BUFFERBASEADDRESS,
+    RADIO_SHADOW_NB_COMMANDS
+}RadioShadowId_t;
+
+/*!
+ * \brief Last parameters applied to the radio for one configuration command
+ */
+typedef struct
+{
+    bool    Valid;
+    uint8_t Size;
+    uint8_t Buffer[RADIO_SHADOW_BUFFER_SIZE];
+}RadioShadowCommand_t;
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 /*!
@@ -137,6 +168,12 @@ volatile uint32_t FrequencyError = 0;
  */
 static bool ImageCalibrated = false;
 
+/*!
+ * \brief Shadow of the radio configuration, used to skip commands that would
+ *        not change anything. Cleared whenever the radio loses its configuration.
+ */
+static RadioShadowCommand_t RadioShadow[RADIO_SHADOW_NB_COMMANDS];
+
 /*!
  * Precomputed FSK bandwidth registers values
  */
@@ -175,6 +212,22 @@ static const FskBandwidth_t FskBandwidths[] =
  */
 static void Radio_SMPS_Set( uint8_t level );
 
+/*!
+ * \brief Compares parameters with the shadow of a configuration command and
+ *        records them when they differ
+ *
+ * \param [in]  id          Shadowed command
+ * \param [in]  buffer      Parameters about to be applied
+ * \param [in]  size        Number of parameter bytes
+ * \retval      changed     true if the command has to be sent to the radio
+ */
+static bool Radio_ShadowUpdate( RadioShadowId_t id, const uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Forgets the shadowed configuration, forcing the next setters to resend it
+ */
+static void Radio_ShadowInvalidate( void );
+
 /*!
  * \brief IRQ Callback radio function
  */
@@ -190,6 +243,9 @@ void SUBGRF_Init( DioIrqHandler dioIrq )
 
     RADIO_INIT();
 
+    /* The radio has been reset: nothing shadowed is applied anymore */
+    Radio_ShadowInvalidate();
+
     /* set default SMPS current drive to default*/
     Radio_SMPS_Set(SMPS_DRIVE_SETTING_DEFAULT);
 
@@ -350,6 +406,12 @@ void SUBGRF_SetSleep( SleepParams_t sleepConfig )
                       ( ( uint8_t )sleepConfig.Fields.WakeUpRTC ) );
     SUBGRF_WriteCommand( RADIO_SET_SLEEP, &value, 1 );
     OperatingMode = MODE_SLEEP;
+
+    /* Only a warm start retains the configuration across sleep */
+    if( sleepConfig.Fields.WarmStart == 0 )
+    {
+        Radio_ShadowInvalidate();
+    }
 }
 
 void SUBGRF_SetStandby( RadioStandbyModes_t standbyConfig )
@@ -559,7 +621,10 @@ void SUBGRF_SetDioIrqParams( uint16_t irqMask, uint16_t dio1Mask, uint16_t dio2M
     buf[5] = ( uint8_t )( dio2Mask & 0x00FF );
     buf[6] = ( uint8_t )( ( dio3Mask >> 8 ) & 0x00FF );
     buf[7] = ( uint8_t )( dio3Mask & 0x00FF );
-    SUBGRF_WriteCommand( RADIO_CFG_DIOIRQ, buf, 8 );
+    if( Radio_ShadowUpdate( RADIO_SHADOW_DIOIRQ, buf, 8 ) == true )
+    {
+        SUBGRF_WriteCommand( RADIO_CFG_DIOIRQ, buf, 8 );
+    }
 }
 
 uint16_t SUBGRF_GetIrqStatus( void )
@@ -597,19 +662,32 @@ void SUBGRF_SetRfFrequency( uint32_t frequency )
     buf[1] = ( uint8_t )( ( chan >> 16 ) & 0xFF );
     buf[2] = ( uint8_t )( ( chan >> 8 ) & 0xFF );
     buf[3] = ( uint8_t )( chan & 0xFF );
-    SUBGRF_WriteCommand( RADIO_SET_RFFREQUENCY, buf, 4 );
+    if( Radio_ShadowUpdate( RADIO_SHADOW_RFFREQUENCY, buf, 4 ) == true )
+    {
+        SUBGRF_WriteCommand( RADIO_SET_RFFREQUENCY, buf, 4 );
+    }
 }
 
 void SUBGRF_SetPacketType( RadioPacketTypes_t packetType )
 {
+    uint8_t type = ( uint8_t )packetType;
+
     // Save packet type internally to avoid questioning the radio
     PacketType = packetType;
 
+    if( Radio_ShadowUpdate( RADIO_SHADOW_PACKETTYPE, &type, 1 ) == false )
+    {
+        return;
+    }
+    // Modulation and packet parameters are interpreted per packet type: resend them
+    RadioShadow[RADIO_SHADOW_MODULATIONPARAMS].Valid = false;
+    RadioShadow[RADIO_SHADOW_PACKETPARAMS].Valid = false;
+
     if( packetType == PACKET_TYPE_GFSK )
     {
         SUBGRF_WriteRegister( REG_BIT_SYNC, 0x00 );
     }
-    SUBGRF_WriteCommand( RADIO_SET_PACKETTYPE, ( uint8_t* )&packetType, 1 );
+    SUBGRF_WriteCommand( RADIO_SET_PACKETTYPE, &type, 1 );
 }
 
 RadioPacketTypes_t SUBGRF_GetPacketType( void )
@@ -619,9 +697,18 @@ RadioPacketTypes_t SUBGRF_GetPacketType( void )
 
 void SUBGRF_SetTxParams( uint8_t paSelect, int8_t power, RadioRampTimes_t rampTime )
 {
-    uint8_t buf[2];
+    uint8_t buf[3];
     int32_t max_power;
 
+    /* PA config, OCP and clamp only depend on these inputs: skip them all when unchanged */
+    buf[0] = paSelect;
+    buf[1] = ( uint8_t )power;
+    buf[2] = ( uint8_t )rampTime;
+    if( Radio_ShadowUpdate( RADIO_SHADOW_TXPARAMS, buf, 3 ) == false )
+    {
+        return;
+    }
+
     if (paSelect == RFO_LP)
     {
         max_power = RBI_GetRFOMaxPowerConfig(RBI_RFO_LP_MAXPOWER);
@@ -718,7 +805,6 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[5] = ( tempVal >> 16 ) & 0xFF;
         buf[6] = ( tempVal >> 8 ) & 0xFF;
         buf[7] = ( tempVal& 0xFF );
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     case PACKET_TYPE_BPSK:
         n = 4;
@@ -727,7 +813,6 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[1] = ( tempVal >> 8 ) & 0xFF;
         buf[2] = tempVal & 0xFF;
         buf[3] = modulationParams->Params.Bpsk.ModulationShaping;
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     case PACKET_TYPE_LORA:
         n = 4;
@@ -735,9 +820,6 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[1] = modulationParams->Params.LoRa.Bandwidth;
         buf[2] = modulationParams->Params.LoRa.CodingRate;
         buf[3] = modulationParams->Params.LoRa.LowDatarateOptimize;
-
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
-
         break;
     case PACKET_TYPE_GMSK:
         n = 5;
@@ -747,11 +829,14 @@ void SUBGRF_SetModulationParams( ModulationParams_t *modulationParams )
         buf[2] = tempVal & 0xFF;
         buf[3] = modulationParams->Params.Gfsk.ModulationShaping;
         buf[4] = modulationParams->Params.Gfsk.Bandwidth;
-        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     default:
     case PACKET_TYPE_NONE:
-      break;
+      return;
+    }
+    if( Radio_ShadowUpdate( RADIO_SHADOW_MODULATIONPARAMS, buf, n ) == true )
+    {
+        SUBGRF_WriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
     }
 }
 
@@ -816,7 +901,10 @@ void SUBGRF_SetPacketParams( PacketParams_t *packetParams )
     case PACKET_TYPE_NONE:
         return;
     }
-    SUBGRF_WriteCommand( RADIO_SET_PACKETPARAMS, buf, n );
+    if( Radio_ShadowUpdate( RADIO_SHADOW_PACKETPARAMS, buf, n ) == true )
+    {
+        SUBGRF_WriteCommand( RADIO_SET_PACKETPARAMS, buf, n );
+    }
 }
 
 void SUBGRF_SetCadParams( RadioLoRaCadSymbols_t cadSymbolNum, uint8_t cadDetPeak, uint8_t cadDetMin, RadioCadExitModes_t cadExitMode, uint32_t cadTimeout )
@@ -840,7 +928,10 @@ void SUBGRF_SetBufferBaseAddress( uint8_t txBaseAddress, uint8_t rxBaseAddress )
 
     buf[0] = txBaseAddress;
     buf[1] = rxBaseAddress;
-    SUBGRF_WriteCommand( RADIO_SET_BUFFERBASEADDRESS, buf, 2 );
+    if( Radio_ShadowUpdate( RADIO_SHADOW_BUFFERBASEADDRESS, buf, 2 ) == true )
+    {
+        SUBGRF_WriteCommand( RADIO_SET_BUFFERBASEADDRESS, buf, 2 );
+    }
 }
 
 RadioPhyStatus_t SUBGRF_GetStatus( void )
@@ -1147,6 +1238,29 @@ static void Radio_SMPS_Set(uint8_t level)
   }
 }
 
+static bool Radio_ShadowUpdate( RadioShadowId_t id, const uint8_t *buffer, uint8_t size )
+{
+    RadioShadowCommand_t *shadow = &RadioShadow[id];
+    bool changed = ( shadow->Valid == false ) || ( shadow->Size != size );
+
+    for( uint8_t i = 0; ( changed == false ) && ( i < size ); i++ )
+    {
+        changed = ( shadow->Buffer[i] != buffer[i] );
+    }
+    if( changed == true )
+    {
+        RADIO_MEMCPY8( shadow->Buffer, buffer, size );
+        shadow->Size = size;
+        shadow->Valid = true;
+    }
+    return changed;
+}
+
+static void Radio_ShadowInvalidate( void )
+{
+    RADIO_MEMSET8( RadioShadow, 0, sizeof( RadioShadow ) );
+}
+
 uint8_t SUBGRF_GetFskBandwidthRegValue( uint32_t bandwidth )
 {
     uint8_t i;
@@ -0,0 +1,136 @@
+/**
+ * @file PWX_AlarmWindow.c
+ * @brief Class C Alarm Window Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * After a threshold alarm, a follow-up command would otherwise wait for the
+ * RX windows of the next uplink. The device switches to Class C for a short
+ * window after the alarm uplink instead, so the command arrives within
+ * seconds. Continuous receive costs about ALARM_WINDOW_RX_UA, so the window
+ * also draws from a budget that refills over the day: an alarm that keeps
+ * firing shortens, then skips, its windows rather than drain the battery.
+ * Charges are kept in uAs.
+ */
+
+#include "PWX_AlarmWindow.h"
+#include "main.h"
+#include "sys_app.h"
+#include "utilities.h"
+
+/* Private Variables */
+static uint16_t _windowSeconds;
+static uint16_t _budgetMas;
+static uint32_t _availableUas;
+static uint32_t _refillTick;
+static bool _isArmed;
+static bool _isOpen;
+static uint32_t _openTick;
+static uint32_t _numWindows;
+static uint32_t _numSkipped;
+static uint32_t _openMs;            // total time open since boot
+
+/* Private Function Prototypes */
+static void refillBudget(void);
+
+/**
+ * @brief Adds the share of the budget earned since the last refill, up to a full budget.
+ */
+static void refillBudget(void) {
+    uint32_t now = HAL_GetTick();
+    uint32_t capacityUas = (uint32_t)_budgetMas * 1000U;
+    uint64_t earnedUas = ((uint64_t)(now - _refillTick) * _budgetMas) / ALARM_WINDOW_BUDGET_PERIOD_S;
+
+    if (earnedUas == 0) {
+        return;
+    }
+    _refillTick = now;
+    _availableUas = (uint32_t)MIN((uint64_t)_availableUas + earnedUas, (uint64_t)capacityUas);
+}
+
+void initAlarmWindow(void) {
+    _windowSeconds = ALARM_WINDOW_DEFAULT_S;
+    _budgetMas = ALARM_WINDOW_DEFAULT_BUDGET_MAS;
+    _availableUas = (uint32_t)_budgetMas * 1000U;
+    _refillTick = HAL_GetTick();
+    _isArmed = false;
+    _isOpen = false;
+    _numWindows = 0;
+    _numSkipped = 0;
+    _openMs = 0;
+}
+
+void armAlarmWindow(void) {
+    _isArmed = (!_isOpen && _windowSeconds != 0 && _budgetMas != 0);
+}
+
+void disarmAlarmWindow(void) {
+    _isArmed = false;
+}
+
+bool isAlarmWindowArmed(void) {
+    return _isArmed;
+}
+
+bool isAlarmWindowOpen(void) {
+    return _isOpen;
+}
+
+uint32_t openAlarmWindow(void) {
+    uint32_t windowMs;
+
+    if (!_isArmed || _isOpen) {
+        return 0;
+    }
+    _isArmed = false;
+    refillBudget();
+
+    windowMs = MIN((uint32_t)_windowSeconds * 1000U, (uint32_t)(((uint64_t)_availableUas * 1000U) / ALARM_WINDOW_RX_UA));
+    if (windowMs < ALARM_WINDOW_MIN_MS) {
+        _numSkipped++;
+        APP_LOG(TS_OFF, VLEVEL_M, "Alarm Window: budget exhausted, %u uAs left \r\n", _availableUas);
+        return 0;
+    }
+    _isOpen = true;
+    _openTick = HAL_GetTick();
+    _numWindows++;
+    return windowMs;
+}
+
+void closeAlarmWindow(void) {
+    uint32_t elapsedMs;
+    uint32_t chargeUas;
+
+    if (!_isOpen) {
+        return;
+    }
+    _isOpen = false;
+    refillBudget();
+
+    elapsedMs = HAL_GetTick() - _openTick;
+    chargeUas = (uint32_t)(((uint64_t)elapsedMs * ALARM_WINDOW_RX_UA) / 1000U);
+    _availableUas = (chargeUas < _availableUas) ? (_availableUas - chargeUas) : 0;
+    _openMs += elapsedMs;
+    APP_LOG(TS_OFF, VLEVEL_M, "Alarm Window: closed after %u ms, %u uAs charged \r\n", elapsedMs, chargeUas);
+}
+
+bool setAlarmWindowConfig(uint16_t windowSeconds, uint16_t budgetMas) {
+    if (windowSeconds > ALARM_WINDOW_MAX_S) {
+        return false;
+    }
+    refillBudget();
+    _windowSeconds = windowSeconds;
+    _budgetMas = budgetMas;
+    _availableUas = MIN(_availableUas, (uint32_t)_budgetMas * 1000U);
+    if (windowSeconds == 0 || budgetMas == 0) {
+        _isArmed = false;
+    }
+    return true;
+}
+
+void printAlarmWindow(void) {
+    refillBudget();
+    APP_LOG(TS_OFF, VLEVEL_M, "Alarm Window: %u opened, %u skipped | %u ms open, %u uAs | %u/%u mAs left \r\n",
+            _numWindows, _numSkipped, _openMs,
+            (uint32_t)(((uint64_t)_openMs * ALARM_WINDOW_RX_UA) / 1000U), _availableUas / 1000U, _budgetMas);
+}
@@ -0,0 +1,162 @@
+/**
+ * @file PWX_ClockPolicy.c
+ * @brief Dynamic System Clock Policy Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * Most of a sensing cycle is spent polling for Modbus answers and sensor
+ * warm-up, where 48 MHz buys nothing. Tasks vote for the level they need
+ * and the MSI range follows the highest vote. HAL_RCC_OscConfig() orders
+ * the flash wait states around the range change and updates
+ * SystemCoreClock; the regulator stays in range 1 so flash can still be
+ * programmed at any level. USART1 is the only peripheral whose kernel
+ * clock follows SYSCLK, its BRR is re-derived in the same critical
+ * section. LPUART1 and I2C1 run from HSI, the time base from the RTC.
+ */
+
+#include "PWX_ClockPolicy.h"
+#include "main.h"
+#include "usart.h"
+#include "sys_app.h"
+#include "utilities_conf.h"
+#include "utilities.h"
+#include "LoRaMac.h"
+
+#define CLOCK_POLICY_MIN_CYCLES_PER_CHAR    1000    // receive interrupt and re-arm, per USART1 character
+
+/* Private Variables */
+static const uint32_t _msiRanges[CLOCK_LEVEL_NUM] = { RCC_MSIRANGE_6, RCC_MSIRANGE_8, RCC_MSIRANGE_11 };
+static const uint32_t _sysclkHz[CLOCK_LEVEL_NUM] = { 4000000U, 16000000U, 48000000U };
+
+static ClockLevel_t _votes[CLOCK_USER_NUM];
+static bool _isVoting[CLOCK_USER_NUM];
+static ClockLevel_t _level;
+static uint32_t _levelTick;
+static uint32_t _residencyMs[CLOCK_LEVEL_NUM];
+static uint32_t _switches;
+
+/* Private Function Prototypes */
+static ClockLevel_t getUartFloor(uint32_t baudRate);
+static void applyClockPolicy(void);
+static bool switchClock(ClockLevel_t level);
+
+/**
+ * @brief Lowest level at which USART1 is accurate enough and its interrupt keeps up.
+ */
+static ClockLevel_t getUartFloor(uint32_t baudRate) {
+    if (baudRate == 0) {
+        return CLOCK_LEVEL_LOW;
+    }
+    for (ClockLevel_t level = CLOCK_LEVEL_LOW; level < CLOCK_LEVEL_HIGH; level++) {
+        uint32_t brr = (_sysclkHz[level] + (baudRate / 2)) / baudRate;
+        uint32_t actual;
+        uint32_t errorPpm;
+
+        if (brr < 16) {
+            continue;
+        }
+        actual = _sysclkHz[level] / brr;
+        errorPpm = (uint32_t)(((uint64_t)((actual > baudRate) ? (actual - baudRate) : (baudRate - actual)) * 1000000U) / baudRate);
+        if (errorPpm <= CLOCK_POLICY_MAX_BAUD_ERR_PPM
+                && ((_sysclkHz[level] / baudRate) * 10) >= CLOCK_POLICY_MIN_CYCLES_PER_CHAR) {
+            return level;
+        }
+    }
+    return CLOCK_LEVEL_HIGH;
+}
+
+static void applyClockPolicy(void) {
+    ClockLevel_t level = CLOCK_LEVEL_LOW;
+    bool isVoted = false;
+
+    for (uint8_t u = 0; u < CLOCK_USER_NUM; u++) {
+        if (_isVoting[u]) {
+            isVoted = true;
+            level = MAX(level, _votes[u]);
+        }
+    }
+    if (!isVoted || LoRaMacIsBusy()) {
+        level = CLOCK_LEVEL_HIGH;
+    }
+    level = MAX(level, getUartFloor(huart1.Init.BaudRate));
+
+    /* A transmission in progress would be garbled, the next vote applies the level */
+    if (level == _level || huart1.gState != HAL_UART_STATE_READY) {
+        return;
+    }
+    if (!switchClock(level)) {
+        APP_LOG(TS_OFF, VLEVEL_M, "Clock: switch to level %u failed \r\n", level);
+        return;
+    }
+    _residencyMs[_level] += HAL_GetTick() - _levelTick;
+    _levelTick = HAL_GetTick();
+    _level = level;
+    _switches++;
+}
+
+/**
+ * @brief Changes the MSI range and re-derives the USART1 divider before anything can use it.
+ */
+static bool switchClock(ClockLevel_t level) {
+    RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+    HAL_StatusTypeDef status;
+
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_MSI;
+    RCC_OscInitStruct.MSIState = RCC_MSI_ON;
+    RCC_OscInitStruct.MSICalibrationValue = RCC_MSICALIBRATION_DEFAULT;
+    RCC_OscInitStruct.MSIClockRange = _msiRanges[level];
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+
+    UTILS_ENTER_CRITICAL_SECTION();
+    status = HAL_RCC_OscConfig(&RCC_OscInitStruct);
+    if (status == HAL_OK && huart1.Instance != NULL) {
+        __HAL_UART_DISABLE(&huart1);
+        huart1.Instance->BRR = UART_DIV_SAMPLING16(HAL_RCC_GetPCLK2Freq(), huart1.Init.BaudRate,
+                huart1.Init.ClockPrescaler);
+        __HAL_UART_ENABLE(&huart1);
+    }
+    UTILS_EXIT_CRITICAL_SECTION();
+    return status == HAL_OK;
+}
+
+void initClockPolicy(void) {
+    for (uint8_t u = 0; u < CLOCK_USER_NUM; u++) {
+        _isVoting[u] = false;
+    }
+    for (uint8_t l = 0; l < CLOCK_LEVEL_NUM; l++) {
+        _residencyMs[l] = 0;
+    }
+    _level = CLOCK_LEVEL_HIGH;
+    _levelTick = HAL_GetTick();
+    _switches = 0;
+}
+
+void requestClockLevel(ClockUser_t user, ClockLevel_t level) {
+    _votes[user] = level;
+    _isVoting[user] = true;
+    applyClockPolicy();
+}
+
+void releaseClockLevel(ClockUser_t user) {
+    _isVoting[user] = false;
+    applyClockPolicy();
+}
+
+ClockLevel_t getClockLevel(void) {
+    return _level;
+}
+
+uint32_t getClockResidencyMs(ClockLevel_t level) {
+    uint32_t residencyMs = _residencyMs[level];
+
+    if (level == _level) {
+        residencyMs += HAL_GetTick() - _levelTick;
+    }
+    return residencyMs;
+}
+
+void printClockPolicy(void) {
+    APP_LOG(TS_OFF, VLEVEL_M, "Clock: 4 MHz %u ms | 16 MHz %u ms | 48 MHz %u ms | %u switches \r\n",
+            getClockResidencyMs(CLOCK_LEVEL_LOW), getClockResidencyMs(CLOCK_LEVEL_MEDIUM),
+            getClockResidencyMs(CLOCK_LEVEL_HIGH), _switches);
+}
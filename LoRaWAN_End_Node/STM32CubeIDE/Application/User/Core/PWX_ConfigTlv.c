@@ -0,0 +1,417 @@
+/**
+ * @file PWX_ConfigTlv.c
+ * @brief Atomic TLV Configuration Downlink Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * A downlink is parsed in full into a staged update before anything is
+ * touched, so a malformed or out-of-range TLV anywhere in the payload leaves
+ * the device exactly as it was. Only then is every changed flash page
+ * written, once per page.
+ */
+
+#include "PWX_ConfigTlv.h"
+#include "project_config.h"
+#include "utilities.h"
+#include <string.h>
+
+#define HASH_SCRATCH_SIZE               (CONFIG_TLV_MAX_CMD_SIZE + 11)
+
+/* Private Function Prototypes */
+static uint64_t getBigEndian(const uint8_t *value, uint8_t length);
+static ConfigTlvStatus_t parseParam(ConfigTlvUpdate_t *update, uint8_t tag, const uint8_t *value, uint8_t length);
+static ConfigTlvStatus_t parseDeviceEdit(ConfigTlvUpdate_t *update, const uint8_t *value, uint8_t length);
+static ConfigTlvStatus_t parseSegmentEdit(ConfigTlvUpdate_t *update, const uint8_t *value, uint8_t length);
+static void mergeParams(const ConfigTlvUpdate_t *update, SecureElementNvmData_t *nvm);
+static bool isDeviceTouched(const ConfigTlvUpdate_t *update, uint8_t device);
+static FLASH_IF_StatusTypedef writePage(void *destination, const void *source, uint32_t length);
+
+static uint64_t getBigEndian(const uint8_t *value, uint8_t length) {
+    uint64_t result = 0;
+
+    for (uint8_t i = 0; i < length; i++) {
+        result = (result << 8) | value[i];
+    }
+    return result;
+}
+
+/**
+ * @brief Stages one pwx* parameter after checking its length and range.
+ */
+static ConfigTlvStatus_t parseParam(ConfigTlvUpdate_t *update, uint8_t tag, const uint8_t *value, uint8_t length) {
+    uint8_t expected;
+    uint32_t parsed;
+
+    switch (tag) {
+        case CONFIG_TLV_TX_INTERVAL:
+        case CONFIG_TLV_HEARTBEAT_INTERVAL:
+            expected = 4;
+            break;
+        case CONFIG_TLV_SAMPLING_METHOD:
+        case CONFIG_TLV_MEASUREMENT_METHOD:
+            expected = 1;
+            break;
+        default:
+            expected = 2;
+            break;
+    }
+    if (length != expected) {
+        return CONFIG_TLV_ERR_LENGTH;
+    }
+    if (hasConfigTlv(update, tag)) {
+        return CONFIG_TLV_ERR_DUPLICATE;
+    }
+
+    parsed = (uint32_t)getBigEndian(value, length);
+    switch (tag) {
+        case CONFIG_TLV_TX_INTERVAL:
+        case CONFIG_TLV_HEARTBEAT_INTERVAL:
+            if (parsed < CONFIG_TLV_MIN_INTERVAL_S || parsed > CONFIG_TLV_MAX_INTERVAL_S) {
+                return CONFIG_TLV_ERR_RANGE;
+            }
+            if (tag == CONFIG_TLV_TX_INTERVAL) {
+                update->txIntervalSeconds = parsed;
+            } else {
+                update->heartbeatSeconds = parsed;
+            }
+            break;
+        case CONFIG_TLV_CNF_UPLINK_COUNT:
+            if (parsed == 0 || parsed > CONFIG_TLV_MAX_CNF_UPLINK_COUNT) {
+                return CONFIG_TLV_ERR_RANGE;
+            }
+            update->cnfUplinkCount = (uint16_t)parsed;
+            break;
+        case CONFIG_TLV_THRESHOLD_HIGH:
+        case CONFIG_TLV_THRESHOLD_LOW:
+            if (parsed == 0 || parsed > CONFIG_TLV_MAX_THRESHOLD) {
+                return CONFIG_TLV_ERR_RANGE;
+            }
+            if (tag == CONFIG_TLV_THRESHOLD_HIGH) {
+                update->thresholdHigh = (uint16_t)parsed;
+            } else {
+                update->thresholdLow = (uint16_t)parsed;
+            }
+            break;
+        case CONFIG_TLV_SAMPLING_COUNT:
+            if (parsed == 0 || parsed > CONFIG_TLV_MAX_SAMPLING_COUNT) {
+                return CONFIG_TLV_ERR_RANGE;
+            }
+            update->samplingCount = (uint16_t)parsed;
+            break;
+        case CONFIG_TLV_SAMPLING_METHOD:
+        case CONFIG_TLV_MEASUREMENT_METHOD:
+            if (parsed > 1) {
+                return CONFIG_TLV_ERR_RANGE;
+            }
+            if (tag == CONFIG_TLV_SAMPLING_METHOD) {
+                update->samplingMethod = (uint8_t)parsed;
+            } else {
+                update->measurementMethod = (uint8_t)parsed;
+            }
+            break;
+        default:
+            return CONFIG_TLV_ERR_UNKNOWN_TAG;
+    }
+
+    update->present |= (1U << tag);
+    return CONFIG_TLV_OK;
+}
+
+static ConfigTlvStatus_t parseDeviceEdit(ConfigTlvUpdate_t *update, const uint8_t *value, uint8_t length) {
+    ConfigTlvDeviceEdit_t *edit;
+
+    if (length != 5) {
+        return CONFIG_TLV_ERR_LENGTH;
+    }
+    if (value[0] == 0 || value[0] > NUM_DEVICES || value[1] > 1 || value[2] > PARITY_ODD || value[3] > STOP_BIT_2) {
+        return CONFIG_TLV_ERR_RANGE;
+    }
+    for (uint8_t i = 0; i < update->numDeviceEdits; i++) {
+        if (update->deviceEdits[i].device == value[0]) {
+            return CONFIG_TLV_ERR_DUPLICATE;
+        }
+    }
+    if (update->numDeviceEdits >= CONFIG_TLV_MAX_DEVICE_EDITS) {
+        return CONFIG_TLV_ERR_TOO_MANY;
+    }
+
+    edit = &update->deviceEdits[update->numDeviceEdits++];
+    edit->device   = value[0];
+    edit->baudrate = value[1];
+    edit->parity   = value[2];
+    edit->stopBits = value[3];
+    edit->active   = value[4] == 0 ? 0 : 1;
+    return CONFIG_TLV_OK;
+}
+
+static ConfigTlvStatus_t parseSegmentEdit(ConfigTlvUpdate_t *update, const uint8_t *value, uint8_t length) {
+    ConfigTlvSegmentEdit_t *edit;
+    uint8_t cmdSize;
+
+    if (length <= CONFIG_TLV_SEGMENT_HEADER_SIZE || length > (CONFIG_TLV_SEGMENT_HEADER_SIZE + CONFIG_TLV_MAX_CMD_SIZE)) {
+        return CONFIG_TLV_ERR_LENGTH;
+    }
+    if (value[0] == 0 || value[0] > NUM_DEVICES || value[1] == 0 || value[1] > NUM_DEV_SEGMENTS) {
+        return CONFIG_TLV_ERR_RANGE;
+    }
+    for (uint8_t i = 0; i < update->numSegmentEdits; i++) {
+        if (update->segmentEdits[i].device == value[0] && update->segmentEdits[i].segment == value[1]) {
+            return CONFIG_TLV_ERR_DUPLICATE;
+        }
+    }
+    if (update->numSegmentEdits >= CONFIG_TLV_MAX_SEGMENT_EDITS) {
+        return CONFIG_TLV_ERR_TOO_MANY;
+    }
+
+    cmdSize = length - CONFIG_TLV_SEGMENT_HEADER_SIZE;
+    edit = &update->segmentEdits[update->numSegmentEdits++];
+    edit->device         = value[0];
+    edit->segment        = value[1];
+    edit->enable         = value[2] == 0 ? 0 : 1;
+    edit->sendNow        = value[3] == 0 ? 0 : 1;
+    edit->validAddresses = getBigEndian(&value[4], 8);
+    edit->cmdSize        = cmdSize;
+    memcpy(edit->cmdRaw, &value[CONFIG_TLV_SEGMENT_HEADER_SIZE], cmdSize);
+    return CONFIG_TLV_OK;
+}
+
+ConfigTlvStatus_t parseConfigTlv(const uint8_t *payload, size_t size, ConfigTlvUpdate_t *update) {
+    ConfigTlvStatus_t status = CONFIG_TLV_OK;
+    size_t offset = 1;
+    uint8_t index = 0;
+
+    memset(update, 0, sizeof(ConfigTlvUpdate_t));
+    update->failedIndex = CONFIG_TLV_NO_INDEX;
+    if (size < 1) {
+        return CONFIG_TLV_ERR_TRUNCATED;
+    }
+    update->txnId = payload[0];
+
+    while (offset < size) {
+        uint8_t tag, length;
+
+        if ((offset + 2) > size) {
+            status = CONFIG_TLV_ERR_TRUNCATED;
+            break;
+        }
+        tag = payload[offset];
+        length = payload[offset + 1];
+        if ((offset + 2 + length) > size) {
+            status = CONFIG_TLV_ERR_TRUNCATED;
+            break;
+        }
+
+        if (tag == CONFIG_TLV_MODBUS_DEVICE) {
+            status = parseDeviceEdit(update, &payload[offset + 2], length);
+        } else if (tag == CONFIG_TLV_MODBUS_SEGMENT) {
+            status = parseSegmentEdit(update, &payload[offset + 2], length);
+        } else if (tag >= CONFIG_TLV_TX_INTERVAL && tag <= CONFIG_TLV_HEARTBEAT_INTERVAL) {
+            status = parseParam(update, tag, &payload[offset + 2], length);
+        } else {
+            status = CONFIG_TLV_ERR_UNKNOWN_TAG;
+        }
+        if (status != CONFIG_TLV_OK) {
+            break;
+        }
+
+        offset += 2 + length;
+        index++;
+    }
+
+    if (status != CONFIG_TLV_OK) {
+        update->failedIndex = index;
+        return status;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_THRESHOLD_HIGH) && hasConfigTlv(update, CONFIG_TLV_THRESHOLD_LOW)
+            && update->thresholdLow >= update->thresholdHigh) {
+        return CONFIG_TLV_ERR_RANGE;
+    }
+    return CONFIG_TLV_OK;
+}
+
+static void mergeParams(const ConfigTlvUpdate_t *update, SecureElementNvmData_t *nvm) {
+    if (hasConfigTlv(update, CONFIG_TLV_TX_INTERVAL)) {
+        nvm->pwxTxInterval = (uint64_t)update->txIntervalSeconds * 1000;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_CNF_UPLINK_COUNT)) {
+        nvm->pwxCnfUplinkCount = update->cnfUplinkCount;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_THRESHOLD_HIGH)) {
+        nvm->pwxWaterLevelThresholdHigh = update->thresholdHigh;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_THRESHOLD_LOW)) {
+        nvm->pwxWaterLevelThresholdLow = update->thresholdLow;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_SAMPLING_COUNT)) {
+        nvm->pwxSamplingCount = update->samplingCount;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_SAMPLING_METHOD)) {
+        nvm->pwxSamplingMethod = update->samplingMethod;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_MEASUREMENT_METHOD)) {
+        nvm->pwxMeasurementMethod = update->measurementMethod;
+    }
+    if (hasConfigTlv(update, CONFIG_TLV_HEARTBEAT_INTERVAL)) {
+        nvm->pwxHeartbeatInterval = (uint64_t)update->heartbeatSeconds * 1000;
+    }
+}
+
+static bool isDeviceTouched(const ConfigTlvUpdate_t *update, uint8_t device) {
+    for (uint8_t i = 0; i < update->numDeviceEdits; i++) {
+        if (update->deviceEdits[i].device == device) {
+            return true;
+        }
+    }
+    for (uint8_t i = 0; i < update->numSegmentEdits; i++) {
+        if (update->segmentEdits[i].device == device) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Writes only what changed, falling back to a page erase and full write.
+ */
+static FLASH_IF_StatusTypedef writePage(void *destination, const void *source, uint32_t length) {
+    if (FLASH_IF_DiffWrite(destination, source, length) == FLASH_IF_OK) {
+        return FLASH_IF_OK;
+    }
+    if (FLASH_IF_Erase(destination, FLASH_PAGE_SIZE) != FLASH_IF_OK) {
+        return FLASH_IF_ERASE_ERROR;
+    }
+    return FLASH_IF_Write(destination, source, length);
+}
+
+ConfigTlvStatus_t commitConfigTlv(ConfigTlvUpdate_t *update, SecureElementNvmData_t *nvm) {
+    struct ModbusDevice device;
+
+    if (FLASH_IF_Read(nvm, LORAWAN_NVM_BASE_ADDRESS, sizeof(SecureElementNvmData_t)) != FLASH_IF_OK) {
+        return CONFIG_TLV_ERR_FLASH;
+    }
+    mergeParams(update, nvm);
+
+    /* A single threshold is checked against the one already stored */
+    if (nvm->pwxWaterLevelThresholdLow >= nvm->pwxWaterLevelThresholdHigh
+            && (hasConfigTlv(update, CONFIG_TLV_THRESHOLD_HIGH) || hasConfigTlv(update, CONFIG_TLV_THRESHOLD_LOW))) {
+        update->failedIndex = CONFIG_TLV_NO_INDEX;
+        return CONFIG_TLV_ERR_RANGE;
+    }
+
+    /* One read-modify-write per touched Modbus device page */
+    for (uint8_t dev = 1; dev <= NUM_DEVICES; dev++) {
+        if (!isDeviceTouched(update, dev)) {
+            continue;
+        }
+        if (FLASH_IF_Read(&device, ModbusDeviceFlashAddresses[dev - 1], sizeof(device)) != FLASH_IF_OK) {
+            return CONFIG_TLV_ERR_FLASH;
+        }
+        for (uint8_t i = 0; i < update->numDeviceEdits; i++) {
+            const ConfigTlvDeviceEdit_t *edit = &update->deviceEdits[i];
+            if (edit->device == dev) {
+                device.Baudrate     = edit->baudrate;
+                device.Parity       = edit->parity;
+                device.StopBits     = edit->stopBits;
+                device.DeviceActive = edit->active;
+            }
+        }
+        for (uint8_t i = 0; i < update->numSegmentEdits; i++) {
+            const ConfigTlvSegmentEdit_t *edit = &update->segmentEdits[i];
+            if (edit->device == dev) {
+                struct Segment *segment = &device.Segment[edit->segment - 1];
+                memset(segment->cmdRaw, 0, sizeof(segment->cmdRaw));
+                memcpy(segment->cmdRaw, edit->cmdRaw, edit->cmdSize);
+                segment->cmdSize        = edit->cmdSize;
+                segment->sendNow        = edit->sendNow;
+                segment->validAddresses = edit->validAddresses;
+                segment->enableSegment  = edit->enable;
+            }
+        }
+        if (writePage((void *)ModbusDeviceFlashAddresses[dev - 1], &device, sizeof(device)) != FLASH_IF_OK) {
+            APP_LOG(TS_OFF, VLEVEL_M, "Config TLV: device %u write failed \r\n", dev);
+            return CONFIG_TLV_ERR_FLASH;
+        }
+    }
+
+    if (update->present != 0
+            && writePage(LORAWAN_NVM_BASE_ADDRESS, nvm, sizeof(SecureElementNvmData_t)) != FLASH_IF_OK) {
+        APP_LOG(TS_OFF, VLEVEL_M, "Config TLV: config page write failed \r\n");
+        return CONFIG_TLV_ERR_FLASH;
+    }
+    return CONFIG_TLV_OK;
+}
+
+uint32_t getConfigHash(const SecureElementNvmData_t *nvm) {
+    struct ModbusDevice device;
+    uint8_t scratch[HASH_SCRATCH_SIZE];
+    uint32_t crc = Crc32Init();
+    uint8_t n = 0;
+
+    scratch[n++] = (uint8_t)(nvm->pwxTxInterval >> 24);
+    scratch[n++] = (uint8_t)(nvm->pwxTxInterval >> 16);
+    scratch[n++] = (uint8_t)(nvm->pwxTxInterval >> 8);
+    scratch[n++] = (uint8_t)(nvm->pwxTxInterval & 0xFF);
+    scratch[n++] = (uint8_t)(nvm->pwxHeartbeatInterval >> 24);
+    scratch[n++] = (uint8_t)(nvm->pwxHeartbeatInterval >> 16);
+    scratch[n++] = (uint8_t)(nvm->pwxHeartbeatInterval >> 8);
+    scratch[n++] = (uint8_t)(nvm->pwxHeartbeatInterval & 0xFF);
+    scratch[n++] = (uint8_t)(nvm->pwxCnfUplinkCount >> 8);
+    scratch[n++] = (uint8_t)(nvm->pwxCnfUplinkCount & 0xFF);
+    scratch[n++] = (uint8_t)(nvm->pwxWaterLevelThresholdHigh >> 8);
+    scratch[n++] = (uint8_t)(nvm->pwxWaterLevelThresholdHigh & 0xFF);
+    scratch[n++] = (uint8_t)(nvm->pwxWaterLevelThresholdLow >> 8);
+    scratch[n++] = (uint8_t)(nvm->pwxWaterLevelThresholdLow & 0xFF);
+    scratch[n++] = (uint8_t)(nvm->pwxSamplingCount >> 8);
+    scratch[n++] = (uint8_t)(nvm->pwxSamplingCount & 0xFF);
+    scratch[n++] = nvm->pwxSamplingMethod;
+    scratch[n++] = nvm->pwxMeasurementMethod;
+    crc = Crc32Update(crc, scratch, n);
+
+    /* Per active device: [dev][baud][parity][stop], then per enabled segment: [seg][send now][valid u64][size][cmd] */
+    for (uint8_t dev = 1; dev <= NUM_DEVICES; dev++) {
+        FLASH_IF_Read(&device, ModbusDeviceFlashAddresses[dev - 1], sizeof(device));
+        if (device.DeviceActive != 1) {
+            continue;
+        }
+        scratch[0] = dev;
+        scratch[1] = device.Baudrate;
+        scratch[2] = device.Parity;
+        scratch[3] = device.StopBits;
+        crc = Crc32Update(crc, scratch, 4);
+
+        for (uint8_t seg = 0; seg < NUM_DEV_SEGMENTS; seg++) {
+            const struct Segment *segment = &device.Segment[seg];
+            uint8_t cmdSize = MIN(segment->cmdSize, CONFIG_TLV_MAX_CMD_SIZE);
+            if (segment->enableSegment != 1) {
+                continue;
+            }
+            n = 0;
+            scratch[n++] = seg + 1;
+            scratch[n++] = segment->sendNow;
+            for (int8_t shift = 56; shift >= 0; shift -= 8) {
+                scratch[n++] = (uint8_t)(segment->validAddresses >> shift);
+            }
+            scratch[n++] = cmdSize;
+            memcpy(&scratch[n], segment->cmdRaw, cmdSize);
+            crc = Crc32Update(crc, scratch, n + cmdSize);
+        }
+    }
+    return Crc32Finalize(crc);
+}
+
+size_t buildConfigTlvAck(const ConfigTlvUpdate_t *update, ConfigTlvStatus_t status, uint32_t hash,
+                         uint8_t *destination, size_t maxSize) {
+    size_t index = 0;
+
+    if (maxSize < CONFIG_TLV_ACK_SIZE) {
+        return 0;
+    }
+    destination[index++] = update->txnId;
+    destination[index++] = (uint8_t)status;
+    destination[index++] = update->failedIndex;
+    destination[index++] = (uint8_t)(hash >> 24);
+    destination[index++] = (uint8_t)(hash >> 16);
+    destination[index++] = (uint8_t)(hash >> 8);
+    destination[index++] = (uint8_t)(hash & 0xFF);
+    return index;
+}
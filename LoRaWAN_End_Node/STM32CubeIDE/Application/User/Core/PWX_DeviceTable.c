@@ -0,0 +1,170 @@
+/**
+ * @file PWX_DeviceTable.c
+ * @brief Bulk Modbus Device Table Download Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * The package hands over a block only once it is complete and its
+ * integrity code matches. The block is then checked in full, and only a
+ * valid table touches flash: each device page is rebuilt in RAM and written
+ * once, and pages that come out identical are not written at all.
+ */
+
+#include "PWX_DeviceTable.h"
+#include "project_config.h"
+#include <string.h>
+
+/* Private Variables */
+static uint8_t _block[DEVICE_TABLE_BLOCK_SIZE];
+static uint16_t _deviceOffsets[NUM_DEVICES];   // record offset per listed device, 0 if left out
+static struct ModbusDevice _device;
+
+/* Private Function Prototypes */
+static uint8_t onDataBlockReceived(const uint8_t *block, uint32_t size);
+static DeviceTableResult_t validateDeviceTable(const uint8_t *block, size_t size);
+static void applyDeviceRecord(struct ModbusDevice *device, const uint8_t *record);
+static FLASH_IF_StatusTypedef writePage(void *destination, const void *source, uint32_t length);
+
+LmhpDeviceTableParams_t DeviceTableParams = {
+    .Buffer = _block,
+    .BufferSize = sizeof(_block),
+    .OnDataBlockReceived = onDataBlockReceived,
+};
+
+static uint8_t onDataBlockReceived(const uint8_t *block, uint32_t size) {
+    return (uint8_t)applyDeviceTable(block, size);
+}
+
+/**
+ * @brief Walks every record and notes where each listed device starts.
+ */
+static DeviceTableResult_t validateDeviceTable(const uint8_t *block, size_t size) {
+    size_t offset = DEVICE_TABLE_HEADER_SIZE;
+    uint8_t lastDevice = 0;
+
+    if (size < DEVICE_TABLE_HEADER_SIZE) {
+        return DEVICE_TABLE_ERR_LENGTH;
+    }
+    if (block[0] != DEVICE_TABLE_FORMAT) {
+        return DEVICE_TABLE_ERR_FORMAT;
+    }
+    memset(_deviceOffsets, 0, sizeof(_deviceOffsets));
+
+    for (uint8_t d = 0; d < block[1]; d++) {
+        const uint8_t *record = &block[offset];
+        uint8_t lastSegment = 0;
+
+        if ((offset + DEVICE_TABLE_DEVICE_SIZE) > size) {
+            return DEVICE_TABLE_ERR_LENGTH;
+        }
+        if (record[0] == 0 || record[0] > NUM_DEVICES || record[1] > 1 || record[2] > PARITY_ODD
+                || record[3] > STOP_BIT_2 || record[5] > NUM_DEV_SEGMENTS) {
+            return DEVICE_TABLE_ERR_RANGE;
+        }
+        if (record[0] <= lastDevice) {
+            return DEVICE_TABLE_ERR_ORDER;
+        }
+        lastDevice = record[0];
+        _deviceOffsets[record[0] - 1] = (uint16_t)offset;
+        offset += DEVICE_TABLE_DEVICE_SIZE;
+
+        for (uint8_t s = 0; s < record[5]; s++) {
+            const uint8_t *segment = &block[offset];
+            uint8_t cmdSize;
+
+            if ((offset + DEVICE_TABLE_SEGMENT_SIZE) > size) {
+                return DEVICE_TABLE_ERR_LENGTH;
+            }
+            cmdSize = segment[DEVICE_TABLE_SEGMENT_SIZE - 1];
+            if (segment[0] == 0 || segment[0] > NUM_DEV_SEGMENTS || cmdSize == 0 || cmdSize > DEVICE_TABLE_MAX_CMD_SIZE) {
+                return DEVICE_TABLE_ERR_RANGE;
+            }
+            if (segment[0] <= lastSegment) {
+                return DEVICE_TABLE_ERR_ORDER;
+            }
+            lastSegment = segment[0];
+            offset += DEVICE_TABLE_SEGMENT_SIZE + cmdSize;
+            if (offset > size) {
+                return DEVICE_TABLE_ERR_LENGTH;
+            }
+        }
+    }
+    return (offset == size) ? DEVICE_TABLE_APPLIED : DEVICE_TABLE_ERR_LENGTH;
+}
+
+/**
+ * @brief Replaces the settings and every segment of a device with a validated record.
+ */
+static void applyDeviceRecord(struct ModbusDevice *device, const uint8_t *record) {
+    const uint8_t *segment = &record[DEVICE_TABLE_DEVICE_SIZE];
+
+    device->Baudrate       = record[1];
+    device->Parity         = record[2];
+    device->StopBits       = record[3];
+    device->DeviceActive   = (record[4] & DEVICE_TABLE_DEVICE_ACTIVE) ? 1 : 0;
+    device->enableCRCCheck = (record[4] & DEVICE_TABLE_DEVICE_CRC_CHECK) != 0;
+    device->standardModbus = (record[4] & DEVICE_TABLE_DEVICE_STANDARD) != 0;
+    memset(device->Segment, 0, sizeof(device->Segment));
+
+    for (uint8_t s = 0; s < record[5]; s++) {
+        struct Segment *target = &device->Segment[segment[0] - 1];
+        uint64_t validAddresses = 0;
+
+        for (uint8_t i = 0; i < 8; i++) {
+            validAddresses = (validAddresses << 8) | segment[2 + i];
+        }
+        target->enableSegment  = (segment[1] & DEVICE_TABLE_SEGMENT_ENABLE) ? 1 : 0;
+        target->sendNow        = (segment[1] & DEVICE_TABLE_SEGMENT_SEND_NOW) ? 1 : 0;
+        target->validAddresses = validAddresses;
+        target->cmdSize        = segment[DEVICE_TABLE_SEGMENT_SIZE - 1];
+        memcpy(target->cmdRaw, &segment[DEVICE_TABLE_SEGMENT_SIZE], target->cmdSize);
+        segment += DEVICE_TABLE_SEGMENT_SIZE + target->cmdSize;
+    }
+}
+
+/**
+ * @brief Writes only what changed, falling back to a page erase and full write.
+ */
+static FLASH_IF_StatusTypedef writePage(void *destination, const void *source, uint32_t length) {
+    if (FLASH_IF_DiffWrite(destination, source, length) == FLASH_IF_OK) {
+        return FLASH_IF_OK;
+    }
+    if (FLASH_IF_Erase(destination, FLASH_PAGE_SIZE) != FLASH_IF_OK) {
+        return FLASH_IF_ERASE_ERROR;
+    }
+    return FLASH_IF_Write(destination, source, length);
+}
+
+DeviceTableResult_t applyDeviceTable(const uint8_t *block, size_t size) {
+    DeviceTableResult_t result = validateDeviceTable(block, size);
+    uint8_t numWritten = 0;
+
+    if (result != DEVICE_TABLE_APPLIED) {
+        APP_LOG(TS_OFF, VLEVEL_M, "Device Table: rejected, error %u \r\n", result);
+        return result;
+    }
+
+    for (uint8_t dev = 1; dev <= NUM_DEVICES; dev++) {
+        void *page = (void *)ModbusDeviceFlashAddresses[dev - 1];
+
+        if (FLASH_IF_Read(&_device, page, sizeof(_device)) != FLASH_IF_OK) {
+            return DEVICE_TABLE_ERR_FLASH;
+        }
+        if (_deviceOffsets[dev - 1] != 0) {
+            applyDeviceRecord(&_device, &block[_deviceOffsets[dev - 1]]);
+        } else {
+            _device.DeviceActive = 0;
+        }
+        if (memcmp(page, &_device, sizeof(_device)) == 0) {
+            continue;
+        }
+        if (writePage(page, &_device, sizeof(_device)) != FLASH_IF_OK) {
+            APP_LOG(TS_OFF, VLEVEL_M, "Device Table: device %u write failed \r\n", dev);
+            return DEVICE_TABLE_ERR_FLASH;
+        }
+        numWritten++;
+    }
+
+    APP_LOG(TS_OFF, VLEVEL_M, "Device Table: %u device(s) listed, %u page(s) written \r\n", block[1], numWritten);
+    return DEVICE_TABLE_APPLIED;
+}
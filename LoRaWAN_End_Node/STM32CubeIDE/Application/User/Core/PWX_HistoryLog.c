@@ -0,0 +1,245 @@
+/**
+ * @file PWX_HistoryLog.c
+ * @brief Flash Ring History Log Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * Records are appended to blank 32-byte slots only, so every append is a
+ * single FLASH_IF_Write of 4 double words with no read-modify-erase cycle.
+ * When the write head enters a page that still holds old records, that page
+ * is erased as a whole and the oldest records are dropped.
+ */
+
+#include "PWX_HistoryLog.h"
+#include "PWX_TimeSync.h"
+#include "PWX_ST50H_Modbus.h"
+#include "flash_if.h"
+#include "sys_app.h"
+
+/* Private Variables */
+static uint32_t _headSlot;                       // next slot to write
+static uint32_t _nextSeq;                        // seq of next record
+static uint32_t _oldestSeq = HISTORY_SEQ_NONE;   // oldest valid seq in flash
+
+/* Private Function Prototypes */
+static inline uint8_t *slotAddress(uint32_t slot);
+static bool isSlotBlank(uint32_t slot);
+static bool isRecordValid(const HistoryRecord_t *record);
+static uint32_t findOldestSeq(void);
+
+/**
+ * @brief Returns the flash address of a slot.
+ */
+static inline uint8_t *slotAddress(uint32_t slot) {
+    return (uint8_t *)HISTORY_LOG_BASE_ADDRESS + (slot * HISTORY_LOG_RECORD_SIZE);
+}
+
+/**
+ * @brief Checks if every byte of a slot is still erased.
+ */
+static bool isSlotBlank(uint32_t slot) {
+    const uint64_t *word = (const uint64_t *)slotAddress(slot);
+
+    for (uint8_t i = 0; i < (HISTORY_LOG_RECORD_SIZE / sizeof(uint64_t)); i++) {
+        if (word[i] != UINT64_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks the sequence number and CRC of a record read from flash.
+ */
+static bool isRecordValid(const HistoryRecord_t *record) {
+    if (record->seq == HISTORY_SEQ_NONE) {
+        return false;
+    }
+    return calculateModbusCRC((const uint8_t *)record, offsetof(HistoryRecord_t, crc)) == record->crc;
+}
+
+/**
+ * @brief Scans every slot and returns the lowest valid sequence number.
+ */
+static uint32_t findOldestSeq(void) {
+    HistoryRecord_t record;
+    uint32_t oldest = HISTORY_SEQ_NONE;
+
+    for (uint32_t slot = 0; slot < HISTORY_LOG_TOTAL_SLOTS; slot++) {
+        FLASH_IF_Read(&record, slotAddress(slot), sizeof(record));
+        if (isRecordValid(&record) && record.seq < oldest) {
+            oldest = record.seq;
+        }
+    }
+    return oldest;
+}
+
+void initHistoryLog(void) {
+    HistoryRecord_t record;
+    uint32_t newestSeq = HISTORY_SEQ_NONE;
+    uint32_t newestSlot = 0;
+
+    _oldestSeq = HISTORY_SEQ_NONE;
+
+    for (uint32_t slot = 0; slot < HISTORY_LOG_TOTAL_SLOTS; slot++) {
+        FLASH_IF_Read(&record, slotAddress(slot), sizeof(record));
+        if (!isRecordValid(&record)) {
+            continue;
+        }
+        if (newestSeq == HISTORY_SEQ_NONE || record.seq > newestSeq) {
+            newestSeq = record.seq;
+            newestSlot = slot;
+        }
+        if (record.seq < _oldestSeq) {
+            _oldestSeq = record.seq;
+        }
+    }
+
+    if (newestSeq == HISTORY_SEQ_NONE) {
+        _headSlot = 0;
+        _nextSeq = 0;
+    } else {
+        _headSlot = (newestSlot + 1) % HISTORY_LOG_TOTAL_SLOTS;
+        _nextSeq = newestSeq + 1;
+    }
+
+    APP_LOG(TS_OFF, VLEVEL_M, "History Log: next seq %u | oldest seq %d | head slot %u \r\n",
+            _nextSeq, (_oldestSeq == HISTORY_SEQ_NONE) ? -1 : (int)_oldestSeq, _headSlot);
+}
+
+bool appendHistoryRecord(HistoryRecord_t *record) {
+    HistoryRecord_t verify;
+
+    /*
+     * Find a blank slot. A non-blank slot at the start of a page means the ring
+     * has wrapped onto old data: erase the page. A non-blank slot in the middle
+     * of a page is a torn write from a power loss: skip it.
+     */
+    for (uint32_t tries = 0; !isSlotBlank(_headSlot); tries++) {
+        if (tries > HISTORY_LOG_TOTAL_SLOTS) {
+            return false;
+        }
+        if ((_headSlot % HISTORY_LOG_SLOTS_PER_PAGE) == 0) {
+            if (FLASH_IF_Erase(slotAddress(_headSlot), HISTORY_LOG_PAGE_SIZE) != FLASH_IF_OK) {
+                APP_LOG(TS_OFF, VLEVEL_M, "History Log: page erase failed \r\n");
+                return false;
+            }
+            _oldestSeq = findOldestSeq();
+        } else {
+            _headSlot = (_headSlot + 1) % HISTORY_LOG_TOTAL_SLOTS;
+        }
+    }
+
+    record->seq = _nextSeq;
+    record->timestamp = getSyncedSeconds();
+    record->reserved = 0xFF;
+    record->crc = calculateModbusCRC((const uint8_t *)record, offsetof(HistoryRecord_t, crc));
+
+    if (FLASH_IF_Write(slotAddress(_headSlot), record, sizeof(HistoryRecord_t)) != FLASH_IF_OK) {
+        APP_LOG(TS_OFF, VLEVEL_M, "History Log: write failed at slot %u \r\n", _headSlot);
+        _headSlot = (_headSlot + 1) % HISTORY_LOG_TOTAL_SLOTS;
+        return false;
+    }
+
+    FLASH_IF_Read(&verify, slotAddress(_headSlot), sizeof(verify));
+    _headSlot = (_headSlot + 1) % HISTORY_LOG_TOTAL_SLOTS;
+    if (!isRecordValid(&verify)) {
+        return false;
+    }
+
+    if (_oldestSeq == HISTORY_SEQ_NONE) {
+        _oldestSeq = _nextSeq;
+    }
+    _nextSeq++;
+    return true;
+}
+
+bool readHistoryRecord(uint32_t seq, HistoryRecord_t *record) {
+    if (_oldestSeq == HISTORY_SEQ_NONE || seq < _oldestSeq || seq >= _nextSeq) {
+        return false;
+    }
+
+    /*
+     * Without torn slots, records are contiguous behind the head, so the slot
+     * can be computed directly. Fall back to a full scan when it does not match.
+     */
+    uint32_t distance = _nextSeq - seq;
+    if (distance <= HISTORY_LOG_TOTAL_SLOTS) {
+        uint32_t slot = (_headSlot + HISTORY_LOG_TOTAL_SLOTS - distance) % HISTORY_LOG_TOTAL_SLOTS;
+        FLASH_IF_Read(record, slotAddress(slot), sizeof(HistoryRecord_t));
+        if (isRecordValid(record) && record->seq == seq) {
+            return true;
+        }
+    }
+
+    for (uint32_t slot = 0; slot < HISTORY_LOG_TOTAL_SLOTS; slot++) {
+        FLASH_IF_Read(record, slotAddress(slot), sizeof(HistoryRecord_t));
+        if (isRecordValid(record) && record->seq == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t getHistoryOldestSeq(void) {
+    return _oldestSeq;
+}
+
+uint32_t getHistoryNextSeq(void) {
+    return _nextSeq;
+}
+
+size_t buildHistoryBackfill(uint32_t *nextSeq, uint32_t lastSeq, uint8_t *destination, size_t maxSize) {
+    HistoryRecord_t record;
+    size_t index = 0;
+    uint32_t seq = *nextSeq;
+
+    if (_oldestSeq == HISTORY_SEQ_NONE) {
+        *nextSeq = lastSeq + 1;
+        return 0;
+    }
+    if (seq < _oldestSeq) {
+        seq = _oldestSeq;
+    }
+    if (lastSeq >= _nextSeq) {
+        lastSeq = _nextSeq - 1;
+    }
+
+    /* Skip sequence numbers lost to torn writes */
+    while (seq <= lastSeq && !readHistoryRecord(seq, &record)) {
+        seq++;
+    }
+    if (seq > lastSeq || maxSize < (HISTORY_BACKFILL_HEADER_SIZE + HISTORY_BACKFILL_RECORD_SIZE)) {
+        *nextSeq = seq;
+        return 0;
+    }
+
+    destination[index++] = (uint8_t)(seq >> 24);
+    destination[index++] = (uint8_t)(seq >> 16);
+    destination[index++] = (uint8_t)(seq >> 8);
+    destination[index++] = (uint8_t)(seq & 0xFF);
+
+    while (seq <= lastSeq && (index + HISTORY_BACKFILL_RECORD_SIZE) <= maxSize) {
+        if (record.seq != seq && !readHistoryRecord(seq, &record)) {
+            break;
+        }
+        destination[index++] = (uint8_t)(record.timestamp >> 24);
+        destination[index++] = (uint8_t)(record.timestamp >> 16);
+        destination[index++] = (uint8_t)(record.timestamp >> 8);
+        destination[index++] = (uint8_t)(record.timestamp & 0xFF);
+        destination[index++] = (uint8_t)(record.waterLevelLatest >> 8);
+        destination[index++] = (uint8_t)(record.waterLevelLatest & 0xFF);
+        destination[index++] = (uint8_t)(record.waterLevel >> 8);
+        destination[index++] = (uint8_t)(record.waterLevel & 0xFF);
+        destination[index++] = (uint8_t)(record.waterLevelMin >> 8);
+        destination[index++] = (uint8_t)(record.waterLevelMin & 0xFF);
+        destination[index++] = (uint8_t)(record.waterLevelMax >> 8);
+        destination[index++] = (uint8_t)(record.waterLevelMax & 0xFF);
+        destination[index++] = (uint8_t)(record.vbat >> 8);
+        destination[index++] = (uint8_t)(record.vbat & 0xFF);
+        seq++;
+    }
+
+    *nextSeq = seq;
+    return index;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file PWX_IdleGovernor.c
+ * @brief Tickless Idle Governor Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * STOP2 costs the energy of its exit (clock and peripheral restore, at the
+ * run current instead of the sleep current it replaces) and pays it back at
+ * IDLE_GOV_SLEEP_UA - IDLE_GOV_STOP2_UA. The
+ * governor compares the distance to the next timer deadline with that
+ * break-even time and vetoes STOP2 through its own UTIL_LPM requester bit.
+ * The restore is timed with the DWT cycle counter on every STOP2 exit, at the
+ * core clock of the entry: MSI keeps its range through STOP2 and the core
+ * wakes on it, whatever SystemCoreClock says once the restore is done.
+ */
+
+#include "PWX_IdleGovernor.h"
+#include "main.h"
+#include "stm32_lpm.h"
+#include "stm32_timer.h"
+#include "sys_app.h"
+#include "utilities_def.h"
+
+#if (IDLE_GOV_RUN_UA <= IDLE_GOV_SLEEP_UA) || (IDLE_GOV_SLEEP_UA <= IDLE_GOV_STOP2_UA)
+#error "IDLE_GOV_SLEEP_UA must lie between IDLE_GOV_STOP2_UA and IDLE_GOV_RUN_UA"
+#endif
+
+/* Private Variables */
+static UTIL_TIMER_Object_t _wakeAheadTimer;
+static uint32_t _restoreUs;             // EWMA of the software restore after STOP2
+static uint32_t _enterTick;
+static uint32_t _wakeCycles;
+static uint32_t _enterClockMhz;         // core clock the wake-up runs on
+static IdleMode_t _mode;
+static uint32_t _residencyMs[IDLE_MODE_NUM];
+static uint32_t _entries[IDLE_MODE_NUM];
+
+/* Private Function Prototypes */
+static void OnWakeAheadEvent(void *context);
+static uint32_t getBreakEvenUs(uint32_t latencyUs);
+
+/**
+ * @brief Nothing to do, the wake itself was the point.
+ */
+static void OnWakeAheadEvent(void *context) {
+}
+
+/**
+ * @brief Idle time beyond which STOP2 saves more than its exit costs.
+ */
+static uint32_t getBreakEvenUs(uint32_t latencyUs) {
+    return (uint32_t)(((uint64_t)(IDLE_GOV_RUN_UA - IDLE_GOV_SLEEP_UA) * latencyUs) / (IDLE_GOV_SLEEP_UA - IDLE_GOV_STOP2_UA));
+}
+
+void initIdleGovernor(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    _restoreUs = 0;
+    for (uint8_t m = 0; m < IDLE_MODE_NUM; m++) {
+        _residencyMs[m] = 0;
+        _entries[m] = 0;
+    }
+    UTIL_TIMER_Create(&_wakeAheadTimer, 0xFFFFFFFFU, UTIL_TIMER_ONESHOT, OnWakeAheadEvent, NULL);
+}
+
+void idleGovernorSelect(void) {
+    uint32_t remainingTicks = UTIL_TIMER_GetFirstRemainingTime();
+    uint32_t latencyUs = getStopExitLatencyUs();
+    uint64_t remainingUs;
+    bool isStopWorth;
+
+    if (remainingTicks == 0xFFFFFFFFU) {
+        /* No timer running, only an interrupt ends the idle period */
+        UTIL_LPM_SetStopMode((1 << CFG_LPM_GOVERNOR_Id), UTIL_LPM_ENABLE);
+        return;
+    }
+
+    remainingUs = (uint64_t)UTIL_TimerDriver.Tick2ms(remainingTicks) * 1000;
+    isStopWorth = remainingUs >= ((uint64_t)latencyUs + getBreakEvenUs(latencyUs));
+    UTIL_LPM_SetStopMode((1 << CFG_LPM_GOVERNOR_Id), isStopWorth ? UTIL_LPM_ENABLE : UTIL_LPM_DISABLE);
+
+    /* Wake ahead of the deadline by the exit latency, the rest is spent in sleep */
+    if (isStopWorth && latencyUs >= IDLE_GOV_PREARM_MIN_US && !UTIL_TIMER_IsRunning(&_wakeAheadTimer)) {
+        uint32_t aheadMs = (latencyUs + 999) / 1000;
+        uint32_t remainingMs = (uint32_t)(remainingUs / 1000);
+
+        if (remainingMs > aheadMs) {
+            UTIL_TIMER_SetPeriod(&_wakeAheadTimer, remainingMs - aheadMs);
+            UTIL_TIMER_Start(&_wakeAheadTimer);
+        }
+    }
+}
+
+void idleGovernorOnEnter(IdleMode_t mode) {
+    _mode = mode;
+    _entries[mode]++;
+    _enterTick = HAL_GetTick();
+    _enterClockMhz = SystemCoreClock / 1000000U;
+}
+
+void idleGovernorOnWake(void) {
+    _wakeCycles = DWT->CYCCNT;
+    _residencyMs[_mode] += HAL_GetTick() - _enterTick;
+}
+
+void idleGovernorOnExit(void) {
+    uint32_t restoreUs;
+
+    if (_mode != IDLE_MODE_STOP2 || _enterClockMhz == 0) {
+        return;
+    }
+    restoreUs = (DWT->CYCCNT - _wakeCycles) / _enterClockMhz;
+    if (_restoreUs == 0) {
+        _restoreUs = restoreUs;
+    } else {
+        _restoreUs = _restoreUs + restoreUs / (1 << IDLE_GOV_LATENCY_SHIFT) - _restoreUs / (1 << IDLE_GOV_LATENCY_SHIFT);
+    }
+}
+
+uint32_t getIdleResidencyMs(IdleMode_t mode) {
+    return _residencyMs[mode];
+}
+
+uint32_t getIdleEntries(IdleMode_t mode) {
+    return _entries[mode];
+}
+
+uint32_t getStopExitLatencyUs(void) {
+    return IDLE_GOV_STOP2_WAKEUP_US + _restoreUs;
+}
+
+void printIdleGovernor(void) {
+    APP_LOG(TS_OFF, VLEVEL_M, "Idle: sleep %u ms (%u) | STOP2 %u ms (%u) | exit %u us \r\n",
+            _residencyMs[IDLE_MODE_SLEEP], _entries[IDLE_MODE_SLEEP],
+            _residencyMs[IDLE_MODE_STOP2], _entries[IDLE_MODE_STOP2], getStopExitLatencyUs());
+}
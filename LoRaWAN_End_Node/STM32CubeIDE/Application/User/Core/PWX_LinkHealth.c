@@ -0,0 +1,179 @@
+/**
+ * @file PWX_LinkHealth.c
+ * @brief Link Health Tracker and Confirmed-Uplink Policy Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * Every uplink that asks the network for an answer (confirmed or carrying a
+ * LinkCheckReq) is an evidence request. Its outcome feeds a loss-rate
+ * estimate, and the misses of an ongoing run of unanswered requests are held
+ * back until the run ends, so an outage does not inflate the very loss rate
+ * it is being tested against.
+ */
+
+#include "PWX_LinkHealth.h"
+#include "sys_app.h"
+
+#define LOSS_RATE_ONE       256U    // loss rate is kept in 1/256 units
+#define LOSS_RATE_INITIAL   32U     // 12.5% until measured
+#define LOSS_RATE_SHIFT     3       // EWMA weight of 1/8
+#define SNR_AVG_SCALE       4       // SNR average is kept in 1/4 dB
+
+/* Private Variables */
+static uint16_t _lossRate;
+static uint16_t _uplinksSinceEvidence;
+static uint8_t  _consecutiveMisses;
+static bool     _isAwaitingAnswer;
+static bool     _isLinkCheckPending;
+static bool     _hasSnr;
+static int16_t  _snrAverage;
+static int8_t   _lastRssi;
+static bool     _hasMargin;
+static uint8_t  _lastMargin;
+static uint8_t  _lastGateways;
+
+/* Private Function Prototypes */
+static void updateLossRate(bool lost);
+static void recordAnswer(void);
+static void recordMiss(void);
+static bool isLinkDegraded(void);
+static uint8_t getOutageMisses(void);
+
+static void updateLossRate(bool lost) {
+    if (lost) {
+        _lossRate += (LOSS_RATE_ONE - _lossRate) >> LOSS_RATE_SHIFT;
+    } else {
+        _lossRate -= _lossRate >> LOSS_RATE_SHIFT;
+    }
+}
+
+/**
+ * @brief Closes the current evidence request as answered and ends a run of misses.
+ */
+static void recordAnswer(void) {
+    if (_isAwaitingAnswer) {
+        while (_consecutiveMisses > 0) {
+            updateLossRate(true);
+            _consecutiveMisses--;
+        }
+        updateLossRate(false);
+        _isAwaitingAnswer = false;
+    }
+    _consecutiveMisses = 0;
+    _isLinkCheckPending = false;
+    _uplinksSinceEvidence = 0;
+}
+
+static void recordMiss(void) {
+    if (_consecutiveMisses < UINT8_MAX) {
+        _consecutiveMisses++;
+    }
+    _isLinkCheckPending = false;
+}
+
+static bool isLinkDegraded(void) {
+    if (_consecutiveMisses > 0) {
+        return true;
+    }
+    if (_hasMargin && (_lastMargin < LINK_HEALTH_MARGIN_GOOD_DB || _lastGateways == 0)) {
+        return true;
+    }
+    return _hasSnr && (_snrAverage < (LINK_HEALTH_SNR_LOW_DB * SNR_AVG_SCALE));
+}
+
+/**
+ * @brief Smallest miss count n with lossRate^n < 1 / LINK_HEALTH_OUTAGE_ODDS, clamped.
+ */
+static uint8_t getOutageMisses(void) {
+    uint32_t chance = 1UL << 16;    // Q16
+    uint8_t misses;
+
+    for (misses = 1; misses < LINK_HEALTH_OUTAGE_MAX_MISSES; misses++) {
+        chance = (chance * _lossRate) / LOSS_RATE_ONE;
+        if ((chance * LINK_HEALTH_OUTAGE_ODDS) < (1UL << 16)) {
+            break;
+        }
+    }
+    return (misses < LINK_HEALTH_OUTAGE_MIN_MISSES) ? LINK_HEALTH_OUTAGE_MIN_MISSES : misses;
+}
+
+void initLinkHealth(void) {
+    _lossRate = LOSS_RATE_INITIAL;
+    _uplinksSinceEvidence = 0;
+    _consecutiveMisses = 0;
+    _isAwaitingAnswer = false;
+    _isLinkCheckPending = false;
+    _hasSnr = false;
+    _snrAverage = 0;
+    _lastRssi = 0;
+    _hasMargin = false;
+    _lastMargin = 0;
+    _lastGateways = 0;
+}
+
+LinkUplinkType_t getLinkUplinkType(uint16_t evidenceInterval) {
+    /* The LinkCheckAns would have come with the downlinks of the previous uplink */
+    if (_isLinkCheckPending) {
+        recordMiss();
+    }
+
+    if (_consecutiveMisses == 0 && (_uplinksSinceEvidence + 1U) < evidenceInterval) {
+        return LINK_UPLINK_UNCONFIRMED;
+    }
+    return isLinkDegraded() ? LINK_UPLINK_CONFIRMED : LINK_UPLINK_LINK_CHECK;
+}
+
+void linkHealthOnTx(LinkUplinkType_t type, bool ackReceived) {
+    if (_uplinksSinceEvidence < UINT16_MAX) {
+        _uplinksSinceEvidence++;
+    }
+
+    switch (type) {
+        case LINK_UPLINK_CONFIRMED:
+            _isAwaitingAnswer = true;
+            if (ackReceived) {
+                recordAnswer();
+            } else {
+                recordMiss();
+            }
+            break;
+        case LINK_UPLINK_LINK_CHECK:
+            _isAwaitingAnswer = true;
+            _isLinkCheckPending = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void linkHealthOnRx(int8_t rssi, int8_t snr, bool linkCheck, uint8_t margin, uint8_t gateways) {
+    int16_t sample = (int16_t)snr * SNR_AVG_SCALE;
+
+    _lastRssi = rssi;
+    if (_hasSnr) {
+        _snrAverage += (sample - _snrAverage) / 4;
+    } else {
+        _snrAverage = sample;
+        _hasSnr = true;
+    }
+
+    /* The LinkCheck flag stays set after the first answer, so only trust it while one is expected */
+    if (linkCheck && _isLinkCheckPending) {
+        _hasMargin = true;
+        _lastMargin = margin;
+        _lastGateways = gateways;
+    }
+
+    /* Any downlink proves the link works */
+    recordAnswer();
+}
+
+bool isLinkOutage(void) {
+    return _consecutiveMisses >= getOutageMisses();
+}
+
+void printLinkHealth(void) {
+    APP_LOG(TS_OFF, VLEVEL_M, "Link Health: loss %u/256 | misses %u/%u | since evidence %u | RSSI %d | SNR %.2q | margin %d dB (%u GW) \r\n",
+            _lossRate, _consecutiveMisses, getOutageMisses(), _uplinksSinceEvidence, _lastRssi,
+            (int)_snrAverage * (100 / SNR_AVG_SCALE), _hasMargin ? (int)_lastMargin : -1, _lastGateways);
+}
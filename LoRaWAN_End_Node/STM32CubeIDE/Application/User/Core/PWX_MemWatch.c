@@ -0,0 +1,146 @@
+/**
+ * @file PWX_MemWatch.c
+ * @brief Stack and Heap High-Water Marks Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * The MSP stack grows down from _estack into the _Min_Stack_Size reserve,
+ * which _sbrk() never hands to the heap. Only that reserve is painted at
+ * boot, so after each sequencer task at most _Min_Stack_Size bytes are
+ * scanned upwards from its floor; the first overwritten word is the deepest
+ * the stack went, interrupts included. Only the used part is then repainted,
+ * so each task is charged with its own depth. A stack that ran past the
+ * reserve reads as the full reserve.
+ */
+
+#include "PWX_MemWatch.h"
+#include "main.h"
+#include "sys_app.h"
+
+extern uint8_t _end;        /* Symbols defined in the linker script */
+extern uint8_t _estack;
+extern uint8_t _Min_Stack_Size;
+
+/* Private Variables */
+static uint32_t *_paintFloor;   // bottom of the stack reserve
+static uint16_t _stackPeak;
+static uint16_t _heapPeak;
+static uint16_t _heapFailures;
+static uint16_t _taskPeak[MEM_WATCH_MAX_TASKS];
+
+/* Private Function Prototypes */
+static uint32_t *alignUp(const uint8_t *address);
+static uint32_t *findDeepestWord(void);
+static void paintRange(uint32_t *from, uint32_t *to);
+
+static uint32_t *alignUp(const uint8_t *address) {
+    return (uint32_t *)(((uintptr_t)address + 3U) & ~(uintptr_t)3U);
+}
+
+static uint32_t *findDeepestWord(void) {
+    uint32_t *word = _paintFloor;
+    uint32_t *top = (uint32_t *)__get_MSP();
+
+    while (word < top && *word == MEM_WATCH_PAINT) {
+        word++;
+    }
+    return word;
+}
+
+static void paintRange(uint32_t *from, uint32_t *to) {
+    while (from < to) {
+        *from++ = MEM_WATCH_PAINT;
+    }
+}
+
+void paintStack(void) {
+    uint32_t *top = (uint32_t *)(__get_MSP() - MEM_WATCH_GUARD_BYTES);
+
+    _paintFloor = alignUp(&_estack - (uintptr_t)&_Min_Stack_Size);
+    paintRange(_paintFloor, top);
+}
+
+void memWatchTaskDone(uint32_t taskId) {
+    uint32_t *deepest;
+    uint16_t depth;
+
+    if (_paintFloor == NULL) {
+        return;
+    }
+    deepest = findDeepestWord();
+    depth = (uint16_t)(&_estack - (uint8_t *)deepest);
+
+    if (depth > _stackPeak) {
+        _stackPeak = depth;
+    }
+    if (taskId < MEM_WATCH_MAX_TASKS && depth > _taskPeak[taskId]) {
+        _taskPeak[taskId] = depth;
+    }
+    paintRange(deepest, (uint32_t *)(__get_MSP() - MEM_WATCH_GUARD_BYTES));
+}
+
+void memWatchOnSbrk(const uint8_t *heapEnd, bool isFailed) {
+    uint16_t extent = (uint16_t)(heapEnd - &_end);
+
+    if (isFailed) {
+        if (_heapFailures < UINT16_MAX) {
+            _heapFailures++;
+        }
+        return;
+    }
+    if (extent > _heapPeak) {
+        _heapPeak = extent;
+    }
+}
+
+uint16_t getStackPeakBytes(void) {
+    return _stackPeak;
+}
+
+uint16_t getTaskStackPeakBytes(uint32_t taskId) {
+    return (taskId < MEM_WATCH_MAX_TASKS) ? _taskPeak[taskId] : 0;
+}
+
+uint16_t getHeapPeakBytes(void) {
+    return _heapPeak;
+}
+
+uint16_t getHeapFailures(void) {
+    return _heapFailures;
+}
+
+size_t buildMemWatchBlock(uint8_t *destination, size_t maxSize) {
+    uint8_t deepestTask = MEM_WATCH_NO_TASK;
+    uint16_t deepestPeak = 0;
+    size_t index = 0;
+
+    if (maxSize < MEM_WATCH_BLOCK_SIZE) {
+        return 0;
+    }
+    for (uint8_t t = 0; t < MEM_WATCH_MAX_TASKS; t++) {
+        if (_taskPeak[t] > deepestPeak) {
+            deepestPeak = _taskPeak[t];
+            deepestTask = t;
+        }
+    }
+
+    destination[index++] = (uint8_t)(_stackPeak >> 8);
+    destination[index++] = (uint8_t)_stackPeak;
+    destination[index++] = (uint8_t)(_heapPeak >> 8);
+    destination[index++] = (uint8_t)_heapPeak;
+    destination[index++] = (uint8_t)((_heapFailures > UINT8_MAX) ? UINT8_MAX : _heapFailures);
+    destination[index++] = deepestTask;
+    destination[index++] = (uint8_t)(deepestPeak >> 8);
+    destination[index++] = (uint8_t)deepestPeak;
+    return index;
+}
+
+void printMemWatch(void) {
+    APP_LOG(TS_OFF, VLEVEL_M, "Memory: stack peak %u B | heap peak %u B | sbrk failures %u \r\n",
+            _stackPeak, _heapPeak, _heapFailures);
+    for (uint8_t t = 0; t < MEM_WATCH_MAX_TASKS; t++) {
+        if (_taskPeak[t] != 0) {
+            APP_LOG(TS_OFF, VLEVEL_M, "  task %u: stack peak %u B \r\n", t, _taskPeak[t]);
+        }
+    }
+}
@@ -11,7 +11,9 @@
 #include "lora_app.h"
 #include "project_config.h"
 #include "usart.h"
+#include "utilities.h"
 #include <stdio.h>
+#include <string.h>
 
 
 
@@ -43,133 +45,107 @@ const void *ModbusDeviceFlashAddresses[] = {
 };
 
 
-uint16_t bytesToUInt16(uint8_t byte1, uint8_t byte2) {
-    return (uint16_t)((byte1 << 8) | byte2);
-}
-
-void convertUint16ToUint8(uint16_t *input, size_t inputSize, uint8_t *output) {
-    for (size_t i = 0; i < inputSize; ++i) {
-        output[2 * i] = (uint8_t)(input[i] >> 8);    // Higher byte
-        output[2 * i + 1] = (uint8_t)(input[i] & 0xFF);  // Lower byte
-    }
+/**
+ * @brief Waits for the segment response: ends after an idle gap, or at the timeout without a first byte.
+ */
+static uint16_t waitForScanResponse(ModBus_t *modbusResponse){
+	volatile uint16_t *rxIndex = &modbusResponse->rxIndex;
+	uint32_t start = HAL_GetTick();
+	uint32_t lastByte = start;
+	uint16_t received = 0;
+
+	while ((HAL_GetTick() - start) < MODBUS_SCAN_TIMEOUT_MS) {
+		uint16_t count = *rxIndex;
+		if (count != received) {
+			received = count;
+			lastByte = HAL_GetTick();
+		} else if (received > 0 && (HAL_GetTick() - lastByte) >= MODBUS_SCAN_IDLE_MS) {
+			break;
+		}
+	}
+	return received;
 }
 
-void scanModbusDevice(struct ModbusDevice ModbusDevice, uint8_t SegmentID, size_t* outputSize, uint8_t* arrFilteredData){
-	// Set Device Setting - Baud rate, Parity, Stop Bit
-	initModbusParameters(ModbusDevice.Baudrate, ModbusDevice.Parity, ModbusDevice.StopBits);
-
+size_t filterModbusRegisters(const struct Segment *segment, const uint8_t *response, uint16_t responseSize,
+		uint8_t *destination, size_t maxSize){
+	uint64_t addresses = segment->validAddresses;
+	uint8_t numRegisters;
+	size_t index = 0;
 
-
-	HAL_Delay(1000);
-
-
-    // Send Commands to Modbus Device
-	APP_LOG(TS_OFF, VLEVEL_M, "SENDING DEVICE MODBUS COMMAND \r\n");
-	//printf("SENDING DEVICE MODBUS COMMAND \r\n");
-
-	//	data = DeviceSample.Segment[1].cmd;
-	//	sendRaw_CRC(data, getArrayLength(data), &ModbusResp);
-	//	OS_Delay(1000);
-
-	APP_LOG(TS_OFF, VLEVEL_M, "MODBUS COMMAND (Hex):  \r\n");
-
-	for (int x = 0; x < ModbusDevice.Segment[SegmentID].cmdSize; x++){
-		APP_LOG(TS_OFF, VLEVEL_M, "%02X ", ModbusDevice.Segment[SegmentID].cmdRaw[x]);
+	if (responseSize < MODBUS_SCAN_HEADER_SIZE || response[2] > (responseSize - MODBUS_SCAN_HEADER_SIZE)) {
+		return 0;
 	}
+	numRegisters = response[2] / 2;
 
-	APP_LOG(TS_OFF, VLEVEL_M, "\r\n");
+	// Only the set bits are visited, lowest register first
+	while (addresses != 0) {
+		uint8_t reg = (uint8_t)__builtin_ctzll(addresses);
+		const uint8_t *value;
 
-	sendRaw(ModbusDevice.Segment[SegmentID].cmdRaw, (uint16_t)ModbusDevice.Segment[SegmentID].cmdSize, &ModbusResp);
-	HAL_Delay(2000);
+		if (reg >= numRegisters || (index + 2) > maxSize) {
+			break;
+		}
+		value = &response[MODBUS_SCAN_HEADER_SIZE + (reg * 2)];
+		destination[index++] = value[0];
+		destination[index++] = value[1];
+		addresses &= addresses - 1;
+	}
+	return index;
+}
 
+size_t scanModbusDevice(const struct ModbusDevice *ModbusDevice, uint8_t SegmentID, uint8_t *destination, size_t maxSize){
+	const struct Segment *segment = &ModbusDevice->Segment[SegmentID];
+	uint16_t length;
+	uint8_t cmdType;
 
-//    // Parse Response
-	APP_LOG(TS_OFF, VLEVEL_M, "MMODBUS RESPONSE (Hex):   \r\n");
+	// Set Device Setting - Baud rate, Parity, Stop Bit
+	initModbusParameters(ModbusDevice->Baudrate, ModbusDevice->Parity, ModbusDevice->StopBits);
 
-	for (int x = 0; x < ModbusResp.rxIndex; x++){
-		APP_LOG(TS_OFF, VLEVEL_M, "%02X \r\n", ModbusResp.buffer[x]);
+	// Nothing but polling until the answer is in, the clock policy keeps USART1 in tolerance
+	requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
 
+	APP_LOG(TS_OFF, VLEVEL_M, "MODBUS COMMAND (Hex): ");
+	for (uint8_t x = 0; x < segment->cmdSize; x++){
+		APP_LOG(TS_OFF, VLEVEL_M, "%02X ", segment->cmdRaw[x]);
 	}
 	APP_LOG(TS_OFF, VLEVEL_M, "\r\n");
 
-	uint16_t bytesToSend[64];     // this will hold registers to send
-	uint8_t bytesToSendIndex = 0;
-
-	uint8_t cmdType = ModbusResp.buffer[1]; // Determine Modbus Command - Read or Write Coil or Registers
-
-	if(cmdType == HOLDING_REGISTER || cmdType ==  DISCRETE_INPUT){
-		printf("Parsing Data \n");
-		for (uint8_t i = 0; i < 32; i++) { // 8 is used for testing instead of 64 for 64 bit value
-			if ((ModbusDevice.Segment[SegmentID].validAddresses & (1 << i)) != 0) {
-				uint8_t offset = (i * 2) + 3;
-				uint16_t value = bytesToUInt16(ModbusResp.buffer[offset], ModbusResp.buffer[offset + 1]);
-			    printf("Save Holding Register %d: Value = %04X\n", i, value);
-				 // Store the value in the array
-				if (bytesToSendIndex < sizeof(bytesToSend) / sizeof(bytesToSend[0])) {
-					bytesToSend[bytesToSendIndex++] = value;
-				} else {
-					printf("Warning: Sending array is full.\n");
-				}
-			}
-		}
-
-		size_t _outputBytesSize = bytesToSendIndex;
-		uint8_t outputBytes[_outputBytesSize * 2];
+	sendRaw((uint8_t *)segment->cmdRaw, (uint16_t)segment->cmdSize, &ModbusResp);
+	length = waitForScanResponse(&ModbusResp);
+	releaseClockLevel(CLOCK_USER_MODBUS);
+	if (length == 0) {
+		APP_LOG(TS_OFF, VLEVEL_M, "MODBUS RESPONSE: timeout \r\n");
+		return 0;
+	}
 
-		convertUint16ToUint8(bytesToSend, _outputBytesSize, outputBytes);
+	if (ModbusDevice->enableCRCCheck) {
+		uint16_t crc;
 
-		printf("Register to Send: ");
-		for(uint8_t i = 0; i < _outputBytesSize * 2; i++){
-			printf("%02X, ", outputBytes[i]);
+		if (length < (MODBUS_SCAN_HEADER_SIZE + MODBUS_SCAN_CRC_SIZE)) {
+			APP_LOG(TS_OFF, VLEVEL_M, "MODBUS RESPONSE: %u byte(s), too short \r\n", length);
+			return 0;
 		}
-		printf("\n");
-
-
-		for (size_t i = 0; i < _outputBytesSize * 2; i++) {
-			arrFilteredData[i] = outputBytes[i];
+		crc = (uint16_t)ModbusResp.buffer[length - 2] | ((uint16_t)ModbusResp.buffer[length - 1] << 8);
+		if (calculateModbusCRC(ModbusResp.buffer, length - MODBUS_SCAN_CRC_SIZE) != crc) {
+			APP_LOG(TS_OFF, VLEVEL_M, "MODBUS RESPONSE: CRC mismatch \r\n");
+			return 0;
 		}
+	}
 
+	cmdType = ModbusResp.buffer[1]; // Determine Modbus Command - Read or Write Coil or Registers
 
-//		printf("Segment Data to Send:\n");
-//		for (uint8_t i = 0; i < _outputBytesSize * 2; i++) {
-//			printf("%02X ", arrFilteredData[i]);
-//		}
-//		printf("\n");
-
-		*outputSize = _outputBytesSize * 2;
+	if (cmdType == HOLDING_REGISTER || cmdType == DISCRETE_INPUT) {
+		size_t outputSize = filterModbusRegisters(segment, ModbusResp.buffer, length, destination, maxSize);
 
-	}
-	//else if(cmdType == COIL_STATUS || cmdType ==  INPUT_STATUS){
-//		for (uint8_t i = 0; i < 8; i++) { // 8 is used for testing instead of 64 for 64 bit value
-//			if ((ModbusDevice.Segment[0].validAddresses & (1 << i)) != 0) {
-//				uint8_t offset = i + 3;
-//				uint16_t value = ModbusResp.buffer[offset];
-//				// printf("Save Holding Register %d: Value = %04X\n", i, value);
-//				 // Store the value in the array
-//				if (bytesToSendIndex < sizeof(bytesToSend) / sizeof(bytesToSend[0])) {
-//					bytesToSend[bytesToSendIndex++] = value;
-//				} else {
-//					printf("Warning: Sending array is full.\n");
-//				}
-//
-//			}
-//
-//		}
-//		printf("Register to Send: ");
-//		for(uint8_t i = 0; i < bytesToSendIndex; i++){
-//			printf("%04X, ", bytesToSend[i]);
-//		}
-//		printf("\n");
-	//}
-
-	else{
-
-		for (size_t i = 0; i < ModbusResp.rxIndex; i++) {
-			arrFilteredData[i] = ModbusResp.buffer[i];
-		}
-		*outputSize = ModbusResp.rxIndex;
+		APP_LOG(TS_OFF, VLEVEL_M, "MODBUS RESPONSE: %u byte(s), %u register byte(s) kept \r\n", length, (uint16_t)outputSize);
+		return outputSize;
 	}
 
+	// Anything else is passed on as received
+	length = (uint16_t)MIN((size_t)length, maxSize);
+	memcpy(destination, ModbusResp.buffer, length);
+	APP_LOG(TS_OFF, VLEVEL_M, "MODBUS RESPONSE: %u byte(s) \r\n", length);
+	return length;
 }
 
 
@@ -40,7 +40,7 @@ void checkOnChange(uint8_t ID, ModbusMonitorSlot_t *slot);
 
 PUTCHAR_PROTOTYPE
 {
-  HAL_UART_Transmit(&huart2, (uint8_t *)&ch, 1, HAL_MAX_DELAY);
+  HAL_UART_Transmit(&hlpuart1, (uint8_t *)&ch, 1, HAL_MAX_DELAY);
   return ch;
 }
 
@@ -409,25 +409,25 @@ VarData_u convertBytesToData(uint8_t *bytes, uint8_t dataType) {
 		case Modbus_Float_ABCD:
 		   result.f = bytesToFloat(bytes[0], bytes[1], bytes[2], bytes[3]);
 #ifdef DEBUG_DATA_CONVERSION
-		   printf("Float_ABCD: %02f \r\n", result.f);
+		   APP_LOG(TS_OFF, VLEVEL_M, "Float_ABCD: %.3q \r\n", FIXED_POINT(result.f, 1000));
 #endif
 		   break;
 		case Modbus_Float_DCBA:
 		   result.f = bytesToFloat(bytes[3], bytes[2], bytes[1], bytes[0]);
 #ifdef DEBUG_DATA_CONVERSION
-		   printf("Float_DCBA: %02f \r\n", result.f);
+		   APP_LOG(TS_OFF, VLEVEL_M, "Float_DCBA: %.3q \r\n", FIXED_POINT(result.f, 1000));
 #endif
 		   break;
 		case Modbus_Float_BADC:
 		   result.f = bytesToFloat(bytes[1], bytes[0], bytes[3], bytes[2]);
 #ifdef DEBUG_DATA_CONVERSION
-		   printf("Float_BADC: %02f \r\n", result.f);
+		   APP_LOG(TS_OFF, VLEVEL_M, "Float_BADC: %.3q \r\n", FIXED_POINT(result.f, 1000));
 #endif
 		   break;
 		case Modbus_Float_CDAB:
 		   result.f = bytesToFloat(bytes[2], bytes[3], bytes[0], bytes[1]);
 #ifdef DEBUG_DATA_CONVERSION
-		   printf("Float_CDAB: %02f \r\n", result.f);
+		   APP_LOG(TS_OFF, VLEVEL_M, "Float_CDAB: %.3q \r\n", FIXED_POINT(result.f, 1000));
 #endif
 		   break;
 		case Modbus_uInt8:
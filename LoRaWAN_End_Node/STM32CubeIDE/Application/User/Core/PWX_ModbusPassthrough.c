@@ -0,0 +1,305 @@
+/**
+ * @file PWX_ModbusPassthrough.c
+ * @brief Remote Modbus Passthrough Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * Requests of one downlink are staged, then run from the sequencer one after
+ * the other on the same sendRaw() path the monitoring slots use. The answer
+ * of a read is kept in a small cache, so a backend polling the same
+ * registers from several places costs one bus transaction per freshness
+ * window. Writes are never cached and drop what is cached for their slave.
+ */
+
+#include "PWX_ModbusPassthrough.h"
+#include "project_config.h"
+#include <string.h>
+
+#define MODBUS_FRAME_CRC_SIZE       2
+#define MODBUS_MIN_RESPONSE_SIZE    4       // slave id, function code, CRC
+
+#if (MODBUS_PASSTHROUGH_MAX_REQUESTS > 8)
+#error "MODBUS_PASSTHROUGH_MAX_REQUESTS must fit the unsent response mask"
+#endif
+
+typedef struct {
+    uint8_t pduSize;
+    uint8_t pdu[MODBUS_PASSTHROUGH_MAX_PDU];
+    uint8_t status;
+    uint8_t responseSize;
+    uint8_t response[MODBUS_PASSTHROUGH_MAX_RESPONSE];
+} PassthroughRequest_t;
+
+typedef struct {
+    bool     valid;
+    uint32_t timestamp;
+    uint8_t  pduSize;
+    uint8_t  pdu[MODBUS_PASSTHROUGH_MAX_PDU];
+    uint8_t  responseSize;
+    uint8_t  response[MODBUS_PASSTHROUGH_MAX_RESPONSE];
+} PassthroughCacheEntry_t;
+
+/* Private Variables */
+static PassthroughRequest_t _requests[MODBUS_PASSTHROUGH_MAX_REQUESTS];
+static PassthroughCacheEntry_t _cache[MODBUS_PASSTHROUGH_CACHE_SIZE];
+static uint8_t _txnId;
+static uint8_t _numRequests;
+static bool    _isPending;
+static uint8_t _unsentMask;     // bit per request whose response is not uplinked yet
+
+/* Private Function Prototypes */
+static inline bool isReadFunction(uint8_t functionCode);
+static inline uint8_t getRecordSize(const PassthroughRequest_t *request);
+static PassthroughCacheEntry_t *findCacheEntry(const PassthroughRequest_t *request);
+static void storeCacheEntry(const PassthroughRequest_t *request);
+static void dropCacheEntries(uint8_t slaveId);
+static uint16_t waitForResponse(ModBus_t *modbusResponse);
+static void executeRequest(PassthroughRequest_t *request, ModBus_t *modbusResponse);
+
+static inline bool isReadFunction(uint8_t functionCode) {
+    return functionCode >= ModbusCMD_ReadCoilStatus && functionCode <= ModbusCMD_ReadInputRegisters;
+}
+
+static inline uint8_t getRecordSize(const PassthroughRequest_t *request) {
+    return MODBUS_PASSTHROUGH_RECORD_HEADER + request->responseSize;
+}
+
+static PassthroughCacheEntry_t *findCacheEntry(const PassthroughRequest_t *request) {
+    uint32_t now = HAL_GetTick();
+
+    for (uint8_t i = 0; i < MODBUS_PASSTHROUGH_CACHE_SIZE; i++) {
+        PassthroughCacheEntry_t *entry = &_cache[i];
+        if (!entry->valid || entry->pduSize != request->pduSize) {
+            continue;
+        }
+        if ((now - entry->timestamp) >= MODBUS_PASSTHROUGH_CACHE_MS) {
+            entry->valid = false;
+            continue;
+        }
+        if (memcmp(entry->pdu, request->pdu, request->pduSize) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Caches an answered read in a free entry, or over the oldest one.
+ */
+static void storeCacheEntry(const PassthroughRequest_t *request) {
+    uint32_t now = HAL_GetTick();
+    PassthroughCacheEntry_t *entry = &_cache[0];
+
+    for (uint8_t i = 0; i < MODBUS_PASSTHROUGH_CACHE_SIZE; i++) {
+        if (!_cache[i].valid) {
+            entry = &_cache[i];
+            break;
+        }
+        if ((now - _cache[i].timestamp) > (now - entry->timestamp)) {
+            entry = &_cache[i];
+        }
+    }
+
+    entry->valid = true;
+    entry->timestamp = now;
+    entry->pduSize = request->pduSize;
+    memcpy(entry->pdu, request->pdu, request->pduSize);
+    entry->responseSize = request->responseSize;
+    memcpy(entry->response, request->response, request->responseSize);
+}
+
+static void dropCacheEntries(uint8_t slaveId) {
+    for (uint8_t i = 0; i < MODBUS_PASSTHROUGH_CACHE_SIZE; i++) {
+        if (_cache[i].valid && _cache[i].pdu[0] == slaveId) {
+            _cache[i].valid = false;
+        }
+    }
+}
+
+/**
+ * @brief Waits for the first byte, then until the line stays idle.
+ * @return Number of bytes received, 0 on timeout.
+ */
+static uint16_t waitForResponse(ModBus_t *modbusResponse) {
+    volatile uint16_t *rxIndex = &modbusResponse->rxIndex;
+    uint32_t start = HAL_GetTick();
+    uint32_t lastByte = start;
+    uint16_t received = 0;
+
+    while ((HAL_GetTick() - start) < MODBUS_PASSTHROUGH_TIMEOUT_MS) {
+        uint16_t count = *rxIndex;
+        if (count != received) {
+            received = count;
+            lastByte = HAL_GetTick();
+        } else if (received > 0 && (HAL_GetTick() - lastByte) >= MODBUS_PASSTHROUGH_IDLE_MS) {
+            break;
+        }
+    }
+    return received;
+}
+
+static void executeRequest(PassthroughRequest_t *request, ModBus_t *modbusResponse) {
+    uint8_t frame[MODBUS_PASSTHROUGH_MAX_PDU + MODBUS_FRAME_CRC_SIZE];
+    uint16_t crc;
+    uint16_t length;
+
+    memcpy(frame, request->pdu, request->pduSize);
+    crc = calculateModbusCRC(frame, request->pduSize);
+    frame[request->pduSize] = (uint8_t)(crc & 0xFF);
+    frame[request->pduSize + 1] = (uint8_t)(crc >> 8);
+
+    sendRaw(frame, request->pduSize + MODBUS_FRAME_CRC_SIZE, modbusResponse);
+    length = waitForResponse(modbusResponse);
+
+    request->responseSize = 0;
+    if (length == 0) {
+        request->status = MODBUS_PASSTHROUGH_TIMEOUT;
+        return;
+    }
+    if (length < MODBUS_MIN_RESPONSE_SIZE) {
+        request->status = MODBUS_PASSTHROUGH_BAD_RESPONSE;
+        return;
+    }
+
+    length -= MODBUS_FRAME_CRC_SIZE;
+    crc = (uint16_t)modbusResponse->buffer[length] | ((uint16_t)modbusResponse->buffer[length + 1] << 8);
+    if (calculateModbusCRC(modbusResponse->buffer, length) != crc) {
+        request->status = MODBUS_PASSTHROUGH_BAD_RESPONSE;
+    } else if (length > MODBUS_PASSTHROUGH_MAX_RESPONSE) {
+        request->status = MODBUS_PASSTHROUGH_TOO_LARGE;
+    } else {
+        request->status = MODBUS_PASSTHROUGH_OK;
+        request->responseSize = (uint8_t)length;
+        memcpy(request->response, modbusResponse->buffer, length);
+    }
+}
+
+void initModbusPassthrough(void) {
+    memset(_cache, 0, sizeof(_cache));
+    _numRequests = 0;
+    _isPending = false;
+    _unsentMask = 0;
+}
+
+uint8_t queueModbusPassthrough(const uint8_t *payload, size_t size) {
+    size_t offset = 1;
+
+    if (_isPending || _unsentMask != 0) {
+        APP_LOG(TS_OFF, VLEVEL_M, "Modbus Passthrough: txn %u dropped \r\n", _txnId);
+    }
+    _numRequests = 0;
+    _isPending = false;
+    _unsentMask = 0;
+    if (payload == NULL || size < 2) {
+        return 0;
+    }
+
+    _txnId = payload[0];
+    while (offset < size && _numRequests < MODBUS_PASSTHROUGH_MAX_REQUESTS) {
+        PassthroughRequest_t *request = &_requests[_numRequests++];
+        uint8_t length = payload[offset++];
+
+        request->responseSize = 0;
+        if (length < 2 || length > MODBUS_PASSTHROUGH_MAX_PDU || (offset + length) > size) {
+            /* The rest of the payload cannot be framed */
+            request->pduSize = 0;
+            request->status = MODBUS_PASSTHROUGH_INVALID;
+            break;
+        }
+        request->pduSize = length;
+        memcpy(request->pdu, &payload[offset], length);
+        request->status = MODBUS_PASSTHROUGH_OK;
+        offset += length;
+    }
+
+    _isPending = (_numRequests > 0);
+    return _numRequests;
+}
+
+bool isModbusPassthroughPending(void) {
+    return _isPending;
+}
+
+void runModbusPassthrough(ModBus_t *modbusResponse) {
+    uint8_t cached = 0;
+
+    if (!_isPending) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < _numRequests; i++) {
+        PassthroughRequest_t *request = &_requests[i];
+        PassthroughCacheEntry_t *entry;
+
+        if (request->status == MODBUS_PASSTHROUGH_INVALID) {
+            continue;
+        }
+
+        if (!isReadFunction(request->pdu[1])) {
+            dropCacheEntries(request->pdu[0]);
+            executeRequest(request, modbusResponse);
+            continue;
+        }
+
+        entry = findCacheEntry(request);
+        if (entry != NULL) {
+            request->status = MODBUS_PASSTHROUGH_CACHED;
+            request->responseSize = entry->responseSize;
+            memcpy(request->response, entry->response, entry->responseSize);
+            cached++;
+            continue;
+        }
+
+        executeRequest(request, modbusResponse);
+        if (request->status == MODBUS_PASSTHROUGH_OK) {
+            storeCacheEntry(request);
+        }
+    }
+
+    APP_LOG(TS_OFF, VLEVEL_M, "Modbus Passthrough: txn %u | %u request(s) | %u cached \r\n",
+            _txnId, _numRequests, cached);
+    _isPending = false;
+    _unsentMask = (uint8_t)((1U << _numRequests) - 1);
+}
+
+size_t buildModbusPassthroughUplink(uint8_t *destination, size_t maxSize, uint8_t *packed) {
+    size_t index = 0;
+
+    *packed = 0;
+    if (_unsentMask == 0 || maxSize < (1U + MODBUS_PASSTHROUGH_RECORD_HEADER)) {
+        return 0;
+    }
+
+    destination[index++] = _txnId;
+    for (uint8_t i = 0; i < _numRequests; i++) {
+        PassthroughRequest_t *request = &_requests[i];
+
+        if ((_unsentMask & (1U << i)) == 0) {
+            continue;
+        }
+        if ((1U + getRecordSize(request)) > maxSize) {
+            /* Would never fit at this data rate, report it without data */
+            request->status = MODBUS_PASSTHROUGH_TOO_LARGE;
+            request->responseSize = 0;
+        }
+        if ((index + getRecordSize(request)) > maxSize) {
+            continue;
+        }
+
+        destination[index++] = i;
+        destination[index++] = request->status;
+        destination[index++] = request->responseSize;
+        memcpy(&destination[index], request->response, request->responseSize);
+        index += request->responseSize;
+        *packed |= (uint8_t)(1U << i);
+    }
+    return index;
+}
+
+void markModbusPassthroughSent(uint8_t packed) {
+    _unsentMask &= (uint8_t)~packed;
+}
+
+bool hasModbusPassthroughReplies(void) {
+    return _unsentMask != 0;
+}
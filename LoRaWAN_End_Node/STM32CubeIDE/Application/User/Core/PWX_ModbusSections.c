@@ -0,0 +1,187 @@
+/**
+ * @file PWX_ModbusSections.c
+ * @brief Multi-Device Modbus Section Aggregator Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * A section is the filtered answer of one segment, often ten bytes or so,
+ * while every uplink costs the PHY and MAC overhead plus its own duty cycle
+ * wait. The sections of all 16 devices are scanned once per cycle into a
+ * shared pool, then packed first fit into frames as large as the data rate
+ * allows. The data is copied with buildDataToSend(), a section only leaves
+ * the queue once the MAC has accepted the frame carrying it.
+ *
+ * scanModbusDevice() sets USART1 up for each device in turn, so the ST50H
+ * level sensor settings are put back once the cycle is collected.
+ */
+
+#include "PWX_ModbusSections.h"
+#include "project_config.h"
+#include "utilities.h"
+#include "usart.h"
+#include <string.h>
+
+#if (MODBUS_SECTION_MAX_QUEUED > 32)
+#error "MODBUS_SECTION_MAX_QUEUED must fit the packed section mask"
+#endif
+
+typedef struct {
+    uint8_t  tag;           // ((device - 1) << 4) | segment
+    uint8_t  size;
+    uint16_t offset;        // into _pool
+} ModbusSection_t;
+
+/* Private Variables */
+static ModbusSection_t _sections[MODBUS_SECTION_MAX_QUEUED];
+static uint8_t  _pool[MODBUS_SECTION_POOL_SIZE];
+static uint8_t  _numSections;
+static uint32_t _unsentMask;        // bit per section not uplinked yet
+static uint32_t _numSent;
+static uint32_t _numFrames;
+static uint32_t _numDropped;        // stale when the next cycle collected
+static uint16_t _nextSection;       // (device << 4) | segment the next collection starts at
+
+/* Private Function Prototypes */
+static uint8_t countSections(uint32_t mask);
+static uint8_t scanSections(void);
+
+static uint8_t countSections(uint32_t mask) {
+    uint8_t count = 0;
+
+    while (mask != 0) {
+        mask &= mask - 1;
+        count++;
+    }
+    return count;
+}
+
+void initModbusSections(void) {
+    _numSections = 0;
+    _unsentMask = 0;
+    _numSent = 0;
+    _numFrames = 0;
+    _numDropped = 0;
+    _nextSection = 0;
+}
+
+/**
+ * @brief Reads the segments into the queue, round robin from _nextSection.
+ */
+static uint8_t scanSections(void) {
+    uint8_t stale = countSections(_unsentMask);
+    uint16_t used = 0;
+
+    if (stale > 0) {
+        _numDropped += stale;
+        APP_LOG(TS_OFF, VLEVEL_M, "Modbus Sections: %u stale section(s) dropped \r\n", stale);
+    }
+    _numSections = 0;
+    _unsentMask = 0;
+
+    /* Round robin, so devices past a full queue are read first next cycle */
+    for (uint16_t n = 0; n < (NUM_DEVICES * NUM_DEV_SEGMENTS); n++) {
+        uint16_t position = (uint16_t)((_nextSection + n) % (NUM_DEVICES * NUM_DEV_SEGMENTS));
+        uint8_t dev = (uint8_t)(position / NUM_DEV_SEGMENTS);
+        uint8_t seg = (uint8_t)(position % NUM_DEV_SEGMENTS);
+        const struct ModbusDevice *device = (const struct ModbusDevice *)ModbusDeviceFlashAddresses[dev];
+        const struct Segment *segment = &device->Segment[seg];
+        size_t room;
+        size_t size;
+
+        if (device->DeviceActive != 1 || segment->enableSegment != 1 || segment->sendNow != 1
+                || segment->cmdSize == 0 || segment->cmdSize > sizeof(segment->cmdRaw)) {
+            continue;
+        }
+        if (_numSections >= MODBUS_SECTION_MAX_QUEUED || used >= MODBUS_SECTION_POOL_SIZE) {
+            APP_LOG(TS_OFF, VLEVEL_M, "Modbus Sections: queue full at device %u segment %u \r\n", dev + 1, seg);
+            _nextSection = position;
+            return _numSections;
+        }
+
+        room = MIN((size_t)(MODBUS_SECTION_POOL_SIZE - used), (size_t)MODBUS_SECTION_MAX_DATA);
+        size = scanModbusDevice(device, seg, &_pool[used], room);
+        if (size == 0) {
+            continue;
+        }
+        if (size == room && room < MODBUS_SECTION_MAX_DATA) {
+            /* May be cut short by the end of the pool, read again first next cycle */
+            APP_LOG(TS_OFF, VLEVEL_M, "Modbus Sections: pool full at device %u segment %u \r\n", dev + 1, seg);
+            _nextSection = position;
+            return _numSections;
+        }
+
+        _sections[_numSections].tag = (uint8_t)((dev << 4) | seg);
+        _sections[_numSections].size = (uint8_t)size;
+        _sections[_numSections].offset = used;
+        _unsentMask |= (1UL << _numSections);
+        _numSections++;
+        used += (uint16_t)size;
+    }
+    _nextSection = 0;
+    return _numSections;
+}
+
+uint8_t collectModbusSections(void) {
+    UART_InitTypeDef levelSensorInit = huart1.Init;
+    uint8_t numSections = scanSections();
+
+    if (memcmp(&huart1.Init, &levelSensorInit, sizeof(levelSensorInit)) != 0) {
+        huart1.Init = levelSensorInit;
+        if (HAL_UART_Init(&huart1) != HAL_OK) {
+            Error_Handler();
+        }
+        HAL_UART_Receive_IT(&huart1, (uint8_t *)ModbusResp.buffer, 1);
+    }
+    return numSections;
+}
+
+size_t buildModbusSectionUplink(uint8_t *destination, size_t maxSize, uint32_t *packed) {
+    size_t index = 0;
+
+    *packed = 0;
+    if (_unsentMask == 0 || maxSize < MODBUS_SECTION_HEADER_SIZE) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < _numSections; i++) {
+        ModbusSection_t *section = &_sections[i];
+
+        if ((_unsentMask & (1UL << i)) == 0) {
+            continue;
+        }
+        if ((size_t)(MODBUS_SECTION_HEADER_SIZE + section->size) > maxSize) {
+            /* Would never fit at this data rate, report it without data */
+            section->size = 0;
+        }
+        if ((index + MODBUS_SECTION_HEADER_SIZE + section->size) > maxSize) {
+            continue;
+        }
+
+        destination[index++] = section->tag;
+        destination[index++] = section->size;
+        if (section->size > 0) {
+            index = buildDataToSend(destination, &_pool[section->offset], section->size, (uint8_t)index);
+        }
+        *packed |= (1UL << i);
+    }
+    return index;
+}
+
+void markModbusSectionsSent(uint32_t packed) {
+    packed &= _unsentMask;
+    if (packed == 0) {
+        return;
+    }
+    _unsentMask &= ~packed;
+    _numSent += countSections(packed);
+    _numFrames++;
+}
+
+bool hasModbusSections(void) {
+    return _unsentMask != 0;
+}
+
+void printModbusSections(void) {
+    APP_LOG(TS_OFF, VLEVEL_M, "Modbus Sections: %u sent in %u frame(s), %u frame(s) saved | %u stale dropped \r\n",
+            _numSent, _numFrames, _numSent - _numFrames, _numDropped);
+}
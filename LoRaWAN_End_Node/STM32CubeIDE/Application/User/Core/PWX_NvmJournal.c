@@ -0,0 +1,263 @@
+/**
+ * @file PWX_NvmJournal.c
+ * @brief LoRaMac NVM Context Journal Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * Each page starts with a page header, followed by group records. A record is
+ * a 16-byte header plus the group data padded to 8 bytes. The data is written
+ * before its header, and a page header is written only after the full snapshot
+ * that opens the page, so a power loss leaves at most a blank header that the
+ * boot scan stops at.
+ */
+
+#include "PWX_NvmJournal.h"
+#include "LoRaMac.h"
+#include "flash_if.h"
+#include "utilities.h"
+#include "sys_app.h"
+#include <stddef.h>
+#include <string.h>
+
+#define JOURNAL_PAGE_MAGIC     0x4A4D564EUL    // "NVMJ"
+#define JOURNAL_RECORD_MAGIC   0x4A52U         // "RJ"
+#define JOURNAL_HEADER_SIZE    16U
+#define JOURNAL_NO_PAGE        0xFF
+#define ALIGN8(x)              (((x) + 7U) & ~7U)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t seqInv;
+    uint32_t reserved;
+} JournalPageHeader_t;
+
+typedef struct {
+    uint16_t magic;
+    uint8_t  group;
+    uint8_t  reserved;
+    uint16_t length;
+    uint16_t reserved2;
+    uint32_t crc;
+    uint32_t reserved3;
+} JournalRecordHeader_t;
+
+typedef struct {
+    uint16_t offset;
+    uint16_t size;
+} JournalGroup_t;
+
+/* Same groups LoRaMacHandleNvm() tracks with their own CRC */
+static const JournalGroup_t _groups[] = {
+    { offsetof(LoRaMacNvmData_t, Crypto),        sizeof(LoRaMacCryptoNvmData_t) },
+    { offsetof(LoRaMacNvmData_t, MacGroup1),     sizeof(LoRaMacNvmDataGroup1_t) },
+    { offsetof(LoRaMacNvmData_t, MacGroup2),     sizeof(LoRaMacNvmDataGroup2_t) },
+    { offsetof(LoRaMacNvmData_t, SecureElement), sizeof(SecureElementNvmData_t) },
+    { offsetof(LoRaMacNvmData_t, RegionGroup1),  sizeof(RegionNvmDataGroup1_t) },
+    { offsetof(LoRaMacNvmData_t, RegionGroup2),  sizeof(RegionNvmDataGroup2_t) },
+    { offsetof(LoRaMacNvmData_t, ClassB),        sizeof(LoRaMacClassBNvmData_t) },
+};
+#define JOURNAL_NUM_GROUPS     (sizeof(_groups) / sizeof(_groups[0]))
+
+/* Private Variables */
+static uint8_t _activePage = JOURNAL_NO_PAGE;
+static uint32_t _pageSeq;
+static uint32_t _writeOffset;
+static const uint8_t *_latest[JOURNAL_NUM_GROUPS];
+
+/* Private Function Prototypes */
+static inline uint8_t *pageAddress(uint8_t page);
+static bool isAreaBlank(const uint8_t *start, uint32_t length);
+static uint32_t replayPage(uint8_t page);
+static bool appendGroup(uint8_t group, const uint8_t *data);
+static bool writeSnapshot(const uint8_t *nvm);
+
+static inline uint8_t *pageAddress(uint8_t page) {
+    return (uint8_t *)NVM_JOURNAL_BASE_ADDRESS + (page * NVM_JOURNAL_PAGE_SIZE);
+}
+
+static bool isAreaBlank(const uint8_t *start, uint32_t length) {
+    for (uint32_t i = 0; i < length; i += 8) {
+        if (*(const uint64_t *)(start + i) != UINT64_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Indexes the valid records of a page and returns the offset after the last one.
+ */
+static uint32_t replayPage(uint8_t page) {
+    uint8_t *base = pageAddress(page);
+    uint32_t offset = JOURNAL_HEADER_SIZE;
+    JournalRecordHeader_t header;
+
+    while ((offset + JOURNAL_HEADER_SIZE) <= NVM_JOURNAL_PAGE_SIZE) {
+        FLASH_IF_Read(&header, base + offset, sizeof(header));
+        if (header.magic != JOURNAL_RECORD_MAGIC || header.group >= JOURNAL_NUM_GROUPS
+                || header.length != _groups[header.group].size
+                || (offset + JOURNAL_HEADER_SIZE + ALIGN8(header.length)) > NVM_JOURNAL_PAGE_SIZE) {
+            break;
+        }
+        if (Crc32(base + offset + JOURNAL_HEADER_SIZE, header.length) != header.crc) {
+            break;
+        }
+        _latest[header.group] = base + offset + JOURNAL_HEADER_SIZE;
+        offset += JOURNAL_HEADER_SIZE + ALIGN8(header.length);
+    }
+    return offset;
+}
+
+/**
+ * @brief Writes one group record at the write offset of the active page.
+ */
+static bool appendGroup(uint8_t group, const uint8_t *data) {
+    uint8_t *record = pageAddress(_activePage) + _writeOffset;
+    uint16_t length = _groups[group].size;
+    uint32_t bodyLength = length & ~7U;
+    uint32_t need = JOURNAL_HEADER_SIZE + ALIGN8(length);
+    JournalRecordHeader_t header;
+    uint8_t tail[8];
+
+    if ((_writeOffset + need) > NVM_JOURNAL_PAGE_SIZE || !isAreaBlank(record, need)) {
+        return false;
+    }
+
+    /* Data first, header last: the header commits the record */
+    if (bodyLength > 0 && FLASH_IF_Write(record + JOURNAL_HEADER_SIZE, data, bodyLength) != FLASH_IF_OK) {
+        return false;
+    }
+    if (bodyLength < length) {
+        memset(tail, 0xFF, sizeof(tail));
+        memcpy(tail, data + bodyLength, length - bodyLength);
+        if (FLASH_IF_Write(record + JOURNAL_HEADER_SIZE + bodyLength, tail, sizeof(tail)) != FLASH_IF_OK) {
+            return false;
+        }
+    }
+
+    header.magic = JOURNAL_RECORD_MAGIC;
+    header.group = group;
+    header.reserved = 0xFF;
+    header.length = length;
+    header.reserved2 = 0xFFFF;
+    header.crc = Crc32((uint8_t *)data, length);
+    header.reserved3 = 0xFFFFFFFF;
+    if (FLASH_IF_Write(record, &header, sizeof(header)) != FLASH_IF_OK) {
+        return false;
+    }
+
+    _latest[group] = record + JOURNAL_HEADER_SIZE;
+    _writeOffset += need;
+    return true;
+}
+
+/**
+ * @brief Erases the next page and writes every group to it, then commits the page header.
+ */
+static bool writeSnapshot(const uint8_t *nvm) {
+    uint8_t page = (_activePage == JOURNAL_NO_PAGE) ? 0 : (_activePage + 1) % NVM_JOURNAL_NUM_PAGES;
+    JournalPageHeader_t pageHeader;
+    bool complete = true;
+
+    if (FLASH_IF_Erase(pageAddress(page), NVM_JOURNAL_PAGE_SIZE) != FLASH_IF_OK) {
+        APP_LOG(TS_OFF, VLEVEL_M, "NVM Journal: erase failed \r\n");
+        return false;
+    }
+
+    /* The previous page stays valid until the new page header is written */
+    const uint8_t *previous[JOURNAL_NUM_GROUPS];
+    uint8_t previousPage = _activePage;
+    uint32_t previousOffset = _writeOffset;
+    memcpy(previous, _latest, sizeof(previous));
+
+    _activePage = page;
+    _writeOffset = JOURNAL_HEADER_SIZE;
+    for (uint8_t g = 0; g < JOURNAL_NUM_GROUPS; g++) {
+        if (!appendGroup(g, nvm + _groups[g].offset)) {
+            complete = false;
+            break;
+        }
+    }
+
+    pageHeader.magic = JOURNAL_PAGE_MAGIC;
+    pageHeader.seq = _pageSeq + 1;
+    pageHeader.seqInv = ~pageHeader.seq;
+    pageHeader.reserved = 0xFFFFFFFF;
+    if (!complete || FLASH_IF_Write(pageAddress(page), &pageHeader, sizeof(pageHeader)) != FLASH_IF_OK) {
+        APP_LOG(TS_OFF, VLEVEL_M, "NVM Journal: snapshot failed \r\n");
+        _activePage = previousPage;
+        _writeOffset = previousOffset;
+        memcpy(_latest, previous, sizeof(previous));
+        return false;
+    }
+
+    _pageSeq = pageHeader.seq;
+    return true;
+}
+
+void initNvmJournal(void) {
+    JournalPageHeader_t header;
+
+    _activePage = JOURNAL_NO_PAGE;
+    _pageSeq = 0;
+    for (uint8_t page = 0; page < NVM_JOURNAL_NUM_PAGES; page++) {
+        FLASH_IF_Read(&header, pageAddress(page), sizeof(header));
+        if (header.magic != JOURNAL_PAGE_MAGIC || header.seqInv != ~header.seq) {
+            continue;
+        }
+        if (_activePage == JOURNAL_NO_PAGE || header.seq > _pageSeq) {
+            _activePage = page;
+            _pageSeq = header.seq;
+        }
+    }
+
+    memset(_latest, 0, sizeof(_latest));
+    if (_activePage != JOURNAL_NO_PAGE) {
+        _writeOffset = replayPage(_activePage);
+        APP_LOG(TS_OFF, VLEVEL_M, "NVM Journal: page %u | seq %u | %u bytes used \r\n",
+                _activePage, _pageSeq, _writeOffset);
+    }
+}
+
+bool restoreNvmJournal(void *nvm, uint32_t nvmSize) {
+    if (_activePage == JOURNAL_NO_PAGE || nvmSize < sizeof(LoRaMacNvmData_t)) {
+        return false;
+    }
+    for (uint8_t g = 0; g < JOURNAL_NUM_GROUPS; g++) {
+        if (_latest[g] == NULL) {
+            return false;
+        }
+    }
+    for (uint8_t g = 0; g < JOURNAL_NUM_GROUPS; g++) {
+        FLASH_IF_Read((uint8_t *)nvm + _groups[g].offset, _latest[g], _groups[g].size);
+    }
+    return true;
+}
+
+bool storeNvmJournal(const void *nvm, uint32_t nvmSize) {
+    const uint8_t *image = (const uint8_t *)nvm;
+    uint8_t appended = 0;
+
+    if (nvmSize < sizeof(LoRaMacNvmData_t)) {
+        return false;
+    }
+    if (_activePage == JOURNAL_NO_PAGE) {
+        return writeSnapshot(image);
+    }
+
+    for (uint8_t g = 0; g < JOURNAL_NUM_GROUPS; g++) {
+        const uint8_t *group = image + _groups[g].offset;
+        if (_latest[g] != NULL && memcmp(_latest[g], group, _groups[g].size) == 0) {
+            continue;
+        }
+        if (!appendGroup(g, group)) {
+            /* Page full or torn area: start a new page with a full snapshot */
+            return writeSnapshot(image);
+        }
+        appended++;
+    }
+
+    APP_LOG(TS_OFF, VLEVEL_M, "NVM Journal: %u group(s) appended \r\n", appended);
+    return true;
+}
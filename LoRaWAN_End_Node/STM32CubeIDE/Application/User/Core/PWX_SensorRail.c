@@ -0,0 +1,160 @@
+/**
+ * @file PWX_SensorRail.c
+ * @brief Sensor Power-Rail Manager Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * The rails are on while at least one user holds a reference. Instead of a
+ * blind delay after power-up, the sensor is asked for a single register
+ * until it answers. The answer time feeds a running estimate, and the next
+ * power-up starts probing just before that estimate, so a sensor that is
+ * ready early is read early and the probes stay few.
+ */
+
+#include "PWX_SensorRail.h"
+#include "PWX_ClockPolicy.h"
+#include "sys_app.h"
+#include "utilities.h"
+
+/* Private Variables */
+static const uint8_t _levelSensorProbe[] = { 0x01, 0x03, 0x00, 0x03, 0x00, 0x01, 0x74, 0x0A };
+
+static const SensorRailProfile_t _profiles[SENSOR_RAIL_NUM_SENSORS] = {
+    [SENSOR_RAIL_LEVEL_SENSOR] = { _levelSensorProbe, sizeof(_levelSensorProbe), 7, 200, 1500 },
+};
+
+static uint8_t  _refCount;
+static uint32_t _powerOnTick;
+static uint8_t  _readyMask;     // bit per sensor that answered, or timed out, since power-up
+static uint16_t _learnedMs[SENSOR_RAIL_NUM_SENSORS];
+
+/* Private Function Prototypes */
+static bool probeSensor(const SensorRailProfile_t *profile, ModBus_t *modbusResponse);
+static void learnWarmUp(SensorRailSensor_t sensor, uint32_t readyMs);
+static uint32_t getFirstProbeMs(SensorRailSensor_t sensor);
+
+/**
+ * @brief Sends the probe and checks for a well-formed answer from the same slave.
+ */
+static bool probeSensor(const SensorRailProfile_t *profile, ModBus_t *modbusResponse) {
+    volatile uint16_t *rxIndex = &modbusResponse->rxIndex;
+    uint32_t start;
+    uint16_t length;
+    uint16_t crc;
+
+    sendRaw((uint8_t *)profile->probeCmd, profile->probeSize, modbusResponse);
+    start = HAL_GetTick();
+    while (*rxIndex < profile->responseSize && (HAL_GetTick() - start) < SENSOR_RAIL_PROBE_TIMEOUT_MS) {
+    }
+
+    length = *rxIndex;
+    if (length < profile->responseSize || modbusResponse->buffer[0] != profile->probeCmd[0]
+            || modbusResponse->buffer[1] != profile->probeCmd[1]) {
+        return false;
+    }
+    length = profile->responseSize - 2;
+    crc = (uint16_t)modbusResponse->buffer[length] | ((uint16_t)modbusResponse->buffer[length + 1] << 8);
+    return calculateModbusCRC(modbusResponse->buffer, length) == crc;
+}
+
+static void learnWarmUp(SensorRailSensor_t sensor, uint32_t readyMs) {
+    int32_t learned = _learnedMs[sensor];
+
+    if (learned == 0) {
+        learned = (int32_t)readyMs;
+    } else {
+        learned += ((int32_t)readyMs - learned) / (1 << SENSOR_RAIL_LEARN_SHIFT);
+    }
+    _learnedMs[sensor] = (uint16_t)((learned > 0) ? learned : 1);
+}
+
+/**
+ * @brief Probe a quarter ahead of the learned warm-up, so an early sensor pulls the estimate down.
+ */
+static uint32_t getFirstProbeMs(SensorRailSensor_t sensor) {
+    uint32_t firstProbe = _learnedMs[sensor] - (_learnedMs[sensor] / 4);
+
+    if (firstProbe < _profiles[sensor].minWarmUpMs) {
+        firstProbe = _profiles[sensor].minWarmUpMs;
+    }
+    return firstProbe;
+}
+
+void initSensorRail(void) {
+    _refCount = 0;
+    _readyMask = 0;
+    for (uint8_t s = 0; s < SENSOR_RAIL_NUM_SENSORS; s++) {
+        _learnedMs[s] = 0;
+    }
+    HAL_GPIO_WritePin(SENSOR_RAIL_PORT, SENSOR_RAIL_PINS, GPIO_PIN_RESET);
+}
+
+void acquireSensorRail(void) {
+    if (_refCount++ == 0) {
+        HAL_GPIO_WritePin(SENSOR_RAIL_PORT, SENSOR_RAIL_PINS, GPIO_PIN_SET);
+        _powerOnTick = HAL_GetTick();
+        _readyMask = 0;
+    }
+}
+
+void releaseSensorRail(void) {
+    if (_refCount == 0) {
+        return;
+    }
+    if (--_refCount == 0) {
+        HAL_GPIO_WritePin(SENSOR_RAIL_PORT, SENSOR_RAIL_PINS, GPIO_PIN_RESET);
+    }
+}
+
+bool waitSensorRailReady(SensorRailSensor_t sensor, ModBus_t *modbusResponse) {
+    const SensorRailProfile_t *profile = &_profiles[sensor];
+    uint32_t step = SENSOR_RAIL_PROBE_STEP_MS;
+    uint32_t firstProbe = getFirstProbeMs(sensor);
+    uint32_t elapsed;
+    bool isMeasured;
+
+    if (_refCount == 0) {
+        return false;
+    }
+    if (_readyMask & (1U << sensor)) {
+        return true;
+    }
+
+    /* Only delays and probes until ready, at the lowest clock */
+    requestClockLevel(CLOCK_USER_SENSOR_RAIL, CLOCK_LEVEL_LOW);
+
+    /* Work done since power-up already counts towards the warm-up */
+    elapsed = HAL_GetTick() - _powerOnTick;
+    isMeasured = (elapsed < firstProbe);
+    if (isMeasured) {
+        HAL_Delay(firstProbe - elapsed);
+    }
+
+    while (!probeSensor(profile, modbusResponse)) {
+        isMeasured = true;
+        elapsed = HAL_GetTick() - _powerOnTick;
+        if (elapsed >= profile->maxWarmUpMs) {
+            APP_LOG(TS_OFF, VLEVEL_M, "Sensor Rail: sensor %u not ready after %u ms \r\n", sensor, elapsed);
+            _readyMask |= (1U << sensor);
+            releaseClockLevel(CLOCK_USER_SENSOR_RAIL);
+            return false;
+        }
+        HAL_Delay(MIN(step, profile->maxWarmUpMs - elapsed));
+        step *= 2;
+    }
+    releaseClockLevel(CLOCK_USER_SENSOR_RAIL);
+
+    /* An answer to the first probe sent late only bounds the warm-up from above */
+    elapsed = HAL_GetTick() - _powerOnTick;
+    if (isMeasured || elapsed < _learnedMs[sensor]) {
+        learnWarmUp(sensor, elapsed);
+    }
+    _readyMask |= (1U << sensor);
+    APP_LOG(TS_OFF, VLEVEL_M, "Sensor Rail: sensor %u ready after %u ms (learned %u ms) \r\n",
+            sensor, elapsed, _learnedMs[sensor]);
+    return true;
+}
+
+uint16_t getSensorWarmUpMs(SensorRailSensor_t sensor) {
+    return _learnedMs[sensor];
+}
@@ -0,0 +1,301 @@
+/**
+ * @file PWX_TimeSync.c
+ * @brief Network Clock Sync and Time-Tagged Samples Implementation
+ * @date October 19, 2026
+ * @version 1.0
+ *
+ * The MAC applies each DeviceTimeAns with SysTimeSet(). The offset between
+ * that time and the free-running MCU time (SysTimeGetMcuTime()) is compared
+ * with the one of an earlier sync at least TIME_SYNC_MIN_DRIFT_SPAN_S away,
+ * which gives the RTC drift. Until the next answer the drift is added back to
+ * SysTimeGet(), and the request interval stretches as the drift gets smaller.
+ */
+
+#include "PWX_TimeSync.h"
+#include "CayenneLpp.h"
+#include "stm32_systime.h"
+#include "sys_app.h"
+#include "utilities.h"
+
+#define DRIFT_LIMIT_PPB     200000L     // 200 ppm, beyond that a span is considered bogus
+#define DRIFT_SHIFT         2           // EWMA weight of 1/4
+#define DRIFT_RESIDUAL_DIV  4           // compensated clock assumed to keep a quarter of the drift
+
+typedef struct {
+    uint32_t seconds;
+    uint16_t level;
+} TimedSample_t;
+
+/* Private Variables */
+static bool    _isSynced;
+static bool    _hasDrift;
+static int32_t _driftPpb;
+static int64_t _syncMcuMs;      // MCU time of the last sync
+static int64_t _syncOffsetMs;   // SysTime minus MCU time right after the last sync
+static int64_t _baseMcuMs;      // start of the span the next drift measurement covers
+static int64_t _baseOffsetMs;
+static TimedSample_t _samples[TIME_SYNC_MAX_SAMPLES];
+static uint8_t _firstSample;
+static uint8_t _numSamples;
+
+/* Private Function Prototypes */
+static inline int64_t toMs(SysTime_t time);
+static int64_t getCorrectionMs(int64_t mcuMs);
+static uint32_t getSyncIntervalSeconds(void);
+static void shiftSamples(int32_t seconds);
+static inline const TimedSample_t *getSample(uint8_t index);
+static uint8_t getSeriesRun(uint8_t first, uint16_t *step);
+static size_t getSeriesSize(uint8_t first);
+
+static inline int64_t toMs(SysTime_t time) {
+    return ((int64_t)time.Seconds * 1000) + time.SubSeconds;
+}
+
+/**
+ * @brief Drift accumulated since the last sync, in ms.
+ */
+static int64_t getCorrectionMs(int64_t mcuMs) {
+    if (!_hasDrift) {
+        return 0;
+    }
+    return ((mcuMs - _syncMcuMs) * _driftPpb) / 1000000000LL;
+}
+
+static uint32_t getSyncIntervalSeconds(void) {
+    uint32_t residualPpb;
+    uint32_t interval;
+
+    if (!_hasDrift) {
+        return TIME_SYNC_MIN_INTERVAL_S;
+    }
+    residualPpb = (uint32_t)((_driftPpb < 0) ? -_driftPpb : _driftPpb) / DRIFT_RESIDUAL_DIV;
+    if (residualPpb == 0) {
+        return TIME_SYNC_MAX_INTERVAL_S;
+    }
+
+    /* error (ms) = interval (s) * residual (ppb) / 10^6 */
+    interval = (uint32_t)(((uint64_t)TIME_SYNC_TOLERANCE_MS * 1000000ULL) / residualPpb);
+    if (interval < TIME_SYNC_MIN_INTERVAL_S) {
+        return TIME_SYNC_MIN_INTERVAL_S;
+    }
+    return (interval > TIME_SYNC_MAX_INTERVAL_S) ? TIME_SYNC_MAX_INTERVAL_S : interval;
+}
+
+/**
+ * @brief Moves the recorded samples by the step the sync applied, so they stay in the new time base.
+ */
+static void shiftSamples(int32_t seconds) {
+    for (uint8_t i = 0; i < _numSamples; i++) {
+        TimedSample_t *sample = &_samples[(_firstSample + i) % TIME_SYNC_MAX_SAMPLES];
+        sample->seconds += (uint32_t)seconds;
+    }
+}
+
+void initTimeSync(void) {
+    int64_t mcuMs = toMs(SysTimeGetMcuTime());
+
+    _isSynced = false;
+    _hasDrift = false;
+    _driftPpb = 0;
+    _syncMcuMs = mcuMs;
+    _syncOffsetMs = toMs(SysTimeGet()) - mcuMs;
+    _baseMcuMs = _syncMcuMs;
+    _baseOffsetMs = _syncOffsetMs;
+    clearTimedSamples();
+}
+
+void timeSyncOnUpdate(void) {
+    int64_t mcuMs = toMs(SysTimeGetMcuTime());
+    int64_t offsetMs = toMs(SysTimeGet()) - mcuMs;
+    int64_t stepMs = offsetMs - (_syncOffsetMs + getCorrectionMs(mcuMs));
+    int64_t spanMs = mcuMs - _baseMcuMs;
+
+    shiftSamples((int32_t)(stepMs / 1000));
+
+    if (!_isSynced) {
+        /* First answer: nothing to measure the drift against yet */
+        _baseMcuMs = mcuMs;
+        _baseOffsetMs = offsetMs;
+    } else if (spanMs >= ((int64_t)TIME_SYNC_MIN_DRIFT_SPAN_S * 1000)) {
+        int64_t measured = ((offsetMs - _baseOffsetMs) * 1000000000LL) / spanMs;
+        if (measured > -DRIFT_LIMIT_PPB && measured < DRIFT_LIMIT_PPB) {
+            if (_hasDrift) {
+                _driftPpb += ((int32_t)measured - _driftPpb) / (1 << DRIFT_SHIFT);
+            } else {
+                _driftPpb = (int32_t)measured;
+                _hasDrift = true;
+            }
+        }
+        _baseMcuMs = mcuMs;
+        _baseOffsetMs = offsetMs;
+    }
+
+    /* The first step is the whole epoch offset, too large for an int32 in ms */
+    APP_LOG(TS_OFF, VLEVEL_M, "Time Sync: step %c%u.%03u s | drift %d ppb | next in %u s \r\n",
+            (stepMs < 0) ? '-' : '+', (uint32_t)(((stepMs < 0) ? -stepMs : stepMs) / 1000),
+            (uint32_t)(((stepMs < 0) ? -stepMs : stepMs) % 1000), _driftPpb, getSyncIntervalSeconds());
+    _syncMcuMs = mcuMs;
+    _syncOffsetMs = offsetMs;
+    _isSynced = true;
+}
+
+bool isTimeSyncDue(void) {
+    int64_t elapsedMs;
+
+    if (!_isSynced) {
+        return true;
+    }
+    elapsedMs = toMs(SysTimeGetMcuTime()) - _syncMcuMs;
+    return (elapsedMs / 1000) >= getSyncIntervalSeconds();
+}
+
+bool isTimeSynced(void) {
+    return _isSynced;
+}
+
+uint32_t getSyncedSeconds(void) {
+    int64_t mcuMs = toMs(SysTimeGetMcuTime());
+
+    return (uint32_t)((toMs(SysTimeGet()) + getCorrectionMs(mcuMs)) / 1000);
+}
+
+int32_t getTimeSyncDriftPpb(void) {
+    return _driftPpb;
+}
+
+void recordTimedSample(uint16_t level) {
+    TimedSample_t *sample;
+
+    if (_numSamples == TIME_SYNC_MAX_SAMPLES) {
+        _firstSample = (_firstSample + 1) % TIME_SYNC_MAX_SAMPLES;
+        _numSamples--;
+    }
+    sample = &_samples[(_firstSample + _numSamples) % TIME_SYNC_MAX_SAMPLES];
+    sample->seconds = getSyncedSeconds();
+    sample->level = level;
+    _numSamples++;
+}
+
+void clearTimedSamples(void) {
+    _firstSample = 0;
+    _numSamples = 0;
+}
+
+size_t buildTimedSampleBlock(uint8_t *destination, size_t maxSize) {
+    const TimedSample_t *newest;
+    uint8_t count;
+    uint8_t start;
+    uint32_t base;
+    size_t index = 0;
+
+    if (_numSamples == 0 || maxSize < (TIME_SYNC_BLOCK_HEADER_SIZE + TIME_SYNC_BLOCK_RECORD_SIZE)) {
+        return 0;
+    }
+
+    /* Newest samples that fit, within the u16 reach of the base time */
+    count = (uint8_t)MIN((size_t)_numSamples, (maxSize - TIME_SYNC_BLOCK_HEADER_SIZE) / TIME_SYNC_BLOCK_RECORD_SIZE);
+    start = _numSamples - count;
+    newest = &_samples[(_firstSample + _numSamples - 1) % TIME_SYNC_MAX_SAMPLES];
+    while (count > 1 && (int32_t)(newest->seconds - _samples[(_firstSample + start) % TIME_SYNC_MAX_SAMPLES].seconds) > UINT16_MAX) {
+        start++;
+        count--;
+    }
+    base = _samples[(_firstSample + start) % TIME_SYNC_MAX_SAMPLES].seconds;
+
+    destination[index++] = (uint8_t)(base >> 24);
+    destination[index++] = (uint8_t)(base >> 16);
+    destination[index++] = (uint8_t)(base >> 8);
+    destination[index++] = (uint8_t)base;
+    destination[index++] = _isSynced ? TIME_SYNC_FLAG_SYNCED : 0;
+    destination[index++] = count;
+    for (uint8_t i = start; i < _numSamples; i++) {
+        const TimedSample_t *sample = &_samples[(_firstSample + i) % TIME_SYNC_MAX_SAMPLES];
+        int32_t delta = (int32_t)(sample->seconds - base);
+        uint16_t offset = (delta < 0) ? 0 : (uint16_t)delta;
+
+        destination[index++] = (uint8_t)(offset >> 8);
+        destination[index++] = (uint8_t)offset;
+        destination[index++] = (uint8_t)(sample->level >> 8);
+        destination[index++] = (uint8_t)sample->level;
+    }
+    return index;
+}
+
+static inline const TimedSample_t *getSample(uint8_t index) {
+    return &_samples[(_firstSample + index) % TIME_SYNC_MAX_SAMPLES];
+}
+
+/**
+ * @brief Longest run from a sample on a regular grid, the step re-fitted as the run grows.
+ */
+static uint8_t getSeriesRun(uint8_t first, uint16_t *step) {
+    uint32_t base = getSample(first)->seconds;
+    uint8_t count = 1;
+
+    *step = 0;
+    while ((first + count) < _numSamples) {
+        uint32_t span = getSample(first + count)->seconds - base;
+        uint32_t candidate = (span + (count / 2)) / count;
+        bool isOnGrid = (candidate > 0 && candidate <= UINT16_MAX);
+
+        for (uint8_t i = 1; isOnGrid && i <= count; i++) {
+            int32_t error = (int32_t)(getSample(first + i)->seconds - (base + (i * candidate)));
+            isOnGrid = (error >= -TIME_SYNC_SERIES_JITTER_S && error <= TIME_SYNC_SERIES_JITTER_S);
+        }
+        if (!isOnGrid) {
+            break;
+        }
+        *step = (uint16_t)candidate;
+        count++;
+    }
+    return count;
+}
+
+static size_t getSeriesSize(uint8_t first) {
+    size_t size = 0;
+    uint16_t step;
+
+    while (first < _numSamples) {
+        uint8_t count = getSeriesRun(first, &step);
+        size += CAYENNE_LPP_ANALOG_SERIES_SIZE(count);
+        first += count;
+    }
+    return size;
+}
+
+size_t buildTimedSampleSeries(uint8_t *destination, size_t maxSize) {
+    int16_t values[TIME_SYNC_MAX_SAMPLES];
+    uint8_t channel = _isSynced ? TIME_SYNC_SERIES_CHANNEL : TIME_SYNC_SERIES_CHANNEL_UNSYNCED;
+    uint8_t first = 0;
+
+    /* Newest samples that fit, a dropped sample can also merge or split the runs */
+    while (first < _numSamples && getSeriesSize(first) > maxSize) {
+        first++;
+    }
+    if (first == _numSamples) {
+        return 0;
+    }
+
+    CayenneLppReset();
+    while (first < _numSamples) {
+        uint16_t step;
+        uint8_t count = getSeriesRun(first, &step);
+
+        for (uint8_t i = 0; i < count; i++) {
+            values[i] = (int16_t)getSample(first + i)->level;
+        }
+        if (CayenneLppAddAnalogInputSeries(channel, getSample(first)->seconds, step, values, count) == 0) {
+            return 0;
+        }
+        first += count;
+    }
+    return CayenneLppCopy(destination);
+}
+
+void printTimeSync(void) {
+    int64_t elapsedMs = toMs(SysTimeGetMcuTime()) - _syncMcuMs;
+
+    APP_LOG(TS_OFF, VLEVEL_M, "Time Sync: %s | drift %d ppb | %u s since sync, interval %u s | %u sample(s) \r\n",
+            _isSynced ? "synced" : "not synced", _driftPpb, (uint32_t)(elapsedMs / 1000),
+            getSyncIntervalSeconds(), _numSamples);
+}
@@ -23,6 +23,8 @@
 /* Includes */
 #include <errno.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include "PWX_MemWatch.h"
 
 /**
  * Pointer to the current high watermark of the heap usage
@@ -69,11 +71,13 @@ void *_sbrk(ptrdiff_t incr)
   if (__sbrk_heap_end + incr > max_heap)
   {
     errno = ENOMEM;
+    memWatchOnSbrk(__sbrk_heap_end, true);
     return (void *)-1;
   }
 
   prev_heap_end = __sbrk_heap_end;
   __sbrk_heap_end += incr;
+  memWatchOnSbrk(__sbrk_heap_end, false);
 
   return (void *)prev_heap_end;
 }
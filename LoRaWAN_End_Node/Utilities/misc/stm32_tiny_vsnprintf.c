@@ -191,6 +191,43 @@ static char *ee_number(char *str, int max_size, long num, int base, int size, in
   return str;
 }
 
+/* Fixed point: num is the value x 10^precision, printed as <int>.<frac> */
+static char *ee_fixed(char *str, int max_size, long num, int size, int precision, int type)
+{
+  char tmp[24];
+  unsigned long mag;
+  int i = 0;
+  int n;
+
+  if (precision < 0) precision = 2;
+  if (precision > 9) precision = 9;
+
+  /* Negated as unsigned, so that INT_MIN does not overflow with a 32-bit long */
+  mag = (num < 0) ? (0UL - (unsigned long)num) : (unsigned long)num;
+
+  /* Digits are built in reverse: fraction first, then the integer part */
+  for (n = 0; n < precision; n++)
+  {
+    tmp[i++] = lower_digits[mag % 10];
+    mag /= 10;
+  }
+  if (precision > 0) tmp[i++] = '.';
+  do
+  {
+    tmp[i++] = lower_digits[mag % 10];
+    mag /= 10;
+  } while (mag != 0);
+
+  size -= i;
+  if (num < 0) size--;
+  if (!(type & ZEROPAD)) while (size-- > 0) ASSIGN_STR(' ');
+  if (num < 0) ASSIGN_STR('-');
+  while (size-- > 0) ASSIGN_STR('0');
+  while (i-- > 0) ASSIGN_STR(tmp[i]);
+
+  return str;
+}
+
 #ifdef TINY_PRINTF
 #else
 static char *eaddr(char *str, unsigned char *addr, int size, int precision, int type)
@@ -556,7 +593,15 @@ repeat:
     // Get the precision
     precision = -1;
 #ifdef TINY_PRINTF
-    /* Does not support %. */
+    /* Only supports %.<digits>, used by %q */
+    if (*fmt == '.')
+    {
+      ++fmt;
+      if (is_digit(*fmt))
+        precision = ee_skip_atoi(&fmt);
+      else
+        precision = 0;
+    }
 #else
     if (*fmt == '.')
     {
@@ -661,6 +706,10 @@ repeat:
       case 'u':
         break;
 
+      case 'q':
+        str = ee_fixed(str, ((size - 1) - (str - buf)), (long)va_arg(args, int), field_width, precision, flags);
+        continue;
+
 #ifdef HAS_FLOAT
 
       case 'f':
@@ -29,6 +29,13 @@ extern "C"
 #include <string.h>
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
+/* Exported macros -----------------------------------------------------------*/
+/**
+ * @brief  Converts a float to the integer expected by %q, rounded to nearest.
+ *         _scale must match the %q precision, e.g. FIXED_POINT(v, 1000) with "%.3q"
+ */
+#define FIXED_POINT(_val, _scale)  ((int)(((_val) * (_scale)) + (((_val) < 0) ? -0.5f : 0.5f)))
+
 /* External variables --------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 
@@ -37,8 +44,10 @@ extern "C"
  *
  *         It has been adapted so that:
  *         - Tiny implementation, when defining TINY_PRINTF, is available. In such as case,
- *           not all the format are available. Instead, only %02X, %x, %d, %u, %s and %c are available.
+ *           not all the format are available. Instead, only %02X, %x, %d, %u, %s, %c and %q are available.
  *           %f,, %+, %#, %- and others are excluded
+ *         - %q prints a fixed point value: the int argument is the value x 10^precision,
+ *           "%.3q" with 12345 prints "12.345" (default precision is 2)
  *         - Provide a snprintf like implementation. The size of the buffer is provided,
  *           and the length of the filled buffer is returned (not including the final '\0' char).
  *         The string may be truncated
@@ -108,6 +108,13 @@ typedef struct
 #define UTIL_SEQ_MEMSET8( dest, value, size )   UTILS_MEMSET8( dest, value, size )
 #endif
 
+/**
+ * @brief hook called after each task returns, none by default.
+ */
+#ifndef UTIL_SEQ_POST_TASK_HOOK
+#define UTIL_SEQ_POST_TASK_HOOK( task_id )
+#endif
+
 /**
  * @}
  */
@@ -288,6 +295,7 @@ void UTIL_SEQ_Run( UTIL_SEQ_bm_t Mask_bm )
 
     /* Execute the task */
     TaskCb[CurrentTaskIdx]( );
+    UTIL_SEQ_POST_TASK_HOOK( CurrentTaskIdx );
 
     local_taskset = TaskSet;
     local_evtset = EvtSet;
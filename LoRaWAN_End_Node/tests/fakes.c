@@ -0,0 +1,459 @@
+/**
+ * @file fakes.c
+ * @brief Host stand-ins for the hardware and the stack around the tested modules
+ */
+
+#include "fakes.h"
+#include "usart.h"
+#include "stm32_adv_trace.h"
+#include "stm32_timer.h"
+#include "LmHandler.h"
+#include "LoRaMacCrypto.h"
+#include "utilities.h"
+#include "subghz.h"
+#include "radio_board_if.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+uint32_t fakeTickMs;
+uint32_t fakeTickStepMs;
+SysTime_t fakeSysTime;
+SysTime_t fakeMcuTime;
+
+struct ModbusDevice fakeDevices[NUM_DEVICES];
+SecureElementNvmData_t fakeConfigPage;
+uint32_t fakeFlashWrites;
+bool fakeFlashFails;
+uint32_t fakeFlashPrograms;
+uint32_t fakeFlashFastRows;
+uint32_t fakeFlashErases;
+int32_t fakePowerBudget = -1;
+jmp_buf fakePowerLoss;
+static bool flashLocked = true;
+static uint8_t pageBuffer[FLASH_PAGE_SIZE];
+
+uint32_t fakeUartInits;
+
+uint32_t fakeSubghzCommands[256];
+uint32_t fakeSubghzRegisterWrites;
+
+uint16_t fakeGpioA;
+uint16_t (*fakeModbusSlave)(const uint8_t *request, uint16_t size, uint8_t *response);
+static ModBus_t *modbusReception;
+uint8_t *fakeConsoleRx;
+
+uint8_t fakeSentBuffer[256];
+uint8_t fakeSentSize;
+uint8_t fakeSentPort;
+
+/* Firmware globals the modules link against */
+UART_HandleTypeDef huart1;
+SUBGHZ_HandleTypeDef hsubghz;
+ModBus_t ModbusResp;
+/* Weak, as is buildDataToSend(): a test linking PWX_ModbusDevice.c gets the real pages */
+__attribute__((weak)) const void *ModbusDeviceFlashAddresses[NUM_DEVICES] = {
+    &fakeDevices[0],  &fakeDevices[1],  &fakeDevices[2],  &fakeDevices[3],
+    &fakeDevices[4],  &fakeDevices[5],  &fakeDevices[6],  &fakeDevices[7],
+    &fakeDevices[8],  &fakeDevices[9],  &fakeDevices[10], &fakeDevices[11],
+    &fakeDevices[12], &fakeDevices[13], &fakeDevices[14], &fakeDevices[15],
+};
+
+/* Target memory at the addresses the firmware casts to uint32_t */
+__attribute__((constructor)) static void mapTargetMemory(void) {
+    const struct {
+        uintptr_t base;
+        size_t size;
+    } areas[] = {
+        { FAKE_FLASH_BASE,                        FAKE_FLASH_SIZE },
+        { SRAM1_BASE,                        0x10000 },
+        { FLASH_REG_BASE,                    0x1000 },
+        { ENGI_BYTES_BASE & ~0xFFFUL,        0x1000 },
+        { PWR_BASE & ~0xFFFUL,               0x1000 },
+        { DWT_BASE,                          0x1000 },
+        { SCS_BASE,                          0x1000 },
+    };
+
+    for (uint8_t i = 0; i < sizeof(areas) / sizeof(areas[0]); i++) {
+        if (mmap((void *)areas[i].base, areas[i].size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != (void *)areas[i].base) {
+            fprintf(stderr, "cannot map target memory at 0x%08lx\n", (unsigned long)areas[i].base);
+            abort();
+        }
+    }
+    *(uint16_t *)FLASHSIZE_BASE = FAKE_FLASH_SIZE >> 10;
+    memset((void *)FAKE_FLASH_BASE, 0xFF, FAKE_FLASH_SIZE);
+}
+
+void fakeReset(void) {
+    fakeTickMs = 0;
+    fakeTickStepMs = 0;
+    memset(&fakeSysTime, 0, sizeof(fakeSysTime));
+    memset(&fakeMcuTime, 0, sizeof(fakeMcuTime));
+    memset(fakeDevices, 0, sizeof(fakeDevices));
+    memset(&fakeConfigPage, 0, sizeof(fakeConfigPage));
+    fakeFlashWrites = 0;
+    fakeFlashFails = false;
+    memset((void *)FAKE_FLASH_BASE, 0xFF, FAKE_FLASH_SIZE);
+    fakeFlashPrograms = 0;
+    fakeFlashFastRows = 0;
+    fakeFlashErases = 0;
+    fakePowerBudget = -1;
+    flashLocked = true;
+    fakeGpioA = 0;
+    fakeUartInits = 0;
+    fakeModbusSlave = NULL;
+    modbusReception = NULL;
+    fakeConsoleRx = NULL;
+    memset(fakeSubghzCommands, 0, sizeof(fakeSubghzCommands));
+    fakeSubghzRegisterWrites = 0;
+    fakeSentSize = 0;
+    fakeSentPort = 0;
+}
+
+/* The config page is the only flash address that is not already a RAM page */
+static void *translate(const void *address) {
+    return (address == LORAWAN_NVM_BASE_ADDRESS) ? (void *)&fakeConfigPage : (void *)address;
+}
+
+uint32_t HAL_GetTick(void) {
+    fakeTickMs += fakeTickStepMs;
+    return fakeTickMs;
+}
+
+void Error_Handler(void) {
+    fprintf(stderr, "Error_Handler() called\n");
+    abort();
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) {
+    fakeUartInits++;
+    return HAL_OK;
+}
+
+void HAL_Delay(uint32_t Delay) {
+    fakeTickMs += Delay;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    if (GPIOx == GPIOA) {
+        fakeGpioA = (PinState == GPIO_PIN_SET) ? (fakeGpioA | GPIO_Pin) : (fakeGpioA & ~GPIO_Pin);
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    if (fakeModbusSlave != NULL && modbusReception != NULL) {
+        modbusReception->rxIndex = fakeModbusSlave(pData, Size, modbusReception->buffer);
+        modbusReception = NULL;
+    }
+    return HAL_OK;
+}
+
+/* sendRaw() arms the reception into the buffer of its ModBus_t, the console its one character */
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) {
+    if (huart->Instance == LPUART1) {
+        fakeConsoleRx = pData;
+        return HAL_OK;
+    }
+    modbusReception = (ModBus_t *)(pData - offsetof(ModBus_t, buffer));
+    return HAL_OK;
+}
+
+__attribute__((weak)) size_t buildDataToSend(uint8_t *destination, uint8_t *source, size_t sourceSize, uint8_t desStartIndex) {
+    memcpy(&destination[desStartIndex], source, sourceSize);
+    return desStartIndex + sourceSize;
+}
+
+static bool inFlash(const void *address) {
+    return ((uintptr_t)address >= FAKE_FLASH_BASE) && ((uintptr_t)address < (FAKE_FLASH_BASE + FAKE_FLASH_SIZE))
+           && (address != LORAWAN_NVM_BASE_ADDRESS);
+}
+
+/* The STM32WL program rule, false for what the hardware reports as PROGERR */
+static bool programDoubleWord(uintptr_t address, uint64_t data) {
+    uint64_t *word = (uint64_t *)address;
+
+    if ((address % 8) != 0 || !inFlash(word) || (*word != UINT64_MAX && data != 0)) {
+        return false;
+    }
+    if (fakePowerBudget == 0) {
+        *word &= data | 0xFFFFFFFF00000000ULL;
+        longjmp(fakePowerLoss, 1);
+    }
+    if (fakePowerBudget > 0) {
+        fakePowerBudget--;
+    }
+    *word = data;
+    fakeFlashPrograms++;
+    return true;
+}
+
+static void erasePage(uint32_t page) {
+    uint8_t *address = (uint8_t *)FAKE_FLASH_BASE + (page * FLASH_PAGE_SIZE);
+
+    if (fakePowerBudget == 0) {
+        memset(address, 0xFF, FLASH_PAGE_SIZE / 2);
+        longjmp(fakePowerLoss, 1);
+    }
+    if (fakePowerBudget > 0) {
+        fakePowerBudget--;
+    }
+    memset(address, 0xFF, FLASH_PAGE_SIZE);
+    fakeFlashErases++;
+}
+
+static bool isBlank(const uint8_t *address, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (address[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Programs the double words that are not left erased, as FLASH_IF_INT_Program() does */
+static bool programArea(uint8_t *destination, const uint8_t *source, uint32_t length) {
+    uint64_t data;
+
+    for (uint32_t i = 0; i < length; i += 8) {
+        memcpy(&data, &source[i], sizeof(data));
+        if (data != UINT64_MAX && !programDoubleWord((uintptr_t)&destination[i], data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+    flashLocked = false;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+    flashLocked = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data) {
+    if (flashLocked) {
+        return HAL_ERROR;
+    }
+    if (TypeProgram == FLASH_TYPEPROGRAM_FAST) {
+        const uint64_t *row = (const uint64_t *)(uintptr_t)(uint32_t)Data;
+
+        if ((Address % 256) != 0) {
+            return HAL_ERROR;
+        }
+        for (uint32_t i = 0; i < 32; i++) {
+            if (!programDoubleWord(Address + (i * 8), row[i])) {
+                return HAL_ERROR;
+            }
+        }
+        fakeFlashFastRows++;
+        return HAL_OK;
+    }
+    return programDoubleWord(Address, Data) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError) {
+    if (flashLocked || (pEraseInit->Page + pEraseInit->NbPages) > (FAKE_FLASH_SIZE / FLASH_PAGE_SIZE)) {
+        return HAL_ERROR;
+    }
+    for (uint32_t page = pEraseInit->Page; page < pEraseInit->Page + pEraseInit->NbPages; page++) {
+        erasePage(page);
+    }
+    *PageError = 0xFFFFFFFFUL;
+    return HAL_OK;
+}
+
+__attribute__((weak)) FLASH_IF_StatusTypedef FLASH_IF_Read(void *pDestination, const void *pSource, uint32_t uLength) {
+    memcpy(pDestination, translate(pSource), uLength);
+    return FLASH_IF_OK;
+}
+
+/* Same result as flash_if.c: a page that is not blank where written is erased and rewritten */
+__attribute__((weak)) FLASH_IF_StatusTypedef FLASH_IF_Write(void *pDestination, const void *pSource, uint32_t uLength) {
+    uint8_t *destination = (uint8_t *)pDestination;
+    const uint8_t *source = (const uint8_t *)pSource;
+
+    if (fakeFlashFails) {
+        return FLASH_IF_WRITE_ERROR;
+    }
+    fakeFlashWrites++;
+    if (!inFlash(pDestination)) {
+        memcpy(translate(pDestination), pSource, uLength);
+        return FLASH_IF_OK;
+    }
+    if (((uintptr_t)destination % 8) != 0 || (uLength % 8) != 0) {
+        return FLASH_IF_PARAM_ERROR;
+    }
+
+    while (uLength > 0) {
+        uint32_t offset = ((uintptr_t)destination - FAKE_FLASH_BASE) % FLASH_PAGE_SIZE;
+        uint32_t length = MIN(uLength, FLASH_PAGE_SIZE - offset);
+        uint8_t *page = destination - offset;
+
+        if (isBlank(destination, length)) {
+            if (!programArea(destination, source, length)) {
+                return FLASH_IF_WRITE_ERROR;
+            }
+        } else {
+            memcpy(pageBuffer, page, FLASH_PAGE_SIZE);
+            memcpy(&pageBuffer[offset], source, length);
+            erasePage(((uintptr_t)page - FAKE_FLASH_BASE) / FLASH_PAGE_SIZE);
+            if (!programArea(page, pageBuffer, FLASH_PAGE_SIZE)) {
+                return FLASH_IF_WRITE_ERROR;
+            }
+        }
+        destination += length;
+        source += length;
+        uLength -= length;
+    }
+    return FLASH_IF_OK;
+}
+
+__attribute__((weak)) FLASH_IF_StatusTypedef FLASH_IF_DiffWrite(void *pDestination, const void *pSource, uint32_t uLength) {
+    return FLASH_IF_Write(pDestination, pSource, uLength);
+}
+
+__attribute__((weak)) FLASH_IF_StatusTypedef FLASH_IF_Erase(void *pStart, uint32_t uLength) {
+    if (fakeFlashFails) {
+        return FLASH_IF_ERASE_ERROR;
+    }
+    if (inFlash(pStart) && uLength > 0) {
+        uint32_t first = ((uintptr_t)pStart - FAKE_FLASH_BASE) / FLASH_PAGE_SIZE;
+        uint32_t last = ((uintptr_t)pStart + uLength - 1 - FAKE_FLASH_BASE) / FLASH_PAGE_SIZE;
+
+        for (uint32_t page = first; page <= last; page++) {
+            erasePage(page);
+        }
+    }
+    return FLASH_IF_OK;
+}
+
+SysTime_t SysTimeGet(void) {
+    return fakeSysTime;
+}
+
+SysTime_t SysTimeGetMcuTime(void) {
+    return fakeMcuTime;
+}
+
+UTIL_ADV_TRACE_Status_t UTIL_ADV_TRACE_COND_FSend(uint32_t VerboseLevel, uint32_t Region, uint32_t TimeStampState,
+                                                  const char *strFormat, ...) {
+    return UTIL_ADV_TRACE_OK;
+}
+
+/* Weak: a test linking stm32_timer.c runs the real timer list on its own UTIL_TimerDriver */
+__attribute__((weak)) UTIL_TIMER_Status_t UTIL_TIMER_Create(UTIL_TIMER_Object_t *TimerObject, uint32_t PeriodValue, UTIL_TIMER_Mode_t Mode,
+                                      void (*Callback)(void *), void *Argument) {
+    memset(TimerObject, 0, sizeof(*TimerObject));
+    return UTIL_TIMER_OK;
+}
+
+__attribute__((weak)) UTIL_TIMER_Status_t UTIL_TIMER_Start(UTIL_TIMER_Object_t *TimerObject) {
+    TimerObject->IsRunning = 1;
+    return UTIL_TIMER_OK;
+}
+
+__attribute__((weak)) UTIL_TIMER_Status_t UTIL_TIMER_SetPeriod(UTIL_TIMER_Object_t *TimerObject, uint32_t NewPeriodValue) {
+    return UTIL_TIMER_OK;
+}
+
+__attribute__((weak)) UTIL_TIMER_Time_t UTIL_TIMER_GetCurrentTime(void) {
+    return fakeTickMs;
+}
+
+__attribute__((weak)) UTIL_TIMER_Time_t UTIL_TIMER_GetElapsedTime(UTIL_TIMER_Time_t past) {
+    return fakeTickMs - past;
+}
+
+__attribute__((weak)) UTIL_TIMER_Status_t UTIL_TIMER_Stop(UTIL_TIMER_Object_t *TimerObject) {
+    TimerObject->IsRunning = 0;
+    return UTIL_TIMER_OK;
+}
+
+/* Sub-GHz radio: commands and writes are only counted, reads return 0 */
+void MX_SUBGHZ_Init(void) {
+}
+
+HAL_StatusTypeDef HAL_SUBGHZ_ExecSetCmd(SUBGHZ_HandleTypeDef *hsubghz, SUBGHZ_RadioSetCmd_t Command, uint8_t *pBuffer,
+                                        uint16_t Size) {
+    fakeSubghzCommands[(uint8_t)Command]++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SUBGHZ_ExecGetCmd(SUBGHZ_HandleTypeDef *hsubghz, SUBGHZ_RadioGetCmd_t Command, uint8_t *pBuffer,
+                                        uint16_t Size) {
+    memset(pBuffer, 0, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SUBGHZ_WriteBuffer(SUBGHZ_HandleTypeDef *hsubghz, uint8_t Offset, uint8_t *pBuffer,
+                                         uint16_t Size) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SUBGHZ_ReadBuffer(SUBGHZ_HandleTypeDef *hsubghz, uint8_t Offset, uint8_t *pBuffer,
+                                        uint16_t Size) {
+    memset(pBuffer, 0, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SUBGHZ_WriteRegisters(SUBGHZ_HandleTypeDef *hsubghz, uint16_t Address, uint8_t *pBuffer,
+                                            uint16_t Size) {
+    fakeSubghzRegisterWrites++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SUBGHZ_ReadRegisters(SUBGHZ_HandleTypeDef *hsubghz, uint16_t Address, uint8_t *pBuffer,
+                                           uint16_t Size) {
+    memset(pBuffer, 0, Size);
+    return HAL_OK;
+}
+
+int32_t RBI_Init(void) {
+    return 0;
+}
+
+int32_t RBI_ConfigRFSwitch(RBI_Switch_TypeDef Config) {
+    return 0;
+}
+
+int32_t RBI_GetTxConfig(void) {
+    return RBI_CONF_RFO_LP_HP;
+}
+
+int32_t RBI_IsTCXO(void) {
+    return 1;
+}
+
+int32_t RBI_IsDCDC(void) {
+    return 1;
+}
+
+int32_t RBI_GetRFOMaxPowerConfig(RBI_RFOMaxPowerConfig_TypeDef Config) {
+    return (Config == RBI_RFO_LP_MAXPOWER) ? 15 : 22;
+}
+
+TimerTime_t LmHandlerGetDutyCycleWaitTime(void) {
+    return 0;
+}
+
+LmHandlerErrorStatus_t LmHandlerSend(LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                     bool allowDelayedTx) {
+    memcpy(fakeSentBuffer, appData->Buffer, appData->BufferSize);
+    fakeSentSize = appData->BufferSize;
+    fakeSentPort = appData->Port;
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+uint32_t fakeDataBlockCode(const uint8_t *buffer, uint32_t size, uint16_t sessionCnt, uint32_t descriptor) {
+    return Crc32((uint8_t *)buffer, (uint16_t)size) ^ ((uint32_t)sessionCnt << 16) ^ descriptor;
+}
+
+LoRaMacCryptoStatus_t LoRaMacCryptoComputeDataBlock(uint8_t *buffer, uint32_t size, uint16_t sessionCnt,
+                                                    uint8_t fragIndex, uint32_t descriptor, uint32_t *cmac) {
+    *cmac = fakeDataBlockCode(buffer, size, sessionCnt, descriptor);
+    return LORAMAC_CRYPTO_SUCCESS;
+}
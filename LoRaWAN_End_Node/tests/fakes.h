@@ -0,0 +1,100 @@
+/**
+ * @file fakes.h
+ * @brief Host stand-ins for the hardware and the stack around the tested modules
+ *
+ * The Modbus device pages are fakeDevices[], unless PWX_ModbusDevice.c is
+ * linked, and the config page at LORAWAN_NVM_BASE_ADDRESS is fakeConfigPage,
+ * both plain RAM. The rest of the flash behaves like NOR flash at its real
+ * address. Time only moves when a test moves it, or by fakeTickStepMs on
+ * every HAL_GetTick() for busy waits. The UTIL_TIMER_* fakes only flag a
+ * timer as running; they are weak, for tests that link stm32_timer.c. The
+ * PWR registers and the DWT/SCS core pages are plain memory.
+ */
+
+#ifndef TESTS_FAKES_H_
+#define TESTS_FAKES_H_
+
+#undef NDEBUG                   /* the checks below call the code under test */
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <setjmp.h>
+
+#include "project_config.h"
+#include "stm32_systime.h"
+
+/* HAL_GetTick() and UTIL_TIMER_GetCurrentTime(), in ms */
+extern uint32_t fakeTickMs;
+extern uint32_t fakeTickStepMs;
+
+/* SysTimeGet() and SysTimeGetMcuTime() */
+extern SysTime_t fakeSysTime;
+extern SysTime_t fakeMcuTime;
+
+/* Flash pages */
+extern struct ModbusDevice fakeDevices[NUM_DEVICES];
+extern SecureElementNvmData_t fakeConfigPage;
+extern uint32_t fakeFlashWrites;        // FLASH_IF_Write() and FLASH_IF_DiffWrite() calls
+extern bool fakeFlashFails;             // every write fails while set
+
+/*
+ * Flash main memory mapped at its real address: erased bytes read 0xFF and a
+ * double word can only be programmed while erased, or cleared to 0. The
+ * FLASH_IF_* fakes are weak, tests that link the real flash_if.c get the same
+ * memory through HAL_FLASH_Program() and HAL_FLASHEx_Erase(). SRAM1/SRAM2 are
+ * mapped too, for buffers whose address flash_if.c keeps in a uint32_t.
+ */
+#define FAKE_FLASH_BASE         0x08000000UL    // FLASH_BASE, LoRaMacCrypto.h redefines it
+#define FAKE_FLASH_SIZE         0x40000UL
+extern uint32_t fakeFlashPrograms;      // double words programmed
+extern uint32_t fakeFlashFastRows;      // FLASH_TYPEPROGRAM_FAST rows
+extern uint32_t fakeFlashErases;        // pages erased
+
+/*
+ * Flash operations left before power is lost, -1 for no limit. A double word
+ * being programmed at that moment keeps only its first word, a page being
+ * erased only its first half, then fakePowerLoss is longjmp()'ed to.
+ */
+extern int32_t fakePowerBudget;
+extern jmp_buf fakePowerLoss;
+
+/* GPIOA output pins set, the sensor rails are PA6/PA7 */
+extern uint16_t fakeGpioA;
+
+/* USART1 */
+extern uint32_t fakeUartInits;          // HAL_UART_Init() calls
+
+/* LPUART1 console: where the armed reception stores its character, NULL while none is armed */
+extern uint8_t *fakeConsoleRx;
+
+/*
+ * Modbus slave: a frame transmitted while a reception is armed is handed to
+ * fakeModbusSlave, its answer lands in the ModBus_t sendRaw() armed, as
+ * Modbus_RxCallback() would store it. Without a slave the bus stays silent.
+ */
+extern uint16_t (*fakeModbusSlave)(const uint8_t *request, uint16_t size, uint8_t *response);
+
+/* Sub-GHz radio: HAL_SUBGHZ_ExecSetCmd() calls per opcode, register writes */
+extern uint32_t fakeSubghzCommands[256];
+extern uint32_t fakeSubghzRegisterWrites;
+
+/* Last payload handed to LmHandlerSend() */
+extern uint8_t fakeSentBuffer[256];
+extern uint8_t fakeSentSize;
+extern uint8_t fakeSentPort;
+
+/**
+ * @brief What the fake LoRaMacCryptoComputeDataBlock() returns for a block.
+ */
+uint32_t fakeDataBlockCode(const uint8_t *buffer, uint32_t size, uint16_t sessionCnt, uint32_t descriptor);
+
+/**
+ * @brief Clears the flash pages and the counters, time back to 0.
+ */
+void fakeReset(void);
+
+#define RUN_TEST(test)  do { test(); printf("  %s\n", #test); } while (0)
+
+#endif /* TESTS_FAKES_H_ */
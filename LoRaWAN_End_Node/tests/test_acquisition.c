@@ -0,0 +1,193 @@
+/**
+ * @file test_acquisition.c
+ * @brief Acquisition cycle timing: LTC4015 burst inside the sensor warm-up, Modbus reads once the sensor answers
+ */
+
+#include "fakes.h"
+#include "PWX_SensorRail.h"
+#include "PWX_ClockPolicy.h"
+#include <string.h>
+
+#define SENSOR_WARMUP_MS    600     // the simulated sensor answers this long after power-up
+#define NB_READS            10
+#define READ_MS             300     // fetchSensorData() spacing of the level reads
+#define SEND_MS             1       // sendRaw() settles after each frame
+#define SLACK_MS            8       // ticks read by the busy waits
+
+static const uint8_t levelRead[] = { 0x01, 0x03, 0x00, 0x03, 0x00, 0x01, 0x74, 0x0A };
+
+static uint32_t ltcBurstMs;
+static uint32_t powerOnMs;
+static uint32_t firstAnswerMs;      // after power-up, UINT32_MAX until the sensor answered
+static uint32_t busFrames;
+static uint32_t answers;
+
+/* Stands in for PWX_ClockPolicy.c, the clock is not simulated */
+void requestClockLevel(ClockUser_t user, ClockLevel_t level) {
+}
+
+void releaseClockLevel(ClockUser_t user) {
+}
+
+/* The level sensor: silent without power or before its warm-up is over */
+static uint16_t sensor(const uint8_t *request, uint16_t size, uint8_t *answer) {
+    uint16_t crc;
+
+    assert(size == sizeof(levelRead) && memcmp(request, levelRead, size) == 0);
+    busFrames++;
+    if ((fakeGpioA & SENSOR_RAIL_PINS) != SENSOR_RAIL_PINS || (fakeTickMs - powerOnMs) < SENSOR_WARMUP_MS) {
+        return 0;
+    }
+    if (firstAnswerMs == UINT32_MAX) {
+        firstAnswerMs = fakeTickMs - powerOnMs;
+    }
+    answers++;
+    answer[0] = 0x01;
+    answer[1] = 0x03;
+    answer[2] = 0x02;
+    answer[3] = 0x04;
+    answer[4] = 0xD2;
+    crc = calculateModbusCRC(answer, 5);
+    answer[5] = (uint8_t)(crc & 0xFF);
+    answer[6] = (uint8_t)(crc >> 8);
+    return 7;
+}
+
+static void setUp(void) {
+    fakeReset();
+    /* probeSensor() spins on HAL_GetTick() */
+    fakeTickStepMs = 1;
+    fakeModbusSlave = sensor;
+    ltcBurstMs = 150;
+    firstAnswerMs = UINT32_MAX;
+    busFrames = 0;
+    answers = 0;
+    initSensorRail();
+}
+
+static void acquire(void) {
+    bool isOff = (fakeGpioA & SENSOR_RAIL_PINS) == 0;
+
+    acquireSensorRail();
+    if (isOff) {
+        powerOnMs = fakeTickMs;
+        firstAnswerMs = UINT32_MAX;
+    }
+}
+
+/* fetchLTCData(): blocking I2C register reads and the charger settling delay */
+static void ltcBurst(void) {
+    HAL_Delay(ltcBurstMs);
+}
+
+/* fetchSensorData() */
+static void fetchLevel(void) {
+    acquire();
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    for (uint8_t i = 0; i < NB_READS; i++) {
+        sendRaw((uint8_t *)levelRead, sizeof(levelRead), &ModbusResp);
+        assert(ModbusResp.rxIndex == 7);
+        HAL_Delay(READ_MS);
+    }
+    releaseSensorRail();
+}
+
+/* The sample that completes a transmit cycle, as SendTxData() orders it, returns the awake time */
+static uint32_t transmitSample(void) {
+    uint32_t start = fakeTickMs;
+
+    acquire();
+    ltcBurst();
+    fetchLevel();
+    releaseSensorRail();
+    assert((fakeGpioA & SENSOR_RAIL_PINS) == 0);
+    return fakeTickMs - start;
+}
+
+/* The same work back to back, as before the overlap */
+static uint32_t sequentialSample(void) {
+    uint32_t start = fakeTickMs;
+
+    fetchLevel();
+    ltcBurst();
+    return fakeTickMs - start;
+}
+
+static bool near(uint32_t value, uint32_t expected) {
+    return value >= expected && value <= expected + SLACK_MS;
+}
+
+static void testLtcBurstHidesInTheWarmUp(void) {
+    uint32_t overlapped;
+    uint32_t sequential;
+    uint32_t readyMs;
+
+    setUp();
+    overlapped = transmitSample();
+    readyMs = firstAnswerMs;
+    assert(readyMs >= SENSOR_WARMUP_MS && answers == 1 + NB_READS);
+
+    /* Same sensor, same probing from power-up: the burst is the whole difference */
+    setUp();
+    sequential = sequentialSample();
+    assert(near(firstAnswerMs, readyMs) || near(readyMs, firstAnswerMs));
+    assert(near(sequential, overlapped + ltcBurstMs) || near(overlapped + ltcBurstMs, sequential));
+
+    /* The awake window is the warm-up and the reads, the burst costs nothing */
+    assert(near(overlapped, readyMs + (NB_READS * (READ_MS + SEND_MS))));
+}
+
+static void testLearnedWarmUpStillCoversTheBurst(void) {
+    uint32_t awake;
+    uint32_t unlearnedMs;
+
+    setUp();
+    transmitSample();
+    unlearnedMs = firstAnswerMs;
+    /* Once learned, probing starts a quarter early instead of at the minimum and backs off less */
+    for (uint8_t cycle = 0; cycle < 8; cycle++) {
+        fakeTickMs += 60000;
+        awake = transmitSample();
+    }
+    assert(getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR) >= SENSOR_WARMUP_MS);
+    assert(firstAnswerMs >= SENSOR_WARMUP_MS && firstAnswerMs < unlearnedMs);
+    assert(near(awake, firstAnswerMs + (NB_READS * (READ_MS + SEND_MS))));
+}
+
+static void testLongBurstIsTheLongestStage(void) {
+    uint32_t awake;
+    uint32_t probes;
+
+    setUp();
+    ltcBurstMs = 1200;
+    awake = transmitSample();
+
+    /* The warm-up was over during the burst: one probe right after it, then the reads */
+    probes = busFrames - NB_READS;
+    assert(probes == 1 && near(firstAnswerMs, ltcBurstMs));
+    assert(near(awake, ltcBurstMs + (NB_READS * (READ_MS + SEND_MS))));
+}
+
+static void testNoReadBeforeTheSensorAnswers(void) {
+    setUp();
+    /* Every unanswered frame was a probe, sent before the sensor was ready */
+    transmitSample();
+    assert(answers == 1 + NB_READS && busFrames > answers);
+    assert(firstAnswerMs >= SENSOR_WARMUP_MS);
+
+    /* A sample that does not complete the cycle goes without the burst */
+    fakeTickMs += 60000;
+    answers = 0;
+    fetchLevel();
+    assert(answers == 1 + NB_READS && firstAnswerMs >= SENSOR_WARMUP_MS);
+    assert((fakeGpioA & SENSOR_RAIL_PINS) == 0);
+}
+
+int main(void) {
+    printf("test_acquisition\n");
+    RUN_TEST(testLtcBurstHidesInTheWarmUp);
+    RUN_TEST(testLearnedWarmUpStillCoversTheBurst);
+    RUN_TEST(testLongBurstIsTheLongestStage);
+    RUN_TEST(testNoReadBeforeTheSensorAnswers);
+    return 0;
+}
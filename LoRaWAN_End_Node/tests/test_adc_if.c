@@ -0,0 +1,278 @@
+/**
+ * @file test_adc_if.c
+ * @brief VREFINT/TEMPSENSOR burst: conversion math, burst reuse, calibration kept across bring-ups, ADC on-time
+ */
+
+#include "fakes.h"
+#include "adc_if.h"
+#include <stdlib.h>
+
+#define VALIDITY_MS         1000    // ADC_BURST_VALIDITY_MS
+#define RECAL_DELTA         10      // ADC_RECAL_TEMPERATURE_DELTA
+#define VREFINT_MV          1212.0  // the reference the model converts
+#define TS_V30_MV           760.0   // sensor output at 30 degC
+#define TS_SLOPE_MV         2.5     // per degC
+#define FULL_SCALE          4095.0
+#define TRUE_FACTOR         0x45    // what Calibration_Start() measures
+#define CALIBRATION_MS      2       // model costs, not measured figures
+#define CONVERSION_MS       1
+
+/* Conversion results are positive, no libm */
+static uint32_t toCounts(double value) {
+    return (uint32_t)(value + 0.5);
+}
+
+/* ADC model: the die and the supply, the converter state */
+static double vddaMv;
+static double dieC;
+static uint32_t factor;             // calibration factor in the ADC, lost on every bring-up
+static uint32_t rankChannel[3];
+static uint8_t nextRank;
+static uint32_t powerUps;
+static uint32_t calibrations;
+static uint32_t restores;
+static uint32_t bursts;
+
+/* Stands in for adc.c */
+ADC_HandleTypeDef hadc;
+
+void MX_ADC_Init(void) {
+    assert(0);
+}
+
+/* Stands in for the HAL ADC driver */
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc) {
+    assert(hadc->Init.NbrOfConversion == 2 && hadc->Init.ScanConvMode == ADC_SCAN_ENABLE);
+    assert(hadc->Init.OversamplingMode == ENABLE && hadc->Init.Oversampling.Ratio == ADC_OVERSAMPLING_RATIO_16 &&
+           hadc->Init.Oversampling.RightBitShift == ADC_RIGHTBITSHIFT_4);
+    powerUps++;
+    factor = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_DeInit(ADC_HandleTypeDef *hadc) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc) {
+    calibrations++;
+    factor = TRUE_FACTOR;
+    fakeTickMs += CALIBRATION_MS;
+    return HAL_OK;
+}
+
+uint32_t HAL_ADCEx_Calibration_GetValue(ADC_HandleTypeDef *hadc) {
+    return factor;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_SetValue(ADC_HandleTypeDef *hadc, uint32_t CalibrationFactor) {
+    restores++;
+    factor = CalibrationFactor;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef ADC_Enable(ADC_HandleTypeDef *hadc) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *pConfig) {
+    rankChannel[(pConfig->Rank == ADC_REGULAR_RANK_1) ? 1 : 2] = pConfig->Channel;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc) {
+    bursts++;
+    nextRank = 1;
+    fakeTickMs += CONVERSION_MS;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc) {
+    return HAL_OK;
+}
+
+/* 16 samples averaged back to 12 bits, off by the calibration error */
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc) {
+    double mv = 0;
+
+    assert(nextRank == 1 || nextRank == 2);
+    if (rankChannel[nextRank] == ADC_CHANNEL_VREFINT) {
+        mv = VREFINT_MV;
+    } else if (rankChannel[nextRank] == ADC_CHANNEL_TEMPSENSOR) {
+        mv = TS_V30_MV + ((dieC - 30) * TS_SLOPE_MV);
+    } else {
+        assert(0);
+    }
+    nextRank++;
+    return toCounts((mv * FULL_SCALE / vddaMv) + ((double)TRUE_FACTOR - factor));
+}
+
+/* Engineering bytes as programmed in production */
+static void setProductionCalibration(bool isCalibrated) {
+    *VREFINT_CAL_ADDR = isCalibrated ? (uint16_t)toCounts(VREFINT_MV * FULL_SCALE / VREFINT_CAL_VREF) : 0xFFFF;
+    *TEMPSENSOR_CAL1_ADDR = isCalibrated ? (uint16_t)toCounts(TS_V30_MV * FULL_SCALE / TEMPSENSOR_CAL_VREFANALOG) : 0;
+    *TEMPSENSOR_CAL2_ADDR = isCalibrated
+                          ? (uint16_t)toCounts((TS_V30_MV + (100 * TS_SLOPE_MV)) * FULL_SCALE / TEMPSENSOR_CAL_VREFANALOG)
+                          : 0;
+}
+
+static void setUp(void) {
+    fakeReset();
+    setProductionCalibration(true);
+    vddaMv = 3000;
+    dieC = 25;
+    factor = 0;
+    powerUps = 0;
+    calibrations = 0;
+    restores = 0;
+    bursts = 0;
+    SYS_InitMeasurement();
+}
+
+/* Past the reuse window, so the next read converts */
+static void nextUplink(void) {
+    fakeTickMs += 60000;
+}
+
+static int16_t temperature(void) {
+    return (int16_t)(SYS_GetTemperatureLevel() >> 8);
+}
+
+static void testVddaAndTemperatureMath(void) {
+    const double supplies[] = { 1800, 2400, 3000, 3300, 3600 };
+    const double dies[] = { -20, 0, 25, 60, 85 };
+
+    setUp();
+    for (uint8_t s = 0; s < sizeof(supplies) / sizeof(supplies[0]); s++) {
+        for (uint8_t d = 0; d < sizeof(dies) / sizeof(dies[0]); d++) {
+            vddaMv = supplies[s];
+            dieC = dies[d];
+            nextUplink();
+            assert(abs((int32_t)SYS_GetBatteryLevel() - (int32_t)vddaMv) <= 4);
+            assert(abs(temperature() - (int16_t)dieC) <= 1);
+        }
+    }
+}
+
+static void testGenericParametersWithoutProductionCalibration(void) {
+    setUp();
+    setProductionCalibration(false);
+    vddaMv = 3300;
+    dieC = 50;
+    /* VREFINT taken as 1.21 V instead of the model's 1.212 V, datasheet V30 and slope */
+    assert(abs((int32_t)SYS_GetBatteryLevel() - 3300) <= 3300 / 200);
+    assert(abs(temperature() - 50) <= 2);
+}
+
+static void testOneBurstServesBothReads(void) {
+    setUp();
+    /* As an uplink reads them: the battery, then the temperature that used to read the battery again */
+    SYS_GetBatteryLevel();
+    temperature();
+    SYS_GetBatteryLevel();
+    assert(bursts == 1 && powerUps == 1);
+    assert(rankChannel[1] == ADC_CHANNEL_VREFINT && rankChannel[2] == ADC_CHANNEL_TEMPSENSOR);
+
+    /* Reused within the window only */
+    vddaMv = 2500;
+    fakeTickMs += VALIDITY_MS - 1;
+    assert(abs((int32_t)SYS_GetBatteryLevel() - 3000) <= 4 && bursts == 1);
+    fakeTickMs += 1;
+    assert(abs((int32_t)SYS_GetBatteryLevel() - 2500) <= 4 && bursts == 2);
+}
+
+static void testCalibrationIsKeptAcrossBringUps(void) {
+    setUp();
+    for (uint8_t uplink = 0; uplink < 20; uplink++) {
+        vddaMv = 3000 - (uplink * 20);
+        nextUplink();
+        /* A bring-up without the factor would read TRUE_FACTOR counts high */
+        assert(abs((int32_t)SYS_GetBatteryLevel() - (int32_t)vddaMv) <= 4);
+        assert(abs(temperature() - 25) <= 1);
+    }
+    assert(powerUps == 20 && calibrations == 1 && restores == 19);
+
+    /* A reboot calibrates again */
+    SYS_InitMeasurement();
+    nextUplink();
+    SYS_GetBatteryLevel();
+    assert(calibrations == 2 && restores == 19);
+}
+
+static void testTemperatureDriftTriggersRecalibration(void) {
+    setUp();
+    temperature();
+    assert(calibrations == 1);
+
+    /* Within the delta the factor holds */
+    dieC = 25 + RECAL_DELTA - 2;
+    nextUplink();
+    temperature();
+    dieC = 25 - RECAL_DELTA + 2;
+    nextUplink();
+    temperature();
+    assert(calibrations == 1);
+
+    /* The burst that sees the drift flags it, the next bring-up calibrates */
+    dieC = 25 + RECAL_DELTA + 1;
+    nextUplink();
+    temperature();
+    assert(calibrations == 1);
+    nextUplink();
+    temperature();
+    assert(calibrations == 2);
+
+    /* The calibration point moved with the die */
+    dieC = 25 + (2 * RECAL_DELTA) - 1;
+    nextUplink();
+    temperature();
+    nextUplink();
+    temperature();
+    assert(calibrations == 2);
+    dieC = 25;
+    nextUplink();
+    temperature();
+    nextUplink();
+    temperature();
+    assert(calibrations == 3);
+}
+
+static void testMeasurementOnTimePerUplink(void) {
+    /* Before: battery, temperature and the battery read inside it, each a full bring-up with calibration */
+    const uint32_t perChannelMs = 3 * (CALIBRATION_MS + CONVERSION_MS);
+    uint32_t start;
+    uint32_t onTime;
+
+    setUp();
+    /* Counted since boot, the other tests ran first */
+    start = SYS_GetMeasurementOnTime();
+    SYS_GetBatteryLevel();
+    temperature();
+    assert(SYS_GetMeasurementOnTime() - start == CALIBRATION_MS + CONVERSION_MS);
+
+    for (uint8_t uplink = 0; uplink < 10; uplink++) {
+        onTime = SYS_GetMeasurementOnTime();
+        nextUplink();
+        SYS_GetBatteryLevel();
+        temperature();
+        assert(SYS_GetMeasurementOnTime() - onTime == CONVERSION_MS);
+    }
+    onTime = SYS_GetMeasurementOnTime() - start;
+    assert(onTime == CALIBRATION_MS + (11 * CONVERSION_MS));
+    assert(onTime * 6 < perChannelMs * 11);
+}
+
+int main(void) {
+    printf("test_adc_if\n");
+    RUN_TEST(testVddaAndTemperatureMath);
+    RUN_TEST(testGenericParametersWithoutProductionCalibration);
+    RUN_TEST(testOneBurstServesBothReads);
+    RUN_TEST(testCalibrationIsKeptAcrossBringUps);
+    RUN_TEST(testTemperatureDriftTriggersRecalibration);
+    RUN_TEST(testMeasurementOnTimePerUplink);
+    return 0;
+}
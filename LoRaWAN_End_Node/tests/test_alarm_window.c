@@ -0,0 +1,122 @@
+/**
+ * @file test_alarm_window.c
+ * @brief Budget math of the Class C alarm window
+ */
+
+#include "fakes.h"
+#include "PWX_AlarmWindow.h"
+
+#define FULL_BUDGET_UAS     ((uint32_t)ALARM_WINDOW_DEFAULT_BUDGET_MAS * 1000U)
+#define WINDOW_MS           ((uint32_t)ALARM_WINDOW_DEFAULT_S * 1000U)
+#define WINDOW_UAS          ((uint32_t)(((uint64_t)WINDOW_MS * ALARM_WINDOW_RX_UA) / 1000U))
+
+/* Opens the window and keeps it open for its full length */
+static uint32_t runWindow(void) {
+    uint32_t windowMs;
+
+    armAlarmWindow();
+    windowMs = openAlarmWindow();
+    if (windowMs != 0) {
+        fakeTickMs += windowMs;
+        closeAlarmWindow();
+    }
+    return windowMs;
+}
+
+static void testFullWindowsThenShortenedThenSkipped(void) {
+    uint32_t fullWindows = FULL_BUDGET_UAS / WINDOW_UAS;
+    uint32_t leftUas = FULL_BUDGET_UAS - (fullWindows * WINDOW_UAS);
+    uint32_t shortMs = (uint32_t)(((uint64_t)leftUas * 1000U) / ALARM_WINDOW_RX_UA);
+
+    fakeReset();
+    initAlarmWindow();
+    /* Back to back windows, the refill over them is too small to matter */
+    for (uint32_t i = 0; i < fullWindows; i++) {
+        assert(runWindow() == WINDOW_MS);
+    }
+    assert(shortMs >= ALARM_WINDOW_MIN_MS && shortMs < WINDOW_MS);
+    assert(runWindow() >= shortMs && runWindow() == 0);
+    assert(!isAlarmWindowOpen());
+}
+
+static void testBudgetRefillsOverThePeriod(void) {
+    uint32_t tenthMs = (uint32_t)(((uint64_t)(FULL_BUDGET_UAS / 10) * 1000U) / ALARM_WINDOW_RX_UA);
+    uint32_t windowMs;
+
+    assert(tenthMs < WINDOW_MS);
+    fakeReset();
+    initAlarmWindow();
+    while (runWindow() != 0) {
+    }
+
+    /* A tenth of the period earns a tenth of the budget, on top of what the skipped window left */
+    fakeTickMs += (ALARM_WINDOW_BUDGET_PERIOD_S * 1000U) / 10;
+    armAlarmWindow();
+    windowMs = openAlarmWindow();
+    assert(windowMs >= tenthMs && windowMs < (tenthMs + ALARM_WINDOW_MIN_MS));
+    closeAlarmWindow();
+
+    /* The refill never goes past a full budget */
+    fakeTickMs += 10 * ALARM_WINDOW_BUDGET_PERIOD_S * 1000U;
+    for (uint32_t i = 0; i < FULL_BUDGET_UAS / WINDOW_UAS; i++) {
+        assert(runWindow() == WINDOW_MS);
+    }
+    assert(runWindow() < WINDOW_MS);
+}
+
+static void testShortWindowChargesOnlyItsTime(void) {
+    uint32_t windowMs;
+
+    fakeReset();
+    initAlarmWindow();
+    armAlarmWindow();
+    windowMs = openAlarmWindow();
+    assert(windowMs == WINDOW_MS && isAlarmWindowOpen());
+
+    /* The command came early: only 15 s are charged */
+    fakeTickMs += 15000;
+    closeAlarmWindow();
+    for (uint32_t i = 0; i < (FULL_BUDGET_UAS - ((15000U * ALARM_WINDOW_RX_UA) / 1000U)) / WINDOW_UAS; i++) {
+        assert(runWindow() == WINDOW_MS);
+    }
+}
+
+static void testConfig(void) {
+    fakeReset();
+    initAlarmWindow();
+
+    assert(!setAlarmWindowConfig(ALARM_WINDOW_MAX_S + 1, 100));
+    assert(setAlarmWindowConfig(30, 100));
+    /* 100 mAs keep 5.5 mA open for 18181 ms, under the 30 s asked for */
+    assert(runWindow() == (100000U * 1000U) / ALARM_WINDOW_RX_UA);
+
+    /* 0 disables the window */
+    assert(setAlarmWindowConfig(0, 100));
+    armAlarmWindow();
+    assert(!isAlarmWindowArmed() && openAlarmWindow() == 0);
+    assert(setAlarmWindowConfig(30, 0));
+    armAlarmWindow();
+    assert(!isAlarmWindowArmed());
+}
+
+static void testArmIgnoredWhileOpen(void) {
+    fakeReset();
+    initAlarmWindow();
+    armAlarmWindow();
+    assert(openAlarmWindow() != 0);
+    armAlarmWindow();
+    assert(!isAlarmWindowArmed() && openAlarmWindow() == 0);
+    disarmAlarmWindow();
+    closeAlarmWindow();
+    assert(!isAlarmWindowOpen());
+}
+
+int main(void) {
+    printf("test_alarm_window\n");
+    RUN_TEST(testFullWindowsThenShortenedThenSkipped);
+    RUN_TEST(testBudgetRefillsOverThePeriod);
+    RUN_TEST(testShortWindowChargesOnlyItsTime);
+    RUN_TEST(testConfig);
+    RUN_TEST(testArmIgnoredWhileOpen);
+    return 0;
+}
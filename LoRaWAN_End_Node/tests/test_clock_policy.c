@@ -0,0 +1,232 @@
+/**
+ * @file test_clock_policy.c
+ * @brief Clock votes: highest vote wins, MAC and USART1 floors, BRR re-derived, baud error per level, charge per cycle
+ */
+
+#include "fakes.h"
+#include "PWX_ClockPolicy.h"
+#include "usart.h"
+#include "LoRaMac.h"
+
+/* Run current per level, MSI, range 1, SMPS off: model figures, not measured */
+static const uint32_t levelUa[CLOCK_LEVEL_NUM] = { 640, 1840, 5050 };
+static const uint32_t levelHz[CLOCK_LEVEL_NUM] = { 4000000, 16000000, 48000000 };
+
+static USART_TypeDef usart1;
+static uint32_t sysclkHz;
+static uint32_t switches;
+static bool isOscFailing;
+static bool isMacBusy;
+
+/* Stands in for the HAL RCC driver: the MSI range is SYSCLK, AHB and APB2 undivided */
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct) {
+    assert(RCC_OscInitStruct->OscillatorType == RCC_OSCILLATORTYPE_MSI && RCC_OscInitStruct->MSIState == RCC_MSI_ON);
+    assert(RCC_OscInitStruct->PLL.PLLState == RCC_PLL_NONE);
+    if (isOscFailing) {
+        return HAL_ERROR;
+    }
+    switch (RCC_OscInitStruct->MSIClockRange) {
+    case RCC_MSIRANGE_6:
+        sysclkHz = 4000000;
+        break;
+    case RCC_MSIRANGE_8:
+        sysclkHz = 16000000;
+        break;
+    case RCC_MSIRANGE_11:
+        sysclkHz = 48000000;
+        break;
+    default:
+        assert(0);
+    }
+    switches++;
+    return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void) {
+    return sysclkHz;
+}
+
+/* Stands in for the HAL UART driver, UART_DIV_SAMPLING16() reads it */
+const uint16_t UARTPrescTable[12] = { 1U, 2U, 4U, 6U, 8U, 10U, 12U, 16U, 32U, 64U, 128U, 256U };
+
+/* Stands in for LoRaMac.c */
+bool LoRaMacIsBusy(void) {
+    return isMacBusy;
+}
+
+static void setUp(uint32_t baudRate) {
+    fakeReset();
+    sysclkHz = 48000000;
+    switches = 0;
+    isOscFailing = false;
+    isMacBusy = false;
+    huart1.Instance = &usart1;
+    huart1.Init.BaudRate = baudRate;
+    huart1.Init.ClockPrescaler = UART_PRESCALER_DIV1;
+    huart1.gState = HAL_UART_STATE_READY;
+    usart1.BRR = UART_DIV_SAMPLING16(sysclkHz, baudRate, UART_PRESCALER_DIV1);
+    usart1.CR1 = USART_CR1_UE;
+    initClockPolicy();
+}
+
+/* The level the policy runs at matches the clock and USART1 divides that clock */
+static void assertClock(ClockLevel_t level) {
+    assert(getClockLevel() == level && sysclkHz == levelHz[level]);
+    assert(usart1.BRR == UART_DIV_SAMPLING16(sysclkHz, huart1.Init.BaudRate, UART_PRESCALER_DIV1));
+    assert((usart1.CR1 & USART_CR1_UE) != 0);
+}
+
+static uint32_t baudErrorPpm(uint32_t hz, uint32_t baudRate) {
+    uint32_t actual = hz / UART_DIV_SAMPLING16(hz, baudRate, UART_PRESCALER_DIV1);
+
+    return (uint32_t)(((uint64_t)((actual > baudRate) ? actual - baudRate : baudRate - actual) * 1000000U) / baudRate);
+}
+
+static void testHighestVoteWins(void) {
+    setUp(9600);
+    assertClock(CLOCK_LEVEL_HIGH);
+
+    requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_LOW);
+    requestClockLevel(CLOCK_USER_SENSOR_RAIL, CLOCK_LEVEL_MEDIUM);
+    assertClock(CLOCK_LEVEL_MEDIUM);
+    releaseClockLevel(CLOCK_USER_MODBUS);
+    assertClock(CLOCK_LEVEL_MEDIUM);
+    requestClockLevel(CLOCK_USER_SENSOR_RAIL, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_LOW);
+
+    /* With no vote left the clock goes back to full speed */
+    releaseClockLevel(CLOCK_USER_SENSOR_RAIL);
+    assertClock(CLOCK_LEVEL_HIGH);
+    assert(switches == 4);
+
+    /* A vote for the level already running switches nothing */
+    requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_HIGH);
+    releaseClockLevel(CLOCK_USER_MODBUS);
+    assert(switches == 4);
+}
+
+static void testBusyMacHoldsFullSpeed(void) {
+    setUp(9600);
+    isMacBusy = true;
+    requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_HIGH);
+    assert(switches == 0);
+
+    /* The next vote after the MAC is done applies */
+    isMacBusy = false;
+    requestClockLevel(CLOCK_USER_SENSOR_RAIL, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_LOW);
+}
+
+static void testBaudErrorAtEachLevel(void) {
+    const uint32_t baudRates[] = { 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400 };
+
+    for (uint8_t b = 0; b < sizeof(baudRates) / sizeof(baudRates[0]); b++) {
+        ClockLevel_t level;
+
+        setUp(baudRates[b]);
+        requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+        level = getClockLevel();
+        assertClock(level);
+        /* The level picked keeps the error within bounds and 1000 cycles per character */
+        assert(level == CLOCK_LEVEL_HIGH || baudErrorPpm(levelHz[level], baudRates[b]) <= CLOCK_POLICY_MAX_BAUD_ERR_PPM);
+        assert(level == CLOCK_LEVEL_HIGH || (levelHz[level] / baudRates[b]) * 10 >= 1000);
+        /* and is the lowest that does */
+        for (ClockLevel_t lower = CLOCK_LEVEL_LOW; lower < level; lower++) {
+            assert(UART_DIV_SAMPLING16(levelHz[lower], baudRates[b], UART_PRESCALER_DIV1) < 16 ||
+                   baudErrorPpm(levelHz[lower], baudRates[b]) > CLOCK_POLICY_MAX_BAUD_ERR_PPM ||
+                   (levelHz[lower] / baudRates[b]) * 10 < 1000);
+        }
+        printf("    %6u baud: %2u MHz, %4u ppm off\n", baudRates[b], levelHz[level] / 1000000,
+               baudErrorPpm(levelHz[level], baudRates[b]));
+    }
+}
+
+static void testSwitchWaitsForTheTransmission(void) {
+    setUp(9600);
+    huart1.gState = HAL_UART_STATE_BUSY_TX;
+    requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_HIGH);
+    assert(switches == 0);
+
+    huart1.gState = HAL_UART_STATE_READY;
+    requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_LOW);
+}
+
+static void testFailedSwitchKeepsTheLevel(void) {
+    setUp(9600);
+    isOscFailing = true;
+    requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_HIGH);
+
+    isOscFailing = false;
+    requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+    assertClock(CLOCK_LEVEL_LOW);
+}
+
+/* Charge of one sensing cycle, in nC: sensor warm-up, four segment scans, then the uplink */
+static uint64_t sensingCycleCharge(bool isScaling) {
+    uint64_t chargeUaMs = 0;
+    uint32_t start = fakeTickMs;
+
+    if (isScaling) {
+        requestClockLevel(CLOCK_USER_SENSOR_RAIL, CLOCK_LEVEL_LOW);
+    }
+    fakeTickMs += 800;
+    if (isScaling) {
+        releaseClockLevel(CLOCK_USER_SENSOR_RAIL);
+    }
+    for (uint8_t segment = 0; segment < 4; segment++) {
+        if (isScaling) {
+            requestClockLevel(CLOCK_USER_MODBUS, CLOCK_LEVEL_LOW);
+        }
+        fakeTickMs += 150;
+        if (isScaling) {
+            releaseClockLevel(CLOCK_USER_MODBUS);
+        }
+    }
+    /* Payload, CMAC and the MAC at full speed */
+    fakeTickMs += 40;
+    for (ClockLevel_t level = CLOCK_LEVEL_LOW; level < CLOCK_LEVEL_NUM; level++) {
+        chargeUaMs += (uint64_t)getClockResidencyMs(level) * levelUa[level];
+    }
+    assert(getClockResidencyMs(CLOCK_LEVEL_LOW) + getClockResidencyMs(CLOCK_LEVEL_MEDIUM) +
+           getClockResidencyMs(CLOCK_LEVEL_HIGH) == fakeTickMs - start);
+    return chargeUaMs;
+}
+
+static void testChargePerSensingCycle(void) {
+    uint64_t fixed;
+    uint64_t scaled;
+
+    setUp(9600);
+    fixed = sensingCycleCharge(false);
+    assert(getClockResidencyMs(CLOCK_LEVEL_HIGH) == 1440);
+
+    setUp(9600);
+    scaled = sensingCycleCharge(true);
+    assert(getClockResidencyMs(CLOCK_LEVEL_LOW) == 1400 && getClockResidencyMs(CLOCK_LEVEL_HIGH) == 40);
+    assert(switches == 10);
+    printf("    sensing cycle at 9600 baud: %llu uC at 48 MHz, %llu uC with the votes\n",
+           (unsigned long long)(fixed / 1000), (unsigned long long)(scaled / 1000));
+    assert(scaled * 5 < fixed);
+
+    /* At 115200 baud USART1 needs 16 MHz */
+    setUp(115200);
+    scaled = sensingCycleCharge(true);
+    assert(getClockResidencyMs(CLOCK_LEVEL_MEDIUM) == 1400);
+    assert(scaled * 2 < fixed);
+}
+
+int main(void) {
+    printf("test_clock_policy\n");
+    RUN_TEST(testHighestVoteWins);
+    RUN_TEST(testBusyMacHoldsFullSpeed);
+    RUN_TEST(testBaudErrorAtEachLevel);
+    RUN_TEST(testSwitchWaitsForTheTransmission);
+    RUN_TEST(testFailedSwitchKeepsTheLevel);
+    RUN_TEST(testChargePerSensingCycle);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file test_config_tlv.c
+ * @brief TLV configuration downlink: parser, commit and config hash
+ */
+
+#include "fakes.h"
+#include "PWX_ConfigTlv.h"
+#include <string.h>
+
+static ConfigTlvUpdate_t update;
+
+static ConfigTlvStatus_t parse(const uint8_t *payload, size_t size) {
+    return parseConfigTlv(payload, size, &update);
+}
+
+static void testEveryParameter(void) {
+    const uint8_t payload[] = {
+        0x42,
+        CONFIG_TLV_TX_INTERVAL,        4, 0x00, 0x00, 0x0E, 0x10,      // 3600 s
+        CONFIG_TLV_CNF_UPLINK_COUNT,   2, 0x00, 0x0A,
+        CONFIG_TLV_THRESHOLD_HIGH,     2, 0x00, 0xC8,
+        CONFIG_TLV_THRESHOLD_LOW,      2, 0x00, 0x32,
+        CONFIG_TLV_SAMPLING_COUNT,     2, 0x00, 0x05,
+        CONFIG_TLV_SAMPLING_METHOD,    1, 0x01,
+        CONFIG_TLV_MEASUREMENT_METHOD, 1, 0x00,
+        CONFIG_TLV_HEARTBEAT_INTERVAL, 4, 0x00, 0x01, 0x51, 0x80,      // 86400 s
+    };
+
+    assert(parse(payload, sizeof(payload)) == CONFIG_TLV_OK);
+    assert(update.txnId == 0x42 && update.failedIndex == CONFIG_TLV_NO_INDEX);
+    assert(update.txIntervalSeconds == 3600 && update.heartbeatSeconds == 86400);
+    assert(update.cnfUplinkCount == 10 && update.thresholdHigh == 200 && update.thresholdLow == 50);
+    assert(update.samplingCount == 5 && update.samplingMethod == 1 && update.measurementMethod == 0);
+    for (uint8_t tag = CONFIG_TLV_TX_INTERVAL; tag <= CONFIG_TLV_HEARTBEAT_INTERVAL; tag++) {
+        assert(hasConfigTlv(&update, tag));
+    }
+}
+
+static void testModbusEdits(void) {
+    const uint8_t payload[] = {
+        0x01,
+        CONFIG_TLV_MODBUS_DEVICE,  5, 3, 1, PARITY_EVEN, STOP_BIT_1, 1,
+        CONFIG_TLV_MODBUS_SEGMENT, CONFIG_TLV_SEGMENT_HEADER_SIZE + 3,
+            3, 16, 1, 0, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x03, 0x00,
+    };
+
+    assert(parse(payload, sizeof(payload)) == CONFIG_TLV_OK);
+    assert(update.present == 0 && update.numDeviceEdits == 1 && update.numSegmentEdits == 1);
+    assert(update.deviceEdits[0].device == 3 && update.deviceEdits[0].baudrate == 1);
+    assert(update.deviceEdits[0].parity == PARITY_EVEN && update.deviceEdits[0].active == 1);
+    assert(update.segmentEdits[0].segment == 16 && update.segmentEdits[0].enable == 1);
+    assert(update.segmentEdits[0].sendNow == 0 && update.segmentEdits[0].cmdSize == 3);
+    /* All 64 bits of the valid address mask */
+    assert(update.segmentEdits[0].validAddresses == 0x8000000000000001ULL);
+    assert(memcmp(update.segmentEdits[0].cmdRaw, "\x01\x03\x00", 3) == 0);
+}
+
+static void testErrorsReportTheOffendingTlv(void) {
+    const uint8_t truncated[] = { 0x01, CONFIG_TLV_SAMPLING_COUNT, 2, 0x00, 0x05, CONFIG_TLV_TX_INTERVAL, 4, 0x00 };
+    const uint8_t unknown[] = { 0x01, CONFIG_TLV_SAMPLING_COUNT, 2, 0x00, 0x05, 0x09, 1, 0x00 };
+    const uint8_t badLength[] = { 0x01, CONFIG_TLV_THRESHOLD_HIGH, 1, 0x10 };
+    const uint8_t duplicate[] = { 0x01, CONFIG_TLV_SAMPLING_COUNT, 2, 0x00, 0x05, CONFIG_TLV_SAMPLING_COUNT, 2, 0x00, 0x06 };
+    const uint8_t shortInterval[] = { 0x01, CONFIG_TLV_TX_INTERVAL, 4, 0x00, 0x00, 0x00, CONFIG_TLV_MIN_INTERVAL_S - 1 };
+    const uint8_t badDevice[] = { 0x01, CONFIG_TLV_MODBUS_DEVICE, 5, NUM_DEVICES + 1, 0, 0, 0, 1 };
+    const uint8_t noCommand[] = { 0x01, CONFIG_TLV_MODBUS_SEGMENT, CONFIG_TLV_SEGMENT_HEADER_SIZE,
+                                  1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    const uint8_t inverted[] = { 0x01, CONFIG_TLV_THRESHOLD_HIGH, 2, 0x00, 0x32, CONFIG_TLV_THRESHOLD_LOW, 2, 0x00, 0x32 };
+
+    assert(parse(truncated, sizeof(truncated)) == CONFIG_TLV_ERR_TRUNCATED && update.failedIndex == 1);
+    assert(parse(unknown, sizeof(unknown)) == CONFIG_TLV_ERR_UNKNOWN_TAG && update.failedIndex == 1);
+    assert(parse(badLength, sizeof(badLength)) == CONFIG_TLV_ERR_LENGTH && update.failedIndex == 0);
+    assert(parse(duplicate, sizeof(duplicate)) == CONFIG_TLV_ERR_DUPLICATE && update.failedIndex == 1);
+    assert(parse(shortInterval, sizeof(shortInterval)) == CONFIG_TLV_ERR_RANGE);
+    assert(parse(badDevice, sizeof(badDevice)) == CONFIG_TLV_ERR_RANGE);
+    assert(parse(noCommand, sizeof(noCommand)) == CONFIG_TLV_ERR_LENGTH);
+    /* Both thresholds given: checked against each other, no index */
+    assert(parse(inverted, sizeof(inverted)) == CONFIG_TLV_ERR_RANGE && update.failedIndex == CONFIG_TLV_NO_INDEX);
+    assert(parse(NULL, 0) == CONFIG_TLV_ERR_TRUNCATED);
+}
+
+static void testTooManyEdits(void) {
+    uint8_t payload[1 + ((CONFIG_TLV_MAX_DEVICE_EDITS + 1) * 7)];
+    size_t size = 0;
+
+    payload[size++] = 0x01;
+    for (uint8_t dev = 1; dev <= CONFIG_TLV_MAX_DEVICE_EDITS + 1; dev++) {
+        const uint8_t edit[] = { CONFIG_TLV_MODBUS_DEVICE, 5, dev, 0, PARITY_NONE, STOP_BIT_1, 1 };
+        memcpy(&payload[size], edit, sizeof(edit));
+        size += sizeof(edit);
+    }
+    assert(parse(payload, size) == CONFIG_TLV_ERR_TOO_MANY && update.failedIndex == CONFIG_TLV_MAX_DEVICE_EDITS);
+}
+
+static void testCommitWritesEachPageOnce(void) {
+    const uint8_t payload[] = {
+        0x07,
+        CONFIG_TLV_THRESHOLD_LOW,  2, 0x00, 0x14,
+        CONFIG_TLV_MODBUS_DEVICE,  5, 2, 0, PARITY_NONE, STOP_BIT_1, 1,
+        CONFIG_TLV_MODBUS_SEGMENT, CONFIG_TLV_SEGMENT_HEADER_SIZE + 1, 2, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0x0F, 0x03,
+        CONFIG_TLV_MODBUS_SEGMENT, CONFIG_TLV_SEGMENT_HEADER_SIZE + 1, 2, 2, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0xF0, 0x04,
+    };
+    SecureElementNvmData_t nvm;
+
+    fakeReset();
+    fakeConfigPage.pwxWaterLevelThresholdHigh = 100;
+    fakeConfigPage.pwxWaterLevelThresholdLow = 10;
+    assert(parse(payload, sizeof(payload)) == CONFIG_TLV_OK);
+    assert(commitConfigTlv(&update, &nvm) == CONFIG_TLV_OK);
+
+    /* One device page and the config page */
+    assert(fakeFlashWrites == 2);
+    assert(fakeConfigPage.pwxWaterLevelThresholdLow == 20 && fakeConfigPage.pwxWaterLevelThresholdHigh == 100);
+    assert(fakeDevices[1].DeviceActive == 1 && fakeDevices[1].Segment[0].validAddresses == 0x0F);
+    assert(fakeDevices[1].Segment[1].cmdRaw[0] == 0x04 && fakeDevices[1].Segment[1].enableSegment == 1);
+    assert(fakeDevices[0].DeviceActive == 0);
+}
+
+static void testCommitChecksASingleThresholdAgainstTheStoredOne(void) {
+    const uint8_t payload[] = { 0x08, CONFIG_TLV_THRESHOLD_LOW, 2, 0x00, 0x64 };
+    SecureElementNvmData_t nvm;
+
+    fakeReset();
+    fakeConfigPage.pwxWaterLevelThresholdHigh = 100;
+    assert(parse(payload, sizeof(payload)) == CONFIG_TLV_OK);
+    assert(commitConfigTlv(&update, &nvm) == CONFIG_TLV_ERR_RANGE);
+    assert(fakeFlashWrites == 0 && fakeConfigPage.pwxWaterLevelThresholdLow == 0);
+}
+
+static void testHashCoversTheConfig(void) {
+    SecureElementNvmData_t nvm;
+    uint32_t hash;
+    uint8_t ack[CONFIG_TLV_ACK_SIZE];
+
+    fakeReset();
+    fakeDevices[4].DeviceActive = 1;
+    fakeDevices[4].Segment[3].enableSegment = 1;
+    fakeDevices[4].Segment[3].cmdSize = 2;
+    memcpy(&nvm, &fakeConfigPage, sizeof(nvm));
+    hash = getConfigHash(&nvm);
+
+    /* The top bit of the valid address mask changes the hash */
+    fakeDevices[4].Segment[3].validAddresses = 1ULL << 63;
+    assert(getConfigHash(&nvm) != hash);
+    fakeDevices[4].Segment[3].validAddresses = 0;
+    assert(getConfigHash(&nvm) == hash);
+
+    /* Disabled segments and inactive devices do not */
+    fakeDevices[4].Segment[4].cmdSize = 7;
+    fakeDevices[5].Baudrate = 1;
+    assert(getConfigHash(&nvm) == hash);
+
+    nvm.pwxSamplingCount++;
+    assert(getConfigHash(&nvm) != hash);
+
+    update.txnId = 0x33;
+    update.failedIndex = 2;
+    assert(buildConfigTlvAck(&update, CONFIG_TLV_ERR_RANGE, 0x01020304, ack, sizeof(ack) - 1) == 0);
+    assert(buildConfigTlvAck(&update, CONFIG_TLV_ERR_RANGE, 0x01020304, ack, sizeof(ack)) == CONFIG_TLV_ACK_SIZE);
+    assert(memcmp(ack, "\x33\x04\x02\x01\x02\x03\x04", CONFIG_TLV_ACK_SIZE) == 0);
+}
+
+int main(void) {
+    printf("test_config_tlv\n");
+    RUN_TEST(testEveryParameter);
+    RUN_TEST(testModbusEdits);
+    RUN_TEST(testErrorsReportTheOffendingTlv);
+    RUN_TEST(testTooManyEdits);
+    RUN_TEST(testCommitWritesEachPageOnce);
+    RUN_TEST(testCommitChecksASingleThresholdAgainstTheStoredOne);
+    RUN_TEST(testHashCoversTheConfig);
+    return 0;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file test_device_table.c
+ * @brief Fragmented device table download: GF(2) decoder and session answers
+ *
+ * The coded fragments are built here from the TS004 parity matrix, so the
+ * decoder is checked against the encoder the server side runs.
+ */
+
+#include "fakes.h"
+#include "LmhpDeviceTable.h"
+#include <string.h>
+
+#define MAX_BLOCK_SIZE      (DEVICE_TABLE_MAX_NB_FRAG * DEVICE_TABLE_MAX_FRAG_SIZE)
+
+static uint8_t buffer[MAX_BLOCK_SIZE];
+static uint8_t block[MAX_BLOCK_SIZE];
+static uint8_t received[MAX_BLOCK_SIZE];
+static uint32_t receivedSize;
+static uint32_t numReceived;
+static uint8_t appStatus;
+
+static uint8_t onDataBlockReceived(const uint8_t *data, uint32_t size) {
+    memcpy(received, data, size);
+    receivedSize = size;
+    numReceived++;
+    return appStatus;
+}
+
+static LmhpDeviceTableParams_t params = {
+    .Buffer = buffer,
+    .BufferSize = sizeof(buffer),
+    .OnDataBlockReceived = onDataBlockReceived,
+};
+
+static LmhPackage_t *package;
+static uint32_t seed;
+
+static uint32_t nextRandom(void) {
+    seed = (seed * 1103515245U) + 12345U;
+    return seed >> 8;
+}
+
+static void setUp(uint32_t bufferSize) {
+    uint32_t now = fakeTickMs;
+
+    /* The package keeps the time of its last answer, time must not go back */
+    fakeReset();
+    fakeTickMs = now;
+    params.BufferSize = bufferSize;
+    package = LmhpDeviceTablePackageFactory();
+    package->Init(&params, NULL, 0);
+    memset(buffer, 0, sizeof(buffer));
+    receivedSize = 0;
+    numReceived = 0;
+    appStatus = 0;
+}
+
+static void downlink(const uint8_t *payload, uint8_t size) {
+    McpsIndication_t indication = {
+        .Port = DEVICE_TABLE_PORT,
+        .RxData = true,
+        .Buffer = (uint8_t *)payload,
+        .BufferSize = size,
+    };
+
+    package->OnMcpsIndicationProcess(&indication);
+}
+
+/* Lets the answer go out, returns its size or 0 if none was pending */
+static uint8_t answer(void) {
+    if (!package->IsTxPending()) {
+        return 0;
+    }
+    fakeTickMs += 2000;
+    package->Process();
+    assert(!package->IsTxPending() && fakeSentPort == DEVICE_TABLE_PORT);
+    return fakeSentSize;
+}
+
+static uint8_t setup(uint16_t session, uint16_t nbFrag, uint8_t fragSize, uint8_t padding, uint32_t integrity) {
+    const uint32_t descriptor = 0xA5000000U | session;
+    const uint8_t payload[] = {
+        0x01, session & 0xFF, session >> 8, nbFrag & 0xFF, nbFrag >> 8, fragSize, padding,
+        descriptor & 0xFF, (descriptor >> 8) & 0xFF, (descriptor >> 16) & 0xFF, descriptor >> 24,
+        integrity & 0xFF, (integrity >> 8) & 0xFF, (integrity >> 16) & 0xFF, integrity >> 24,
+    };
+
+    downlink(payload, sizeof(payload));
+    assert(answer() == 2 && fakeSentBuffer[0] == 0x01);
+    return fakeSentBuffer[1];
+}
+
+/* TS004 parity matrix line n (1 for the first coded fragment) for m uncoded fragments */
+static int32_t prbs23(int32_t x) {
+    return (x >> 1) + (((x & 0x01) ^ ((x & 0x20) >> 5)) << 22);
+}
+
+static void parityLine(int32_t n, int32_t m, bool *line) {
+    int32_t mm = ((m & (m - 1)) == 0) ? 1 : 0;
+    int32_t x = 1 + (1001 * n);
+
+    memset(line, 0, (size_t)m * sizeof(bool));
+    for (int32_t nbCoeff = 0; nbCoeff < (m / 2); nbCoeff++) {
+        int32_t r = 1 << 16;
+        while (r >= m) {
+            x = prbs23(x);
+            r = x % (m + mm);
+        }
+        line[r] = true;
+    }
+}
+
+/* Sends fragment index, uncoded 1..nbFrag or coded above */
+static void sendFragment(uint16_t index, uint16_t nbFrag, uint8_t fragSize) {
+    uint8_t payload[3 + DEVICE_TABLE_MAX_FRAG_SIZE];
+
+    payload[0] = 0x02;
+    payload[1] = index & 0xFF;
+    payload[2] = index >> 8;
+    if (index <= nbFrag) {
+        memcpy(&payload[3], &block[(index - 1) * fragSize], fragSize);
+    } else {
+        bool line[DEVICE_TABLE_MAX_NB_FRAG];
+
+        memset(&payload[3], 0, fragSize);
+        parityLine(index - nbFrag, nbFrag, line);
+        for (uint16_t i = 0; i < nbFrag; i++) {
+            if (line[i]) {
+                for (uint8_t b = 0; b < fragSize; b++) {
+                    payload[3 + b] ^= block[(i * fragSize) + b];
+                }
+            }
+        }
+    }
+    downlink(payload, 3 + fragSize);
+}
+
+static uint32_t makeBlock(uint16_t session, uint16_t nbFrag, uint8_t fragSize, uint8_t padding) {
+    uint32_t size = ((uint32_t)nbFrag * fragSize) - padding;
+
+    for (uint32_t i = 0; i < size; i++) {
+        block[i] = (uint8_t)nextRandom();
+    }
+    memset(&block[size], 0, padding);
+    return fakeDataBlockCode(block, size, session, 0xA5000000U | session);
+}
+
+/*
+ * Runs a session losing lossPercent of the fragments, uncoded then coded
+ * ones, until the block indication. Returns the fragments the device got.
+ */
+static uint32_t runSession(uint16_t session, uint16_t nbFrag, uint8_t fragSize, uint8_t padding, uint32_t lossPercent) {
+    uint32_t size = ((uint32_t)nbFrag * fragSize) - padding;
+    uint32_t integrity = makeBlock(session, nbFrag, fragSize, padding);
+    uint32_t numSent = 0;
+
+    assert(setup(session, nbFrag, fragSize, padding, integrity) == DEVICE_TABLE_STATUS_OK);
+    for (uint32_t index = 1; index <= (4U * nbFrag) + 16U && numReceived == 0; index++) {
+        if ((nextRandom() % 100) < lossPercent) {
+            continue;
+        }
+        sendFragment((uint16_t)index, nbFrag, fragSize);
+        numSent++;
+    }
+
+    assert(numReceived == 1 && receivedSize == size);
+    assert(memcmp(received, block, size) == 0);
+    assert(answer() == 5);
+    assert(fakeSentBuffer[0] == 0x05 && fakeSentBuffer[1] == (session & 0xFF) && fakeSentBuffer[2] == (session >> 8));
+    assert(fakeSentBuffer[3] == DEVICE_TABLE_STATUS_OK && fakeSentBuffer[4] == 0);
+    return numSent;
+}
+
+static void testUncodedFragmentsInOrder(void) {
+    setUp(sizeof(buffer));
+    seed = 1;
+    assert(runSession(1, 10, 50, 7, 0) == 10);
+}
+
+static void testRecoversLostFragmentsFromCodedOnes(void) {
+    const struct {
+        uint16_t nbFrag;
+        uint8_t fragSize;
+        uint32_t lossPercent;
+    } cases[] = {
+        { 2, 10, 30 },
+        { 16, 48, 10 },
+        { 37, 100, 30 },
+        { 64, 51, 50 },
+        { DEVICE_TABLE_MAX_NB_FRAG, DEVICE_TABLE_MAX_FRAG_SIZE, 30 },
+    };
+
+    for (uint8_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint32_t worst = 0;
+
+        for (seed = 1; seed <= 20; seed++) {
+            uint32_t numSent;
+
+            setUp(sizeof(buffer));
+            numSent = runSession(c + 2, cases[c].nbFrag, cases[c].fragSize, 3, cases[c].lossPercent);
+            assert(numSent >= cases[c].nbFrag);
+            worst = MAX(worst, numSent - cases[c].nbFrag);
+        }
+        printf("    %u fragments, %u%% lost: at most %u received over the fragment count, 20 runs\n",
+               cases[c].nbFrag, cases[c].lossPercent, worst);
+    }
+}
+
+static void testCodedFragmentsOnly(void) {
+    uint32_t integrity;
+
+    setUp(sizeof(buffer));
+    seed = 7;
+    /* Every uncoded fragment lost */
+    integrity = makeBlock(9, 20, 30, 0);
+    assert(setup(9, 20, 30, 0, integrity) == DEVICE_TABLE_STATUS_OK);
+    for (uint16_t index = 21; index <= 200 && numReceived == 0; index++) {
+        sendFragment(index, 20, 30);
+    }
+    assert(numReceived == 1 && memcmp(received, block, 20 * 30) == 0);
+}
+
+static void testBadIntegrityIsNotApplied(void) {
+    uint32_t integrity;
+
+    setUp(sizeof(buffer));
+    seed = 3;
+    integrity = makeBlock(4, 8, 20, 0);
+    assert(setup(4, 8, 20, 0, integrity ^ 1) == DEVICE_TABLE_STATUS_OK);
+    for (uint16_t index = 1; index <= 8; index++) {
+        sendFragment(index, 8, 20);
+    }
+    assert(numReceived == 0);
+    assert(answer() == 5 && fakeSentBuffer[3] == DEVICE_TABLE_STATUS_BAD_INTEGRITY);
+}
+
+static void testApplicationRejectsTheBlock(void) {
+    uint32_t integrity;
+
+    setUp(sizeof(buffer));
+    seed = 4;
+    appStatus = 0x22;
+    integrity = makeBlock(5, 4, 20, 0);
+    assert(setup(5, 4, 20, 0, integrity) == DEVICE_TABLE_STATUS_OK);
+    for (uint16_t index = 1; index <= 4; index++) {
+        sendFragment(index, 4, 20);
+    }
+    assert(numReceived == 1);
+    assert(answer() == 5 && fakeSentBuffer[3] == DEVICE_TABLE_STATUS_REJECTED && fakeSentBuffer[4] == 0x22);
+}
+
+static void testSetupChecks(void) {
+    const uint8_t shortSetup[] = { 0x01, 1, 0, 4, 0, 20, 0 };
+
+    setUp(1000);
+    assert(setup(1, 0, 20, 0, 0) == DEVICE_TABLE_STATUS_BAD_SETUP);
+    assert(setup(1, DEVICE_TABLE_MAX_NB_FRAG + 1, 20, 0, 0) == DEVICE_TABLE_STATUS_BAD_SETUP);
+    assert(setup(1, 4, DEVICE_TABLE_MAX_FRAG_SIZE + 1, 0, 0) == DEVICE_TABLE_STATUS_BAD_SETUP);
+    assert(setup(1, 4, 20, 20, 0) == DEVICE_TABLE_STATUS_BAD_SETUP);
+    assert(setup(1, 51, 20, 0, 0) == DEVICE_TABLE_STATUS_NO_MEMORY);
+    assert(setup(1, 50, 20, 0, 0) == DEVICE_TABLE_STATUS_OK);
+    downlink(shortSetup, sizeof(shortSetup));
+    assert(answer() == 2 && fakeSentBuffer[1] == DEVICE_TABLE_STATUS_BAD_SETUP);
+}
+
+static void testStatusAndDelete(void) {
+    const uint8_t status[] = { 0x03 };
+    const uint8_t remove[] = { 0x04 };
+    uint32_t integrity;
+
+    setUp(sizeof(buffer));
+    seed = 5;
+    integrity = makeBlock(0x0102, 10, 20, 0);
+    assert(setup(0x0102, 10, 20, 0, integrity) == DEVICE_TABLE_STATUS_OK);
+    sendFragment(1, 10, 20);
+    sendFragment(2, 10, 20);
+    sendFragment(2, 10, 20);
+    sendFragment(12, 10, 20);
+
+    /* A repeated setup keeps what was received */
+    assert(setup(0x0102, 10, 20, 0, integrity) == DEVICE_TABLE_STATUS_OK);
+    downlink(status, sizeof(status));
+    assert(answer() == 8);
+    assert(memcmp(fakeSentBuffer, "\x03\x02\x01\x04\x00\x07\x00", 7) == 0);
+    assert(fakeSentBuffer[7] == DEVICE_TABLE_STATUS_IN_PROGRESS);
+
+    downlink(remove, sizeof(remove));
+    assert(answer() == 2 && fakeSentBuffer[1] == DEVICE_TABLE_STATUS_OK);
+    downlink(remove, sizeof(remove));
+    assert(answer() == 2 && fakeSentBuffer[1] == DEVICE_TABLE_STATUS_NO_SESSION);
+
+    /* Fragments without a session are ignored */
+    sendFragment(3, 10, 20);
+    assert(!package->IsTxPending() && numReceived == 0);
+}
+
+int main(void) {
+    printf("test_device_table\n");
+    RUN_TEST(testUncodedFragmentsInOrder);
+    RUN_TEST(testRecoversLostFragmentsFromCodedOnes);
+    RUN_TEST(testCodedFragmentsOnly);
+    RUN_TEST(testBadIntegrityIsNotApplied);
+    RUN_TEST(testApplicationRejectsTheBlock);
+    RUN_TEST(testSetupChecks);
+    RUN_TEST(testStatusAndDelete);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file test_flash_if.c
+ * @brief flash_if.c on the NOR flash model: diff-write, fast rows, page boundaries
+ *
+ * flash_if.c keeps addresses in uint32_t, so the page buffer and every source
+ * buffer live in the SRAM mapped at its real address.
+ */
+
+#include "fakes.h"
+#include "flash_if.h"
+#include <string.h>
+
+#define TEST_PAGE           ((uint8_t *)(FAKE_FLASH_BASE + (96 * FLASH_PAGE_SIZE)))
+#define PAGE_BUFFER         ((uint8_t *)SRAM1_BASE)
+#define SOURCE              ((uint8_t *)(SRAM1_BASE + (2 * FLASH_PAGE_SIZE)))
+
+static void setUp(void) {
+    fakeReset();
+    FLASH_IF_Init(PAGE_BUFFER);
+}
+
+static void fillSource(uint32_t length, uint8_t seed) {
+    for (uint32_t i = 0; i < length; i++) {
+        SOURCE[i] = (uint8_t)(seed + (i * 7));
+    }
+}
+
+static void clearCounters(void) {
+    fakeFlashPrograms = 0;
+    fakeFlashFastRows = 0;
+    fakeFlashErases = 0;
+}
+
+static void testWriteUsesFastRows(void) {
+    setUp();
+    fillSource(FLASH_PAGE_SIZE, 1);
+    assert(FLASH_IF_Write(TEST_PAGE, SOURCE, FLASH_PAGE_SIZE) == FLASH_IF_OK);
+    assert(memcmp(TEST_PAGE, SOURCE, FLASH_PAGE_SIZE) == 0);
+    assert(fakeFlashFastRows == FLASH_PAGE_SIZE / 256 && fakeFlashErases == 0);
+
+    /* A source that is not word aligned goes double word by double word */
+    setUp();
+    memmove(SOURCE + 1, SOURCE, 512);
+    assert(FLASH_IF_Write(TEST_PAGE, SOURCE + 1, 512) == FLASH_IF_OK);
+    assert(memcmp(TEST_PAGE, SOURCE + 1, 512) == 0);
+    assert(fakeFlashFastRows == 0 && fakeFlashPrograms == 512 / 8);
+}
+
+static void testUnchangedDataIsNotWritten(void) {
+    setUp();
+    fillSource(256, 3);
+    assert(FLASH_IF_Write(TEST_PAGE, SOURCE, 256) == FLASH_IF_OK);
+    clearCounters();
+    assert(FLASH_IF_DiffWrite(TEST_PAGE, SOURCE, 256) == FLASH_IF_OK);
+    assert(fakeFlashPrograms == 0 && fakeFlashErases == 0);
+}
+
+static void testOnlyChangedDoubleWordsAreProgrammed(void) {
+    setUp();
+    /* Double words 2 and 5 left erased */
+    fillSource(64, 5);
+    memset(SOURCE + 16, 0xFF, 8);
+    memset(SOURCE + 40, 0xFF, 8);
+    assert(FLASH_IF_Write(TEST_PAGE, SOURCE, 64) == FLASH_IF_OK);
+
+    /* Filling both erased ones and clearing another one to 0 is done in place */
+    clearCounters();
+    fillSource(64, 5);
+    memset(SOURCE + 56, 0x00, 8);
+    assert(FLASH_IF_DiffWrite(TEST_PAGE, SOURCE, 64) == FLASH_IF_OK);
+    assert(memcmp(TEST_PAGE, SOURCE, 64) == 0);
+    assert(fakeFlashPrograms == 3 && fakeFlashErases == 0);
+}
+
+static void testChangedDoubleWordNeedsAnErase(void) {
+    uint8_t before[FLASH_PAGE_SIZE];
+
+    setUp();
+    fillSource(FLASH_PAGE_SIZE, 7);
+    assert(FLASH_IF_Write(TEST_PAGE, SOURCE, FLASH_PAGE_SIZE) == FLASH_IF_OK);
+    memcpy(before, TEST_PAGE, sizeof(before));
+
+    /* One double word in the middle of the page rewritten */
+    clearCounters();
+    fillSource(8, 0x40);
+    assert(FLASH_IF_DiffWrite(TEST_PAGE + 1000, SOURCE, 8) == FLASH_IF_OK);
+    assert(fakeFlashErases == 1 && fakeFlashFastRows == FLASH_PAGE_SIZE / 256);
+    assert(memcmp(TEST_PAGE + 1000, SOURCE, 8) == 0);
+    assert(memcmp(TEST_PAGE, before, 1000) == 0);
+    assert(memcmp(TEST_PAGE + 1008, before + 1008, FLASH_PAGE_SIZE - 1008) == 0);
+
+    /* Without a page buffer the page cannot be rebuilt: nothing is touched */
+    FLASH_IF_Init(NULL);
+    memcpy(before, TEST_PAGE, sizeof(before));
+    clearCounters();
+    fillSource(8, 0x80);
+    assert(FLASH_IF_DiffWrite(TEST_PAGE + 1000, SOURCE, 8) == FLASH_IF_PARAM_ERROR);
+    assert(fakeFlashErases == 0 && fakeFlashPrograms == 0);
+    assert(memcmp(TEST_PAGE, before, sizeof(before)) == 0);
+}
+
+static void testPageBoundary(void) {
+    uint8_t *next = TEST_PAGE + FLASH_PAGE_SIZE;
+    uint8_t *start = next - 32;
+    uint8_t nextPage[FLASH_PAGE_SIZE];
+
+    setUp();
+    fillSource(FLASH_PAGE_SIZE, 9);
+    assert(FLASH_IF_Write(next, SOURCE, FLASH_PAGE_SIZE) == FLASH_IF_OK);
+    fillSource(32, 11);
+    assert(FLASH_IF_Write(start, SOURCE, 32) == FLASH_IF_OK);
+
+    /* 32 bytes on each side, the only change clears a double word of the second page */
+    clearCounters();
+    memcpy(nextPage, next, sizeof(nextPage));
+    fillSource(64, 11);
+    memset(SOURCE + 32, 0x00, 8);
+    memcpy(SOURCE + 40, next + 8, 24);
+    assert(FLASH_IF_DiffWrite(start, SOURCE, 64) == FLASH_IF_OK);
+    assert(memcmp(start, SOURCE, 64) == 0);
+    assert(fakeFlashPrograms == 1 && fakeFlashErases == 0);
+
+    /* A rewrite on the second page erases that page only */
+    clearCounters();
+    memcpy(nextPage, next, sizeof(nextPage));
+    SOURCE[48] ^= 0x55;
+    assert(FLASH_IF_DiffWrite(start, SOURCE, 64) == FLASH_IF_OK);
+    assert(fakeFlashErases == 1);
+    assert(memcmp(start, SOURCE, 64) == 0);
+    assert(memcmp(next + 32, nextPage + 32, FLASH_PAGE_SIZE - 32) == 0);
+
+    /* And on both pages, both are erased */
+    clearCounters();
+    SOURCE[0] ^= 0x55;
+    SOURCE[63] ^= 0x55;
+    assert(FLASH_IF_DiffWrite(start, SOURCE, 64) == FLASH_IF_OK);
+    assert(fakeFlashErases == 2);
+    assert(memcmp(start, SOURCE, 64) == 0);
+}
+
+static void testParameterErrors(void) {
+    setUp();
+    fillSource(16, 13);
+    assert(FLASH_IF_DiffWrite(TEST_PAGE + 4, SOURCE, 8) == FLASH_IF_PARAM_ERROR);
+    assert(FLASH_IF_DiffWrite(TEST_PAGE, SOURCE, 12) == FLASH_IF_PARAM_ERROR);
+    assert(FLASH_IF_DiffWrite(TEST_PAGE, NULL, 8) == FLASH_IF_PARAM_ERROR);
+    assert(FLASH_IF_DiffWrite(SOURCE, SOURCE + 8, 8) == FLASH_IF_PARAM_ERROR);
+    assert(fakeFlashPrograms == 0);
+}
+
+int main(void) {
+    printf("test_flash_if\n");
+    RUN_TEST(testWriteUsesFastRows);
+    RUN_TEST(testUnchangedDataIsNotWritten);
+    RUN_TEST(testOnlyChangedDoubleWordsAreProgrammed);
+    RUN_TEST(testChangedDoubleWordNeedsAnErase);
+    RUN_TEST(testPageBoundary);
+    RUN_TEST(testParameterErrors);
+    return 0;
+}
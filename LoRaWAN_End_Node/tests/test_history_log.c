@@ -0,0 +1,236 @@
+/**
+ * @file test_history_log.c
+ * @brief Flash ring history log: wrap-around, torn and corrupted records, backfill ranges
+ */
+
+#include "fakes.h"
+#include "PWX_HistoryLog.h"
+#include "PWX_TimeSync.h"
+#include <string.h>
+
+#define BACKFILL_SIZE(n)    (HISTORY_BACKFILL_HEADER_SIZE + ((n) * HISTORY_BACKFILL_RECORD_SIZE))
+
+/* Stands in for PWX_TimeSync.c */
+uint32_t getSyncedSeconds(void) {
+    return fakeSysTime.Seconds;
+}
+
+static void setUp(void) {
+    fakeReset();
+    initHistoryLog();
+}
+
+/* Appends a record whose level and timestamp both derive from its sequence number */
+static bool append(void) {
+    HistoryRecord_t record;
+    uint32_t seq = getHistoryNextSeq();
+
+    memset(&record, 0, sizeof(record));
+    record.waterLevelLatest = (uint16_t)(1000 + seq);
+    record.waterLevel = (uint16_t)(2000 + seq);
+    record.vbat = 3300;
+    fakeSysTime.Seconds = 600 * seq;
+    return appendHistoryRecord(&record);
+}
+
+static void checkRecord(uint32_t seq) {
+    HistoryRecord_t record;
+
+    assert(readHistoryRecord(seq, &record));
+    assert(record.seq == seq && record.timestamp == 600 * seq);
+    assert(record.waterLevelLatest == (uint16_t)(1000 + seq) && record.waterLevel == (uint16_t)(2000 + seq));
+}
+
+/* First sequence number of a backfill payload, and the latest level of its i-th record */
+static uint32_t backfillSeq(const uint8_t *payload) {
+    return ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) | ((uint32_t)payload[2] << 8) | payload[3];
+}
+
+static uint16_t backfillLevel(const uint8_t *payload, uint8_t i) {
+    const uint8_t *record = &payload[HISTORY_BACKFILL_HEADER_SIZE + (i * HISTORY_BACKFILL_RECORD_SIZE)];
+
+    return (uint16_t)((record[4] << 8) | record[5]);
+}
+
+/* Power is lost after budget flash operations while appending, then the device boots again */
+static void appendWithPowerLoss(int32_t budget) {
+    fakePowerBudget = budget;
+    if (setjmp(fakePowerLoss) == 0) {
+        append();
+        assert(false);
+    }
+    fakePowerBudget = -1;
+    initHistoryLog();
+}
+
+static void testAppendAndReboot(void) {
+    setUp();
+    assert(getHistoryOldestSeq() == HISTORY_SEQ_NONE && getHistoryNextSeq() == 0);
+    for (uint32_t i = 0; i < 5; i++) {
+        assert(append());
+    }
+    /* One program pass of 4 double words per record */
+    assert(fakeFlashPrograms == 5 * (HISTORY_LOG_RECORD_SIZE / 8) && fakeFlashErases == 0);
+
+    initHistoryLog();
+    assert(getHistoryOldestSeq() == 0 && getHistoryNextSeq() == 5);
+    for (uint32_t seq = 0; seq < 5; seq++) {
+        checkRecord(seq);
+    }
+    assert(append());
+    checkRecord(5);
+}
+
+static void testRingWrapDropsTheOldestPage(void) {
+    HistoryRecord_t record;
+
+    setUp();
+    for (uint32_t i = 0; i < HISTORY_LOG_TOTAL_SLOTS; i++) {
+        assert(append());
+    }
+    assert(fakeFlashErases == 0 && getHistoryOldestSeq() == 0);
+
+    /* The next record erases the first page and drops its records */
+    assert(append());
+    assert(fakeFlashErases == 1);
+    assert(getHistoryOldestSeq() == HISTORY_LOG_SLOTS_PER_PAGE);
+    assert(!readHistoryRecord(0, &record) && !readHistoryRecord(HISTORY_LOG_SLOTS_PER_PAGE - 1, &record));
+    checkRecord(HISTORY_LOG_SLOTS_PER_PAGE);
+    checkRecord(HISTORY_LOG_TOTAL_SLOTS);
+
+    /* A full second lap, then the head found again after a reboot */
+    for (uint32_t i = 0; i < HISTORY_LOG_TOTAL_SLOTS; i++) {
+        assert(append());
+    }
+    initHistoryLog();
+    assert(getHistoryNextSeq() == (2 * HISTORY_LOG_TOTAL_SLOTS) + 1);
+    assert(getHistoryOldestSeq() == getHistoryNextSeq() - HISTORY_LOG_TOTAL_SLOTS + HISTORY_LOG_SLOTS_PER_PAGE - 1);
+    checkRecord(getHistoryOldestSeq());
+    assert(append());
+    checkRecord(getHistoryNextSeq() - 1);
+}
+
+static void testTornRecordIsSkipped(void) {
+    HistoryRecord_t record;
+
+    setUp();
+    for (uint32_t i = 0; i < 3; i++) {
+        assert(append());
+    }
+    /* Two double words of the fourth record programmed, the third one half way */
+    appendWithPowerLoss(2);
+    assert(getHistoryNextSeq() == 3 && getHistoryOldestSeq() == 0);
+    assert(!readHistoryRecord(3, &record));
+
+    /* The torn slot is never written twice: the record goes to the next one */
+    fakeFlashErases = 0;
+    assert(append());
+    assert(fakeFlashErases == 0);
+    checkRecord(3);
+    initHistoryLog();
+    assert(getHistoryNextSeq() == 4);
+    for (uint32_t seq = 0; seq < 4; seq++) {
+        checkRecord(seq);
+    }
+}
+
+static void testPowerLossDuringWrapErase(void) {
+    setUp();
+    for (uint32_t i = 0; i < HISTORY_LOG_TOTAL_SLOTS; i++) {
+        assert(append());
+    }
+    /* The erase of the first page stops half way */
+    appendWithPowerLoss(0);
+    assert(getHistoryNextSeq() == HISTORY_LOG_TOTAL_SLOTS);
+    assert(getHistoryOldestSeq() == HISTORY_LOG_SLOTS_PER_PAGE / 2);
+    checkRecord(HISTORY_LOG_SLOTS_PER_PAGE / 2);
+
+    /* The blank half is used, the old half is skipped, then the ring goes on */
+    for (uint32_t i = 0; i < HISTORY_LOG_SLOTS_PER_PAGE; i++) {
+        assert(append());
+    }
+    checkRecord(HISTORY_LOG_TOTAL_SLOTS);
+    checkRecord(getHistoryNextSeq() - 1);
+    initHistoryLog();
+    assert(getHistoryNextSeq() == HISTORY_LOG_TOTAL_SLOTS + HISTORY_LOG_SLOTS_PER_PAGE);
+    checkRecord(getHistoryNextSeq() - 1);
+}
+
+static void testCorruptedRecordFailsTheCrc(void) {
+    uint8_t payload[64];
+    HistoryRecord_t record;
+    uint32_t nextSeq = 0;
+    uint8_t *level;
+
+    setUp();
+    for (uint32_t i = 0; i < 3; i++) {
+        assert(append());
+    }
+    /* A bit of the second record's level drops to 0 */
+    level = (uint8_t *)HISTORY_LOG_BASE_ADDRESS + HISTORY_LOG_RECORD_SIZE + offsetof(HistoryRecord_t, waterLevel);
+    *level &= (uint8_t)~0x01;
+    assert(!readHistoryRecord(1, &record));
+    checkRecord(0);
+    checkRecord(2);
+
+    /* Backfill stops at the gap, the next request starts after it */
+    assert(buildHistoryBackfill(&nextSeq, 2, payload, sizeof(payload)) == BACKFILL_SIZE(1));
+    assert(backfillSeq(payload) == 0 && nextSeq == 1);
+    assert(buildHistoryBackfill(&nextSeq, 2, payload, sizeof(payload)) == BACKFILL_SIZE(1));
+    assert(backfillSeq(payload) == 2 && backfillLevel(payload, 0) == 1002 && nextSeq == 3);
+
+    /* The same after a reboot, the record stays out of the index */
+    initHistoryLog();
+    assert(getHistoryNextSeq() == 3 && !readHistoryRecord(1, &record));
+}
+
+static void testBackfillRanges(void) {
+    uint8_t payload[BACKFILL_SIZE(8)];
+    uint32_t nextSeq;
+
+    setUp();
+    nextSeq = 0;
+    assert(buildHistoryBackfill(&nextSeq, 9, payload, sizeof(payload)) == 0 && nextSeq == 10);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        assert(append());
+    }
+
+    /* Inside the log: stops after the last requested sequence */
+    nextSeq = 2;
+    assert(buildHistoryBackfill(&nextSeq, 5, payload, sizeof(payload)) == BACKFILL_SIZE(4));
+    assert(backfillSeq(payload) == 2 && nextSeq == 6);
+    for (uint8_t i = 0; i < 4; i++) {
+        assert(backfillLevel(payload, i) == 1002 + i);
+    }
+
+    /* Split over uplinks by the payload size */
+    nextSeq = 0;
+    assert(buildHistoryBackfill(&nextSeq, 9, payload, BACKFILL_SIZE(3) + 5) == BACKFILL_SIZE(3) && nextSeq == 3);
+    assert(buildHistoryBackfill(&nextSeq, 9, payload, BACKFILL_SIZE(3) + 5) == BACKFILL_SIZE(3) && nextSeq == 6);
+    assert(buildHistoryBackfill(&nextSeq, 9, payload, BACKFILL_SIZE(1) - 1) == 0 && nextSeq == 6);
+
+    /* Past the newest record: ends there */
+    nextSeq = 8;
+    assert(buildHistoryBackfill(&nextSeq, 1000, payload, sizeof(payload)) == BACKFILL_SIZE(2) && nextSeq == 10);
+    assert(buildHistoryBackfill(&nextSeq, 1000, payload, sizeof(payload)) == 0 && nextSeq == 10);
+
+    /* Before the oldest record: starts there */
+    for (uint32_t i = 0; i < HISTORY_LOG_TOTAL_SLOTS; i++) {
+        assert(append());
+    }
+    nextSeq = 0;
+    assert(buildHistoryBackfill(&nextSeq, HISTORY_LOG_SLOTS_PER_PAGE + 1, payload, sizeof(payload)) == BACKFILL_SIZE(2));
+    assert(backfillSeq(payload) == HISTORY_LOG_SLOTS_PER_PAGE && nextSeq == HISTORY_LOG_SLOTS_PER_PAGE + 2);
+}
+
+int main(void) {
+    printf("test_history_log\n");
+    RUN_TEST(testAppendAndReboot);
+    RUN_TEST(testRingWrapDropsTheOldestPage);
+    RUN_TEST(testTornRecordIsSkipped);
+    RUN_TEST(testPowerLossDuringWrapErase);
+    RUN_TEST(testCorruptedRecordFailsTheCrc);
+    RUN_TEST(testBackfillRanges);
+    return 0;
+}
@@ -0,0 +1,421 @@
+/**
+ * @file test_idle_governor.c
+ * @brief Idle governor on the real timer list and LPM hooks: break-even, wake-ahead, 3 min / 15 min schedule current
+ */
+
+#include "fakes.h"
+#include "PWX_IdleGovernor.h"
+#include "stm32_lpm.h"
+#include "stm32_timer.h"
+#include "utilities_def.h"
+#include "usart_if.h"
+
+#define CORE_MHZ            48
+#define SAMPLE_MS           (3 * 60 * 1000)
+#define TX_MS               (15 * 60 * 1000)
+#define RX1_DELAY_MS        1000
+#define RX2_DELAY_MS        2000
+#define DAY_US              (24ULL * 3600 * 1000000)
+
+/* What the schedule spends awake, model figures for the report */
+#define SAMPLE_WORK_US      3600000     // sensor warm-up and ten level reads, HAL_Delay() in between
+#define TX_WORK_US          60000       // airtime of the uplink
+#define TX_UA               25000       // MCU and radio at 14 dBm
+#define RX_WORK_US          20000       // an empty receive window
+#define RX_UA               8000
+
+typedef enum {
+    POLICY_GOVERNOR = 0,
+    POLICY_STOP2,                       // STOP2 whenever UTIL_LPM allows it, as before the governor
+    POLICY_SLEEP,
+} Policy_t;
+
+/* A UTIL_TIMER and when it was due */
+typedef struct {
+    UTIL_TIMER_Object_t timer;
+    uint64_t deadlineUs;
+    uint32_t fired;
+} SimTimer_t;
+
+static Policy_t policy;
+static uint64_t nowUs;
+static uint64_t endUs;
+static uint64_t chargeUaUs;
+static uint64_t awakeUs;
+static uint32_t restoreUs;              // what vcom_Resume() and the clock restore take after STOP2
+static bool isAlarmArmed;
+static uint64_t alarmUs;
+static uint32_t timerContext;
+static int64_t worstLateUs;
+
+static SimTimer_t sample;
+static SimTimer_t rx1;
+static SimTimer_t rx2;
+static SimTimer_t poll;
+static uint32_t samples;
+static uint32_t pollsLeft;
+
+/* Stands in for system_stm32wlxx.c */
+uint32_t SystemCoreClock = CORE_MHZ * 1000000;
+
+/* The core counts cycles while it runs only */
+static void advance(uint64_t us, uint32_t ua, bool isRunning) {
+    nowUs += us;
+    chargeUaUs += us * ua;
+    fakeTickMs = (uint32_t)(nowUs / 1000);
+    if (isRunning) {
+        awakeUs += us;
+        DWT->CYCCNT += (uint32_t)(us * CORE_MHZ);
+    }
+}
+
+static void work(uint64_t us, uint32_t ua) {
+    advance(us, ua, true);
+}
+
+/* Stands in for timer_if.c: the RTC ticks in ms here, the alarm is absolute */
+static uint32_t nowTicks(void) {
+    return (uint32_t)(nowUs / 1000);
+}
+
+static UTIL_TIMER_Status_t timerInit(void) {
+    isAlarmArmed = false;
+    timerContext = 0;
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t timerDeInit(void) {
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t timerStart(uint32_t timeout) {
+    isAlarmArmed = true;
+    alarmUs = (uint64_t)(timerContext + timeout) * 1000;
+    return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t timerStop(void) {
+    isAlarmArmed = false;
+    return UTIL_TIMER_OK;
+}
+
+static uint32_t timerSetContext(void) {
+    timerContext = nowTicks();
+    return timerContext;
+}
+
+static uint32_t timerGetContext(void) {
+    return timerContext;
+}
+
+static uint32_t timerElapsed(void) {
+    return nowTicks() - timerContext;
+}
+
+static uint32_t timerValue(void) {
+    return nowTicks();
+}
+
+static uint32_t timerMinimum(void) {
+    return 1;
+}
+
+static uint32_t timerSameUnit(uint32_t value) {
+    return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver = {
+    timerInit, timerDeInit, timerStart, timerStop, timerSetContext, timerGetContext,
+    timerElapsed, timerValue, timerMinimum, timerSameUnit, timerSameUnit,
+};
+
+/* Stands in for the HAL: WFI idles in the mode until the RTC alarm, taken once, or the end of the run */
+static void waitForInterrupt(uint32_t ua) {
+    uint64_t wakeUs = endUs;
+
+    if (isAlarmArmed && alarmUs < endUs) {
+        wakeUs = alarmUs;
+        isAlarmArmed = false;
+    }
+    if (wakeUs > nowUs) {
+        advance(wakeUs - nowUs, ua, false);
+    }
+}
+
+void HAL_SuspendTick(void) {
+}
+
+void HAL_ResumeTick(void) {
+}
+
+void HAL_PWREx_EnterSTOP2Mode(uint8_t STOPEntry) {
+    waitForInterrupt(IDLE_GOV_STOP2_UA);
+    /* Regulator and MSI back before the first instruction */
+    advance(IDLE_GOV_STOP2_WAKEUP_US, IDLE_GOV_RUN_UA, false);
+}
+
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry) {
+    waitForInterrupt(IDLE_GOV_SLEEP_UA);
+}
+
+/* Stands in for usart_if.c, with the rest of the restore the governor times */
+void vcom_Resume(void) {
+    work(restoreUs, IDLE_GOV_RUN_UA);
+}
+
+/* UTIL_SEQ_Idle() and the RTC alarm interrupt, until untilUs */
+static void runUntil(uint64_t untilUs) {
+    endUs = untilUs;
+    while (nowUs < endUs) {
+        if (policy == POLICY_GOVERNOR) {
+            idleGovernorSelect();
+        }
+        UTIL_LPM_EnterLowPower();
+        UTIL_TIMER_IRQ_Handler();
+    }
+}
+
+static void arm(SimTimer_t *simTimer, uint32_t periodMs) {
+    UTIL_TIMER_SetPeriod(&simTimer->timer, periodMs);
+    UTIL_TIMER_Start(&simTimer->timer);
+    simTimer->deadlineUs = ((uint64_t)nowTicks() + periodMs) * 1000;
+}
+
+static void served(SimTimer_t *simTimer) {
+    int64_t lateUs = (int64_t)(nowUs - simTimer->deadlineUs);
+
+    simTimer->fired++;
+    if (lateUs > worstLateUs) {
+        worstLateUs = lateUs;
+    }
+}
+
+static void OnRxEvent(void *context) {
+    served(context);
+    work(RX_WORK_US, RX_UA);
+}
+
+/* SendTxData() on every sample, an uplink and its two receive windows on every fifth */
+static void OnSampleEvent(void *context) {
+    served(&sample);
+    work(SAMPLE_WORK_US, IDLE_GOV_RUN_UA);
+    if ((++samples % (TX_MS / SAMPLE_MS)) == 0) {
+        work(TX_WORK_US, TX_UA);
+        arm(&rx1, RX1_DELAY_MS);
+        arm(&rx2, RX2_DELAY_MS);
+    }
+    arm(&sample, SAMPLE_MS);
+}
+
+/* A short task re-armed every ms */
+static void OnPollEvent(void *context) {
+    served(&poll);
+    work(100, IDLE_GOV_RUN_UA);
+    if (--pollsLeft > 0) {
+        arm(&poll, 1);
+    }
+}
+
+static void setUp(Policy_t newPolicy, uint32_t newRestoreUs) {
+    fakeReset();
+    policy = newPolicy;
+    nowUs = 0;
+    chargeUaUs = 0;
+    awakeUs = 0;
+    restoreUs = newRestoreUs;
+    worstLateUs = 0;
+    samples = 0;
+    UTIL_TIMER_Init();
+    UTIL_LPM_Init();
+    /* As SystemApp_Init() */
+    UTIL_LPM_SetOffMode((1 << CFG_LPM_APPLI_Id), UTIL_LPM_DISABLE);
+    if (policy == POLICY_SLEEP) {
+        UTIL_LPM_SetStopMode((1 << CFG_LPM_APPLI_Id), UTIL_LPM_DISABLE);
+    }
+    initIdleGovernor();
+    UTIL_TIMER_Create(&sample.timer, SAMPLE_MS, UTIL_TIMER_ONESHOT, OnSampleEvent, &sample);
+    UTIL_TIMER_Create(&rx1.timer, RX1_DELAY_MS, UTIL_TIMER_ONESHOT, OnRxEvent, &rx1);
+    UTIL_TIMER_Create(&rx2.timer, RX2_DELAY_MS, UTIL_TIMER_ONESHOT, OnRxEvent, &rx2);
+    UTIL_TIMER_Create(&poll.timer, 1, UTIL_TIMER_ONESHOT, OnPollEvent, &poll);
+    sample.fired = 0;
+    rx1.fired = 0;
+    rx2.fired = 0;
+    poll.fired = 0;
+}
+
+/* One STOP2 exit, for the governor to time the restore */
+static void measureExit(void) {
+    uint32_t fired = rx1.fired;
+
+    arm(&rx1, 1000);
+    runUntil(rx1.deadlineUs + 1);
+    assert(rx1.fired == fired + 1);
+}
+
+/* The mode the governor picks for a deadline gapMs away, then the deadline is served */
+static IdleMode_t firstIdleMode(uint32_t gapMs) {
+    uint32_t stopEntries = getIdleEntries(IDLE_MODE_STOP2);
+    uint32_t fired = rx2.fired;
+
+    arm(&rx2, gapMs);
+    idleGovernorSelect();
+    UTIL_LPM_EnterLowPower();
+    UTIL_TIMER_IRQ_Handler();
+    runUntil(rx2.deadlineUs + 1);
+    assert(rx2.fired == fired + 1);
+    return (getIdleEntries(IDLE_MODE_STOP2) > stopEntries) ? IDLE_MODE_STOP2 : IDLE_MODE_SLEEP;
+}
+
+static void testExitLatencyIsMeasured(void) {
+    setUp(POLICY_GOVERNOR, 600);
+    assert(getStopExitLatencyUs() == IDLE_GOV_STOP2_WAKEUP_US);
+    measureExit();
+    /* The first exit is taken as is, at the entry clock */
+    assert(getStopExitLatencyUs() == IDLE_GOV_STOP2_WAKEUP_US + 600);
+
+    /* Then an eighth of the way each exit */
+    restoreUs = 1400;
+    measureExit();
+    assert(getStopExitLatencyUs() == IDLE_GOV_STOP2_WAKEUP_US + 600 + (1400 / 8) - (600 / 8));
+    for (uint8_t i = 0; i < 40; i++) {
+        measureExit();
+    }
+    assert(getStopExitLatencyUs() >= IDLE_GOV_STOP2_WAKEUP_US + 1400 - 8 &&
+           getStopExitLatencyUs() <= IDLE_GOV_STOP2_WAKEUP_US + 1400);
+
+    /* Sleep exits are not STOP2 exits */
+    assert(firstIdleMode(1) == IDLE_MODE_SLEEP);
+    assert(getStopExitLatencyUs() >= IDLE_GOV_STOP2_WAKEUP_US + 1400 - 8);
+}
+
+static void testBreakEven(void) {
+    const uint32_t restores[] = { 300, 1500, 4000 };
+    uint32_t entries;
+
+    for (uint8_t r = 0; r < sizeof(restores) / sizeof(restores[0]); r++) {
+        uint64_t latencyUs;
+
+        setUp(POLICY_GOVERNOR, restores[r]);
+        measureExit();
+        latencyUs = getStopExitLatencyUs();
+        assert(latencyUs == IDLE_GOV_STOP2_WAKEUP_US + restores[r]);
+        for (uint32_t gapMs = 1; gapMs <= 20; gapMs++) {
+            /* Idle gapMs in sleep, or the exit at the run current and the rest in STOP2 */
+            uint64_t sleepCharge = (uint64_t)IDLE_GOV_SLEEP_UA * gapMs * 1000;
+            uint64_t stopCharge = (IDLE_GOV_RUN_UA * latencyUs) + (IDLE_GOV_STOP2_UA * ((gapMs * 1000) - latencyUs));
+            IdleMode_t expected = ((gapMs * 1000) > latencyUs && stopCharge < sleepCharge) ? IDLE_MODE_STOP2
+                                                                                            : IDLE_MODE_SLEEP;
+
+            assert(firstIdleMode(gapMs) == expected);
+        }
+    }
+    /* 4 ms of restore: STOP2 pays off from 13 ms on */
+    assert(firstIdleMode(12) == IDLE_MODE_SLEEP && firstIdleMode(13) == IDLE_MODE_STOP2);
+
+    /* No timer running, STOP2 until an interrupt */
+    entries = getIdleEntries(IDLE_MODE_STOP2);
+    runUntil(nowUs + 10000);
+    assert(getIdleEntries(IDLE_MODE_STOP2) == entries + 1);
+}
+
+static void testWakeAheadServesTheDeadline(void) {
+    /* Without the governor the timer is served one exit late */
+    setUp(POLICY_STOP2, 900);
+    measureExit();
+    worstLateUs = 0;
+    arm(&rx2, 100);
+    runUntil(nowUs + 200000);
+    assert(rx2.fired == 1 && worstLateUs == IDLE_GOV_STOP2_WAKEUP_US + 900);
+
+    /* With it, STOP2 ends a ms ahead and the remainder is spent in sleep */
+    setUp(POLICY_GOVERNOR, 900);
+    measureExit();
+    worstLateUs = 0;
+    assert(firstIdleMode(100) == IDLE_MODE_STOP2);
+    assert(worstLateUs == 0);
+    assert(getIdleEntries(IDLE_MODE_SLEEP) == 1);
+
+    /* Exits under IDLE_GOV_PREARM_MIN_US are not worth an early wake */
+    setUp(POLICY_GOVERNOR, 300);
+    measureExit();
+    worstLateUs = 0;
+    assert(firstIdleMode(100) == IDLE_MODE_STOP2);
+    assert(worstLateUs == IDLE_GOV_STOP2_WAKEUP_US + 300 && getIdleEntries(IDLE_MODE_SLEEP) == 0);
+}
+
+static uint64_t pollBurstCharge(Policy_t burstPolicy) {
+    setUp(burstPolicy, 900);
+    measureExit();
+    chargeUaUs = 0;
+    pollsLeft = 200;
+    arm(&poll, 1);
+    /* Long enough for STOP2, where every exit makes the next poll late */
+    runUntil(nowUs + 1000000);
+    assert(poll.fired == 200);
+    return chargeUaUs;
+}
+
+static void testShortDeadlinesStayInSleep(void) {
+    uint64_t governor = pollBurstCharge(POLICY_GOVERNOR);
+    uint32_t stopEntries = getIdleEntries(IDLE_MODE_STOP2);
+    uint64_t stop = pollBurstCharge(POLICY_STOP2);
+
+    /* The measuring exit and the tail after the burst only */
+    assert(stopEntries <= 3);
+    assert(governor < stop);
+    printf("    200 polls 1 ms apart: %llu nC with the governor, %llu nC in STOP2\n",
+           (unsigned long long)(governor / 1000), (unsigned long long)(stop / 1000));
+}
+
+/* 24 h of the schedule, the average current in uA */
+static double runSchedule(Policy_t schedulePolicy) {
+    setUp(schedulePolicy, 900);
+    /* The governor is served late once, by the exit it has not timed yet */
+    measureExit();
+    worstLateUs = 0;
+    arm(&sample, SAMPLE_MS);
+    runUntil(DAY_US);
+    /* Re-armed once the sample is done, as the TxTimer is */
+    assert(sample.fired == DAY_US / (((uint64_t)SAMPLE_MS * 1000) + SAMPLE_WORK_US) || sample.fired == 470);
+    assert(rx2.fired == sample.fired / (TX_MS / SAMPLE_MS));
+    return (double)chargeUaUs / (double)nowUs;
+}
+
+static void testSampleAndTransmitSchedule(void) {
+    double governor;
+    double stop;
+    double sleep;
+    int64_t governorLateUs;
+    int64_t stopLateUs;
+    uint64_t idleMs;
+    uint32_t residencyMs;
+    uint32_t entries;
+
+    governor = runSchedule(POLICY_GOVERNOR);
+    governorLateUs = worstLateUs;
+    idleMs = (nowUs - awakeUs) / 1000;
+    residencyMs = getIdleResidencyMs(IDLE_MODE_SLEEP) + getIdleResidencyMs(IDLE_MODE_STOP2);
+    entries = getIdleEntries(IDLE_MODE_SLEEP) + getIdleEntries(IDLE_MODE_STOP2);
+    /* Residency is counted in HAL ticks, a ms per entry at most */
+    assert(residencyMs <= idleMs + entries && residencyMs + entries >= idleMs);
+    assert(getIdleResidencyMs(IDLE_MODE_STOP2) > (idleMs * 999) / 1000);
+    stop = runSchedule(POLICY_STOP2);
+    stopLateUs = worstLateUs;
+    sleep = runSchedule(POLICY_SLEEP);
+    printf("    3 min sample / 15 min TX over 24 h: %.2f uA with the governor, %.2f uA STOP2 only, %.2f uA sleep only\n",
+           governor, stop, sleep);
+
+    /* The sample dominates; the early wakes cost next to nothing and serve every timer on time */
+    assert(governor <= stop * 1.001 && governor * 10 < sleep);
+    assert(governorLateUs == 0 && stopLateUs == IDLE_GOV_STOP2_WAKEUP_US + 900 && worstLateUs == 0);
+}
+
+int main(void) {
+    printf("test_idle_governor\n");
+    RUN_TEST(testExitLatencyIsMeasured);
+    RUN_TEST(testBreakEven);
+    RUN_TEST(testWakeAheadServesTheDeadline);
+    RUN_TEST(testShortDeadlinesStayInSleep);
+    RUN_TEST(testSampleAndTransmitSchedule);
+    return 0;
+}
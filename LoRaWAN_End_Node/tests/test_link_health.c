@@ -0,0 +1,169 @@
+/**
+ * @file test_link_health.c
+ * @brief Confirmed-uplink policy: evidence interval, degraded link, misses and outage threshold
+ */
+
+#include "fakes.h"
+#include "PWX_LinkHealth.h"
+
+#define INTERVAL        5
+
+/* One scheduled uplink as lora_app.c sends it, optionally answered by a downlink */
+static LinkUplinkType_t uplink(bool answered, int8_t snr, uint8_t margin) {
+    LinkUplinkType_t type = getLinkUplinkType(INTERVAL);
+
+    linkHealthOnTx(type, (type == LINK_UPLINK_CONFIRMED) && answered);
+    if (answered && type != LINK_UPLINK_UNCONFIRMED) {
+        linkHealthOnRx(-90, snr, type == LINK_UPLINK_LINK_CHECK, margin, 1);
+    }
+    return type;
+}
+
+/* Unacknowledged confirmed uplinks until the policy asks for a rejoin */
+static uint8_t missesToOutage(void) {
+    uint8_t misses = 0;
+
+    while (!isLinkOutage()) {
+        linkHealthOnTx(LINK_UPLINK_CONFIRMED, false);
+        misses++;
+        assert(misses <= LINK_HEALTH_OUTAGE_MAX_MISSES + 1);
+    }
+    return misses;
+}
+
+static void testLinkCheckOnceEveryInterval(void) {
+    fakeReset();
+    initLinkHealth();
+    for (uint8_t cycle = 0; cycle < 3; cycle++) {
+        for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+            assert(uplink(true, 5, 20) == LINK_UPLINK_UNCONFIRMED);
+        }
+        assert(uplink(true, 5, 20) == LINK_UPLINK_LINK_CHECK);
+    }
+    assert(!isLinkOutage());
+}
+
+static void testLowMarginAsksForConfirmedUplinks(void) {
+    fakeReset();
+    initLinkHealth();
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        uplink(true, 5, 0);
+    }
+    assert(uplink(true, 5, LINK_HEALTH_MARGIN_GOOD_DB - 1) == LINK_UPLINK_LINK_CHECK);
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        assert(uplink(true, 5, 0) == LINK_UPLINK_UNCONFIRMED);
+    }
+    assert(uplink(true, 5, 0) == LINK_UPLINK_CONFIRMED);
+
+    /* No LinkCheckAns expected: a LinkCheck flag left set does not update the margin */
+    linkHealthOnRx(-90, 5, true, 30, 2);
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        uplink(true, 5, 0);
+    }
+    assert(getLinkUplinkType(INTERVAL) == LINK_UPLINK_CONFIRMED);
+}
+
+static void testNoGatewayOrLowSnrIsDegraded(void) {
+    fakeReset();
+    initLinkHealth();
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        uplink(true, 5, 0);
+    }
+    /* LinkCheckAns from no gateway */
+    assert(getLinkUplinkType(INTERVAL) == LINK_UPLINK_LINK_CHECK);
+    linkHealthOnTx(LINK_UPLINK_LINK_CHECK, false);
+    linkHealthOnRx(-90, 5, true, 20, 0);
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        uplink(true, 5, 0);
+    }
+    assert(getLinkUplinkType(INTERVAL) == LINK_UPLINK_CONFIRMED);
+
+    /* Good margin, but the averaged downlink SNR is below the floor */
+    initLinkHealth();
+    for (uint8_t i = 0; i < 8; i++) {
+        linkHealthOnRx(-120, LINK_HEALTH_SNR_LOW_DB - 4, false, 0, 0);
+    }
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        assert(uplink(true, LINK_HEALTH_SNR_LOW_DB - 4, 20) == LINK_UPLINK_UNCONFIRMED);
+    }
+    assert(uplink(true, LINK_HEALTH_SNR_LOW_DB - 4, 20) == LINK_UPLINK_CONFIRMED);
+}
+
+static void testMissedLinkCheckTurnsConfirmedUntilAnswered(void) {
+    fakeReset();
+    initLinkHealth();
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        uplink(true, 5, 20);
+    }
+    assert(uplink(false, 5, 20) == LINK_UPLINK_LINK_CHECK);
+
+    /* The unanswered LinkCheckReq is a miss: every uplink is confirmed now */
+    assert(uplink(false, 5, 20) == LINK_UPLINK_CONFIRMED);
+    assert(uplink(false, 5, 20) == LINK_UPLINK_CONFIRMED);
+    assert(!isLinkOutage());
+    assert(uplink(true, 5, 20) == LINK_UPLINK_CONFIRMED);
+
+    /* The ACK ends the run, the interval starts over */
+    for (uint8_t i = 0; i < INTERVAL - 1; i++) {
+        assert(uplink(true, 5, 20) == LINK_UPLINK_UNCONFIRMED);
+    }
+    assert(uplink(true, 5, 20) == LINK_UPLINK_LINK_CHECK);
+}
+
+static void testOutageThresholdFollowsTheLossRate(void) {
+    uint8_t cleanThreshold;
+    uint8_t lossyThreshold;
+
+    /* 12.5% loss until measured: the minimum run */
+    fakeReset();
+    initLinkHealth();
+    assert(missesToOutage() == LINK_HEALTH_OUTAGE_MIN_MISSES);
+
+    /* A clean link stays at the minimum */
+    initLinkHealth();
+    for (uint8_t i = 0; i < 100; i++) {
+        uplink(true, 5, 20);
+    }
+    cleanThreshold = missesToOutage();
+    assert(cleanThreshold == LINK_HEALTH_OUTAGE_MIN_MISSES);
+
+    /* A lossy link needs a longer run before it counts as an outage */
+    initLinkHealth();
+    for (uint8_t i = 0; i < 40; i++) {
+        uplink(false, 5, 20);
+        uplink(false, 5, 20);
+        uplink(true, 5, 20);
+    }
+    lossyThreshold = missesToOutage();
+    assert(lossyThreshold > cleanThreshold && lossyThreshold <= LINK_HEALTH_OUTAGE_MAX_MISSES);
+
+    /* A downlink during the run clears the outage */
+    linkHealthOnRx(-90, 5, false, 0, 0);
+    assert(!isLinkOutage());
+}
+
+static void testRunOfMissesDoesNotRaiseItsOwnThreshold(void) {
+    fakeReset();
+    initLinkHealth();
+    /* The misses only enter the loss rate when the run ends, so the outage holds from the minimum on */
+    for (uint8_t i = 1; i <= 3 * LINK_HEALTH_OUTAGE_MAX_MISSES; i++) {
+        linkHealthOnTx(LINK_UPLINK_CONFIRMED, false);
+        assert(isLinkOutage() == (i >= LINK_HEALTH_OUTAGE_MIN_MISSES));
+    }
+
+    /* After the rejoin the statistics start over */
+    initLinkHealth();
+    assert(!isLinkOutage());
+    assert(getLinkUplinkType(INTERVAL) == LINK_UPLINK_UNCONFIRMED);
+}
+
+int main(void) {
+    printf("test_link_health\n");
+    RUN_TEST(testLinkCheckOnceEveryInterval);
+    RUN_TEST(testLowMarginAsksForConfirmedUplinks);
+    RUN_TEST(testNoGatewayOrLowSnrIsDegraded);
+    RUN_TEST(testMissedLinkCheckTurnsConfirmedUntilAnswered);
+    RUN_TEST(testOutageThresholdFollowsTheLossRate);
+    RUN_TEST(testRunOfMissesDoesNotRaiseItsOwnThreshold);
+    return 0;
+}
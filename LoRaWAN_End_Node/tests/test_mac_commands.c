@@ -0,0 +1,189 @@
+/**
+ * @file test_mac_commands.c
+ * @brief MAC command slots: free bitmap allocation, unlinking at head, middle and tail, double removal
+ */
+
+#include "fakes.h"
+#include "LoRaMacCommands.h"
+#include <string.h>
+
+/* CIDs with no meaning to the stack: neither sticky nor confirmed */
+#define CID(n)      ((uint8_t)(0x80 + (n)))
+
+static uint8_t listed[256];
+
+static LoRaMacCommandStatus_t tryAdd(uint8_t cid) {
+    uint8_t payload = (uint8_t)~cid;
+
+    return LoRaMacCommandsAddCmd(cid, &payload, 1);
+}
+
+static void add(uint8_t cid) {
+    assert(tryAdd(cid) == LORAMAC_COMMANDS_SUCCESS);
+}
+
+static MacCommand_t *find(uint8_t cid) {
+    MacCommand_t *command = NULL;
+
+    assert(LoRaMacCommandsGetCmd(cid, &command) == LORAMAC_COMMANDS_SUCCESS);
+    return command;
+}
+
+static void removeCid(uint8_t cid) {
+    assert(LoRaMacCommandsRemoveCmd(find(cid)) == LORAMAC_COMMANDS_SUCCESS);
+}
+
+/* Walks the list through its serialization, returns the number of commands in it */
+static uint8_t listCommands(void) {
+    uint8_t buffer[256];
+    size_t size = 0;
+    size_t counted = 0;
+    uint8_t count = 0;
+
+    assert(LoRaMacCommandsGetSizeSerializedCmds(&counted) == LORAMAC_COMMANDS_SUCCESS);
+    assert(LoRaMacCommandsSerializeCmds(sizeof(buffer), &size, buffer) == LORAMAC_COMMANDS_SUCCESS);
+    assert(size == counted && (size % 2) == 0);
+    for (size_t i = 0; i < size; i += 2) {
+        assert(buffer[i + 1] == (uint8_t)~buffer[i]);
+        listed[count++] = buffer[i];
+    }
+    return count;
+}
+
+static void checkList(const uint8_t *expected, uint8_t count) {
+    assert(listCommands() == count);
+    assert(memcmp(listed, expected, count) == 0);
+}
+
+#define CHECK_LIST(...)                                                         \
+    do {                                                                        \
+        const uint8_t expected[] = { __VA_ARGS__ };                             \
+        checkList(expected, sizeof(expected));                                  \
+    } while (0)
+
+static void setUp(void) {
+    fakeReset();
+    assert(LoRaMacCommandsInit() == LORAMAC_COMMANDS_SUCCESS);
+}
+
+/* Adds commands from CID(first) on until the slots run out, returns the last CID number + 1 */
+static uint8_t fill(uint8_t first) {
+    while (tryAdd(CID(first)) == LORAMAC_COMMANDS_SUCCESS) {
+        first++;
+        assert(first <= 32);
+    }
+    return first;
+}
+
+static void testEverySlotIsUsed(void) {
+    uint8_t slots;
+
+    setUp();
+    /* 15 slots, 32 with LoRaWAN 1.1 */
+    slots = fill(0);
+    assert(slots == 15 || slots == 32);
+    assert(tryAdd(CID(slots)) == LORAMAC_COMMANDS_ERROR_MEMORY);
+
+    /* A freed slot in the middle is found again, the command goes to the tail */
+    removeCid(CID(slots / 2));
+    add(CID(slots));
+    assert(tryAdd(CID(slots + 1)) == LORAMAC_COMMANDS_ERROR_MEMORY);
+
+    /* Empty again, every slot is free */
+    for (uint8_t i = 0; i <= slots; i++) {
+        if (i != slots / 2) {
+            removeCid(CID(i));
+        }
+    }
+    for (uint8_t i = 0; i < slots; i++) {
+        add(CID(i));
+    }
+    assert(listCommands() == slots);
+    for (uint8_t i = 0; i < slots; i++) {
+        assert(listed[i] == CID(i));
+    }
+}
+
+static void testRemoveHeadMiddleAndTail(void) {
+    setUp();
+    for (uint8_t i = 0; i < 6; i++) {
+        add(CID(i));
+    }
+    removeCid(CID(0));
+    CHECK_LIST(CID(1), CID(2), CID(3), CID(4), CID(5));
+    removeCid(CID(3));
+    CHECK_LIST(CID(1), CID(2), CID(4), CID(5));
+    removeCid(CID(5));
+    CHECK_LIST(CID(1), CID(2), CID(4));
+
+    /* The links left by those removals still hold */
+    add(CID(6));
+    removeCid(CID(4));
+    CHECK_LIST(CID(1), CID(2), CID(6));
+    removeCid(CID(2));
+    CHECK_LIST(CID(1), CID(6));
+    removeCid(CID(6));
+    add(CID(7));
+    removeCid(CID(1));
+    CHECK_LIST(CID(7));
+    removeCid(CID(7));
+    assert(listCommands() == 0);
+}
+
+static void testDoubleRemoveIsRejected(void) {
+    MacCommand_t notASlot;
+    MacCommand_t *middle;
+    size_t size;
+
+    setUp();
+    add(CID(0));
+    add(CID(1));
+    add(CID(2));
+    middle = find(CID(1));
+    assert(LoRaMacCommandsRemoveCmd(middle) == LORAMAC_COMMANDS_SUCCESS);
+    assert(LoRaMacCommandsRemoveCmd(middle) == LORAMAC_COMMANDS_ERROR_CMD_NOT_FOUND);
+
+    memset(&notASlot, 0, sizeof(notASlot));
+    assert(LoRaMacCommandsRemoveCmd(&notASlot) == LORAMAC_COMMANDS_ERROR_CMD_NOT_FOUND);
+    assert(LoRaMacCommandsRemoveCmd(NULL) == LORAMAC_COMMANDS_ERROR_NPE);
+
+    assert(LoRaMacCommandsGetSizeSerializedCmds(&size) == LORAMAC_COMMANDS_SUCCESS && size == 4);
+    CHECK_LIST(CID(0), CID(2));
+    removeCid(CID(2));
+    CHECK_LIST(CID(0));
+}
+
+static void testStickyAndOversizedCommands(void) {
+    uint8_t payload = (uint8_t)~MOTE_MAC_RX_PARAM_SETUP_ANS;
+    uint8_t buffer[8];
+    uint8_t slots;
+    size_t size;
+
+    setUp();
+    add(CID(0));
+    assert(LoRaMacCommandsAddCmd(MOTE_MAC_RX_PARAM_SETUP_ANS, &payload, 1) == LORAMAC_COMMANDS_SUCCESS);
+    add(CID(1));
+    add(CID(2));
+    assert(LoRaMacCommandsRemoveNoneStickyCmds() == LORAMAC_COMMANDS_SUCCESS);
+    CHECK_LIST(MOTE_MAC_RX_PARAM_SETUP_ANS);
+    assert(LoRaMacCommandsRemoveStickyAnsCmds() == LORAMAC_COMMANDS_SUCCESS);
+    assert(listCommands() == 0);
+
+    /* What does not fit in the frame is dropped and its slot freed */
+    for (uint8_t i = 0; i < 10; i++) {
+        add(CID(i));
+    }
+    assert(LoRaMacCommandsSerializeCmds(5, &size, buffer) == LORAMAC_COMMANDS_SUCCESS && size == 4);
+    CHECK_LIST(CID(0), CID(1));
+    slots = fill(2);
+    assert((slots == 15 || slots == 32) && listCommands() == slots);
+}
+
+int main(void) {
+    printf("test_mac_commands\n");
+    RUN_TEST(testEverySlotIsUsed);
+    RUN_TEST(testRemoveHeadMiddleAndTail);
+    RUN_TEST(testDoubleRemoveIsRejected);
+    RUN_TEST(testStickyAndOversizedCommands);
+    return 0;
+}
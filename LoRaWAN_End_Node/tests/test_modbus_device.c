@@ -0,0 +1,213 @@
+/**
+ * @file test_modbus_device.c
+ * @brief Segment scan in place: CTZ register filter over all 64 validAddresses bits, recorded replies, CRC check
+ */
+
+#include "fakes.h"
+#include "PWX_ModbusDevice.h"
+#include "PWX_ClockPolicy.h"
+#include <string.h>
+
+/* Stands in for lora_app.c */
+uint32_t ModbusBaudRates[] = { 9600, 19200, 38400, 115200 };
+uint32_t StopBitSettings[] = { UART_STOPBITS_1, UART_STOPBITS_1, UART_STOPBITS_2 };
+uint32_t ParitySettings[] = { UART_PARITY_NONE, UART_PARITY_EVEN, UART_PARITY_ODD };
+uint8_t activeDeviceIndex;
+uint8_t activeDeviceSegment;
+
+/* Stands in for PWX_ClockPolicy.c */
+static int32_t clockVotes;
+
+void requestClockLevel(ClockUser_t user, ClockLevel_t level) {
+    clockVotes++;
+}
+
+void releaseClockLevel(ClockUser_t user) {
+    clockVotes--;
+}
+
+/* Holding registers 0..9 of a pump controller */
+static const uint8_t recordedRegisters[] = {
+    0x01, 0x03, 0x14, 0x00, 0x64, 0x09, 0x1A, 0x00, 0x00, 0x13, 0x88, 0x00, 0x32, 0xFF, 0xF6,
+    0x01, 0x2C, 0x00, 0x07, 0x43, 0x21, 0x00, 0x01, 0x35, 0x93,
+};
+static const uint8_t recordedRequest[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD };
+
+/* Coil status of slave 5 */
+static const uint8_t recordedCoils[] = { 0x05, 0x01, 0x02, 0xCD, 0x01, 0xDD, 0x6C };
+
+static const uint8_t *reply;
+static uint16_t replySize;
+static uint32_t busFrames;
+static struct ModbusDevice device;
+static struct Segment segment;
+static uint32_t seed;
+
+static uint16_t slave(const uint8_t *request, uint16_t size, uint8_t *answer) {
+    assert(size == device.Segment[0].cmdSize && memcmp(request, device.Segment[0].cmdRaw, size) == 0);
+    busFrames++;
+    memcpy(answer, reply, replySize);
+    return replySize;
+}
+
+static uint64_t nextRandom(void) {
+    seed = (seed * 1103515245UL) + 12345UL;
+    return seed >> 8;
+}
+
+/* The filter before CTZ, shifting a single bit over every register */
+static size_t filterByShifting(uint64_t validAddresses, const uint8_t *response, uint8_t *destination, size_t maxSize) {
+    size_t index = 0;
+
+    for (uint8_t reg = 0; reg < 64 && reg < response[2] / 2; reg++) {
+        if ((validAddresses & (1ULL << reg)) == 0) {
+            continue;
+        }
+        if ((index + 2) > maxSize) {
+            break;
+        }
+        destination[index++] = response[MODBUS_SCAN_HEADER_SIZE + (reg * 2)];
+        destination[index++] = response[MODBUS_SCAN_HEADER_SIZE + (reg * 2) + 1];
+    }
+    return index;
+}
+
+static void setUp(void) {
+    fakeReset();
+    /* waitForScanResponse() spins on HAL_GetTick() */
+    fakeTickStepMs = 1;
+    fakeModbusSlave = slave;
+    busFrames = 0;
+    clockVotes = 0;
+    seed = 1;
+    memset(&device, 0, sizeof(device));
+    device.DeviceActive = 1;
+    device.ID = 1;
+    device.Baudrate = 0;
+    device.enableCRCCheck = true;
+    device.Segment[0].cmdSize = sizeof(recordedRequest);
+    memcpy(device.Segment[0].cmdRaw, recordedRequest, sizeof(recordedRequest));
+    device.Segment[0].enableSegment = 1;
+    reply = recordedRegisters;
+    replySize = sizeof(recordedRegisters);
+}
+
+static void testRecordedReplyIsFiltered(void) {
+    const uint8_t expected[] = { 0x00, 0x64, 0x13, 0x88, 0xFF, 0xF6, 0x00, 0x01 };
+    uint8_t uplink[64];
+
+    setUp();
+    /* Registers 0, 3, 5 and 9 */
+    device.Segment[0].validAddresses = (1ULL << 0) | (1ULL << 3) | (1ULL << 5) | (1ULL << 9);
+    memset(uplink, 0xEE, sizeof(uplink));
+    assert(scanModbusDevice(&device, 0, uplink, sizeof(uplink)) == sizeof(expected));
+    assert(memcmp(uplink, expected, sizeof(expected)) == 0 && uplink[sizeof(expected)] == 0xEE);
+    assert(busFrames == 1 && clockVotes == 0 && fakeUartInits == 1);
+
+    /* Flagged registers past the byte count are not read */
+    device.Segment[0].validAddresses = (1ULL << 9) | (1ULL << 10) | (1ULL << 40) | (1ULL << 63);
+    assert(scanModbusDevice(&device, 0, uplink, sizeof(uplink)) == 2);
+    assert(uplink[0] == 0x00 && uplink[1] == 0x01);
+
+    /* Written straight into the caller's buffer, up to what is left of it */
+    device.Segment[0].validAddresses = 0x3FF;
+    assert(scanModbusDevice(&device, 0, uplink + 10, 7) == 6);
+    assert(memcmp(uplink + 10, &recordedRegisters[MODBUS_SCAN_HEADER_SIZE], 6) == 0 && uplink[16] == 0xEE);
+}
+
+static void testEveryBitOfTheMaskAgainstShifting(void) {
+    uint8_t response[MODBUS_SCAN_HEADER_SIZE + 128];
+    uint8_t filtered[128];
+    uint8_t expected[128];
+
+    setUp();
+    for (uint16_t i = 0; i < sizeof(response); i++) {
+        response[i] = (uint8_t)nextRandom();
+    }
+    response[0] = 0x01;
+    response[1] = 0x03;
+    for (uint16_t trial = 0; trial < 2000; trial++) {
+        uint8_t numRegisters = (uint8_t)(nextRandom() % 65);
+        size_t maxSize = (size_t)(nextRandom() % 140);
+        size_t size;
+
+        response[2] = (uint8_t)(numRegisters * 2);
+        segment.validAddresses = (nextRandom() << 40) ^ (nextRandom() << 20) ^ nextRandom();
+        if ((trial % 8) == 0) {
+            segment.validAddresses = (trial % 16) ? UINT64_MAX : (1ULL << 63) | 1;
+        }
+        size = filterModbusRegisters(&segment, response, (uint16_t)(MODBUS_SCAN_HEADER_SIZE + response[2]), filtered,
+                                     maxSize);
+        assert(size == filterByShifting(segment.validAddresses, response, expected, maxSize));
+        assert(memcmp(filtered, expected, size) == 0);
+    }
+
+    /* Register 63 of a full 64-register read */
+    response[2] = 128;
+    segment.validAddresses = 1ULL << 63;
+    assert(filterModbusRegisters(&segment, response, sizeof(response), filtered, sizeof(filtered)) == 2);
+    assert(filtered[0] == response[MODBUS_SCAN_HEADER_SIZE + 126] && filtered[1] == response[MODBUS_SCAN_HEADER_SIZE + 127]);
+}
+
+static void testByteCountBeyondTheFrameIsRejected(void) {
+    uint8_t uplink[64];
+
+    setUp();
+    segment.validAddresses = UINT64_MAX;
+    /* The byte count claims more than was received */
+    assert(filterModbusRegisters(&segment, recordedRegisters, 10, uplink, sizeof(uplink)) == 0);
+    assert(filterModbusRegisters(&segment, recordedRegisters, 2, uplink, sizeof(uplink)) == 0);
+    /* Trailing CRC bytes are not registers */
+    assert(filterModbusRegisters(&segment, recordedRegisters, sizeof(recordedRegisters), uplink, sizeof(uplink)) == 20);
+}
+
+static void testCrcAndTimeout(void) {
+    uint8_t corrupted[sizeof(recordedRegisters)];
+    uint8_t uplink[64];
+
+    setUp();
+    device.Segment[0].validAddresses = 1;
+    memcpy(corrupted, recordedRegisters, sizeof(corrupted));
+    corrupted[6] ^= 0x40;
+    reply = corrupted;
+    assert(scanModbusDevice(&device, 0, uplink, sizeof(uplink)) == 0);
+
+    /* Devices without CRC checking take it as it comes */
+    device.enableCRCCheck = false;
+    assert(scanModbusDevice(&device, 0, uplink, sizeof(uplink)) == 2);
+    device.enableCRCCheck = true;
+
+    /* Too short to hold a CRC */
+    reply = recordedRegisters;
+    replySize = 4;
+    assert(scanModbusDevice(&device, 0, uplink, sizeof(uplink)) == 0);
+
+    /* A silent slave costs the timeout, the clock vote is given back */
+    replySize = 0;
+    fakeTickMs = 0;
+    assert(scanModbusDevice(&device, 0, uplink, sizeof(uplink)) == 0);
+    assert(fakeTickMs >= MODBUS_SCAN_TIMEOUT_MS && fakeTickMs < MODBUS_SCAN_TIMEOUT_MS + 200);
+    assert(clockVotes == 0);
+}
+
+static void testOtherRepliesAreCopiedAsReceived(void) {
+    uint8_t uplink[64];
+
+    setUp();
+    device.Segment[0].validAddresses = 1;
+    reply = recordedCoils;
+    replySize = sizeof(recordedCoils);
+    assert(scanModbusDevice(&device, 0, uplink, sizeof(uplink)) == sizeof(recordedCoils));
+    assert(memcmp(uplink, recordedCoils, sizeof(recordedCoils)) == 0);
+    assert(scanModbusDevice(&device, 0, uplink, 3) == 3);
+}
+
+int main(void) {
+    printf("test_modbus_device\n");
+    RUN_TEST(testRecordedReplyIsFiltered);
+    RUN_TEST(testEveryBitOfTheMaskAgainstShifting);
+    RUN_TEST(testByteCountBeyondTheFrameIsRejected);
+    RUN_TEST(testCrcAndTimeout);
+    RUN_TEST(testOtherRepliesAreCopiedAsReceived);
+    return 0;
+}
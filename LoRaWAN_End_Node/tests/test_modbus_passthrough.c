@@ -0,0 +1,298 @@
+/**
+ * @file test_modbus_passthrough.c
+ * @brief Passthrough read cache: coalescing within and across downlinks, expiry, write invalidation, uplink packing
+ */
+
+#include "fakes.h"
+#include "PWX_ModbusPassthrough.h"
+#include <string.h>
+
+typedef enum {
+    SLAVE_ANSWERS,
+    SLAVE_SILENT,
+    SLAVE_BAD_CRC,
+    SLAVE_SHORT,
+} SlaveMode_t;
+
+static SlaveMode_t slaveMode;
+static uint32_t busFrames;
+static ModBus_t response;
+static uint8_t uplink[256];
+static size_t uplinkSize;
+
+/* Answers reads with [slave][function][2n][n registers], each byte the frame number, echoes the rest */
+static uint16_t slave(const uint8_t *request, uint16_t size, uint8_t *answer) {
+    uint16_t length;
+    uint16_t crc;
+
+    assert(size >= 4);
+    crc = calculateModbusCRC(request, size - 2);
+    assert(request[size - 2] == (uint8_t)(crc & 0xFF) && request[size - 1] == (uint8_t)(crc >> 8));
+    busFrames++;
+
+    if (request[1] >= ModbusCMD_ReadCoilStatus && request[1] <= ModbusCMD_ReadInputRegisters) {
+        length = (uint16_t)(3 + (2 * request[5]));
+        answer[0] = request[0];
+        answer[1] = request[1];
+        answer[2] = (uint8_t)(2 * request[5]);
+        memset(&answer[3], (uint8_t)busFrames, length - 3);
+    } else {
+        length = size - 2;
+        memcpy(answer, request, length);
+    }
+    crc = calculateModbusCRC(answer, length);
+    answer[length] = (uint8_t)(crc & 0xFF);
+    answer[length + 1] = (uint8_t)(crc >> 8);
+
+    switch (slaveMode) {
+    case SLAVE_SILENT:
+        return 0;
+    case SLAVE_BAD_CRC:
+        answer[length] ^= 0x01;
+        break;
+    case SLAVE_SHORT:
+        return 3;
+    default:
+        break;
+    }
+    return length + 2;
+}
+
+static void setUp(void) {
+    fakeReset();
+    /* waitForResponse() spins on HAL_GetTick() */
+    fakeTickStepMs = 1;
+    fakeModbusSlave = slave;
+    slaveMode = SLAVE_ANSWERS;
+    busFrames = 0;
+    initModbusPassthrough();
+}
+
+static void run(const uint8_t *downlink, size_t size, uint8_t expectedRequests) {
+    assert(queueModbusPassthrough(downlink, size) == expectedRequests);
+    assert(isModbusPassthroughPending());
+    runModbusPassthrough(&response);
+    assert(!isModbusPassthroughPending());
+}
+
+#define RUN(requests, ...)                                                      \
+    do {                                                                        \
+        const uint8_t downlink[] = { __VA_ARGS__ };                             \
+        run(downlink, sizeof(downlink), (requests));                            \
+    } while (0)
+
+/* Read Holding Registers PDU with its length prefix */
+#define READ(slaveId, reg, count)   6, (slaveId), 3, 0, (reg), 0, (count)
+#define WRITE(slaveId, reg, value)  6, (slaveId), 6, 0, (reg), 0, (value)
+
+/* Builds and accepts one uplink, returns the bits packed */
+static uint8_t send(size_t maxSize) {
+    uint8_t packed;
+
+    uplinkSize = buildModbusPassthroughUplink(uplink, maxSize, &packed);
+    assert(uplinkSize <= maxSize);
+    markModbusPassthroughSent(packed);
+    return packed;
+}
+
+/* Record of a request in the last uplink, NULL if it was not packed */
+static const uint8_t *record(uint8_t index) {
+    size_t offset = 1;
+
+    while (offset < uplinkSize) {
+        if (uplink[offset] == index) {
+            return &uplink[offset];
+        }
+        offset += MODBUS_PASSTHROUGH_RECORD_HEADER + uplink[offset + 2];
+    }
+    assert(offset == uplinkSize);
+    return NULL;
+}
+
+static uint8_t statusOf(uint8_t index) {
+    return record(index)[1];
+}
+
+/* Frame number the slave answered a read with */
+static uint8_t frameOf(uint8_t index) {
+    const uint8_t *r = record(index);
+
+    assert(r[2] > 3);
+    return r[MODBUS_PASSTHROUGH_RECORD_HEADER + 3];
+}
+
+static void testIdenticalReadsReachTheBusOnce(void) {
+    setUp();
+    RUN(3, 0x41, READ(1, 0x10, 2), READ(1, 0x10, 2), READ(1, 0x20, 2));
+    assert(busFrames == 2);
+    assert(send(255) == 0x07 && uplink[0] == 0x41);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_OK && statusOf(1) == MODBUS_PASSTHROUGH_CACHED &&
+           statusOf(2) == MODBUS_PASSTHROUGH_OK);
+    /* The cached answer is the one the bus gave, with the same bytes */
+    assert(memcmp(record(0) + 2, record(1) + 2, 1 + record(0)[2]) == 0);
+    assert(frameOf(0) == 1 && frameOf(2) == 2);
+
+    /* A later downlink polling the same registers is answered from the cache */
+    RUN(2, 0x42, READ(1, 0x20, 2), READ(1, 0x10, 2));
+    assert(busFrames == 2);
+    send(255);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_CACHED && frameOf(0) == 2);
+    assert(statusOf(1) == MODBUS_PASSTHROUGH_CACHED && frameOf(1) == 1);
+
+    /* Another slave, count or function code is another request */
+    RUN(3, 0x43, READ(2, 0x10, 2), READ(1, 0x10, 3), 6, 1, 4, 0, 0x10, 0, 2);
+    assert(busFrames == 5);
+}
+
+static void testCacheExpires(void) {
+    uint32_t stored;
+
+    setUp();
+    RUN(1, 0x01, READ(1, 0x10, 1));
+    /* The answer was cached on the last tick read */
+    stored = fakeTickMs;
+
+    /* findCacheEntry() reads the tick once more, one step later */
+    fakeTickMs = stored + MODBUS_PASSTHROUGH_CACHE_MS - 2;
+    RUN(1, 0x02, READ(1, 0x10, 1));
+    assert(busFrames == 1);
+
+    fakeTickMs = stored + MODBUS_PASSTHROUGH_CACHE_MS - 1;
+    RUN(1, 0x03, READ(1, 0x10, 1));
+    assert(busFrames == 2);
+    send(255);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_OK && frameOf(0) == 2);
+
+    /* The fresh answer starts a new window */
+    fakeTickMs += MODBUS_PASSTHROUGH_CACHE_MS / 2;
+    RUN(1, 0x04, READ(1, 0x10, 1));
+    assert(busFrames == 2);
+}
+
+static void testWriteDropsTheSlaveCache(void) {
+    setUp();
+    RUN(2, 0x01, READ(1, 0x10, 1), READ(2, 0x10, 1));
+    assert(busFrames == 2);
+
+    /* The read behind the write sees the new value, the other slave is untouched */
+    RUN(3, 0x02, WRITE(1, 0x10, 7), READ(1, 0x10, 1), READ(2, 0x10, 1));
+    assert(busFrames == 4);
+    send(255);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_OK && record(0)[2] == 6);
+    assert(statusOf(1) == MODBUS_PASSTHROUGH_OK && frameOf(1) == 4);
+    assert(statusOf(2) == MODBUS_PASSTHROUGH_CACHED && frameOf(2) == 2);
+
+    /* Writes are never coalesced */
+    RUN(2, 0x03, WRITE(2, 0x11, 1), WRITE(2, 0x11, 1));
+    assert(busFrames == 6);
+    RUN(1, 0x04, READ(2, 0x10, 1));
+    assert(busFrames == 7);
+}
+
+static void testOldestEntryIsReplaced(void) {
+    setUp();
+    for (uint8_t i = 0; i < MODBUS_PASSTHROUGH_CACHE_SIZE; i++) {
+        RUN(1, i, READ(1, i, 1));
+        fakeTickMs += 100;
+    }
+    assert(busFrames == MODBUS_PASSTHROUGH_CACHE_SIZE);
+
+    /* A cache hit does not refresh the entry, register 0 stays the oldest */
+    RUN(1, 0x10, READ(1, 0, 1));
+    RUN(1, 0x11, READ(1, 0x40, 1));
+    assert(busFrames == MODBUS_PASSTHROUGH_CACHE_SIZE + 1);
+    RUN(4, 0x12, READ(1, 1, 1), READ(1, 2, 1), READ(1, 3, 1), READ(1, 0x40, 1));
+    assert(busFrames == MODBUS_PASSTHROUGH_CACHE_SIZE + 1);
+    RUN(1, 0x13, READ(1, 0, 1));
+    assert(busFrames == MODBUS_PASSTHROUGH_CACHE_SIZE + 2);
+
+    /* Register 0 came back over register 1, the oldest left */
+    RUN(1, 0x14, READ(1, 1, 1));
+    assert(busFrames == MODBUS_PASSTHROUGH_CACHE_SIZE + 3);
+}
+
+static void testFailedAnswersAreNotCached(void) {
+    const SlaveMode_t modes[] = { SLAVE_SILENT, SLAVE_BAD_CRC, SLAVE_SHORT };
+    const uint8_t expected[] = { MODBUS_PASSTHROUGH_TIMEOUT, MODBUS_PASSTHROUGH_BAD_RESPONSE,
+                                 MODBUS_PASSTHROUGH_BAD_RESPONSE };
+    uint32_t start;
+
+    setUp();
+    for (uint8_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        slaveMode = modes[i];
+        start = fakeTickMs;
+        RUN(1, i, READ(1, 0x10, 1));
+        send(255);
+        assert(statusOf(0) == expected[i] && record(0)[2] == 0);
+        if (modes[i] == SLAVE_SILENT) {
+            assert((fakeTickMs - start) >= MODBUS_PASSTHROUGH_TIMEOUT_MS);
+        }
+    }
+    assert(busFrames == 3);
+
+    /* An answer bigger than a record can hold */
+    slaveMode = SLAVE_ANSWERS;
+    RUN(1, 0x10, READ(1, 0x10, 40));
+    send(255);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_TOO_LARGE && record(0)[2] == 0);
+    RUN(1, 0x11, READ(1, 0x10, 40));
+    assert(busFrames == 5);
+
+    /* A length that runs past the payload ends the parsing, nothing reaches the bus for it */
+    RUN(2, 0x12, READ(1, 0x10, 1), 9, 1, 3, 0);
+    assert(busFrames == 6);
+    send(255);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_OK && statusOf(1) == MODBUS_PASSTHROUGH_INVALID);
+    RUN(1, 0x13, 1, 1, READ(1, 0x10, 1));
+    assert(busFrames == 6);
+    send(255);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_INVALID && record(1) == NULL);
+}
+
+static void testUplinkPacksFirstFit(void) {
+    /* Records of 3 + 3 + 2n bytes */
+    const uint8_t bigRecord = 6 + 20;
+    const uint8_t smallRecord = 6 + 2;
+    const uint8_t middleRecord = 6 + 10;
+    uint8_t packed;
+
+    setUp();
+    RUN(3, 0x55, READ(1, 0, 10), READ(1, 0x20, 1), READ(1, 0x30, 5));
+
+    /* The small record fits behind the big one, the middle one waits */
+    assert(send(1 + bigRecord + smallRecord + middleRecord - 1) == 0x03);
+    assert(uplinkSize == 1 + bigRecord + smallRecord && record(2) == NULL);
+    assert(hasModbusPassthroughReplies());
+
+    /* Not accepted by the MAC: the same record again */
+    assert(buildModbusPassthroughUplink(uplink, 1 + middleRecord, &packed) == 1 + middleRecord && packed == 0x04);
+    assert(send(1 + middleRecord) == 0x04 && uplink[0] == 0x55 && statusOf(2) == MODBUS_PASSTHROUGH_OK);
+    assert(!hasModbusPassthroughReplies());
+    assert(send(255) == 0 && uplinkSize == 0);
+
+    /* A record no uplink of that size can carry goes without its data */
+    RUN(2, 0x56, READ(1, 0, 10), READ(1, 0x20, 1));
+    assert(send(1 + MODBUS_PASSTHROUGH_RECORD_HEADER + smallRecord) == 0x03);
+    assert(statusOf(0) == MODBUS_PASSTHROUGH_TOO_LARGE && record(0)[2] == 0);
+    assert(statusOf(1) == MODBUS_PASSTHROUGH_CACHED);
+
+    /* Too small for a transaction ID and a record header */
+    RUN(1, 0x57, READ(1, 0x20, 1));
+    assert(send(MODBUS_PASSTHROUGH_RECORD_HEADER) == 0 && uplinkSize == 0);
+    assert(hasModbusPassthroughReplies());
+
+    /* A new downlink drops what was not sent */
+    RUN(1, 0x58, READ(1, 0x20, 1));
+    assert(send(255) == 0x01 && uplink[0] == 0x58);
+}
+
+int main(void) {
+    printf("test_modbus_passthrough\n");
+    RUN_TEST(testIdenticalReadsReachTheBusOnce);
+    RUN_TEST(testCacheExpires);
+    RUN_TEST(testWriteDropsTheSlaveCache);
+    RUN_TEST(testOldestEntryIsReplaced);
+    RUN_TEST(testFailedAnswersAreNotCached);
+    RUN_TEST(testUplinkPacksFirstFit);
+    return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file test_modbus_sections.c
+ * @brief Section packer: collection, first fit packing and the USART1 restore
+ */
+
+#include "fakes.h"
+#include "PWX_ModbusSections.h"
+#include "usart.h"
+#include <string.h>
+
+/* Size of the section each segment answers with, 0 for a failed scan */
+static uint8_t sectionSize[NUM_DEVICES][NUM_DEV_SEGMENTS];
+static uint32_t numScans;
+
+/* Stands in for PWX_ModbusDevice.c: the section bytes identify device, segment and position */
+size_t scanModbusDevice(const struct ModbusDevice *ModbusDevice, uint8_t SegmentID, uint8_t *destination, size_t maxSize) {
+    uint8_t dev = (uint8_t)(ModbusDevice - fakeDevices);
+    size_t size = MIN((size_t)sectionSize[dev][SegmentID], maxSize);
+
+    /* Each device has its own line settings */
+    huart1.Init.BaudRate = 19200 + dev;
+    for (size_t i = 0; i < size; i++) {
+        destination[i] = (uint8_t)((dev << 4) ^ SegmentID ^ i);
+    }
+    numScans++;
+    return size;
+}
+
+static void enableSection(uint8_t dev, uint8_t seg, uint8_t size) {
+    fakeDevices[dev].DeviceActive = 1;
+    fakeDevices[dev].Segment[seg].enableSegment = 1;
+    fakeDevices[dev].Segment[seg].sendNow = 1;
+    fakeDevices[dev].Segment[seg].cmdSize = 8;
+    sectionSize[dev][seg] = size;
+}
+
+static void setUp(void) {
+    fakeReset();
+    memset(sectionSize, 0, sizeof(sectionSize));
+    numScans = 0;
+    huart1.Init.BaudRate = 9600;
+    huart1.Init.Parity = UART_PARITY_NONE;
+    huart1.Init.StopBits = UART_STOPBITS_1;
+    initModbusSections();
+}
+
+/* Checks every [tag][len][data] of a frame, returns the number of sections in it */
+static uint8_t checkFrame(const uint8_t *frame, size_t size, uint8_t *seen) {
+    size_t index = 0;
+    uint8_t count = 0;
+
+    while (index < size) {
+        uint8_t tag = frame[index++];
+        uint8_t length = frame[index++];
+        uint8_t dev = tag >> 4;
+        uint8_t seg = tag & 0x0F;
+
+        assert(length == 0 || length == sectionSize[dev][seg]);
+        for (uint8_t i = 0; i < length; i++) {
+            assert(frame[index + i] == (uint8_t)((dev << 4) ^ seg ^ i));
+        }
+        index += length;
+        seen[tag]++;
+        count++;
+    }
+    assert(index == size);
+    return count;
+}
+
+static void testSectionsPackFirstFit(void) {
+    const uint8_t sizes[] = { 10, 40, 10, 30, 5, 20 };
+    /* First fit in queue order, 2 header bytes per section: [10][10][5], [40], [30], [20] */
+    const size_t frameSizes[] = { 31, 42, 32, 22 };
+    uint8_t frame[64];
+    uint8_t seen[256] = { 0 };
+    uint32_t packed;
+    size_t size;
+
+    setUp();
+    for (uint8_t i = 0; i < sizeof(sizes); i++) {
+        enableSection(i / 2, i % 2, sizes[i]);
+    }
+    assert(collectModbusSections() == sizeof(sizes));
+
+    size = buildModbusSectionUplink(frame, 51, &packed);
+    assert(size == frameSizes[0] && packed == 0x15);
+    /* Not accepted by the MAC: the same sections come back */
+    assert(buildModbusSectionUplink(frame, 51, &packed) == size && packed == 0x15);
+
+    for (uint8_t n = 0; n < sizeof(frameSizes) / sizeof(frameSizes[0]); n++) {
+        size = buildModbusSectionUplink(frame, 51, &packed);
+        assert(size == frameSizes[n]);
+        checkFrame(frame, size, seen);
+        markModbusSectionsSent(packed);
+    }
+    assert(!hasModbusSections());
+    assert(buildModbusSectionUplink(frame, 51, &packed) == 0 && packed == 0);
+
+    /* Every section exactly once over the frames that were sent */
+    for (uint8_t i = 0; i < sizeof(sizes); i++) {
+        assert(seen[((i / 2) << 4) | (i % 2)] == 1);
+    }
+}
+
+static void testOversizedSectionIsReportedEmpty(void) {
+    uint8_t frame[16];
+    uint8_t seen[256] = { 0 };
+    uint32_t packed;
+
+    setUp();
+    enableSection(7, 3, 20);
+    assert(collectModbusSections() == 1);
+    assert(buildModbusSectionUplink(frame, 11, &packed) == 2);
+    assert(frame[0] == ((7 << 4) | 3) && frame[1] == 0);
+    checkFrame(frame, 2, seen);
+    markModbusSectionsSent(packed);
+    assert(!hasModbusSections());
+}
+
+static void testInactiveAndFailedScansAreSkipped(void) {
+    setUp();
+    enableSection(0, 0, 4);
+    enableSection(0, 1, 0);                     // scan fails
+    enableSection(1, 0, 4);
+    fakeDevices[1].DeviceActive = 0;
+    enableSection(2, 0, 4);
+    fakeDevices[2].Segment[0].sendNow = 0;
+    enableSection(3, 0, 4);
+    fakeDevices[3].Segment[0].cmdSize = 0;
+    assert(collectModbusSections() == 1);
+}
+
+static void testFullQueueResumesWhereItStopped(void) {
+    uint8_t frame[255];
+    uint8_t seen[256] = { 0 };
+    uint32_t packed;
+
+    setUp();
+    /* 40 small sections, more than the queue holds */
+    for (uint8_t i = 0; i < 40; i++) {
+        enableSection(i / NUM_DEV_SEGMENTS, i % NUM_DEV_SEGMENTS, 3);
+    }
+    assert(collectModbusSections() == MODBUS_SECTION_MAX_QUEUED);
+    while (hasModbusSections()) {
+        size_t size = buildModbusSectionUplink(frame, sizeof(frame), &packed);
+        checkFrame(frame, size, seen);
+        markModbusSectionsSent(packed);
+    }
+
+    /* The next cycle starts with the sections left out, then wraps around */
+    assert(collectModbusSections() == MODBUS_SECTION_MAX_QUEUED);
+    while (hasModbusSections()) {
+        size_t size = buildModbusSectionUplink(frame, sizeof(frame), &packed);
+        checkFrame(frame, size, seen);
+        markModbusSectionsSent(packed);
+    }
+    /* 8 left out then 24 from the start: those read twice are the first 24 */
+    for (uint8_t i = 0; i < 40; i++) {
+        assert(seen[((i / NUM_DEV_SEGMENTS) << 4) | (i % NUM_DEV_SEGMENTS)] == ((i < 24) ? 2 : 1));
+    }
+}
+
+static void testStaleSectionsAreDropped(void) {
+    uint8_t frame[64];
+    uint32_t packed;
+
+    setUp();
+    enableSection(0, 0, 10);
+    assert(collectModbusSections() == 1);
+    /* Never sent: the next cycle replaces it */
+    assert(collectModbusSections() == 1);
+    assert(buildModbusSectionUplink(frame, sizeof(frame), &packed) == 12);
+    assert(packed == 1);
+}
+
+static void testLevelSensorUartIsRestored(void) {
+    setUp();
+    enableSection(4, 0, 4);
+    enableSection(9, 2, 4);
+    assert(collectModbusSections() == 2);
+    assert(numScans == 2);
+    assert(huart1.Init.BaudRate == 9600 && huart1.Init.Parity == UART_PARITY_NONE);
+    assert(fakeUartInits == 1);
+
+    /* No device scanned, nothing to restore */
+    setUp();
+    assert(collectModbusSections() == 0);
+    assert(fakeUartInits == 0);
+}
+
+int main(void) {
+    printf("test_modbus_sections\n");
+    RUN_TEST(testSectionsPackFirstFit);
+    RUN_TEST(testOversizedSectionIsReportedEmpty);
+    RUN_TEST(testInactiveAndFailedScansAreSkipped);
+    RUN_TEST(testFullQueueResumesWhereItStopped);
+    RUN_TEST(testStaleSectionsAreDropped);
+    RUN_TEST(testLevelSensorUartIsRestored);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file test_nvm_journal.c
+ * @brief LoRaMac NVM journal: group appends, page snapshots, power loss at every flash operation
+ */
+
+#include "fakes.h"
+#include "PWX_NvmJournal.h"
+#include "LoRaMac.h"
+#include <string.h>
+
+typedef struct {
+    size_t offset;
+    size_t size;
+} Group_t;
+
+static const Group_t groups[] = {
+    { offsetof(LoRaMacNvmData_t, Crypto),        sizeof(LoRaMacCryptoNvmData_t) },
+    { offsetof(LoRaMacNvmData_t, MacGroup1),     sizeof(LoRaMacNvmDataGroup1_t) },
+    { offsetof(LoRaMacNvmData_t, MacGroup2),     sizeof(LoRaMacNvmDataGroup2_t) },
+    { offsetof(LoRaMacNvmData_t, SecureElement), sizeof(SecureElementNvmData_t) },
+    { offsetof(LoRaMacNvmData_t, RegionGroup1),  sizeof(RegionNvmDataGroup1_t) },
+    { offsetof(LoRaMacNvmData_t, RegionGroup2),  sizeof(RegionNvmDataGroup2_t) },
+    { offsetof(LoRaMacNvmData_t, ClassB),        sizeof(LoRaMacClassBNvmData_t) },
+};
+#define NUM_GROUPS      (sizeof(groups) / sizeof(groups[0]))
+#define CRYPTO          0
+#define MAC_GROUP_1     1
+#define MAC_GROUP_2     2
+
+static LoRaMacNvmData_t imageA;
+static LoRaMacNvmData_t imageB;
+static LoRaMacNvmData_t restored;
+
+static void fillImage(LoRaMacNvmData_t *image, uint8_t seed) {
+    uint8_t *bytes = (uint8_t *)image;
+
+    for (size_t i = 0; i < sizeof(*image); i++) {
+        bytes[i] = (uint8_t)(seed + (i * 13));
+    }
+}
+
+/* Changes the first bytes of a group, as a new frame counter would */
+static void touchGroup(LoRaMacNvmData_t *image, uint8_t group) {
+    ((uint8_t *)image)[groups[group].offset]++;
+    ((uint8_t *)image)[groups[group].offset + 1] += 3;
+}
+
+static bool groupEquals(const LoRaMacNvmData_t *a, const LoRaMacNvmData_t *b, uint8_t group) {
+    return memcmp((const uint8_t *)a + groups[group].offset, (const uint8_t *)b + groups[group].offset,
+                  groups[group].size) == 0;
+}
+
+static void reboot(void) {
+    fakePowerBudget = -1;
+    initNvmJournal();
+    memset(&restored, 0, sizeof(restored));
+}
+
+static void checkRestored(const LoRaMacNvmData_t *expected) {
+    reboot();
+    assert(restoreNvmJournal(&restored, sizeof(restored)));
+    assert(memcmp(&restored, expected, sizeof(restored)) == 0);
+}
+
+static void setUp(void) {
+    fakeReset();
+    initNvmJournal();
+    fillImage(&imageA, 1);
+}
+
+/* Stores the image with one group changed each time, until a snapshot has opened a new page */
+static void storeUntilSnapshot(LoRaMacNvmData_t *image) {
+    uint32_t erases = fakeFlashErases;
+
+    while (fakeFlashErases == erases) {
+        touchGroup(image, CRYPTO);
+        assert(storeNvmJournal(image, sizeof(*image)));
+    }
+}
+
+static void testEmptyJournal(void) {
+    setUp();
+    assert(!restoreNvmJournal(&restored, sizeof(restored)));
+    assert(!storeNvmJournal(&imageA, sizeof(imageA) - 1));
+
+    assert(storeNvmJournal(&imageA, sizeof(imageA)));
+    assert(fakeFlashErases == 1);
+    checkRestored(&imageA);
+    assert(!restoreNvmJournal(&restored, sizeof(restored) - 1));
+}
+
+static void testOnlyChangedGroupsAreAppended(void) {
+    uint32_t programs;
+
+    setUp();
+    assert(storeNvmJournal(&imageA, sizeof(imageA)));
+
+    /* Unchanged: nothing written */
+    programs = fakeFlashPrograms;
+    assert(storeNvmJournal(&imageA, sizeof(imageA)));
+    assert(fakeFlashPrograms == programs);
+
+    /* One group: its data and its 16-byte header, no erase */
+    touchGroup(&imageA, MAC_GROUP_1);
+    assert(storeNvmJournal(&imageA, sizeof(imageA)));
+    assert(fakeFlashErases == 1);
+    assert(fakeFlashPrograms - programs <= (sizeof(LoRaMacNvmDataGroup1_t) + 7) / 8 + 2);
+    checkRestored(&imageA);
+
+    /* Appends go on where the replay stopped after a reboot */
+    touchGroup(&imageA, CRYPTO);
+    touchGroup(&imageA, MAC_GROUP_2);
+    assert(storeNvmJournal(&imageA, sizeof(imageA)));
+    checkRestored(&imageA);
+}
+
+static void testFullPageOpensTheNextOne(void) {
+    setUp();
+    assert(storeNvmJournal(&imageA, sizeof(imageA)));
+
+    /* Around the ring of pages twice, the newest page wins after each reboot */
+    for (uint8_t i = 0; i < 2 * NVM_JOURNAL_NUM_PAGES; i++) {
+        storeUntilSnapshot(&imageA);
+        checkRestored(&imageA);
+    }
+    assert(fakeFlashErases == 1 + (2 * NVM_JOURNAL_NUM_PAGES));
+}
+
+/*
+ * Cuts power at every flash operation of a store, one run per operation. After
+ * the reboot every group is either the old or the new one, and the journal
+ * takes the next store. With allGroups, the changes do not fit in the page
+ * left after the first snapshot and the store opens the next page.
+ */
+static void powerLossSweep(bool allGroups) {
+    uint32_t runs = 0;
+
+    for (int32_t budget = 0;; budget++) {
+        uint32_t erases;
+
+        setUp();
+        assert(storeNvmJournal(&imageA, sizeof(imageA)));
+        memcpy(&imageB, &imageA, sizeof(imageB));
+        for (uint8_t g = 0; g < NUM_GROUPS; g++) {
+            if (allGroups || g == CRYPTO || g == MAC_GROUP_1) {
+                touchGroup(&imageB, g);
+            }
+        }
+
+        erases = fakeFlashErases;
+        fakePowerBudget = budget;
+        if (setjmp(fakePowerLoss) == 0) {
+            assert(storeNvmJournal(&imageB, sizeof(imageB)));
+            assert(fakeFlashErases == erases + (allGroups ? 1 : 0));
+            checkRestored(&imageB);
+            break;
+        }
+        runs++;
+
+        reboot();
+        assert(restoreNvmJournal(&restored, sizeof(restored)));
+        for (uint8_t g = 0; g < NUM_GROUPS; g++) {
+            assert(groupEquals(&restored, &imageA, g) || groupEquals(&restored, &imageB, g));
+        }
+
+        assert(storeNvmJournal(&imageB, sizeof(imageB)));
+        checkRestored(&imageB);
+    }
+    assert(runs > 0);
+}
+
+static void testPowerLossDuringAppend(void) {
+    powerLossSweep(false);
+}
+
+static void testPowerLossDuringSnapshot(void) {
+    powerLossSweep(true);
+}
+
+int main(void) {
+    printf("test_nvm_journal\n");
+    RUN_TEST(testEmptyJournal);
+    RUN_TEST(testOnlyChangedGroupsAreAppended);
+    RUN_TEST(testFullPageOpensTheNextOne);
+    RUN_TEST(testPowerLossDuringAppend);
+    RUN_TEST(testPowerLossDuringSnapshot);
+    return 0;
+}
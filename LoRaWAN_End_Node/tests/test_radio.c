@@ -0,0 +1,119 @@
+/**
+ * @file test_radio.c
+ * @brief Memoized LoRa time on air of radio.c against the exact formula, slot recycling
+ */
+
+#include "fakes.h"
+/* The table and the formula are static: the test builds the driver source itself */
+#include "radio.c"
+
+#define PREAMBLE    8
+
+/* What RadioTimeOnAir() returned before the table */
+static uint32_t uncached(uint32_t bandwidth, uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                         uint8_t payloadLen, bool crcOn) {
+    return DIVC(1000U * RadioGetLoRaTimeOnAirNumerator(bandwidth, datarate, coderate, preambleLen, fixLen,
+                                                       payloadLen, crcOn),
+                RadioGetLoRaBandwidthInHz(Bandwidths[bandwidth]));
+}
+
+static uint32_t timeOnAir(uint32_t bandwidth, uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                          uint8_t payloadLen, bool crcOn) {
+    return Radio.TimeOnAir(MODEM_LORA, bandwidth, datarate, coderate, preambleLen, fixLen, payloadLen, crcOn);
+}
+
+static void setUp(void) {
+    fakeReset();
+    memset(RadioToaCache, 0, sizeof(RadioToaCache));
+    RadioToaCacheNextSlot = 0;
+}
+
+static RadioToaCacheSlot_t *slotFor(uint8_t bandwidth, uint8_t datarate, uint8_t coderate) {
+    for (uint8_t i = 0; i < RADIO_TOA_CACHE_NB_SLOTS; i++) {
+        if (RadioToaCache[i].Used && RadioToaCache[i].Bandwidth == bandwidth && RadioToaCache[i].Datarate == datarate &&
+            RadioToaCache[i].Coderate == coderate) {
+            return &RadioToaCache[i];
+        }
+    }
+    return NULL;
+}
+
+/* The 125 kHz, CR 4/5 slot of a spreading factor */
+#define slotOf(datarate)    slotFor(0, (datarate), 1)
+
+static void testEverySettingMatchesTheFormula(void) {
+    setUp();
+    for (uint8_t bw = 0; bw <= 2; bw++) {
+        for (uint8_t sf = 5; sf <= 12; sf++) {
+            for (uint8_t cr = 1; cr <= 4; cr++) {
+                /* First pass fills the slot, the second one reads it */
+                for (uint8_t pass = 0; pass < 2; pass++) {
+                    for (uint16_t len = 0; len <= 255; len++) {
+                        uint32_t expected = uncached(bw, sf, cr, PREAMBLE, false, (uint8_t)len, true);
+
+                        assert(timeOnAir(bw, sf, cr, PREAMBLE, false, (uint8_t)len, true) == expected);
+                    }
+                }
+                assert(slotFor(bw, sf, cr)->TimeOnAir[255] != 0);
+            }
+        }
+    }
+}
+
+static void testEveryKeyFieldSelectsItsOwnSlot(void) {
+    const struct {
+        uint16_t preambleLen;
+        bool fixLen;
+        bool crcOn;
+    } keys[] = {
+        { PREAMBLE, false, true }, { PREAMBLE, true, true }, { PREAMBLE, false, false },
+        { 6, false, true },        { 12, false, true },      { 2000, true, false },
+    };
+
+    setUp();
+    for (uint16_t i = 0; i < 4 * 256; i++) {
+        uint8_t k = (uint8_t)((i * 7) % (sizeof(keys) / sizeof(keys[0])));
+        uint8_t len = (uint8_t)((i * 37) % 256);
+        uint8_t sf = (uint8_t)(5 + (i % 8));
+
+        assert(timeOnAir(0, sf, 1, keys[k].preambleLen, keys[k].fixLen, len, keys[k].crcOn) ==
+               uncached(0, sf, 1, keys[k].preambleLen, keys[k].fixLen, len, keys[k].crcOn));
+    }
+}
+
+static void testOldestSlotIsRecycled(void) {
+    RadioToaCacheSlot_t *slot;
+
+    setUp();
+    /* SF7 and SF9 take both slots, using SF7 again does not reorder them */
+    timeOnAir(0, 7, 1, PREAMBLE, false, 10, true);
+    timeOnAir(0, 9, 1, PREAMBLE, false, 10, true);
+    timeOnAir(0, 7, 1, PREAMBLE, false, 20, true);
+    assert(RadioToaCache[0].Datarate == 7 && RadioToaCache[1].Datarate == 9);
+    assert(RadioToaCache[0].TimeOnAir[20] == uncached(0, 7, 1, PREAMBLE, false, 20, true));
+
+    /* SF12 takes the slot filled first, empty but for its own entry */
+    assert(timeOnAir(0, 12, 1, PREAMBLE, false, 51, true) == uncached(0, 12, 1, PREAMBLE, false, 51, true));
+    slot = slotOf(12);
+    assert(slot == &RadioToaCache[0] && slotOf(7) == NULL && slotOf(9) == &RadioToaCache[1]);
+    for (uint16_t len = 0; len <= 255; len++) {
+        assert((slot->TimeOnAir[len] != 0) == (len == 51));
+    }
+
+    /* SF7 comes back in place of SF9, with the right values */
+    assert(timeOnAir(0, 7, 1, PREAMBLE, false, 20, true) == uncached(0, 7, 1, PREAMBLE, false, 20, true));
+    assert(slotOf(7) == &RadioToaCache[1] && slotOf(9) == NULL && slotOf(12) == &RadioToaCache[0]);
+    assert(RadioToaCache[1].TimeOnAir[10] == 0);
+
+    /* FSK is computed directly */
+    Radio.TimeOnAir(MODEM_FSK, 50000, 50000, 0, 5, false, 20, true);
+    assert(slotOf(7) == &RadioToaCache[1] && slotOf(12) == &RadioToaCache[0] && RadioToaCacheNextSlot == 0);
+}
+
+int main(void) {
+    printf("test_radio\n");
+    RUN_TEST(testEverySettingMatchesTheFormula);
+    RUN_TEST(testEveryKeyFieldSelectsItsOwnSlot);
+    RUN_TEST(testOldestSlotIsRecycled);
+    return 0;
+}
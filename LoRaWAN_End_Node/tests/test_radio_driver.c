@@ -0,0 +1,151 @@
+/**
+ * @file test_radio_driver.c
+ * @brief Configuration shadow of radio_driver.c: skipped commands, packet type change, sleep and reset
+ */
+
+#include "fakes.h"
+#include "radio_driver.h"
+#include <string.h>
+
+static const uint8_t configCommands[] = {
+    RADIO_SET_PACKETTYPE, RADIO_SET_MODULATIONPARAMS, RADIO_SET_PACKETPARAMS, RADIO_SET_RFFREQUENCY,
+    RADIO_SET_TXPARAMS,   RADIO_CFG_DIOIRQ,           RADIO_SET_BUFFERBASEADDRESS,
+};
+#define NB_CONFIG_COMMANDS  (sizeof(configCommands) / sizeof(configCommands[0]))
+
+static void clearCounters(void) {
+    memset(fakeSubghzCommands, 0, sizeof(fakeSubghzCommands));
+    fakeSubghzRegisterWrites = 0;
+}
+
+/* Configuration commands sent since the counters were cleared */
+static uint32_t configSent(void) {
+    uint32_t sent = 0;
+
+    for (uint8_t i = 0; i < NB_CONFIG_COMMANDS; i++) {
+        sent += fakeSubghzCommands[configCommands[i]];
+    }
+    return sent;
+}
+
+static bool eachConfigSentOnce(void) {
+    for (uint8_t i = 0; i < NB_CONFIG_COMMANDS; i++) {
+        if (fakeSubghzCommands[configCommands[i]] != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The LoRa setup radio.c applies before an uplink */
+static void configureLoRa(uint32_t frequency, int8_t power) {
+    ModulationParams_t modulation;
+    PacketParams_t packet;
+
+    memset(&modulation, 0, sizeof(modulation));
+    modulation.PacketType = PACKET_TYPE_LORA;
+    modulation.Params.LoRa.SpreadingFactor = LORA_SF7;
+    modulation.Params.LoRa.Bandwidth = LORA_BW_125;
+    modulation.Params.LoRa.CodingRate = LORA_CR_4_5;
+    memset(&packet, 0, sizeof(packet));
+    packet.PacketType = PACKET_TYPE_LORA;
+    packet.Params.LoRa.PreambleLength = 8;
+    packet.Params.LoRa.HeaderType = LORA_PACKET_VARIABLE_LENGTH;
+    packet.Params.LoRa.PayloadLength = 51;
+    packet.Params.LoRa.CrcMode = LORA_CRC_ON;
+    packet.Params.LoRa.InvertIQ = LORA_IQ_NORMAL;
+
+    SUBGRF_SetPacketType(PACKET_TYPE_LORA);
+    SUBGRF_SetModulationParams(&modulation);
+    SUBGRF_SetPacketParams(&packet);
+    SUBGRF_SetRfFrequency(frequency);
+    SUBGRF_SetTxParams(RFO_HP, power, RADIO_RAMP_40_US);
+    SUBGRF_SetDioIrqParams(IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT, IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT, IRQ_RADIO_NONE,
+                           IRQ_RADIO_NONE);
+    SUBGRF_SetBufferBaseAddress(0x00, 0x00);
+}
+
+static void sleep(bool warmStart) {
+    SleepParams_t params = { 0 };
+
+    params.Fields.WarmStart = warmStart ? 1 : 0;
+    SUBGRF_SetSleep(params);
+}
+
+static void setUp(void) {
+    fakeReset();
+    SUBGRF_Init(NULL);
+    configureLoRa(868100000, 14);
+    clearCounters();
+}
+
+static void testUnchangedConfigurationIsNotResent(void) {
+    setUp();
+    configureLoRa(868100000, 14);
+    assert(configSent() == 0);
+    /* The TX params shadow covers the PA config, OCP and clamp registers too */
+    assert(fakeSubghzRegisterWrites == 0);
+}
+
+static void testOnlyTheChangedCommandIsSent(void) {
+    setUp();
+    configureLoRa(868300000, 14);
+    assert(configSent() == 1 && fakeSubghzCommands[RADIO_SET_RFFREQUENCY] == 1);
+
+    clearCounters();
+    configureLoRa(868300000, 10);
+    assert(configSent() == 1 && fakeSubghzCommands[RADIO_SET_TXPARAMS] == 1);
+    assert(fakeSubghzRegisterWrites > 0);
+
+    /* Back to a previous value is a change too */
+    clearCounters();
+    configureLoRa(868100000, 14);
+    assert(configSent() == 2);
+    assert(fakeSubghzCommands[RADIO_SET_RFFREQUENCY] == 1 && fakeSubghzCommands[RADIO_SET_TXPARAMS] == 1);
+}
+
+static void testPacketTypeChangeResendsModulationAndPacketParams(void) {
+    setUp();
+    SUBGRF_SetPacketType(PACKET_TYPE_GFSK);
+    assert(configSent() == 1 && fakeSubghzCommands[RADIO_SET_PACKETTYPE] == 1);
+
+    clearCounters();
+    configureLoRa(868100000, 14);
+    assert(configSent() == 3);
+    assert(fakeSubghzCommands[RADIO_SET_PACKETTYPE] == 1 && fakeSubghzCommands[RADIO_SET_MODULATIONPARAMS] == 1 &&
+           fakeSubghzCommands[RADIO_SET_PACKETPARAMS] == 1);
+
+    /* The same packet type again changes nothing */
+    clearCounters();
+    SUBGRF_SetPacketType(PACKET_TYPE_LORA);
+    configureLoRa(868100000, 14);
+    assert(configSent() == 0);
+}
+
+static void testSleepAndResetInvalidation(void) {
+    setUp();
+    /* A warm start keeps the configuration */
+    sleep(true);
+    configureLoRa(868100000, 14);
+    assert(configSent() == 0);
+
+    /* A cold start loses all of it */
+    sleep(false);
+    configureLoRa(868100000, 14);
+    assert(eachConfigSentOnce());
+
+    clearCounters();
+    SUBGRF_Init(NULL);
+    clearCounters();
+    configureLoRa(868100000, 14);
+    assert(eachConfigSentOnce());
+}
+
+int main(void) {
+    printf("test_radio_driver\n");
+    RUN_TEST(testUnchangedConfigurationIsNotResent);
+    RUN_TEST(testOnlyTheChangedCommandIsSent);
+    RUN_TEST(testPacketTypeChangeResendsModulationAndPacketParams);
+    RUN_TEST(testSleepAndResetInvalidation);
+    return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file test_region_common.c
+ * @brief Cached channel candidates of RegionCommonCountNbOfEnabledChannels() against a full scan
+ */
+
+#include "fakes.h"
+#include "RegionCommon.h"
+#include "radio.h"
+#include <string.h>
+
+#define NB_CHANNELS     72
+#define NB_BANDS        4
+
+static ChannelParams_t channels[REGION_NVM_MAX_NB_CHANNELS];
+static Band_t bands[NB_BANDS];
+static uint16_t channelsMask[REGION_NVM_CHANNELS_MASK_SIZE];
+static uint16_t joinChannels[REGION_NVM_CHANNELS_MASK_SIZE];
+static RegionCommonCountNbOfEnabledChannelsParams_t params;
+static uint32_t seed;
+
+/* Stands in for radio.c, the beacon setup is not tested */
+const struct Radio_s Radio;
+
+/* Stands in for stm32_systime.c, the duty cycle is not tested */
+SysTime_t SysTimeSub(SysTime_t a, SysTime_t b) {
+    return (SysTime_t){ a.Seconds - b.Seconds, (int16_t)(a.SubSeconds - b.SubSeconds) };
+}
+
+uint32_t SysTimeToMs(SysTime_t sysTime) {
+    return (sysTime.Seconds * 1000) + sysTime.SubSeconds;
+}
+
+SysTime_t SysTimeFromMs(uint32_t timeMs) {
+    return (SysTime_t){ timeMs / 1000, (int16_t)(timeMs % 1000) };
+}
+
+static uint32_t nextRandom(void) {
+    seed = (seed * 1103515245UL) + 12345UL;
+    return seed >> 8;
+}
+
+/* The scan RegionCommon.c did before the candidates were cached */
+static void fullScan(uint8_t *enabled, uint8_t *nbEnabled, uint8_t *nbRestricted) {
+    *nbEnabled = 0;
+    *nbRestricted = 0;
+    for (uint8_t id = 0; id < params.MaxNbChannels; id++) {
+        uint8_t k = id / 16;
+        uint16_t bit = (uint16_t)(1 << (id % 16));
+
+        if ((params.ChannelsMask[k] & bit) == 0 || params.Channels[id].Frequency == 0) {
+            continue;
+        }
+        if (!params.Joined && params.JoinChannels != NULL && (params.JoinChannels[k] & bit) == 0) {
+            continue;
+        }
+        if (!RegionCommonValueInRange(params.Datarate, params.Channels[id].DrRange.Fields.Min,
+                                      params.Channels[id].DrRange.Fields.Max)) {
+            continue;
+        }
+        if (!params.Bands[params.Channels[id].Band].ReadyForTransmission) {
+            (*nbRestricted)++;
+            continue;
+        }
+        enabled[(*nbEnabled)++] = id;
+    }
+}
+
+static void checkAgainstFullScan(void) {
+    uint8_t enabled[REGION_NVM_MAX_NB_CHANNELS];
+    uint8_t expected[REGION_NVM_MAX_NB_CHANNELS];
+    uint8_t nbEnabled = 0xFF;
+    uint8_t nbRestricted = 0xFF;
+    uint8_t nbExpected;
+    uint8_t nbExpectedRestricted;
+
+    fullScan(expected, &nbExpected, &nbExpectedRestricted);
+    RegionCommonCountNbOfEnabledChannels(&params, enabled, &nbEnabled, &nbRestricted);
+    assert(nbEnabled == nbExpected && nbRestricted == nbExpectedRestricted);
+    assert(memcmp(enabled, expected, nbEnabled) == 0);
+}
+
+static void randomChannel(uint8_t id) {
+    uint8_t min = (uint8_t)(nextRandom() % 6);
+
+    channels[id].Frequency = ((nextRandom() % 8) == 0) ? 0 : 902300000 + (id * 200000);
+    channels[id].DrRange.Fields.Min = (int8_t)min;
+    channels[id].DrRange.Fields.Max = (int8_t)(min + (nextRandom() % (6 - min)));
+    channels[id].Band = (uint8_t)(nextRandom() % NB_BANDS);
+}
+
+static void setUp(void) {
+    fakeReset();
+    seed = 1;
+    memset(channels, 0, sizeof(channels));
+    for (uint8_t id = 0; id < NB_CHANNELS; id++) {
+        randomChannel(id);
+    }
+    for (uint8_t b = 0; b < NB_BANDS; b++) {
+        bands[b].ReadyForTransmission = true;
+    }
+    memset(channelsMask, 0xFF, sizeof(channelsMask));
+    channelsMask[4] = 0x00FF;
+    memset(joinChannels, 0xFF, sizeof(joinChannels));
+
+    params.Joined = true;
+    params.Datarate = 0;
+    params.ChannelsMask = channelsMask;
+    params.Channels = channels;
+    params.Bands = bands;
+    params.MaxNbChannels = NB_CHANNELS;
+    params.JoinChannels = joinChannels;
+    RegionCommonChannelsChanged();
+}
+
+static void testMaskEditsNeedNoNotification(void) {
+    setUp();
+    checkAgainstFullScan();
+    for (uint16_t i = 0; i < 500; i++) {
+        uint8_t id = (uint8_t)(nextRandom() % NB_CHANNELS);
+
+        /* As LinkAdrReq and the channel mask remaining bookkeeping edit it */
+        channelsMask[id / 16] ^= (uint16_t)(1 << (id % 16));
+        checkAgainstFullScan();
+    }
+    memset(channelsMask, 0, sizeof(channelsMask));
+    checkAgainstFullScan();
+}
+
+static void testDatarateAndJoinState(void) {
+    setUp();
+    for (uint16_t i = 0; i < 500; i++) {
+        params.Datarate = (uint8_t)(nextRandom() % 7);
+        params.Joined = (nextRandom() % 2) == 0;
+        params.JoinChannels = ((nextRandom() % 4) == 0) ? NULL : joinChannels;
+        if ((nextRandom() % 4) == 0) {
+            uint8_t id = (uint8_t)(nextRandom() % NB_CHANNELS);
+
+            joinChannels[id / 16] ^= (uint16_t)(1 << (id % 16));
+        }
+        checkAgainstFullScan();
+    }
+}
+
+static void testBandReadinessIsReadOnEveryCall(void) {
+    setUp();
+    checkAgainstFullScan();
+    for (uint16_t i = 0; i < 200; i++) {
+        bands[nextRandom() % NB_BANDS].ReadyForTransmission = (nextRandom() % 2) == 0;
+        checkAgainstFullScan();
+    }
+}
+
+static void testChannelsTableEdits(void) {
+    setUp();
+    checkAgainstFullScan();
+    for (uint16_t i = 0; i < 500; i++) {
+        /* As NewChannelReq, DlChannelReq or a CFList do, the MAC then notifies */
+        randomChannel((uint8_t)(nextRandom() % NB_CHANNELS));
+        RegionCommonChannelsChanged();
+        checkAgainstFullScan();
+    }
+
+    /* Another region's table, and a region with a single mask word */
+    params.Channels = channels + 8;
+    params.MaxNbChannels = 16;
+    checkAgainstFullScan();
+    params.Channels = channels;
+    checkAgainstFullScan();
+}
+
+int main(void) {
+    printf("test_region_common\n");
+    RUN_TEST(testMaskEditsNeedNoNotification);
+    RUN_TEST(testDatarateAndJoinState);
+    RUN_TEST(testBandReadinessIsReadOnEveryCall);
+    RUN_TEST(testChannelsTableEdits);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file test_sensor_rail.c
+ * @brief Sensor rails: reference count, readiness probing with back-off, learned warm-up
+ */
+
+#include "fakes.h"
+#include "PWX_SensorRail.h"
+#include "PWX_ClockPolicy.h"
+#include <string.h>
+
+#define MAX_PROBES      16
+
+static uint32_t readyAfterMs;       // the simulated sensor answers this long after power-up, 0 never
+static uint32_t powerOnMs;
+static uint32_t probeMs[MAX_PROBES];
+static uint8_t  probes;
+static int32_t  clockVotes;
+
+/* Stands in for PWX_ClockPolicy.c, counts the votes held */
+void requestClockLevel(ClockUser_t user, ClockLevel_t level) {
+    assert(user == CLOCK_USER_SENSOR_RAIL && level == CLOCK_LEVEL_LOW);
+    clockVotes++;
+}
+
+void releaseClockLevel(ClockUser_t user) {
+    clockVotes--;
+}
+
+static uint16_t sensor(const uint8_t *request, uint16_t size, uint8_t *answer) {
+    uint16_t crc;
+
+    assert(probes < MAX_PROBES);
+    probeMs[probes++] = fakeTickMs - powerOnMs;
+    if ((fakeGpioA & SENSOR_RAIL_PINS) != SENSOR_RAIL_PINS || readyAfterMs == 0 ||
+        (fakeTickMs - powerOnMs) < readyAfterMs) {
+        return 0;
+    }
+    answer[0] = request[0];
+    answer[1] = request[1];
+    answer[2] = 0x02;
+    answer[3] = 0x04;
+    answer[4] = 0xD2;
+    crc = calculateModbusCRC(answer, 5);
+    answer[5] = (uint8_t)(crc & 0xFF);
+    answer[6] = (uint8_t)(crc >> 8);
+    return 7;
+}
+
+static void setUp(void) {
+    fakeReset();
+    /* probeSensor() spins on HAL_GetTick() */
+    fakeTickStepMs = 1;
+    fakeModbusSlave = sensor;
+    readyAfterMs = 400;
+    probes = 0;
+    clockVotes = 0;
+    initSensorRail();
+}
+
+static bool isRailOn(void) {
+    return (fakeGpioA & SENSOR_RAIL_PINS) == SENSOR_RAIL_PINS;
+}
+
+/* Powers the rails from off, waits for the sensor, powers them down again */
+static bool powerCycle(void) {
+    bool isReady;
+
+    assert(!isRailOn());
+    acquireSensorRail();
+    powerOnMs = fakeTickMs;
+    probes = 0;
+    isReady = waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp);
+    assert(clockVotes == 0);
+    releaseSensorRail();
+    fakeTickMs += 60000;
+    return isReady;
+}
+
+static void testReferenceCount(void) {
+    setUp();
+    assert(!isRailOn());
+    acquireSensorRail();
+    acquireSensorRail();
+    assert(isRailOn());
+    releaseSensorRail();
+    assert(isRailOn());
+    releaseSensorRail();
+    assert(!isRailOn());
+
+    /* A release too many does not leave the count wrapped */
+    releaseSensorRail();
+    acquireSensorRail();
+    assert(isRailOn());
+    releaseSensorRail();
+    assert(!isRailOn());
+
+    /* Without a reference there is nothing to wait for */
+    assert(!waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(probes == 0 && clockVotes == 0);
+}
+
+static void testReadinessHoldsUntilPowerDown(void) {
+    setUp();
+    acquireSensorRail();
+    powerOnMs = fakeTickMs;
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(probes > 0 && probeMs[probes - 1] >= readyAfterMs);
+
+    /* A second user of the powered rails goes straight to its reads */
+    probes = 0;
+    acquireSensorRail();
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(probes == 0);
+    releaseSensorRail();
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(probes == 0 && clockVotes == 0);
+    releaseSensorRail();
+
+    /* Power-up starts over */
+    fakeTickMs += 1000;
+    acquireSensorRail();
+    powerOnMs = fakeTickMs;
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(probes > 0);
+    releaseSensorRail();
+}
+
+static void testProbesBackOffUntilTheMaximum(void) {
+    uint32_t step = SENSOR_RAIL_PROBE_STEP_MS;
+    uint32_t start;
+
+    setUp();
+    readyAfterMs = 0;
+    start = fakeTickMs;
+    assert(!powerCycle());
+
+    /* Nothing learned: the first probe at the minimum warm-up */
+    assert(probeMs[0] >= 200 && probeMs[0] < 200 + 4);
+    /* Each gap is the probe timeout plus a step twice the previous one */
+    for (uint8_t i = 2; i < probes - 1; i++) {
+        uint32_t growth = (probeMs[i] - probeMs[i - 1]) - (probeMs[i - 1] - probeMs[i - 2]);
+
+        assert(growth >= step && growth <= step + 4);
+        step *= 2;
+    }
+    /* Given up once maxWarmUpMs is over, the last wait cut to it */
+    assert(probeMs[probes - 1] >= 1500 - SENSOR_RAIL_PROBE_TIMEOUT_MS && probeMs[probes - 1] <= 1500 + 4);
+    assert((fakeTickMs - 60000 - start) <= 1500 + SENSOR_RAIL_PROBE_TIMEOUT_MS + 8);
+    assert(getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR) == 0);
+
+    /* A sensor given up on counts as ready until the next power-up */
+    acquireSensorRail();
+    assert(!waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    probes = 0;
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(probes == 0);
+    releaseSensorRail();
+}
+
+static void testWarmUpIsLearned(void) {
+    uint16_t learned;
+    uint16_t previous;
+    int32_t expected;
+
+    setUp();
+    assert(powerCycle());
+    learned = getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR);
+    assert(learned >= probeMs[probes - 1] && learned <= probeMs[probes - 1] + 4);
+
+    /* Probing starts a quarter ahead of the estimate, which moves a quarter of the way each time */
+    for (uint8_t cycle = 0; cycle < 10; cycle++) {
+        previous = learned;
+        assert(powerCycle());
+        learned = getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR);
+        assert(probeMs[0] >= previous - (previous / 4) && probeMs[0] <= previous - (previous / 4) + 4);
+        expected = previous + (((int32_t)probeMs[probes - 1] - previous) / 4);
+        assert(learned >= expected - 2 && learned <= expected + 2);
+        assert(learned >= readyAfterMs);
+    }
+    assert(learned < readyAfterMs + 100);
+
+    /* A slower sensor pulls the estimate up */
+    previous = learned;
+    readyAfterMs = 700;
+    assert(powerCycle());
+    learned = getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR);
+    assert(learned > previous && learned < readyAfterMs);
+}
+
+static void testLateFirstProbeOnlyBoundsFromAbove(void) {
+    uint16_t learned;
+
+    setUp();
+    assert(powerCycle());
+    learned = getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR);
+
+    /* Other work kept the rails on past the estimate: the answer says little, nothing learned */
+    acquireSensorRail();
+    powerOnMs = fakeTickMs;
+    probes = 0;
+    HAL_Delay(learned + 300);
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(probes == 1 && getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR) == learned);
+    releaseSensorRail();
+
+    /* Past the first probe but short of the estimate: an answer to it lowers the estimate */
+    readyAfterMs = 200;
+    fakeTickMs += 60000;
+    acquireSensorRail();
+    powerOnMs = fakeTickMs;
+    HAL_Delay(learned - (learned / 8));
+    assert(waitSensorRailReady(SENSOR_RAIL_LEVEL_SENSOR, &ModbusResp));
+    assert(getSensorWarmUpMs(SENSOR_RAIL_LEVEL_SENSOR) < learned);
+    releaseSensorRail();
+}
+
+int main(void) {
+    printf("test_sensor_rail\n");
+    RUN_TEST(testReferenceCount);
+    RUN_TEST(testReadinessHoldsUntilPowerDown);
+    RUN_TEST(testProbesBackOffUntilTheMaximum);
+    RUN_TEST(testWarmUpIsLearned);
+    RUN_TEST(testLateFirstProbeOnlyBoundsFromAbove);
+    return 0;
+}
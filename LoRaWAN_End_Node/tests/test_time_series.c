@@ -0,0 +1,188 @@
+/**
+ * @file test_time_series.c
+ * @brief CayenneLPP series encoding of the time-tagged samples, checked by decoding it back
+ */
+
+#include "fakes.h"
+#include "PWX_TimeSync.h"
+#include "CayenneLpp.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LPP_SERIES          200
+#define LPP_ANALOG_INPUT    2
+#define UNIX_OFFSET_S       1700000000UL
+
+typedef struct {
+    uint32_t seconds;
+    uint16_t level;
+} Sample_t;
+
+static Sample_t recorded[TIME_SYNC_MAX_SAMPLES];
+static uint8_t numRecorded;
+
+static void setUp(void) {
+    fakeReset();
+    initTimeSync();
+    numRecorded = 0;
+}
+
+/* Samples every step s from start, the seconds moved by the jitter pattern */
+static void recordSamples(uint32_t start, uint16_t step, uint8_t count, const int8_t *jitter) {
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t seconds = start + ((uint32_t)i * step) + (jitter ? jitter[i % 4] : 0);
+
+        fakeMcuTime.Seconds = seconds;
+        fakeSysTime.Seconds = seconds + (isTimeSynced() ? UNIX_OFFSET_S : 0);
+        recordTimedSample((uint16_t)(1000 + (i * 7)));
+        recorded[numRecorded % TIME_SYNC_MAX_SAMPLES].seconds = fakeSysTime.Seconds;
+        recorded[numRecorded % TIME_SYNC_MAX_SAMPLES].level = (uint16_t)(1000 + (i * 7));
+        numRecorded++;
+    }
+}
+
+/*
+ * Decodes the block and checks it against the newest recorded samples:
+ * each within the jitter of its grid time, in order, with its level.
+ * Returns the number of records.
+ */
+static uint8_t checkSeries(const uint8_t *block, size_t size, uint8_t channel, uint8_t *numSamples) {
+    Sample_t decoded[TIME_SYNC_MAX_SAMPLES];
+    uint8_t count = 0;
+    uint8_t records = 0;
+    size_t index = 0;
+
+    while (index < size) {
+        uint32_t base;
+        uint16_t step;
+        uint8_t n;
+
+        assert(size - index >= CAYENNE_LPP_SERIES_HEADER_SIZE);
+        assert(block[index] == channel && block[index + 1] == LPP_SERIES && block[index + 2] == LPP_ANALOG_INPUT);
+        base = ((uint32_t)block[index + 3] << 24) | ((uint32_t)block[index + 4] << 16) | ((uint32_t)block[index + 5] << 8) | block[index + 6];
+        step = (uint16_t)((block[index + 7] << 8) | block[index + 8]);
+        n = block[index + 9];
+        assert(n > 0 && (n == 1 || step > 0));
+        assert(size - index >= CAYENNE_LPP_ANALOG_SERIES_SIZE(n));
+        index += CAYENNE_LPP_SERIES_HEADER_SIZE;
+        for (uint8_t i = 0; i < n; i++) {
+            assert(count < TIME_SYNC_MAX_SAMPLES);
+            decoded[count].seconds = base + ((uint32_t)i * step);
+            decoded[count].level = (uint16_t)((block[index] << 8) | block[index + 1]);
+            index += 2;
+            count++;
+        }
+        records++;
+    }
+    assert(index == size);
+
+    /* The newest count samples, oldest first */
+    for (uint8_t i = 0; i < count; i++) {
+        const Sample_t *expected = &recorded[(numRecorded - count + i) % TIME_SYNC_MAX_SAMPLES];
+        int32_t error = (int32_t)(decoded[i].seconds - expected->seconds);
+
+        assert(abs(error) <= TIME_SYNC_SERIES_JITTER_S);
+        assert(decoded[i].level == expected->level);
+    }
+    *numSamples = count;
+    return records;
+}
+
+static void testRegularSamplesMakeOneRecord(void) {
+    const int8_t jitter[] = { 0, 2, -1, 1 };
+    uint8_t block[256];
+    uint8_t numSamples;
+    size_t size;
+
+    setUp();
+    recordSamples(100, 900, 24, jitter);
+    size = buildTimedSampleSeries(block, sizeof(block));
+    assert(size == CAYENNE_LPP_ANALOG_SERIES_SIZE(24));
+    assert(checkSeries(block, size, TIME_SYNC_SERIES_CHANNEL_UNSYNCED, &numSamples) == 1 && numSamples == 24);
+    assert(block[7] == (900 >> 8) && block[8] == (900 & 0xFF));
+
+    /* Against the per-sample time tags of the block format */
+    assert(size < buildTimedSampleBlock(block, sizeof(block)));
+    assert(buildTimedSampleBlock(block, sizeof(block)) == TIME_SYNC_BLOCK_HEADER_SIZE + (24 * TIME_SYNC_BLOCK_RECORD_SIZE));
+    printf("    24 samples: series %u bytes, time-tagged block %u bytes\n",
+           (unsigned)size, (unsigned)(TIME_SYNC_BLOCK_HEADER_SIZE + (24 * TIME_SYNC_BLOCK_RECORD_SIZE)));
+}
+
+static void testOffGridSampleStartsANewRecord(void) {
+    uint8_t block[256];
+    uint8_t numSamples;
+    size_t size;
+
+    setUp();
+    recordSamples(0, 600, 5, NULL);
+    /* One sample missed, then the schedule moved by a minute */
+    recordSamples(3600, 600, 3, NULL);
+    recordSamples(3600 + (3 * 600) + 60, 600, 2, NULL);
+    size = buildTimedSampleSeries(block, sizeof(block));
+    assert(checkSeries(block, size, TIME_SYNC_SERIES_CHANNEL_UNSYNCED, &numSamples) == 3 && numSamples == 10);
+    assert(size == CAYENNE_LPP_ANALOG_SERIES_SIZE(5) + CAYENNE_LPP_ANALOG_SERIES_SIZE(3) + CAYENNE_LPP_ANALOG_SERIES_SIZE(2));
+}
+
+static void testNewestSamplesKeptWhenShort(void) {
+    uint8_t block[256];
+    uint8_t numSamples;
+    size_t size;
+
+    setUp();
+    recordSamples(0, 900, 20, NULL);
+    size = buildTimedSampleSeries(block, CAYENNE_LPP_ANALOG_SERIES_SIZE(6) + 1);
+    assert(size == CAYENNE_LPP_ANALOG_SERIES_SIZE(6));
+    assert(checkSeries(block, size, TIME_SYNC_SERIES_CHANNEL_UNSYNCED, &numSamples) == 1 && numSamples == 6);
+
+    /* Room for a single sample, then for none */
+    size = buildTimedSampleSeries(block, CAYENNE_LPP_ANALOG_SERIES_SIZE(1));
+    assert(checkSeries(block, size, TIME_SYNC_SERIES_CHANNEL_UNSYNCED, &numSamples) == 1 && numSamples == 1);
+    assert(buildTimedSampleSeries(block, CAYENNE_LPP_ANALOG_SERIES_SIZE(1) - 1) == 0);
+}
+
+static void testBufferKeepsTheNewestSamples(void) {
+    uint8_t block[256];
+    uint8_t numSamples;
+    size_t size;
+
+    setUp();
+    recordSamples(0, 300, TIME_SYNC_MAX_SAMPLES + 8, NULL);
+    size = buildTimedSampleSeries(block, sizeof(block));
+    assert(checkSeries(block, size, TIME_SYNC_SERIES_CHANNEL_UNSYNCED, &numSamples) == 1);
+    assert(numSamples == TIME_SYNC_MAX_SAMPLES);
+    /* Base time of the oldest kept sample */
+    assert(block[3] == 0 && block[4] == 0 && ((block[5] << 8) | block[6]) == 8 * 300);
+
+    clearTimedSamples();
+    assert(buildTimedSampleSeries(block, sizeof(block)) == 0);
+}
+
+static void testSyncMovesTheSamplesToUnixTime(void) {
+    uint8_t block[256];
+    uint8_t numSamples;
+    size_t size;
+
+    setUp();
+    recordSamples(0, 900, 4, NULL);
+
+    /* DeviceTimeAns: the samples already taken follow the step */
+    fakeSysTime.Seconds = fakeMcuTime.Seconds + UNIX_OFFSET_S;
+    timeSyncOnUpdate();
+    for (uint8_t i = 0; i < numRecorded; i++) {
+        recorded[i].seconds += UNIX_OFFSET_S;
+    }
+    recordSamples(4 * 900, 900, 4, NULL);
+
+    size = buildTimedSampleSeries(block, sizeof(block));
+    assert(checkSeries(block, size, TIME_SYNC_SERIES_CHANNEL, &numSamples) == 1 && numSamples == 8);
+}
+
+int main(void) {
+    printf("test_time_series\n");
+    RUN_TEST(testRegularSamplesMakeOneRecord);
+    RUN_TEST(testOffGridSampleStartsANewRecord);
+    RUN_TEST(testNewestSamplesKeptWhenShort);
+    RUN_TEST(testBufferKeepsTheNewestSamples);
+    RUN_TEST(testSyncMovesTheSamplesToUnixTime);
+    return 0;
+}
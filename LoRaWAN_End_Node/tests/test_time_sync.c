@@ -0,0 +1,248 @@
+/**
+ * @file test_time_sync.c
+ * @brief DeviceTimeReq clock sync against a drifting RTC: steps, drift estimate, request interval, time-tagged block
+ */
+
+#include "fakes.h"
+#include "PWX_TimeSync.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define UNIX_OFFSET_MS      1700000000000LL
+#define HOUR_MS             (3600LL * 1000)
+#define DAY_MS              (24 * HOUR_MS)
+
+static int64_t trueMs;          // time since boot, as the network sees it
+static int32_t rtcDriftPpb;     // positive: the RTC runs slow
+static int64_t sysOffsetMs;     // what SysTimeSet() added to the MCU time
+
+static SysTime_t fromMs(int64_t ms) {
+    return (SysTime_t){ (uint32_t)(ms / 1000), (int16_t)(ms % 1000) };
+}
+
+static int64_t mcuMs(void) {
+    return trueMs - ((trueMs * rtcDriftPpb) / 1000000000LL);
+}
+
+static int64_t unixMs(void) {
+    return UNIX_OFFSET_MS + trueMs;
+}
+
+static void advance(int64_t ms) {
+    trueMs += ms;
+    fakeMcuTime = fromMs(mcuMs());
+    fakeSysTime = fromMs(mcuMs() + sysOffsetMs);
+}
+
+/* DeviceTimeAns: the MAC sets the network time, at its 1/256 s resolution */
+static void sync(void) {
+    int64_t networkMs = ((unixMs() * 256) / 1000) * 1000 / 256;
+
+    sysOffsetMs = networkMs - mcuMs();
+    advance(0);
+    timeSyncOnUpdate();
+}
+
+/* Compensated clock against network time, in s */
+static int64_t clockError(void) {
+    return (int64_t)getSyncedSeconds() - (unixMs() / 1000);
+}
+
+static void setUp(int32_t driftPpb) {
+    fakeReset();
+    trueMs = 0;
+    rtcDriftPpb = driftPpb;
+    sysOffsetMs = 0;
+    advance(5000);
+    initTimeSync();
+}
+
+static uint32_t readU32(const uint8_t *buffer) {
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+static uint16_t readU16(const uint8_t *buffer) {
+    return (uint16_t)((buffer[0] << 8) | buffer[1]);
+}
+
+static void testRequestedUntilTheFirstAnswer(void) {
+    setUp(20000);
+    assert(isTimeSyncDue() && !isTimeSynced());
+    advance(DAY_MS);
+    assert(isTimeSyncDue());
+    /* Seconds since boot, on the RTC */
+    assert(getSyncedSeconds() == (uint32_t)(mcuMs() / 1000));
+
+    sync();
+    assert(isTimeSynced() && !isTimeSyncDue());
+    assert(llabs(clockError()) <= 1);
+    /* One answer does not measure anything */
+    assert(getTimeSyncDriftPpb() == 0);
+    advance((TIME_SYNC_MIN_INTERVAL_S * 1000) - 1000);
+    assert(!isTimeSyncDue());
+    advance(2000);
+    assert(isTimeSyncDue());
+}
+
+static void testDriftIsMeasuredAndCompensated(void) {
+    const int32_t drifts[] = { 20000, -35000, 3000 };
+
+    for (uint8_t d = 0; d < sizeof(drifts) / sizeof(drifts[0]); d++) {
+        int64_t uncorrected;
+
+        setUp(drifts[d]);
+        sync();
+        advance(TIME_SYNC_MIN_INTERVAL_S * 1000);
+        sync();
+        /* The answer resolution over the span */
+        assert(abs(getTimeSyncDriftPpb() - drifts[d]) <= 400);
+
+        /* Three days later the RTC alone is off by seconds, the compensated clock is not */
+        advance(3 * DAY_MS);
+        uncorrected = ((mcuMs() + sysOffsetMs) / 1000) - (unixMs() / 1000);
+        assert(llabs(clockError()) <= 1);
+        assert(llabs(uncorrected) >= (int64_t)llabs(drifts[d]) * 3 * 86400 / 1000000000LL - 1);
+    }
+}
+
+static void testShortSpansAreNotMeasured(void) {
+    setUp(50000);
+    sync();
+    /* An answer within the minimum span only corrects the clock */
+    advance((TIME_SYNC_MIN_DRIFT_SPAN_S * 1000) / 2);
+    sync();
+    assert(getTimeSyncDriftPpb() == 0);
+
+    /* The span runs from the first answer, not the short one, and is counted on the RTC */
+    advance(((TIME_SYNC_MIN_DRIFT_SPAN_S * 1000) / 2) + 60000);
+    sync();
+    assert(abs(getTimeSyncDriftPpb() - 50000) <= 2300);
+}
+
+static void testBogusSpanIsIgnored(void) {
+    setUp(10000);
+    sync();
+    advance(TIME_SYNC_MIN_INTERVAL_S * 1000);
+    sync();
+    assert(abs(getTimeSyncDriftPpb() - 10000) <= 400);
+
+    /* The network clock jumped by a minute: 2800 ppm over the span, not a drift */
+    advance(TIME_SYNC_MIN_INTERVAL_S * 1000);
+    trueMs += 60000;
+    sync();
+    assert(abs(getTimeSyncDriftPpb() - 10000) <= 400);
+    assert(llabs(clockError()) <= 1);
+
+    /* The next span starts after the jump */
+    advance(TIME_SYNC_MIN_INTERVAL_S * 1000);
+    sync();
+    assert(abs(getTimeSyncDriftPpb() - 10000) <= 400);
+}
+
+static void testIntervalStretchesAsTheDriftIsKnown(void) {
+    int64_t interval;
+
+    /* 20 ppm, a quarter of it left after compensation: 1 s is reached in 200000 s */
+    setUp(20000);
+    sync();
+    advance(TIME_SYNC_MIN_INTERVAL_S * 1000);
+    sync();
+    interval = 0;
+    while (!isTimeSyncDue()) {
+        advance(HOUR_MS);
+        interval += HOUR_MS;
+        assert(llabs(clockError()) <= 1);
+    }
+    assert(interval > 190000LL * 1000 && interval <= (200000LL * 1000) + (2 * HOUR_MS));
+
+    /* A quartz within a fraction of a ppm: once a week */
+    setUp(50);
+    sync();
+    advance(TIME_SYNC_MIN_INTERVAL_S * 1000);
+    sync();
+    advance((TIME_SYNC_MAX_INTERVAL_S * 1000) - HOUR_MS);
+    assert(!isTimeSyncDue());
+    /* Elapsed time is counted on the RTC */
+    advance(HOUR_MS + 60000);
+    assert(isTimeSyncDue());
+
+    /* A poor one: every 6 h */
+    setUp(190000);
+    sync();
+    advance(TIME_SYNC_MIN_INTERVAL_S * 1000);
+    sync();
+    advance((TIME_SYNC_MIN_INTERVAL_S * 1000) + 60000);
+    assert(isTimeSyncDue());
+}
+
+static void testMonthOfSyncsStaysWithinTolerance(void) {
+    uint32_t syncs = 0;
+
+    setUp(-25000);
+    for (int64_t t = 0; t < 30 * DAY_MS; t += 15 * 60 * 1000) {
+        if (isTimeSyncDue()) {
+            sync();
+            syncs++;
+        }
+        assert(llabs(clockError()) <= (TIME_SYNC_TOLERANCE_MS / 1000) + 1);
+        advance(15 * 60 * 1000);
+    }
+    /* Against one request every 6 h */
+    assert(syncs < (30 * 24) / 6 / 4);
+    assert(abs(getTimeSyncDriftPpb() + 25000) <= 200);
+}
+
+static void testBlockCarriesRelativeTimestamps(void) {
+    uint8_t block[256];
+    size_t size;
+    uint32_t base;
+
+    setUp(20000);
+    /* Before the first answer, seconds since boot */
+    for (uint8_t i = 0; i < 4; i++) {
+        recordTimedSample((uint16_t)(100 + i));
+        advance(15 * 60 * 1000);
+    }
+    size = buildTimedSampleBlock(block, sizeof(block));
+    assert(size == TIME_SYNC_BLOCK_HEADER_SIZE + (4 * TIME_SYNC_BLOCK_RECORD_SIZE));
+    assert(readU32(block) == 5 && block[4] == 0 && block[5] == 4);
+
+    /* The answer moves the samples to Unix time */
+    sync();
+    recordTimedSample(200);
+    size = buildTimedSampleBlock(block, sizeof(block));
+    base = readU32(block);
+    assert(block[4] == TIME_SYNC_FLAG_SYNCED && block[5] == 5);
+    assert(llabs((int64_t)base - ((UNIX_OFFSET_MS + 5000) / 1000)) <= 1);
+    for (uint8_t i = 0; i < 5; i++) {
+        const uint8_t *record = &block[TIME_SYNC_BLOCK_HEADER_SIZE + (i * TIME_SYNC_BLOCK_RECORD_SIZE)];
+
+        assert(abs((int32_t)readU16(record) - (i * 900)) <= 1);
+        assert(readU16(record + 2) == ((i < 4) ? 100 + i : 200));
+    }
+
+    /* The newest that fit, and only those within the u16 reach of the base */
+    size = buildTimedSampleBlock(block, TIME_SYNC_BLOCK_HEADER_SIZE + (2 * TIME_SYNC_BLOCK_RECORD_SIZE) + 3);
+    assert(size == TIME_SYNC_BLOCK_HEADER_SIZE + (2 * TIME_SYNC_BLOCK_RECORD_SIZE) && block[5] == 2);
+    assert(readU16(&block[TIME_SYNC_BLOCK_HEADER_SIZE + TIME_SYNC_BLOCK_RECORD_SIZE + 2]) == 200);
+    advance(20 * HOUR_MS);
+    recordTimedSample(300);
+    size = buildTimedSampleBlock(block, sizeof(block));
+    assert(block[5] == 1 && size == TIME_SYNC_BLOCK_HEADER_SIZE + TIME_SYNC_BLOCK_RECORD_SIZE);
+    assert(readU16(&block[TIME_SYNC_BLOCK_HEADER_SIZE]) == 0 && readU16(&block[TIME_SYNC_BLOCK_HEADER_SIZE + 2]) == 300);
+
+    clearTimedSamples();
+    assert(buildTimedSampleBlock(block, sizeof(block)) == 0);
+}
+
+int main(void) {
+    printf("test_time_sync\n");
+    RUN_TEST(testRequestedUntilTheFirstAnswer);
+    RUN_TEST(testDriftIsMeasuredAndCompensated);
+    RUN_TEST(testShortSpansAreNotMeasured);
+    RUN_TEST(testBogusSpanIsIgnored);
+    RUN_TEST(testIntervalStretchesAsTheDriftIsKnown);
+    RUN_TEST(testMonthOfSyncsStaysWithinTolerance);
+    RUN_TEST(testBlockCarriesRelativeTimestamps);
+    return 0;
+}
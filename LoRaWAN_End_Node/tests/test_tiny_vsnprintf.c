@@ -0,0 +1,92 @@
+/**
+ * @file test_tiny_vsnprintf.c
+ * @brief Fixed point %q of tiny_vsnprintf_like() and the FIXED_POINT() rounding
+ */
+
+#include "fakes.h"
+#include "stm32_tiny_vsnprintf.h"
+#include <limits.h>
+#include <string.h>
+
+static char output[32];
+
+static const char *format(int size, const char *fmt, ...) {
+    va_list args;
+    int length;
+
+    va_start(args, fmt);
+    length = tiny_vsnprintf_like(output, size, fmt, args);
+    va_end(args);
+    assert(length == (int)strlen(output) && length < size);
+    return output;
+}
+
+#define CHECK(expected, fmt, ...)  assert(strcmp(format(sizeof(output), fmt, __VA_ARGS__), expected) == 0)
+
+static void testPrecision(void) {
+    CHECK("12.345", "%.3q", 12345);
+    CHECK("1.2345", "%.4q", 12345);
+    CHECK("12345", "%.0q", 12345);
+    CHECK("123.45", "%q", 12345);
+    CHECK("0.000000012", "%.9q", 12);
+    /* Above 9 digits the precision is clamped */
+    CHECK("0.000000012", "%.12q", 12);
+}
+
+static void testLeadingZerosOfTheFraction(void) {
+    CHECK("0.005", "%.3q", 5);
+    CHECK("0.050", "%.3q", 50);
+    CHECK("1.005", "%.3q", 1005);
+    CHECK("0.000", "%.3q", 0);
+}
+
+static void testNegativeValues(void) {
+    /* Above -1 the sign is still printed */
+    CHECK("-0.005", "%.3q", -5);
+    CHECK("-0.999", "%.3q", -999);
+    CHECK("-12.345", "%.3q", -12345);
+    CHECK("-12345", "%.0q", -12345);
+    CHECK("-2147483.648", "%.3q", INT_MIN);
+    CHECK("2147483.647", "%.3q", INT_MAX);
+}
+
+static void testWidthAndZeroPadding(void) {
+    CHECK("  12.34", "%7.2q", 1234);
+    CHECK(" -12.34", "%7.2q", -1234);
+    CHECK("0012.34", "%07.2q", 1234);
+    CHECK("-012.34", "%07.2q", -1234);
+    /* Narrower than the value: not cut */
+    CHECK("-12.34", "%3.2q", -1234);
+    CHECK("L=-0.250 m, I=1.0000 A", "L=%.3q m, I=%.4q A", -250, 10000);
+}
+
+static void testTruncatedToTheBuffer(void) {
+    assert(strcmp(format(6, "%.3q", -12345), "-12.3") == 0);
+    assert(strcmp(format(5, "x%.3q", 12345), "x12.") == 0);
+}
+
+static void testFixedPointRounding(void) {
+    /* Halves round away from zero, on both sides */
+    assert(FIXED_POINT(0.0625f, 1000) == 63);
+    assert(FIXED_POINT(-0.0625f, 1000) == -63);
+    assert(FIXED_POINT(0.0624f, 1000) == 62);
+    assert(FIXED_POINT(-0.0624f, 1000) == -62);
+    assert(FIXED_POINT(2.5f, 1) == 3 && FIXED_POINT(-2.5f, 1) == -3);
+    assert(FIXED_POINT(-0.4f, 1) == 0);
+    assert(FIXED_POINT(12.3456f, 10000) == 123456);
+
+    CHECK("-0.063", "%.3q", FIXED_POINT(-0.0625f, 1000));
+    CHECK("-1.2346", "%.4q", FIXED_POINT(-1.23456f, 10000));
+    CHECK("3.300", "%.3q", FIXED_POINT(3.2996f, 1000));
+}
+
+int main(void) {
+    printf("test_tiny_vsnprintf\n");
+    RUN_TEST(testPrecision);
+    RUN_TEST(testLeadingZerosOfTheFraction);
+    RUN_TEST(testNegativeValues);
+    RUN_TEST(testWidthAndZeroPadding);
+    RUN_TEST(testTruncatedToTheBuffer);
+    RUN_TEST(testFixedPointRounding);
+    return 0;
+}
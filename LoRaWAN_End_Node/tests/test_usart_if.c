@@ -0,0 +1,235 @@
+/**
+ * @file test_usart_if.c
+ * @brief LPUART1 console: characters across STOP2 wake-ups, one line per sequencer task, busy and overlong lines
+ */
+
+#include "fakes.h"
+#include "usart_if.h"
+#include "stm32_seq.h"
+#include "utilities_def.h"
+#include <string.h>
+
+extern uint8_t charRx;
+
+static uint32_t linesPosted;
+static bool isLinePending;
+static uint32_t dmaInits;
+static uint32_t stopEntries;
+
+/* Stands in for usart.c */
+UART_HandleTypeDef hlpuart1;
+DMA_HandleTypeDef hdma_lpuart1_tx;
+
+void MX_LPUART1_UART_Init(void) {
+    assert(0);
+}
+
+void HAL_UART_MspDeInit(UART_HandleTypeDef *uartHandle) {
+    assert(0);
+}
+
+/* Stands in for dma.c */
+void MX_DMA_Init(void) {
+    assert(0);
+}
+
+/* Stands in for the HAL; the console is not brought up, only received on */
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma) {
+    assert(hdma == &hdma_lpuart1_tx);
+    dmaInits++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size) {
+    assert(0);
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_StopModeWakeUpSourceConfig(UART_HandleTypeDef *huart, UART_WakeUpTypeDef WakeUpSelection) {
+    assert(0);
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_EnableStopMode(UART_HandleTypeDef *huart) {
+    assert(0);
+    return HAL_ERROR;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn) {
+    assert(0);
+}
+
+void HAL_NVIC_SystemReset(void) {
+    assert(0);
+}
+
+/* Stands in for stm32_seq.c */
+void UTIL_SEQ_SetTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Task_Prio) {
+    assert(TaskId_bm == (1 << CFG_SEQ_Task_CliLineEvent));
+    linesPosted++;
+    isLinePending = true;
+}
+
+/* Stands in for PWX_ST50H_Modbus.c and PWX_ModbusMonitoring.c, the commands not run here */
+void Modbus_RxCallback(ModBus_t *_ModbusResponse) {
+}
+
+void clearModbusParams(uint8_t devId) {
+    assert(0);
+}
+
+void initMonitoringSlotParams(uint8_t slotId) {
+    assert(0);
+}
+
+void viewMonitoringSlotParams(uint8_t slotId) {
+    assert(0);
+}
+
+void initMonitorSlot(uint8_t ID, uint8_t *modbusCMD, uint8_t cmdSize, uint8_t dataType, uint8_t valueStartIndex,
+                     uint16_t ThresholdActive, VarData_u SpikeUp, VarData_u SpikeDown, VarData_u thresholdHigh,
+                     VarData_u thresholdLow, bool onChange, bool triggerFlagValue) {
+    assert(0);
+}
+
+/* The LPUART is retained in STOP2, PWR_ExitStopMode() only resumes vcom */
+static void stop2(void) {
+    stopEntries++;
+    vcom_Resume();
+}
+
+/* A character on the wire is lost unless a reception is armed for it */
+static void receive(char c) {
+    assert(fakeConsoleRx == &charRx);
+    fakeConsoleRx = NULL;
+    charRx = (uint8_t)c;
+    HAL_UART_RxCpltCallback(&hlpuart1);
+}
+
+/* Every start bit wakes the MCU, which goes back to STOP2 before the next one */
+static void type(const char *text) {
+    while (*text != '\0') {
+        receive(*text++);
+        stop2();
+    }
+}
+
+/* UTIL_SEQ_Run() */
+static void runTask(void) {
+    if (isLinePending) {
+        isLinePending = false;
+        vcom_ProcessCommandLine();
+    }
+}
+
+static void setUp(void) {
+    fakeReset();
+    linesPosted = 0;
+    isLinePending = false;
+    dmaInits = 0;
+    stopEntries = 0;
+    isConfigMode = false;
+    hlpuart1.Instance = LPUART1;
+    hlpuart1.ErrorCode = HAL_UART_ERROR_NONE;
+    /* As vcom_ReceiveInit() leaves it */
+    HAL_UART_Receive_IT(&hlpuart1, &charRx, 1);
+}
+
+static void testLineIsPostedOnItsEnd(void) {
+    setUp();
+    type("set config on");
+    assert(linesPosted == 0 && !isConfigMode);
+    type("\n");
+    assert(linesPosted == 1 && !isConfigMode);
+    runTask();
+    assert(isConfigMode);
+
+    type("set config off\n");
+    runTask();
+    assert(linesPosted == 2 && !isConfigMode);
+
+    /* An empty line is posted but is not a command */
+    type("\n");
+    runTask();
+    assert(linesPosted == 3 && !isConfigMode);
+}
+
+static void testNoCharacterLostAcrossStop2(void) {
+    const uint8_t devEui[] = { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x05, 0x12, 0x34 };
+    const uint8_t appEui[] = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF };
+    const uint8_t appKey[] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                               0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+    const char *session[] = {
+        "set config on\r\n",
+        "set deveui 70B3D57ED0051234\r\n",
+        "set appeui 0123456789ABCDEF\r\n",
+        "set appkey 2B7E151628AED2A6ABF7158809CF4F3C\r\n",
+        "set lora-tx interval 900\r\n",
+        "set modbus-hb interval 3600\r\n",
+        "save lora-config\r\n",
+        "set config off\r\n",
+    };
+    uint32_t characters = 0;
+
+    setUp();
+    for (uint8_t line = 0; line < sizeof(session) / sizeof(session[0]); line++) {
+        type(session[line]);
+        runTask();
+        characters += (uint32_t)strlen(session[line]);
+    }
+    assert(linesPosted == sizeof(session) / sizeof(session[0]) && stopEntries == characters);
+    /* Resumed without re-initialising the LPUART, which would drop what it holds */
+    assert(fakeUartInits == 0 && dmaInits == stopEntries);
+
+    assert(memcmp(fakeConfigPage.SeNvmDevJoinKey.DevEui, devEui, sizeof(devEui)) == 0);
+    assert(memcmp(fakeConfigPage.SeNvmDevJoinKey.JoinEui, appEui, sizeof(appEui)) == 0);
+    for (uint8_t key = 0; key < 4; key++) {
+        assert(memcmp(fakeConfigPage.KeyList[key].KeyValue, appKey, sizeof(appKey)) == 0);
+    }
+    assert(fakeConfigPage.pwxTxInterval == 900 && fakeConfigPage.pwxHeartbeatInterval == 3600);
+    assert(!isConfigMode);
+}
+
+static void testLineWhileOneIsPendingIsDropped(void) {
+    setUp();
+    type("set config on\n");
+    /* The task has not run yet */
+    type("set config off\n");
+    assert(linesPosted == 1);
+    runTask();
+    assert(isConfigMode);
+
+    /* The next line after it is taken again */
+    type("set config off\n");
+    runTask();
+    assert(linesPosted == 2 && !isConfigMode);
+}
+
+static void testOverlongLineIsCut(void) {
+    char line[MAX_UART_BUFFER_SIZE + 50];
+
+    setUp();
+    /* Kept to the buffer, the rest is not stored */
+    memset(line, 'x', sizeof(line) - 2);
+    memcpy(line, "set config on", 13);
+    line[sizeof(line) - 2] = '\n';
+    line[sizeof(line) - 1] = '\0';
+    type(line);
+    assert(linesPosted == 1);
+    runTask();
+    assert(isConfigMode);
+
+    /* The next line starts from the beginning of the buffer */
+    type("set config off\n");
+    runTask();
+    assert(!isConfigMode);
+}
+
+int main(void) {
+    printf("test_usart_if\n");
+    RUN_TEST(testLineIsPostedOnItsEnd);
+    RUN_TEST(testNoCharacterLostAcrossStop2);
+    RUN_TEST(testLineWhileOneIsPendingIsDropped);
+    RUN_TEST(testOverlongLineIsCut);
+    return 0;
+}